@@ -1,29 +1,153 @@
 #version 450
 #extension GL_KHR_vulkan_glsl : enable
 
-layout(binding = 0) uniform MVP_UBO
+// material features, specialized per pipeline variant in the same order as Material::Feature
+layout(constant_id = 0) const bool NORMAL_MAP = false;
+layout(constant_id = 1) const bool EMISSIVE = false;
+layout(constant_id = 2) const bool ALPHA_MASK = false;
+layout(constant_id = 3) const bool UNLIT = false;
+
+layout(binding = 0) uniform CAMERA_UBO
 {
-    mat4 model;
     mat4 view;
     mat4 proj;
-} ubo;
+} camera;
 
 layout(binding = 1) uniform LIGHT_UBO
 {
-    vec4 ambient;
-    vec4 color;
-	vec3 position;
-} light;
+    vec4 ambient; // w is intensity
+    uvec4 grid; // clusters along x, y and z, w is the light count
+    vec4 slicing; // x and y turn the log of a view depth into its slice
+    uint firstLight;
+    uint firstCluster;
+    uint firstIndex;
+    uint padding;
+} lighting;
+
+struct Light
+{
+    vec4 position; // w is range
+    vec4 color; // w is intensity
+    vec4 direction; // spots only, w is the cosine of the outer angle
+    vec4 cone; // x is the cosine of the inner angle, y is 1 for spots
+};
+
+// every binding views the whole frame allocator, elements are indexed from its start
+layout(std430, binding = 2) readonly buffer LIGHTS { Light lights[]; };
+layout(std430, binding = 3) readonly buffer CLUSTERS { uvec2 clusters[]; }; // first index and count of the lights touching each cluster
+layout(std430, binding = 4) readonly buffer LIGHT_INDICES { uint lightIndices[]; };
 
-layout(binding = 2) uniform sampler2D albedoSampler;
+// every texture of the scene, the renderer defines BINDLESS_TEXTURES as the array size the device allows
+layout(set = 1, binding = 0) uniform sampler2D textures[BINDLESS_TEXTURES];
+
+layout(push_constant) uniform MATERIAL_PC
+{
+    vec4 emissiveFactor;
+    float alphaCutoff;
+    float emissiveStrength;
+    uint albedoTexture;
+    uint normalTexture;
+    uint emissiveTexture;
+} material;
 
 layout(location = 0) in vec3 inFragColor;
 layout(location = 1) in vec2 inFragTexCoord;
+layout(location = 2) in vec3 inFragNormal;
+layout(location = 3) in vec3 inFragPosition;
 
 layout(location = 0) out vec4 outColor;
 
+// applies the normal map, the tangent frame is derived from the screen-space derivatives as meshes have no tangents
+vec3 PerturbNormal(vec3 normal)
+{
+    vec3 dp1 = dFdx(inFragPosition);
+    vec3 dp2 = dFdy(inFragPosition);
+    vec2 duv1 = dFdx(inFragTexCoord);
+    vec2 duv2 = dFdy(inFragTexCoord);
+
+    vec3 dp2perp = cross(dp2, normal);
+    vec3 dp1perp = cross(normal, dp1);
+    vec3 tangent = dp2perp * duv1.x + dp1perp * duv2.x;
+    vec3 bitangent = dp2perp * duv1.y + dp1perp * duv2.y;
+    float scale = inversesqrt(max(max(dot(tangent, tangent), dot(bitangent, bitangent)), 1e-12));
+
+    vec3 sampled = texture(textures[material.normalTexture], inFragTexCoord).xyz * 2.0 - 1.0;
+    return normalize(mat3(tangent * scale, bitangent * scale, normal) * sampled);
+}
+
+// returns the diffuse light of the lights touching the fragment's cluster
+vec3 ClusterLighting(vec3 normal)
+{
+    if (lighting.grid.w == 0)
+    {
+        return vec3(0.0);
+    }
+
+    // the cluster is the screen tile the fragment is on and the depth slice it's in, as the lights were binned on the cpu
+    vec4 view = camera.view * vec4(inFragPosition, 1.0);
+    vec4 clip = camera.proj * view;
+    vec2 tile = clamp(floor((clip.xy / clip.w * 0.5 + 0.5) * vec2(lighting.grid.xy)), vec2(0.0), vec2(lighting.grid.xy - 1u));
+    float slice = clamp(floor(log(max(-view.z, 1e-6)) * lighting.slicing.x + lighting.slicing.y), 0.0, float(lighting.grid.z - 1u));
+    uvec2 cluster = clusters[lighting.firstCluster + (uint(slice) * lighting.grid.y + uint(tile.y)) * lighting.grid.x + uint(tile.x)];
+
+    vec3 diffuse = vec3(0.0);
+
+    for (uint i = 0; i < cluster.y; i++)
+    {
+        Light light = lights[lighting.firstLight + lightIndices[lighting.firstIndex + cluster.x + i]];
+        vec3 toLight = light.position.xyz - inFragPosition;
+        float distanceSquared = dot(toLight, toLight);
+        float rangeSquared = light.position.w * light.position.w;
+
+        if (distanceSquared >= rangeSquared)
+        {
+            continue;
+        }
+
+        // inverse square falloff windowed to reach zero at the light's range
+        vec3 direction = toLight * inversesqrt(max(distanceSquared, 1e-8));
+        float window = clamp(1.0 - (distanceSquared / rangeSquared) * (distanceSquared / rangeSquared), 0.0, 1.0);
+        float attenuation = window * window / (distanceSquared + 1.0);
+
+        if (light.cone.y > 0.5)
+        {
+            attenuation *= smoothstep(light.direction.w, light.cone.x, dot(-direction, light.direction.xyz));
+        }
+
+        diffuse += light.color.rgb * light.color.w * attenuation * max(dot(normal, direction), 0.0);
+    }
+
+    return diffuse;
+}
+
 void main()
 {
+    vec4 albedo = texture(textures[material.albedoTexture], inFragTexCoord);
+
+    if (ALPHA_MASK && albedo.a < material.alphaCutoff)
+    {
+        discard;
+    }
+
+    vec3 color = albedo.rgb;
+
     // light properties
-    outColor = texture(albedoSampler, inFragTexCoord);
+    if (!UNLIT)
+    {
+        vec3 normal = normalize(inFragNormal);
+
+        if (NORMAL_MAP)
+        {
+            normal = PerturbNormal(normal);
+        }
+
+        color *= lighting.ambient.rgb * lighting.ambient.w + ClusterLighting(normal);
+    }
+
+    if (EMISSIVE)
+    {
+        color += texture(textures[material.emissiveTexture], inFragTexCoord).rgb * material.emissiveFactor.rgb * material.emissiveStrength;
+    }
+
+    outColor = vec4(color, albedo.a);
 }
\ No newline at end of file
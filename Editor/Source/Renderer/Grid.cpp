@@ -21,7 +21,7 @@ namespace Cosmos
 		for (size_t i = 0; i < RENDERER_MAX_FRAMES_IN_FLIGHT; i++)
 		{
 			vkDestroyBuffer(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mUniformBuffers[i], nullptr);
-			vkFreeMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mUniformBuffersMemory[i], nullptr);
+			VKAllocator::GetInstance()->Free(mUniformBuffersMemory[i]);
 		}
 		
 		vkDestroyDescriptorPool(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mDescriptorPool, nullptr);
@@ -76,9 +76,13 @@ namespace Cosmos
 
 		// create pipeline
 		{
-			// shaders
-			Unique<VKShader> vShader = CreateUnique<VKShader>(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(), VKShader::Type::Vertex, "Grid.vert", GetAssetSubDir("Shaders/grid.vert"));
-			Unique<VKShader> fShader = CreateUnique<VKShader>(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(), VKShader::Type::Fragment, "Grid.frag", GetAssetSubDir("Shaders/grid.frag"));
+			// shaders, both compiled at once
+			std::future<Shared<VKShader>> vShaderLoad = VKShader::CreateAsync(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(), VKShader::Type::Vertex, "Grid.vert", GetAssetSubDir("Shaders/grid.vert"));
+			std::future<Shared<VKShader>> fShaderLoad = VKShader::CreateAsync(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(), VKShader::Type::Fragment, "Grid.frag", GetAssetSubDir("Shaders/grid.frag"));
+			Shared<VKShader> vShader = vShaderLoad.get();
+			Shared<VKShader> fShader = fShaderLoad.get();
+			LOG_ASSERT(vShader->IsValid(), "Failed to compile shader %s. Details: %s", vShader->GetPathRef().c_str(), vShader->GetErrorRef().c_str());
+			LOG_ASSERT(fShader->IsValid(), "Failed to compile shader %s. Details: %s", fShader->GetPathRef().c_str(), fShader->GetErrorRef().c_str());
 
 			// constants
 			const std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
@@ -133,7 +137,7 @@ namespace Cosmos
 					&mUniformBuffersMemory[i]
 				);
 
-				vkMapMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mUniformBuffersMemory[i], 0, sizeof(ModelViewProjection_BufferObject), 0, &mUniformBuffersMapped[i]);
+				mUniformBuffersMapped[i] = mUniformBuffersMemory[i].mapped;
 			}
 		}
 
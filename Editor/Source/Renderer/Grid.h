@@ -51,7 +51,7 @@ namespace Cosmos
 		VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
 
 		std::vector<VkBuffer> mUniformBuffers;
-		std::vector<VkDeviceMemory> mUniformBuffersMemory;
+		std::vector<VKAllocation> mUniformBuffersMemory;
 		std::vector<void*> mUniformBuffersMapped;
 	};
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "SceneHierarchy.h"
 #include "Renderer/Grid.h"
 
+#include <random>
+
 namespace Cosmos
 {
 	Mainmenu::Mainmenu(std::unique_ptr<Project>& project, Grid* grid, SceneHierarchy* sceneHierarchy)
@@ -32,10 +34,68 @@ namespace Cosmos
 		ImGuiWindowFlags flags = {};
 
 		auto camera = Application::GetInstance()->GetCamera();
+		Shared<VKRenderer> renderer = std::dynamic_pointer_cast<VKRenderer>(Application::GetInstance()->GetRenderer());
 
 		ImGui::Begin("Info", nullptr, flags);
 		ImGui::Text(ICON_FA_INFO_CIRCLE " FPS: %d", Application::GetInstance()->GetFPSSystem()->GetFPS());
 		ImGui::Text(ICON_FA_INFO_CIRCLE " Timestep: %f", Application::GetInstance()->GetFPSSystem()->GetTimestep());
+
+		Shared<VKResidency> residency = renderer->GetResidency();
+		ImGui::Text(ICON_FA_INFO_CIRCLE " VRAM: %.1f / %.1f MB", residency->GetUsage() / (1024.0f * 1024.0f), residency->GetBudget() / (1024.0f * 1024.0f));
+
+		VKAllocator::Stats memory = renderer->GetAllocator()->GetStats();
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Memory Blocks: %d (%.1f / %.1f MB), %d dedicated", memory.blockCount, memory.usedBytes / (1024.0f * 1024.0f), memory.blockBytes / (1024.0f * 1024.0f), memory.dedicatedCount);
+
+		const VKGeometryPool::Stats& geometry = renderer->GetGeometryPool()->GetStats();
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Geometry: %u meshes, %u / %u vertices, %u / %u indices", geometry.ranges, geometry.usedVertices, geometry.vertexCapacity, geometry.usedIndices, geometry.indexCapacity);
+
+		Shared<VKBindless> bindless = renderer->GetBindless();
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Textures: %u / %u bindless slots", bindless->GetRegisteredCount(), bindless->GetCapacity());
+
+		const Scene::RenderStats& render = Application::GetInstance()->GetActiveScene()->GetRenderStats();
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Draws: %d (%d models in %d batches), %.2fms", render.drawCalls, render.instances, render.batches, render.milliseconds);
+
+		if (OcclusionRasterizer* occlusion = Application::GetInstance()->GetActiveScene()->GetOcclusion())
+		{
+			const OcclusionRasterizer::Stats& software = occlusion->GetStats();
+			ImGui::Text(ICON_FA_INFO_CIRCLE " Software Occlusion: %u occluders (%u primitives), %u / %u models hidden, %.2fms", software.occluders, software.primitives, software.occluded, software.tested, software.milliseconds);
+		}
+
+		const LightClusters::Stats& lighting = Application::GetInstance()->GetActiveScene()->GetLightClusters().GetStats();
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Lights: %u (%u visible), %u cluster entries, at most %u per cluster, %.2fms", lighting.lights, lighting.visible, lighting.indices, lighting.crowded, lighting.milliseconds);
+
+		const VKCuller::Stats& culling = renderer->GetCuller()->GetStats();
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Culling: %u models, %u outside the frustum, %u occluded, %u drawn early, %u drawn late", culling.objects, culling.frustumCulled, culling.occluded, culling.drawnEarly, culling.drawnLate);
+
+		const VKRenderQueue::Stats& binds = renderer->GetRenderQueue()->GetStats();
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Binds: %u pipelines, %u sets, %u buffers, %u pushes (%u skipped)", binds.pipelineBinds, binds.descriptorBinds, binds.vertexBufferBinds, binds.pushConstants, binds.skipped);
+
+		const VKRenderGraph::Stats& graph = renderer->GetRenderGraph()->GetStats();
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Passes: %u (%u culled), %u barriers, %u transient images (%u aliased) in %.2fMB", graph.passes, graph.culled, graph.barriers, graph.transients, graph.aliased, (double)graph.transientBytes / (1024.0 * 1024.0));
+
+		Shared<VKGpuProfiler> gpuProfiler = renderer->GetGpuProfiler();
+
+		if (!gpuProfiler->IsSupported())
+		{
+			ImGui::Text(ICON_FA_INFO_CIRCLE " GPU: timestamps unsupported");
+		}
+
+		else if (ImGui::TreeNodeEx("GPU", 0, ICON_FA_INFO_CIRCLE " GPU: %.2fms%s", gpuProfiler->GetFrameMilliseconds(), gpuProfiler->IsCalibrated() ? "" : " (uncalibrated)"))
+		{
+			for (const VKGpuProfiler::Result& result : gpuProfiler->GetResults())
+			{
+				ImGui::Text("%*s%s: %.3fms", (int)result.depth * 2, "", result.name.c_str(), result.milliseconds);
+			}
+
+			ImGui::TreePop();
+		}
+
+		const VKFramePacer::Stats& pacing = renderer->GetFramePacer()->GetStats();
+		const char* presentMode = renderer->GetSwapchain()->GetPresentMode() == VK_PRESENT_MODE_FIFO_KHR ? "fifo" : renderer->GetSwapchain()->GetPresentMode() == VK_PRESENT_MODE_MAILBOX_KHR ? "mailbox" : "immediate";
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Frames: %.2fms +- %.2fms (at most %.2fms), %u in flight, %s", pacing.frameMilliseconds, pacing.frameDeviation, pacing.frameMaximum, renderer->GetFramesInFlight(), presentMode);
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Pacing: %.2fms cpu, %.2fms gpu, %.2fms waiting, %.2fms acquiring, %.2fms presenting", pacing.cpuMilliseconds, pacing.gpuMilliseconds, pacing.waitMilliseconds, pacing.acquireMilliseconds, pacing.presentMilliseconds);
+		ImGui::Text(ICON_FA_INFO_CIRCLE " Latency: %.2fms from input to gpu finish%s", pacing.latencyMilliseconds, pacing.latencyEstimated ? " (estimated)" : "");
+
 		ImGui::Text(ICON_FA_CAMERA " Camera Pos: %.2f %.2f %.2f", camera->GetPositionRef().x, camera->GetPositionRef().y, camera->GetPositionRef().z);
 		ImGui::Text(ICON_FA_CAMERA " Camera Rot: %.2f %.2f %.2f", camera->GetRotationRef().x, camera->GetRotationRef().y, camera->GetRotationRef().z);
 
@@ -56,6 +116,13 @@ namespace Cosmos
 			if (ImGui::MenuItem("Save")) mMenuAction = Action::Save;
 		
 			ImGui::Separator();
+
+			if (ImGui::MenuItem("Cook Textures")) mMenuAction = Action::CookTextures;
+			if (ImGui::MenuItem("Build Asset Archive")) mMenuAction = Action::BuildArchive;
+
+			ImGui::Separator();
+
+			if (ImGui::MenuItem("Light Benchmark")) mMenuAction = Action::LightBenchmark;
 		
 			ImGui::EndMenu();
 		}
@@ -67,6 +134,14 @@ namespace Cosmos
 				mGrid->ToogleOnOff();
 			}
 
+			// the scene owns the rasterizer, the checkbox follows it
+			bool softwareOcclusion = Application::GetInstance()->GetActiveScene()->GetOcclusion() != nullptr;
+
+			if (CheckboxSliderEx("Software Occlusion", &softwareOcclusion))
+			{
+				Application::GetInstance()->GetActiveScene()->SetSoftwareOcclusion(softwareOcclusion);
+			}
+
 			ImGui::EndMenu();
 		}
 
@@ -77,6 +152,39 @@ namespace Cosmos
 				mDisplaySceneSettings = true;
 			}
 
+			ImGui::Separator();
+
+			// more frames in flight keep the gpu busier, fewer show the input sooner
+			Shared<VKRenderer> renderer = std::dynamic_pointer_cast<VKRenderer>(Application::GetInstance()->GetRenderer());
+			int32_t framesInFlight = (int32_t)renderer->GetFramesInFlight();
+
+			if (ImGui::SliderInt("Frames In Flight", &framesInFlight, 1, RENDERER_MAX_FRAMES_IN_FLIGHT))
+			{
+				renderer->SetFramesInFlight((uint32_t)framesInFlight);
+			}
+
+			const char* presentModes[] = { "Fifo", "Mailbox", "Immediate" };
+			VkPresentModeKHR presentModeValues[] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+			int32_t presentMode = 0;
+
+			for (int32_t i = 0; i < 3; i++)
+			{
+				if (presentModeValues[i] == renderer->GetSwapchain()->GetRequestedPresentMode())
+					presentMode = i;
+			}
+
+			if (ImGui::Combo("Present Mode", &presentMode, presentModes, 3))
+			{
+				renderer->SetPresentMode(presentModeValues[presentMode]);
+			}
+
+			bool lowLatency = renderer->GetFramePacer()->IsLowLatency();
+
+			if (CheckboxSliderEx("Low Latency", &lowLatency))
+			{
+				renderer->GetFramePacer()->SetLowLatency(lowLatency);
+			}
+
 			ImGui::EndMenu();
 		}
 	}
@@ -110,9 +218,83 @@ namespace Cosmos
 				mProject->SaveAs();
 				break;
 			}
+
+			case Cosmos::Mainmenu::CookTextures:
+			{
+				TextureCooker::CookFolder(GetAssetDir());
+				break;
+			}
+
+			case Cosmos::Mainmenu::BuildArchive:
+			{
+				Archive::Build(GetAssetDir(), ASSET_ARCHIVE_PATH);
+				break;
+			}
+
+			case Cosmos::Mainmenu::LightBenchmark:
+			{
+				CreateLightBenchmark();
+				mSceneHierarchy->UnselectEntity();
+				break;
+			}
 		}
 	}
 
+	void Mainmenu::CreateLightBenchmark()
+	{
+		Application* application = Application::GetInstance();
+		Scene* scene = application->GetActiveScene();
+
+		// a floor with a grid of pillars, the pillars are a single batch
+		{
+			Entity* floor = scene->CreateEntity("Benchmark Floor");
+			floor->AddComponent<TransformComponent>().scale = glm::vec3(48.0f, 1.0f, 48.0f);
+			floor->AddComponent<ModelComponent>().model = CreateShared<Model>(application->GetRenderer(), application->GetCamera());
+			floor->GetComponent<ModelComponent>().model->LoadFromFile(GetAssetSubDir("Models/Primitive/plane.gltf"));
+		}
+
+		for (int32_t z = -5; z < 5; z++)
+		{
+			for (int32_t x = -5; x < 5; x++)
+			{
+				Entity* pillar = scene->CreateEntity("Benchmark Pillar");
+				auto& transform = pillar->AddComponent<TransformComponent>();
+				transform.translation = glm::vec3(x * 9.0f + 4.5f, 2.0f, z * 9.0f + 4.5f);
+				transform.scale = glm::vec3(1.0f, 2.0f, 1.0f);
+				pillar->AddComponent<ModelComponent>().model = CreateShared<Model>(application->GetRenderer(), application->GetCamera());
+				pillar->GetComponent<ModelComponent>().model->LoadFromFile(GetAssetSubDir("Models/Primitive/cube.gltf"));
+			}
+		}
+
+		// a fixed seed places the lights the same way every run, so that frame times can be compared
+		std::mt19937 random(1024);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		for (uint32_t i = 0; i < 1024; i++)
+		{
+			Entity* entity = scene->CreateEntity("Benchmark Light");
+			auto& transform = entity->AddComponent<TransformComponent>();
+			transform.translation = glm::vec3(unit(random) * 96.0f - 48.0f, 0.5f + unit(random) * 4.0f, unit(random) * 96.0f - 48.0f);
+
+			auto& light = entity->AddComponent<LightComponent>();
+			float hue = unit(random) * 6.0f;
+			glm::vec3 rgb = glm::clamp(glm::abs(glm::mod(glm::vec3(hue) + glm::vec3(0.0f, 4.0f, 2.0f), 6.0f) - 3.0f) - 1.0f, 0.0f, 1.0f);
+			light.color = glm::mix(glm::vec3(1.0f), rgb, 0.75f);
+			light.intensity = 4.0f + unit(random) * 4.0f;
+			light.range = 3.0f + unit(random) * 4.0f;
+
+			// every fourth light is a spot tilted away from straight down
+			if (i % 4 == 0)
+			{
+				light.type = LightComponent::Spot;
+				light.range *= 2.0f;
+				transform.rotation = glm::vec3(unit(random) - 0.5f, 0.0f, unit(random) - 0.5f);
+			}
+		}
+
+		LOG_TO_TERMINAL(Logger::Info, "Created the light benchmark, 1024 lights over 100 pillars");
+	}
+
 	void Mainmenu::SceneSettingsWindow()
 	{
 		if (!mDisplaySceneSettings)
@@ -20,7 +20,10 @@ namespace Cosmos
 			New,
 			Open,
 			Save,
-			SaveAs
+			SaveAs,
+			CookTextures,
+			BuildArchive,
+			LightBenchmark
 		};
 
 		struct AssetResource
@@ -53,6 +56,9 @@ namespace Cosmos
 		// draws teh scene settings
 		void SceneSettingsWindow();
 
+		// adds a floor, pillars and 1024 point and spot lights to the scene, to profile the clustered lighting
+		void CreateLightBenchmark();
+
 	private:
 
 		std::unique_ptr<Project>& mProject;
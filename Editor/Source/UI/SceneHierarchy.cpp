@@ -97,6 +97,7 @@ namespace Cosmos
 			{
 				DisplayAddComponentEntry<TransformComponent>("Transform");
 				DisplayAddComponentEntry<ModelComponent>("Model");
+				DisplayAddComponentEntry<LightComponent>("Light");
 				DisplayAddComponentEntry<SoundSourceComponent>("Sound Source");
 
 				ImGui::EndMenu();
@@ -275,6 +276,46 @@ namespace Cosmos
 						ImGui::EndDragDropTarget();
 					}
 				}
+
+				ImGui::Separator();
+
+				// hides the models behind it when the software occlusion is enabled
+				{
+					bool occluder = component.model->IsOccluder();
+
+					if (CheckboxSliderEx("Occluder", &occluder))
+					{
+						component.model->SetOccluder(occluder);
+					}
+				}
+			});
+
+		// point or spot light, placed and aimed by the entity's transform
+		DrawComponent<LightComponent>("Light", mSelectedEntity, [&](LightComponent& component)
+			{
+				const char* types[] = { "Point", "Spot" };
+				int type = (int)component.type;
+
+				if (ImGui::Combo("Type", &type, types, IM_ARRAYSIZE(types)))
+				{
+					component.type = (LightComponent::Type)type;
+				}
+
+				ImGui::ColorEdit3("Color", &component.color.x);
+				ImGui::DragFloat("Intensity", &component.intensity, 0.1f, 0.0f, 1000.0f, "%.2f");
+				ImGui::DragFloat("Range", &component.range, 0.1f, 0.0f, 1000.0f, "%.2f");
+
+				if (component.type == LightComponent::Spot)
+				{
+					float inner = glm::degrees(component.innerAngle);
+					float outer = glm::degrees(component.outerAngle);
+
+					ImGui::DragFloat("Inner Angle", &inner, 0.5f, 0.0f, outer, "%.1f");
+					ImGui::DragFloat("Outer Angle", &outer, 0.5f, 0.0f, 90.0f, "%.1f");
+
+					component.innerAngle = glm::radians(std::min(inner, outer));
+					component.outerAngle = glm::radians(outer);
+				}
 			});
 
 		// 3d sound source
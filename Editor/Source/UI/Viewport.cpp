@@ -13,33 +13,39 @@ namespace Cosmos
 		VKCommander::GetInstance()->Insert("Viewport", std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice());
 		VKCommander::GetInstance()->SetMain("Viewport"); // set viewport renderpass to main renderpass
 		VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->msaa = VK_SAMPLE_COUNT_1_BIT;
+
+		// draws the objects the occlusion culling found disoccluded over the viewport pass
+		VKCommander::GetInstance()->Insert("ViewportLate", std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice());
+		VKCommander::GetInstance()->GetEntriesRef()["ViewportLate"]->msaa = VK_SAMPLE_COUNT_1_BIT;
 		
 		LOG_TO_TERMINAL(Logger::Severity::Warn, "Rework Commander class and main RenderPass usage");
 
 		mSurfaceFormat = VK_FORMAT_R8G8B8A8_SRGB;
 		mDepthFormat = FindDepthFormat(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice());
 
-		// render pass
+		// render passes, the early one clears color and depth and the late one draws over them, leaving the color ready to be sampled
+		for (const char* name : { "Viewport", "ViewportLate" })
 		{
+			bool late = strcmp(name, "ViewportLate") == 0;
 			std::array<VkAttachmentDescription, 2> attachments = {};
 
 			// color attachment
 			attachments[0].format = mSurfaceFormat;
-			attachments[0].samples = VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->msaa;
-			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[0].samples = VKCommander::GetInstance()->GetEntriesRef()[name]->msaa;
+			attachments[0].loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
 			attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 			attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 			attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			attachments[0].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			// depth attachment
+			attachments[0].initialLayout = late ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+			attachments[0].finalLayout = late ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			// depth attachment, the depth pyramid is built from the early pass' one
 			attachments[1].format = mDepthFormat;
-			attachments[1].samples = VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->msaa;
-			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-			attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			attachments[1].samples = VKCommander::GetInstance()->GetEntriesRef()[name]->msaa;
+			attachments[1].loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[1].storeOp = late ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[1].stencilLoadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[1].stencilStoreOp = late ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[1].initialLayout = late ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
 			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 			VkAttachmentReference colorReference = {};
@@ -88,10 +94,11 @@ namespace Cosmos
 			renderPassCI.pSubpasses = &subpassDescription;
 			renderPassCI.dependencyCount = (uint32_t)dependencies.size();
 			renderPassCI.pDependencies = dependencies.data();
-			VK_ASSERT(vkCreateRenderPass(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), &renderPassCI, nullptr, &VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->renderPass), "Failed to create renderpass");
+			VK_ASSERT(vkCreateRenderPass(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), &renderPassCI, nullptr, &VKCommander::GetInstance()->GetEntriesRef()[name]->renderPass), "Failed to create renderpass");
 		}
 
-		// command pool
+		// command pools
+		for (const char* name : { "Viewport", "ViewportLate" })
 		{
 			VKDevice::QueueFamilyIndices indices = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->FindQueueFamilies
 			(
@@ -103,19 +110,20 @@ namespace Cosmos
 			cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 			cmdPoolInfo.queueFamilyIndex = indices.graphics.value();
 			cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-			VK_ASSERT(vkCreateCommandPool(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), &cmdPoolInfo, nullptr, &VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->commandPool), "Failed to create command pool");
+			VK_ASSERT(vkCreateCommandPool(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), &cmdPoolInfo, nullptr, &VKCommander::GetInstance()->GetEntriesRef()[name]->commandPool), "Failed to create command pool");
 		}
 
 		// command buffers
+		for (const char* name : { "Viewport", "ViewportLate" })
 		{
-			VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->commandBuffers.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
+			VKCommander::GetInstance()->GetEntriesRef()[name]->commandBuffers.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
 
 			VkCommandBufferAllocateInfo cmdBufferAllocInfo = {};
 			cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 			cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-			cmdBufferAllocInfo.commandPool = VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->commandPool;
-			cmdBufferAllocInfo.commandBufferCount = (uint32_t)VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->commandBuffers.size();
-			VK_ASSERT(vkAllocateCommandBuffers(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), &cmdBufferAllocInfo, VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->commandBuffers.data()), "Failed to allocate command buffers");
+			cmdBufferAllocInfo.commandPool = VKCommander::GetInstance()->GetEntriesRef()[name]->commandPool;
+			cmdBufferAllocInfo.commandBufferCount = (uint32_t)VKCommander::GetInstance()->GetEntriesRef()[name]->commandBuffers.size();
+			VK_ASSERT(vkAllocateCommandBuffers(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), &cmdBufferAllocInfo, VKCommander::GetInstance()->GetEntriesRef()[name]->commandBuffers.data()), "Failed to allocate command buffers");
 		}
 
 		// sampler
@@ -137,6 +145,67 @@ namespace Cosmos
 			VK_ASSERT(vkCreateSampler(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), &samplerCI, nullptr, &mSampler), "Failed to create sampler");
 		}
 
+		// the scene is drawn into the viewport images, which the interface samples
+		{
+			// the depth pyramid is reduced from it when the device can sample it
+			VKRenderGraph::Transient depth = {};
+			depth.format = mDepthFormat;
+			depth.samples = VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->msaa;
+			depth.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+			depth.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+			if (VKDepthPyramid::CanSample(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(), depth.format, depth.samples))
+				depth.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+
+			VKRenderGraph::GetInstance()->CreateTransient("ViewportDepth", depth);
+
+			// the early pass draws the objects visible last frame
+			VKRenderGraph::Pass pass = {};
+			pass.name = "Viewport";
+			pass.writes =
+			{
+				{ "Viewport", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+				{ "ViewportDepth", VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL }
+			};
+			pass.attachments = { "Viewport", "ViewportDepth" };
+			pass.clearValues.resize(2);
+			pass.clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+			pass.clearValues[1].depthStencil = { 1.0f, 0 };
+			pass.prepare = [](VkCommandBuffer cmdBuffer) { Application::GetInstance()->GetActiveScene()->OnPrepareRender(); };
+			pass.record = [](VkCommandBuffer cmdBuffer) { Application::GetInstance()->GetActiveScene()->OnRender(); };
+			VKRenderGraph::GetInstance()->AddPass(pass);
+
+			// the late pass draws the objects the depth pyramid of the early one finds disoccluded
+			VKRenderGraph::Pass latePass = {};
+			latePass.name = "ViewportLate";
+			latePass.reads =
+			{
+				{ "Viewport", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+				{ "ViewportDepth", VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL }
+			};
+			latePass.writes =
+			{
+				{ "Viewport", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+				{ "ViewportDepth", VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL }
+			};
+			latePass.attachments = { "Viewport", "ViewportDepth" };
+			latePass.clearValues.resize(2);
+			latePass.prepare = [this](VkCommandBuffer cmdBuffer)
+				{
+					std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDepthPyramid()->Build(cmdBuffer, mRenderer->GetCurrentFrame(), "ViewportDepth");
+					Application::GetInstance()->GetActiveScene()->OnPrepareLateRender(cmdBuffer);
+				};
+			latePass.record = [](VkCommandBuffer cmdBuffer) { Application::GetInstance()->GetActiveScene()->OnLateRender(cmdBuffer); };
+			VKRenderGraph::GetInstance()->AddPass(latePass);
+
+			VKRenderGraph::Access read = {};
+			read.resource = "Viewport";
+			read.stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			read.access = VK_ACCESS_SHADER_READ_BIT;
+			read.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			VKRenderGraph::GetInstance()->AddRead("ImGui", read);
+		}
+
 		CreateResources();
 
 		// must recreate global states to new primary commander specification
@@ -147,16 +216,17 @@ namespace Cosmos
 	{
 		vkDeviceWaitIdle(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice());
 		
+		VKRenderGraph::GetInstance()->RemovePass("Viewport");
+		VKRenderGraph::GetInstance()->RemovePass("ViewportLate");
+		VKRenderGraph::GetInstance()->RemoveResource("Viewport");
+		VKRenderGraph::GetInstance()->RemoveResource("ViewportDepth");
+
 		vkDestroySampler(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mSampler, nullptr);
 		
-		vkDestroyImageView(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mDepthView, nullptr);
-		vkFreeMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mDepthMemory, nullptr);
-		vkDestroyImage(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mDepthImage, nullptr);
-		
 		for (size_t i = 0; i < std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetImages().size(); i++)
 		{
 			vkDestroyImageView(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mImageViews[i], nullptr);
-			vkFreeMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mImageMemories[i], nullptr);
+			VKAllocator::GetInstance()->Free(mImageMemories[i]);
 			vkDestroyImage(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mImages[i], nullptr);
 		}
 	}
@@ -217,22 +287,13 @@ namespace Cosmos
 
 		if (event->GetType() == EventType::WindowResize)
 		{
-			vkDestroyImageView(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mDepthView, nullptr);
-			vkFreeMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mDepthMemory, nullptr);
-			vkDestroyImage(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mDepthImage, nullptr);
-
 			for (size_t i = 0; i < std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetImages().size(); i++)
 			{
 				vkDestroyImageView(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mImageViews[i], nullptr);
-				vkFreeMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mImageMemories[i], nullptr);
+				VKAllocator::GetInstance()->Free(mImageMemories[i]);
 				vkDestroyImage(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mImages[i], nullptr);
 			}
 
-			for (auto& framebuffer : VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->frameBuffers)
-			{
-				vkDestroyFramebuffer(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), framebuffer, nullptr);
-			}
-
 			CreateResources();
 		}
 	}
@@ -241,34 +302,12 @@ namespace Cosmos
 	{
 		size_t size = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetImages().size();
 
-		// depth buffer
-		{
-			CreateImage
-			(
-				std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(),
-				std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetExtent().width,
-				std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetExtent().height,
-				1,
-				1,
-				VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->msaa,
-				mDepthFormat,
-				VK_IMAGE_TILING_OPTIMAL,
-				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				mDepthImage,
-				mDepthMemory
-			);
-
-			mDepthView = CreateImageView(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(), mDepthImage, mDepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
-		}
-
 		// images
 		{
 			mImages.resize(size);
 			mImageMemories.resize(size);
 			mImageViews.resize(size);
 			mDescriptorSets.resize(size);
-			VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->frameBuffers.resize(size);
 
 			for (size_t i = 0; i < size; i++)
 			{
@@ -307,19 +346,10 @@ namespace Cosmos
 
 				mImageViews[i] = CreateImageView(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(), mImages[i], mSurfaceFormat, VK_IMAGE_ASPECT_COLOR_BIT);
 				mDescriptorSets[i] = AddTexture(mSampler, mImageViews[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-				std::array<VkImageView, 2> attachments = { mImageViews[i], mDepthView };
-
-				VkFramebufferCreateInfo framebufferCI = {};
-				framebufferCI.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-				framebufferCI.renderPass = VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->renderPass;
-				framebufferCI.attachmentCount = (uint32_t)attachments.size();
-				framebufferCI.pAttachments = attachments.data();
-				framebufferCI.width = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetExtent().width;
-				framebufferCI.height = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetExtent().height;
-				framebufferCI.layers = 1;
-				VK_ASSERT(vkCreateFramebuffer(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), &framebufferCI, nullptr, &VKCommander::GetInstance()->GetEntriesRef()["Viewport"]->frameBuffers[i]), "Failed to create framebuffer");
 			}
+
+			// the render graph builds the framebuffers with its depth
+			VKRenderGraph::GetInstance()->Import("Viewport", mImages, mImageViews, VK_IMAGE_ASPECT_COLOR_BIT);
 		}
 	}
 
@@ -88,15 +88,11 @@ namespace Cosmos
 
 		VkSampler mSampler = VK_NULL_HANDLE;
 
-		VkImage mDepthImage = VK_NULL_HANDLE;;
-		VkDeviceMemory mDepthMemory = VK_NULL_HANDLE;
-		VkImageView mDepthView = VK_NULL_HANDLE;
-
 		VkFormat mSurfaceFormat = VK_FORMAT_UNDEFINED;
 		VkFormat mDepthFormat = VK_FORMAT_UNDEFINED;
 
 		std::vector<VkImage> mImages;
-		std::vector<VkDeviceMemory> mImageMemories;
+		std::vector<VKAllocation> mImageMemories;
 		std::vector<VkImageView> mImageViews;
 
 		std::vector<VkDescriptorSet> mDescriptorSets;
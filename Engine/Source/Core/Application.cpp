@@ -21,6 +21,10 @@ namespace Cosmos
 		sound::Listener::GetInstance();
 		thread::PoolManager::GetInstance();
 
+		// prefer the packed assets when shipped alongside the binary
+		if (std::filesystem::exists(ASSET_ARCHIVE_PATH))
+			MountArchive(ASSET_ARCHIVE_PATH);
+
 		// create shared objects
 		mFpsSystem = CreateShared<FramesPerSecond>();
 		mWindow = CreateShared<Window>("Cosmos Application", 1280, 720);
@@ -47,6 +51,9 @@ namespace Cosmos
 
 			// starts fps calculation
 			mFpsSystem->StartFrame();
+
+			// paces the frame before its input is sampled
+			mRenderer->WaitFrame();
 			
 			// updates current tick
 			mWindow->OnUpdate();
@@ -4,6 +4,7 @@
 #include "Entity/Entity.h"
 
 #include "Entity/Components/Base.h"
+#include "Entity/Components/Light.h"
 #include "Entity/Components/Renderable.h"
 #include "Entity/Components/Scriptable.h"
 #include "Entity/Components/Sound.h"
@@ -11,6 +12,7 @@
 #include "Entity/Unique/Skybox.h"
 
 #include "Renderer/Vulkan/VKCommander.h"
+#include "Renderer/Vulkan/VKRenderer.h"
 #include "UI/GUI.h"
 
 #include <iostream>
@@ -25,6 +27,7 @@ namespace Cosmos
 		mEntityMap = {};
 
 		mSkybox = CreateShared<Skybox>(mRenderer, mCamera);
+		mLightClusters = CreateUnique<LightClusters>();
 	}
 
 	Scene::~Scene()
@@ -71,16 +74,38 @@ namespace Cosmos
 		mSkybox->OnUpdate(timestep);
 	}
 
-	void Scene::OnRender()
+	void Scene::OnPrepareRender()
 	{
-		Application::GetInstance()->GetGUI()->OnRender();
+		PROFILER_FUNCTION();
 
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 		uint32_t currentFrame = mRenderer->GetCurrentFrame();
-		VkDeviceSize offsets[] = { 0 };
 		VkCommandBuffer commandBuffer = VKCommander::GetInstance()->GetMainRef()->commandBuffers[currentFrame];
+		Shared<VKRenderer> renderer = std::dynamic_pointer_cast<VKRenderer>(mRenderer);
+
+		mBatchCount = 0;
+		mBatcher.Begin();
+		mRenderStats = {};
 
-		// draw models
 		auto modelsView = mRegistry.view<ModelComponent>();
+
+		// occluders are rasterized on the cpu first, the models they hide are never handed to the gpu culling
+		if (mOcclusion)
+		{
+			mOcclusion->Begin(mCamera->GetProjectionRef() * mCamera->GetViewRef());
+
+			for (auto ent : modelsView)
+			{
+				auto& [model] = modelsView.get<ModelComponent>(ent);
+
+				if (model != nullptr && model->IsLoaded() && model->IsOccluder())
+					mOcclusion->AddOccluder(model->GetOccluderProxy(), model->GetTransform());
+			}
+
+			mOcclusion->Rasterize();
+		}
+
+		// the models loaded from the same file with the same material are batched together
 		for (auto ent : modelsView)
 		{
 			auto& [model] = modelsView.get<ModelComponent>(ent);
@@ -88,9 +113,192 @@ namespace Cosmos
 			if (model == nullptr || !model->IsLoaded())
 				continue;
 
-			model->OnRender(commandBuffer);
+			if (mOcclusion && !mOcclusion->IsVisible(model->GetBoundsMin(), model->GetBoundsMax(), model->GetTransform()))
+			{
+				mRenderStats.occluded++;
+				continue;
+			}
+
+			size_t index = mBatcher.Add(model->GetBatchKey(), model->GetMaterialFeatures(), (uint32_t)model->GetMeshesRef().size());
+
+			if (index == mBatchCount)
+			{
+				if (mBatchCount == mBatches.size())
+					mBatches.emplace_back();
+
+				mBatches[mBatchCount].model = model.get();
+				mBatches[mBatchCount].transforms.clear();
+				mBatches[mBatchCount].depth = std::numeric_limits<float>::max();
+				mBatchCount++;
+			}
+
+			mBatches[index].transforms.push_back(model->GetTransform());
+			mBatches[index].depth = std::min(mBatches[index].depth, glm::distance(mCamera->GetPositionRef(), glm::vec3(model->GetTransform()[3])));
+		}
+
+		mRenderStats.instances = mBatcher.GetInstanceCount();
+		mRenderStats.drawCalls = mBatcher.GetDrawCount();
+		mRenderStats.batches = (uint32_t)mBatcher.GetBatchCount();
+
+		if (mRenderStats.instances == 0)
+			return;
+
+		// camera and lighting are written once for every model
+		Camera_BufferObject camera = {};
+		camera.view = mCamera->GetViewRef();
+		camera.proj = mCamera->GetProjectionRef();
+		Light_BufferObject light = PrepareLights(*renderer->GetFrameAllocator());
+
+		// every object, every draw and every instance slot only live for this frame, ranges are aligned to their element size
+		// as the culling addresses them by index, draws and instances are doubled as the late culling packs into a second half
+		VKLinearAllocator::Range objects = {};
+		VKLinearAllocator::Range draws = {};
+		VKLinearAllocator::Range instances = {};
+		Shared<VKLinearAllocator> frameAllocator = renderer->GetFrameAllocator();
+
+		if (!renderer->GetFrameUniforms()->Write(camera, light)
+			|| !frameAllocator->Allocate(mRenderStats.instances * sizeof(Cull_ObjectData), sizeof(Cull_ObjectData), objects)
+			|| !frameAllocator->Allocate(2 * mRenderStats.drawCalls * sizeof(VkDrawIndexedIndirectCommand), sizeof(VkDrawIndexedIndirectCommand), draws)
+			|| !frameAllocator->Allocate(2 * mRenderStats.instances * sizeof(glm::mat4), sizeof(glm::mat4), instances))
+		{
+			LOG_TO_TERMINAL(Logger::Error, "Frame allocator exhausted, %u models were not drawn", mRenderStats.instances);
+			mBatchCount = 0;
+			mRenderStats = {};
+			return;
+		}
+
+		Cull_ObjectData* objectData = (Cull_ObjectData*)objects.mapped;
+		VkDrawIndexedIndirectCommand* drawData = (VkDrawIndexedIndirectCommand*)draws.mapped;
+		uint32_t firstDraw = (uint32_t)(draws.offset / sizeof(VkDrawIndexedIndirectCommand));
+		uint32_t firstInstance = (uint32_t)(instances.offset / sizeof(glm::mat4));
+		uint32_t objectIndex = 0;
+		uint32_t drawIndex = 0;
+		uint32_t instanceIndex = 0;
+
+		for (size_t i = 0; i < mBatchCount; i++)
+		{
+			Batch& batch = mBatches[i];
+			std::vector<Mesh>& meshes = batch.model->GetMeshesRef();
+
+			batch.drawsOffset = draws.offset + drawIndex * sizeof(VkDrawIndexedIndirectCommand);
+			batch.instancesOffset = instances.offset + instanceIndex * sizeof(glm::mat4);
+			batch.lateDrawsOffset = batch.drawsOffset + mRenderStats.drawCalls * sizeof(VkDrawIndexedIndirectCommand);
+			batch.lateInstancesOffset = batch.instancesOffset + mRenderStats.instances * sizeof(glm::mat4);
+
+			// instance counts start at zero, the culling increments them
+			for (size_t m = 0; m < meshes.size(); m++)
+			{
+				VKGeometryPool::Range geometry = meshes[m].GetGeometry();
+				drawData[drawIndex + m] = { geometry.indexCount, 0, geometry.firstIndex, (int32_t)geometry.firstVertex, 0 };
+				drawData[mRenderStats.drawCalls + drawIndex + m] = drawData[drawIndex + m];
+			}
+
+			for (const glm::mat4& transform : batch.transforms)
+			{
+				Cull_ObjectData& object = objectData[objectIndex++];
+				object.model = transform;
+				object.sphere = glm::vec4(0.0f, 0.0f, 0.0f, batch.model->GetBoundingRadius());
+				object.firstDraw = firstDraw + drawIndex;
+				object.drawCount = (uint32_t)meshes.size();
+				object.instanceBase = firstInstance + instanceIndex;
+				object.padding = 0;
+
+				// every instance samples the batch's albedo, the closest one decides its resolution
+				batch.model->RequestAlbedoResolution(transform);
+			}
+
+			drawIndex += (uint32_t)meshes.size();
+			instanceIndex += (uint32_t)batch.transforms.size();
+		}
+
+		mViewProjection = mCamera->GetProjectionRef() * mCamera->GetViewRef();
+		mObjectsOffset = objects.offset;
+		renderer->GetCuller()->Dispatch(commandBuffer, currentFrame, VKCuller::Phase::Early, mViewProjection, mObjectsOffset, mRenderStats.instances);
+
+		mRenderStats.milliseconds = (float)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0f;
+	}
+
+	Light_BufferObject Scene::PrepareLights(VKLinearAllocator& frameAllocator)
+	{
+		PROFILER_FUNCTION();
+
+		// lights are binned into the froxels of the camera's view, each fragment only loops over the lights of its own
+		mLightClusters->Begin(mCamera->GetViewRef(), mCamera->GetProjectionRef(), mCamera->GetNear(), mCamera->GetFar());
+
+		auto lightsView = mRegistry.view<TransformComponent, LightComponent>();
+		for (auto ent : lightsView)
+		{
+			auto [transformComponent, lightComponent] = lightsView.get<TransformComponent, LightComponent>(ent);
+
+			// spots shine along the entity's down axis, so that an unrotated one lights what's below it
+			float outer = glm::clamp(lightComponent.outerAngle, 0.0f, glm::radians(90.0f));
+			Light_SourceData source = {};
+			source.position = glm::vec4(transformComponent.translation, lightComponent.range);
+			source.color = glm::vec4(lightComponent.color, lightComponent.intensity);
+			source.direction = glm::vec4(glm::normalize(glm::quat(transformComponent.rotation) * glm::vec3(0.0f, -1.0f, 0.0f)), std::cos(outer));
+			source.cone = glm::vec4(std::max(std::cos(glm::clamp(lightComponent.innerAngle, 0.0f, outer)), source.direction.w + 0.0001f), lightComponent.type == LightComponent::Spot ? 1.0f : 0.0f, 0.0f, 0.0f);
+
+			if (!mLightClusters->AddLight(source))
+				break;
 		}
 
+		mLightClusters->Bin();
+
+		// scenes without lights are lit by the ambient alone at full intensity, showing the models' albedo as is
+		Light_BufferObject light = {};
+		glm::uvec3 grid = mLightClusters->GetGrid();
+		const std::vector<Light_SourceData>& lights = mLightClusters->GetLights();
+		const std::vector<Light_ClusterData>& clusters = mLightClusters->GetClusters();
+		const std::vector<uint32_t>& indices = mLightClusters->GetIndices();
+
+		if (lights.empty())
+		{
+			light.ambient.w = 1.0f;
+			return light;
+		}
+
+		// the shader indexes them from the frame allocator's start, ranges are aligned to their element size
+		VKLinearAllocator::Range lightsRange = {};
+		VKLinearAllocator::Range clustersRange = {};
+		VKLinearAllocator::Range indicesRange = {};
+
+		if (!frameAllocator.Allocate(lights.size() * sizeof(Light_SourceData), sizeof(Light_SourceData), lightsRange)
+			|| !frameAllocator.Allocate(clusters.size() * sizeof(Light_ClusterData), sizeof(Light_ClusterData), clustersRange)
+			|| !frameAllocator.Allocate(std::max(indices.size(), (size_t)1) * sizeof(uint32_t), sizeof(uint32_t), indicesRange))
+		{
+			LOG_TO_TERMINAL(Logger::Error, "Frame allocator exhausted, %u lights were not drawn", (uint32_t)lights.size());
+			return light;
+		}
+
+		memcpy(lightsRange.mapped, lights.data(), lights.size() * sizeof(Light_SourceData));
+		memcpy(clustersRange.mapped, clusters.data(), clusters.size() * sizeof(Light_ClusterData));
+		memcpy(indicesRange.mapped, indices.data(), indices.size() * sizeof(uint32_t));
+
+		light.grid = glm::uvec4(grid, (uint32_t)lights.size());
+		light.slicing = glm::vec4(mLightClusters->GetSlicing(), 0.0f, 0.0f);
+		light.firstLight = (uint32_t)(lightsRange.offset / sizeof(Light_SourceData));
+		light.firstCluster = (uint32_t)(clustersRange.offset / sizeof(Light_ClusterData));
+		light.firstIndex = (uint32_t)(indicesRange.offset / sizeof(uint32_t));
+		return light;
+	}
+
+	void Scene::SetSoftwareOcclusion(bool enabled)
+	{
+		if (enabled && !mOcclusion)
+			mOcclusion = CreateUnique<OcclusionRasterizer>();
+
+		else if (!enabled)
+			mOcclusion.reset();
+	}
+
+	void Scene::OnRender()
+	{
+		Application::GetInstance()->GetGUI()->OnRender();
+
+		uint32_t currentFrame = mRenderer->GetCurrentFrame();
+		VkCommandBuffer commandBuffer = VKCommander::GetInstance()->GetMainRef()->commandBuffers[currentFrame];
+		VKRenderQueue* queue = VKRenderQueue::GetInstance();
+
 		// draw quads
 		auto quadsView = mRegistry.view<QuadComponent>();
 		for(auto ent : quadsView)
@@ -103,8 +311,69 @@ namespace Cosmos
 			quad->OnRender(commandBuffer);
 		}
 
-		// draw skybox
-		mSkybox->OnRender(commandBuffer);
+		// draws are submitted as packets and recorded in key order, sharing the binds they have in common
+		{
+			PROFILER_SCOPE("Scene Draws");
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			VkBuffer buffer = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetFrameAllocator()->GetBuffer();
+
+			// models, one indirect draw per mesh of each batch with the instances that survived the culling
+			for (size_t i = 0; i < mBatchCount; i++)
+			{
+				mBatches[i].model->OnRender(*queue, buffer, mBatches[i].instancesOffset, mBatches[i].drawsOffset, mBatches[i].depth);
+			}
+
+			// skybox
+			mSkybox->OnRender(*queue);
+
+			// every mesh lives in the geometry pool, its buffers are bound once for the whole pass
+			VKGeometryPool::GetInstance()->Bind(commandBuffer);
+			queue->Record(commandBuffer);
+
+			mRenderStats.milliseconds += (float)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0f;
+		}
+	}
+
+	void Scene::OnPrepareLateRender(VkCommandBuffer commandBuffer)
+	{
+		PROFILER_FUNCTION();
+
+		if (mBatchCount == 0 || mRenderStats.instances == 0)
+			return;
+
+		// the late draws and instances follow the early ones
+		std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetCuller()->Dispatch
+		(
+			commandBuffer,
+			mRenderer->GetCurrentFrame(),
+			VKCuller::Phase::Late,
+			mViewProjection,
+			mObjectsOffset,
+			mRenderStats.instances,
+			mRenderStats.drawCalls,
+			mRenderStats.instances
+		);
+	}
+
+	void Scene::OnLateRender(VkCommandBuffer commandBuffer)
+	{
+		PROFILER_FUNCTION();
+
+		if (mBatchCount == 0)
+			return;
+
+		VKRenderQueue* queue = VKRenderQueue::GetInstance();
+		VkBuffer buffer = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetFrameAllocator()->GetBuffer();
+
+		// only models, everything else was drawn by the early pass
+		for (size_t i = 0; i < mBatchCount; i++)
+		{
+			mBatches[i].model->OnRender(*queue, buffer, mBatches[i].lateInstancesOffset, mBatches[i].lateDrawsOffset, mBatches[i].depth);
+		}
+
+		VKGeometryPool::GetInstance()->Bind(commandBuffer);
+		queue->Record(commandBuffer);
 	}
 
 	void Scene::OnEvent(Shared<Event> event)
@@ -158,6 +427,14 @@ namespace Cosmos
 					newEnt->GetComponent<ModelComponent>().model->LoadAlbedoTexture(previousModel->GetAlbedoPath());
 				}
 			}
+
+			newEnt->GetComponent<ModelComponent>().model->SetOccluder(previousModel->IsOccluder());
+		}
+
+		// light
+		if (entity->HasComponent<LightComponent>())
+		{
+			newEnt->AddComponent<LightComponent>(entity->GetComponent<LightComponent>());
 		}
 
 		return newEnt;
@@ -253,6 +530,24 @@ namespace Cosmos
 
 				component.model->LoadFromFile(entityData["Model"]["Path"].GetString());
 				component.model->LoadAlbedoTexture(entityData["Model"]["Albedo"].GetString());
+
+				if (entityData["Model"].Exists("Occluder"))
+					component.model->SetOccluder(entityData["Model"]["Occluder"].GetInt() != 0);
+			}
+
+			// check if light exists
+			if (entityData.Exists("Light"))
+			{
+				entity.AddComponent<LightComponent>();
+				auto& component = entity.GetComponent<LightComponent>();
+				auto& dataL = entityData["Light"];
+
+				component.type = (LightComponent::Type)dataL["Type"].GetInt();
+				component.color = { dataL["Color"]["X"].GetDouble(), dataL["Color"]["Y"].GetDouble(), dataL["Color"]["Z"].GetDouble() };
+				component.intensity = (float)dataL["Intensity"].GetDouble();
+				component.range = (float)dataL["Range"].GetDouble();
+				component.innerAngle = (float)dataL["InnerAngle"].GetDouble();
+				component.outerAngle = (float)dataL["OuterAngle"].GetDouble();
 			}
 
 			// check if sound source exists
@@ -320,6 +615,23 @@ namespace Cosmos
 
 				place["Path"].SetString(component.model->GetPath());
 				place["Albedo"].SetString(component.model->GetAlbedoPath());
+				place["Occluder"].SetInt(component.model->IsOccluder() ? 1 : 0);
+			}
+
+			// write the light component if it exists
+			if (entity->HasComponent<LightComponent>())
+			{
+				auto& component = entity->GetComponent<LightComponent>();
+				auto& place = save["Entities"][uuidComponent]["Light"];
+
+				place["Type"].SetInt((int)component.type);
+				place["Color"]["X"].SetDouble(component.color.x);
+				place["Color"]["Y"].SetDouble(component.color.y);
+				place["Color"]["Z"].SetDouble(component.color.z);
+				place["Intensity"].SetDouble(component.intensity);
+				place["Range"].SetDouble(component.range);
+				place["InnerAngle"].SetDouble(component.innerAngle);
+				place["OuterAngle"].SetDouble(component.outerAngle);
 			}
 
 			// write sound source component if it exists
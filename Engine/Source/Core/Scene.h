@@ -4,6 +4,9 @@
 
 #include "Event/Event.h"
 
+#include "Renderer/InstanceBatcher.h"
+#include "Renderer/LightClusters.h"
+#include "Renderer/OcclusionRasterizer.h"
 #include "Renderer/Renderer.h"
 
 #include "Util/DataFile.h"
@@ -16,10 +19,34 @@ namespace Cosmos
 {
 	// forward declarations
 	class Entity;
+	class Model;
 	class Skybox;
+	class VKLinearAllocator;
 
 	class Scene
 	{
+	public:
+
+		struct RenderStats
+		{
+			uint32_t instances = 0;			// models handed to the gpu culling, the culler reads back how many were visible
+			uint32_t batches = 0;			// groups of identical models, each one drawn with its first model's resources
+			uint32_t drawCalls = 0;			// indirect draws recorded by each culling phase, one per mesh of each batch
+			uint32_t occluded = 0;			// models the cpu occlusion culling hid, never handed to the gpu
+			float milliseconds = 0.0f;		// cpu time spent batching, writing the objects, sorting and recording the draws
+		};
+
+		struct Batch
+		{
+			Model* model = nullptr;
+			std::vector<glm::mat4> transforms = {};
+			VkDeviceSize instancesOffset = 0;	// where the culling packs the visible instances, in the frame allocator
+			VkDeviceSize drawsOffset = 0;		// where the batch's indirect draws are, in the frame allocator
+			VkDeviceSize lateInstancesOffset = 0;	// where the late culling packs the disoccluded instances, in the frame allocator
+			VkDeviceSize lateDrawsOffset = 0;	// where the batch's late indirect draws are, in the frame allocator
+			float depth = 0.0f;					// distance from the camera to the closest instance, sorts the batches front to back
+		};
+
 	public:
 
 		// constructor
@@ -39,14 +66,35 @@ namespace Cosmos
 		// returns a reference to the entity unordered map
 		inline std::unordered_map<std::string, Entity>& GetEntityMapRef() { return mEntityMap; }
 
+		// returns the statistics of the last render
+		inline const RenderStats& GetRenderStats() const { return mRenderStats; }
+
+		// returns the cpu occlusion culling, nullptr while it's disabled
+		inline OcclusionRasterizer* GetOcclusion() { return mOcclusion.get(); }
+
+		// enables or disables rasterizing the occluder models on the cpu and skipping the models they hide
+		void SetSoftwareOcclusion(bool enabled);
+
+		// returns the clustered lighting, its lights and clusters are the last frame's
+		inline const LightClusters& GetLightClusters() const { return *mLightClusters; }
+
 	public:
 
 		// updates the scene objects
 		void OnUpdate(float timestep);
 
+		// batches the models and records their culling, must be called before the render pass the scene is drawn on begins
+		void OnPrepareRender();
+
 		// draws the scene drawables
 		void OnRender();
 
+		// records the culling of the objects the early draws didn't cover, must be called after the depth pyramid was built from them
+		void OnPrepareLateRender(VkCommandBuffer commandBuffer);
+
+		// draws the models the late culling found visible
+		void OnLateRender(VkCommandBuffer commandBuffer);
+
 		// event handling
 		void OnEvent(Shared<Event> event);
 
@@ -75,6 +123,11 @@ namespace Cosmos
 		// serializes the scene and returns a structure with it serialized
 		DataFile Serialize();
 
+	private:
+
+		// bins the scene's lights and copies them and their clusters into the frame allocator, returns where the shaders find them
+		Light_BufferObject PrepareLights(VKLinearAllocator& frameAllocator);
+
 	private:
 
 		Shared<Renderer> mRenderer;
@@ -83,5 +136,17 @@ namespace Cosmos
 		std::unordered_map<std::string, Entity> mEntityMap;
 
 		Shared<Skybox> mSkybox;
+
+		// batches are kept between frames so that their transforms' memory is reused
+		std::vector<Batch> mBatches = {};
+		size_t mBatchCount = 0;
+		InstanceBatcher mBatcher;
+		RenderStats mRenderStats = {};
+		Unique<OcclusionRasterizer> mOcclusion;
+		Unique<LightClusters> mLightClusters;
+
+		// the late culling tests the same objects with the same camera as the early one
+		glm::mat4 mViewProjection = glm::mat4(1.0f);
+		VkDeviceSize mObjectsOffset = 0;
 	};
 }
\ No newline at end of file
@@ -56,6 +56,7 @@ namespace Cosmos
 	void Profiler::WriteHeader()
 	{
 		mOutputStream << "{\"otherData\": {},\"traceEvents\":[{}";
+		mOutputStream << ",{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}";
 		mOutputStream.flush();
 	}
 
@@ -82,6 +83,29 @@ namespace Cosmos
 		}
 	}
 
+	void Profiler::WriteGpu(const std::string& name, double start, double duration)
+	{
+		std::lock_guard lock(mMutex);
+
+		if (!mInUse)
+			return;
+
+		std::stringstream json{};
+		json << std::setprecision(3) << std::fixed;
+		json << ",{";
+		json << "\"cat\":\"gpu\",";
+		json << "\"dur\":" << duration << ',';
+		json << "\"name\":\"" << name << "\",";
+		json << "\"ph\":\"X\",";
+		json << "\"pid\":1,";
+		json << "\"tid\":0,";
+		json << "\"ts\":" << start;
+		json << "}";
+
+		mOutputStream << json.str();
+		mOutputStream.flush();
+	}
+
 	void Profiler::WriteFooter()
 	{
 		mOutputStream << "]}";
@@ -2,6 +2,7 @@
 
 #include <mutex>
 #include <fstream>
+#include <string>
 #include <thread>
 
 namespace Cosmos
@@ -53,6 +54,9 @@ namespace Cosmos
 		// ends a session
 		void End();
 
+		// writes a scope timed on the gpu, on its own track, start is in microseconds on the steady clock
+		void WriteGpu(const std::string& name, double start, double duration);
+
 	private:
 
 		// ends the current session (internaly handled so user only needs to care with the other func)
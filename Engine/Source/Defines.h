@@ -5,8 +5,85 @@
 // vulkan renderer
 #define INCLUDE_VULKAN_RENDERER
 
-// how many frames are simultaniously rendered on gpu
-#define RENDERER_MAX_FRAMES_IN_FLIGHT 2
+// most frames simultaniously rendered on gpu, per-frame resources are created for this many
+#define RENDERER_MAX_FRAMES_IN_FLIGHT 3
+
+// frames simultaniously rendered on gpu at startup, changeable at runtime up to the maximum
+#define RENDERER_FRAMES_IN_FLIGHT 2
+
+// present mode the swapchain asks for at startup, falls back to mailbox, immediate and then fifo when unsupported
+#define RENDERER_PRESENT_MODE VK_PRESENT_MODE_MAILBOX_KHR
+
+// frames the frame pacer's mean, deviation and maximum frame times are taken over
+#define RENDERER_FRAME_PACING_HISTORY 120
+
+// microseconds the low latency mode submits a frame ahead of the gpu freeing up, covering mispredicted cpu and gpu times
+#define RENDERER_LOW_LATENCY_MARGIN_US 1000
+
+// cooked textures bigger than this (in texels) are streamed, only the smaller mips are loaded upfront
+#define RENDERER_TEXTURE_STREAMING_TAIL_SIZE 64
+
+// how many streamed textures may be swapped into their higher resolution per frame
+#define RENDERER_TEXTURE_STREAMING_UPLOADS_PER_FRAME 4
+
+// device-local memory budget in megabytes, 0 uses the budget reported by the driver (or 80% of the heaps)
+#define RENDERER_VRAM_BUDGET_MB 0
+
+// size of the memory blocks buffers and images are sub-allocated from, resources bigger than half of it get their own memory
+#define RENDERER_MEMORY_BLOCK_SIZE_MB 64
+
+// host-visible memory each frame in flight may use for transient data, including the objects culled on the gpu and their instances
+#define RENDERER_FRAME_ALLOCATOR_SIZE_KB 4096
+
+// vertices and indices the geometry pool every mesh lives in starts with, whichever runs out doubles
+#define RENDERER_GEOMETRY_POOL_VERTICES 524288
+#define RENDERER_GEOMETRY_POOL_INDICES 1572864
+
+// textures the global bindless array holds, clamped to the device limits
+#define RENDERER_BINDLESS_TEXTURES 4096
+
+// size of the persistently mapped ring uploads are staged in, uploads that don't fit use a temporary buffer
+#define RENDERER_STAGING_RING_SIZE_MB 32
+
+// pipeline cache file written next to the binary, reused across runs on the same driver and device
+#define RENDERER_PIPELINE_CACHE_PATH "PipelineCache.bin"
+
+// how often (in seconds) the pipeline cache is saved while running, besides on shutdown
+#define RENDERER_PIPELINE_CACHE_SAVE_INTERVAL 60
+
+// folder next to the binary holding compiled shaders, keyed by a hash of their sources, includes, defines and compiler settings
+#define RENDERER_SHADER_CACHE_DIR "ShaderCache"
+
+// pipeline variants used while running are listed in this file next to the binary, the next run builds them upfront
+#define RENDERER_PIPELINE_VARIANTS_PATH "PipelineVariants.txt"
+
+// rebuilds the pipelines whose shaders are edited while running, only when assets are loose files
+#define RENDERER_SHADER_HOT_RELOAD true
+
+// scopes the gpu profiler times per frame, the ones past it aren't timed
+#define RENDERER_GPU_PROFILER_SCOPES 128
+
+// levels of the depth pyramid the occlusion culling tests against, its first level is at most 2^(levels - 1) texels wide
+// must match MAX_LEVELS in depthpyramid.comp
+#define RENDERER_DEPTH_PYRAMID_LEVELS 13
+
+// size (in pixels) of the depth buffer occluders are rasterized into on the cpu, split in tiles rasterized on the resources pool
+// both must be multiples of 4, as pixels are processed 4 at a time
+#define RENDERER_OCCLUSION_WIDTH 320
+#define RENDERER_OCCLUSION_HEIGHT 192
+#define RENDERER_OCCLUSION_TILE_WIDTH 80
+#define RENDERER_OCCLUSION_TILE_HEIGHT 48
+
+// triangles of a model kept as its occluder proxy, the biggest ones are kept
+#define RENDERER_OCCLUSION_PROXY_TRIANGLES 256
+
+// froxels the view frustum is split in for the clustered lighting, slices are spaced exponentially between the camera's planes
+#define RENDERER_LIGHT_CLUSTERS_X 16
+#define RENDERER_LIGHT_CLUSTERS_Y 9
+#define RENDERER_LIGHT_CLUSTERS_Z 24
+
+// lights binned per frame, the ones past it are ignored
+#define RENDERER_MAX_LIGHTS 4096
 
 // how many chars in total an entity may have to represent it's name
 #define ENTITY_NAME_MAX_CHARS 128
@@ -17,6 +94,9 @@
 // how many threads the sound resources have
 #define RESOURCES_THREAD_SOUND_COUNT 4
 
+// packed asset archive mounted at startup when present, loose files are used otherwise
+#define ASSET_ARCHIVE_PATH "Data.cpak"
+
 
 //// platform detection
 // windows platform
@@ -8,6 +8,7 @@
 
 #include "Entity/Entity.h"
 #include "Entity/Components/Base.h"
+#include "Entity/Components/Light.h"
 #include "Entity/Components/Renderable.h"
 #include "Entity/Components/Scriptable.h"
 #include "Entity/Components/Sound.h"
@@ -22,9 +23,14 @@
 
 #include "Platform/FileDialog.h"
 
+#include "Renderer/InstanceBatcher.h"
+#include "Renderer/LightClusters.h"
+#include "Renderer/OcclusionRasterizer.h"
 #include "Renderer/Renderer.h"
 #include "Renderer/Texture.h"
+#include "Renderer/TextureCooker.h"
 
+#include "Renderer/Vulkan/VKAllocator.h"
 #include "Renderer/Vulkan/VKCommander.h"
 #include "Renderer/Vulkan/VKDevice.h"
 #include "Renderer/Vulkan/VKBuffer.h"
@@ -32,12 +38,14 @@
 #include "Renderer/Vulkan/VKImage.h"
 #include "Renderer/Vulkan/VKInitializers.h"
 #include "Renderer/Vulkan/VKRenderer.h"
+#include "Renderer/Vulkan/VKResidency.h"
 
 #include "UI/GUI.h"
 #include "UI/Icons.h"
 #include "UI/Spectrum.h"
 #include "UI/Widget.h"
 
+#include "Util/Archive.h"
 #include "Util/DataFile.h"
 #include "Util/FileSystem.h"
 #include "Util/Math.h"
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Util/Math.h"
+
+namespace Cosmos
+{
+	struct LightComponent
+	{
+		enum Type
+		{
+			Point = 0,
+			Spot
+		};
+
+		Type type = Type::Point;
+		glm::vec3 color = glm::vec3(1.0f);
+		float intensity = 1.0f;
+		float range = 10.0f;						// distance the light fades out at
+		float innerAngle = glm::radians(20.0f);		// spots only, half angle of the cone the light is at full intensity
+		float outerAngle = glm::radians(30.0f);		// spots only, half angle of the cone the light fades out at
+
+		// constructor
+		LightComponent() = default;
+	};
+}
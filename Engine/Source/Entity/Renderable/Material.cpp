@@ -12,4 +12,16 @@ namespace Cosmos
     {
         
     }
+
+    uint32_t Material::GetFeatures() const
+    {
+        uint32_t features = Feature::None;
+
+        if (mNormalProperties.enabled && mNormalProperties.texture) features |= Feature::NormalMap;
+        if (mEmissiveProperties.enabled && mEmissiveProperties.texture) features |= Feature::Emissive;
+        if (mSpecification.mode == Specification::Alphamode::Mask) features |= Feature::AlphaMask;
+        if (mSpecification.extUnlit) features |= Feature::Unlit;
+
+        return features;
+    }
 }
\ No newline at end of file
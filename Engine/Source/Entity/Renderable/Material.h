@@ -10,6 +10,16 @@ namespace Cosmos
     {
     public:
 
+        // shader features a material may use, each one a keyword of the model pipeline so that materials only pay for what they enable
+        enum Feature : uint32_t
+        {
+            None = 0,
+            NormalMap = 1 << 0,
+            Emissive = 1 << 1,
+            AlphaMask = 1 << 2,
+            Unlit = 1 << 3
+        };
+
         // alpha channel blending mode
         struct Specification
         {
@@ -21,7 +31,7 @@ namespace Cosmos
             };
             
             std::string name;
-            Alphamode mode; // how to handle the alpha channel
+            Alphamode mode = Opaque; // how to handle the alpha channel
             float alphaCutoff = 1.0f; // amout of oppacity
             bool culling = false; // this is doubleSided on GLTF specification, enabling back-culling when false
             bool extUnlit = false; // extension that unlits the material
@@ -89,6 +99,9 @@ namespace Cosmos
         // returns a reference to the material specification
         inline Specification& GetSpecificationRef() { return mSpecification; }
 
+        // returns the mask of features the material uses, selecting the pipeline variant it's drawn with
+        uint32_t GetFeatures() const;
+
         // returns a reference to the mateiral albedo properties
         inline Albedo& GetAlbedoPropertiesRef() { return mAlbedoProperties; }
 
@@ -4,6 +4,7 @@
 #include "Renderer/Renderer.h"
 #include "Renderer/Vulkan/VKBuffer.h"
 #include "Renderer/Vulkan/VKRenderer.h"
+#include "Renderer/Vulkan/VKUploader.h"
 
 namespace Cosmos
 {
@@ -13,84 +14,48 @@ namespace Cosmos
 		CreateResources();
 	}
 
-	void Mesh::Draw(VkCommandBuffer commandBuffer, VkPipelineLayout layout, VkDescriptorSet& descriptorSet)
+	VKGeometryPool::Range Mesh::GetGeometry() const
 	{
-		VkDeviceSize offsets[] = { 0 };
+		return VKGeometryPool::GetInstance()->GetRange(mGeometry);
+	}
 
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mVertexBuffer, offsets);
+	void Mesh::Submit(VKRenderQueue& queue, VKRenderQueue::Packet packet) const
+	{
+		// indirect draws are indexed
+		if (packet.indirectBuffer != VK_NULL_HANDLE && mIndices.empty())
+			return;
 
-		if (mIndices.size() > 0)
-		{
-			vkCmdBindIndexBuffer(commandBuffer, mIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &descriptorSet, 0, nullptr);
-			vkCmdDrawIndexed(commandBuffer, (uint32_t)mIndices.size(), 1, 0, 0, 0);
-		}
+		// the frame waits for the geometry's upload on the gpu if it's still in flight
+		VKUploader::GetInstance()->Require(mUploadTicket);
 
-		else
+		if (packet.indirectBuffer == VK_NULL_HANDLE)
 		{
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &descriptorSet, 0, nullptr);
-			vkCmdDraw(commandBuffer, (uint32_t)mVertices.size(), 1, 0, 0);
+			VKGeometryPool::Range geometry = GetGeometry();
+			packet.indexCount = geometry.indexCount;
+			packet.vertexCount = geometry.vertexCount;
+			packet.firstIndex = geometry.firstIndex;
+			packet.firstVertex = geometry.firstVertex;
 		}
+
+		queue.Submit(packet);
 	}
 
 	void Mesh::CreateResources()
 	{
-		// vertex Buffer
-		{
-			VkDeviceSize bufferSize = sizeof(mVertices[0]) * mVertices.size();
-
-			VK_ASSERT
-			(
-				BufferCreate
-				(
-					std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(),
-					VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					bufferSize,
-					&mVertexBuffer,
-					&mVertexMemory,
-					mVertices.data()
-				),
-				"Failed to create model Vertex Buffer"
-			);
-		}
-
-		// index buffer
-		{
-			if (mIndices.size() > 0)
-			{
-				VkDeviceSize bufferSize = sizeof(mIndices[0]) * mIndices.size();
-
-				VK_ASSERT
-				(
-					BufferCreate
-					(
-						std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(),
-						VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-						VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-						bufferSize,
-						&mIndexBuffer,
-						&mIndexMemory,
-						mIndices.data()
-					),
-					"Failed to create model Vertex Buffer"
-				);
-			}
-		}
+		// the mesh's ranges of the geometry pool
+		mGeometry = VKGeometryPool::GetInstance()->Allocate((uint32_t)mVertices.size(), (uint32_t)mIndices.size());
+		mUploadTicket = VKGeometryPool::GetInstance()->Upload(mGeometry, mVertices.data(), mIndices.data());
 	}
 
 	void Mesh::DestroyResources()
 	{
-		vkDestroyBuffer(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mVertexBuffer, nullptr);
-		vkFreeMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mVertexMemory, nullptr);
+		// the ranges can't be reused while their upload is pending
+		VKUploader::GetInstance()->Wait(mUploadTicket);
 
-		if (mIndices.size() > 0)
-		{
-			vkDestroyBuffer(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mIndexBuffer, nullptr);
-			vkFreeMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mIndexMemory, nullptr);
-		}
+		VKGeometryPool::GetInstance()->Free(mGeometry);
+		mGeometry = 0;
 
 		mIndices.clear();
 		mVertices.clear();
 	}
-}
\ No newline at end of file
+}
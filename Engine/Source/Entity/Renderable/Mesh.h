@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Renderer/Vulkan/VKGeometryPool.h"
+#include "Renderer/Vulkan/VKRenderQueue.h"
 #include "Renderer/Vulkan/VKVertex.h"
 #include "Util/Memory.h"
 
@@ -28,22 +30,13 @@ namespace Cosmos
 		// returns a reference to the indices vector
 		inline std::vector<uint32_t>& GetIndicesRef() { return mIndices; }
 
-		// returns the vertex buffer
-		inline VkBuffer GetVertexBuffer() const { return mVertexBuffer; }
-
-		// returns the vertex memory
-		inline VkDeviceMemory GetVertexMemory() const { return mVertexMemory; }
-
-		// returns the index buffer
-		inline VkBuffer GetIndexBuffer() const { return mVertexBuffer; }
-
-		// returns the index memory
-		inline VkDeviceMemory GetIndexMemory() const { return mVertexMemory; }
+		// returns where the mesh's vertices and indices are in the geometry pool
+		VKGeometryPool::Range GetGeometry() const;
 
 	public:
 
-		// draws the mesh
-		void Draw(VkCommandBuffer commandBuffer, VkPipelineLayout layout, VkDescriptorSet& descriptorSet);
+		// submits a draw of the mesh, the packet's direct draw is filled with the mesh's geometry while an indirect one is kept as is
+		void Submit(VKRenderQueue& queue, VKRenderQueue::Packet packet) const;
 
 		// creates the renderer resources for this mesh
 		void CreateResources();
@@ -57,9 +50,7 @@ namespace Cosmos
 		std::vector<VKVertex> mVertices;
 		std::vector<uint32_t> mIndices;
 
-		VkBuffer mVertexBuffer = VK_NULL_HANDLE;
-		VkDeviceMemory mVertexMemory = VK_NULL_HANDLE;
-		VkBuffer mIndexBuffer = VK_NULL_HANDLE;
-		VkDeviceMemory mIndexMemory = VK_NULL_HANDLE;
+		uint32_t mGeometry = 0;
+		uint64_t mUploadTicket = 0;
 	};
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "Model.h"
 
 #include "Material.h"
+#include "Core/Application.h"
 #include "Core/Camera.h"
 #include "Renderer/Renderer.h"
 #include "Renderer/Texture.h"
@@ -9,65 +10,100 @@
 #include "Renderer/Vulkan/VKBuffer.h"
 #include "Renderer/Vulkan/VKShader.h"
 #include "Renderer/Vulkan/VKRenderer.h"
+#include "Renderer/Vulkan/VKUploader.h"
 #include "Util/FileSystem.h"
 
 #include "wrapper_assimp.h"
 
+#include <unordered_map>
+
 namespace Cosmos
 {
 	Model::Model(Shared<Renderer> renderer, Shared<Camera> camera)
 		: mRenderer(renderer), mCamera(camera)
 	{
+		// resolved once, reloading its shaders or changing the main render pass rebuilds the same pipeline object
+		mPipeline = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetPipelinesRef()["Model"];
 		mMaterial = CreateShared<Material>();
 		mAlbedoPath = GetAssetSubDir("Textures/dev/colors/orange.png");
 	}
 
+	uint32_t Model::GetMaterialFeatures() const
+	{
+		return mMaterial->GetFeatures();
+	}
+
 	void Model::OnUpdate(float deltaTime, glm::mat4 transform)
 	{
 		if (!mLoaded) return;
 
-		ModelViewProjection_BufferObject ubo = {};
-		ubo.model = transform;
-		ubo.view = mCamera->GetViewRef();
-		ubo.proj = mCamera->GetProjectionRef();
+		mTransform = transform;
 
-		memcpy(mUniformBuffersMapped[mRenderer->GetCurrentFrame()], &ubo, sizeof(ubo));
+		// the material's textures may have been replaced, slots must be settled before the renderer writes this frame's texture array
+		Material::Normal& normal = mMaterial->GetNormalPropertiesRef();
+		Material::Emissive& emissive = mMaterial->GetEmissivePropertiesRef();
+		UpdateTextureSlot(mAlbedoSlot, mAlbedoTexture);
+		UpdateTextureSlot(mNormalSlot, normal.enabled ? normal.texture : nullptr);
+		UpdateTextureSlot(mEmissiveSlot, emissive.enabled ? emissive.texture : nullptr);
 	}
 	
-	void Model::OnRender(VkCommandBuffer commandBuffer)
+	void Model::OnRender(VKRenderQueue& queue, VkBuffer buffer, VkDeviceSize instancesOffset, VkDeviceSize drawsOffset, float depth)
 	{
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetPipelinesRef()["Model"]->GetPipeline());
+		PROFILER_FUNCTION();
 
-		for (auto& mesh : mMeshes)
+		if (mAlbedoTexture)
+			VKUploader::GetInstance()->Require(mAlbedoTexture->GetUploadTicket());
+
+		Material_PushConstant material = {};
+		material.emissiveFactor = mMaterial->GetEmissivePropertiesRef().factor;
+		material.alphaCutoff = mMaterial->GetSpecificationRef().alphaCutoff;
+		material.emissiveStrength = mMaterial->GetSpecificationRef().extEmissiveStrength;
+		material.albedoTexture = mAlbedoSlot;
+		material.normalTexture = mNormalSlot;
+		material.emissiveTexture = mEmissiveSlot;
+
+		// the material's features select the pipeline variant, every variant shares the frame-global uniforms and the texture array
+		VKRenderQueue::Packet packet = {};
+		packet.pipeline = mPipeline->GetVariant(mMaterial->GetFeatures());
+		packet.layout = mPipeline->GetPipelineLayout();
+		packet.sets = { VKFrameUniforms::GetInstance()->GetDescriptorSet(), VKBindless::GetInstance()->GetDescriptorSet(mRenderer->GetCurrentFrame()) };
+		packet.dynamicOffsets = VKFrameUniforms::GetInstance()->GetDynamicOffsets();
+		packet.dynamicOffsetCount = (uint32_t)packet.dynamicOffsets.size();
+		packet.pushConstant = queue.PushConstant(VK_SHADER_STAGE_FRAGMENT_BIT, &material, sizeof(Material_PushConstant));
+		packet.instanceBuffer = buffer;
+		packet.instanceOffset = instancesOffset;
+		packet.indirectBuffer = buffer;
+		packet.key = queue.MakeKey(VKRenderQueue::Opaque, packet.pipeline, mAlbedoSlot, depth);
+
+		// each mesh has its own draw, all of them draw the same visible instances
+		for (size_t i = 0; i < mMeshes.size(); i++)
 		{
-			mesh.Draw(commandBuffer, std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetPipelinesRef()["Model"]->GetPipelineLayout(), mDescriptorSets[mRenderer->GetCurrentFrame()]);
+			packet.indirectOffset = drawsOffset + (VkDeviceSize)(i * sizeof(VkDrawIndexedIndirectCommand));
+			mMeshes[i].Submit(queue, packet);
 		}
 	}
 
 	void Model::Destroy()
 	{
 		vkDeviceWaitIdle(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice());
-		
-		for (size_t i = 0; i < RENDERER_MAX_FRAMES_IN_FLIGHT; i++)
-		{
-			vkDestroyBuffer(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mUniformBuffers[i], nullptr);
-			vkFreeMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mUniformBuffersMemory[i], nullptr);
-
-			vkDestroyBuffer(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mLightBuffers[i], nullptr);
-			vkFreeMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mLightBuffersMemory[i], nullptr);
-		}
-		
-		vkDestroyDescriptorPool(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mDescriptorPool, nullptr);
 
 		for (auto& mesh : mMeshes)
 		{
 			mesh.DestroyResources();
 		}
 
+		UpdateTextureSlot(mAlbedoSlot, nullptr);
+		UpdateTextureSlot(mNormalSlot, nullptr);
+		UpdateTextureSlot(mEmissiveSlot, nullptr);
+
 		if (mAlbedoTexture)
 			mAlbedoTexture.reset();
 
 		mMeshes.clear();
+		mBoundingRadius = 0.0f;
+		mBoundsMin = glm::vec3(0.0f);
+		mBoundsMax = glm::vec3(0.0f);
+		mOccluderProxy.clear();
 		mLoaded = false;
 	}
 
@@ -89,10 +125,23 @@ namespace Cosmos
 			return;
 		}
 
+		// the bounds grow with every vertex processed
+		mBoundsMin = glm::vec3(std::numeric_limits<float>::max());
+		mBoundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+
 		ProcessNode(scene->mRootNode, scene);
 
+		if (mBoundsMin.x > mBoundsMax.x)
+		{
+			mBoundsMin = glm::vec3(0.0f);
+			mBoundsMax = glm::vec3(0.0f);
+		}
+
+		CreateOccluderProxy();
+
 		mLoaded = true;
 		mPath = path;
+		mBatchKey = mPath + "|" + mAlbedoPath;
 
 		CreateResources();
 	}
@@ -109,11 +158,11 @@ namespace Cosmos
 
 		if (mAlbedoTexture) mAlbedoTexture.reset();
 
+		// the bindless slot is swapped on the next update
 		mAlbedoTexture = Texture2D::Create(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(), path.c_str());
 
-		UpdateDescriptorSets();
-
 		mAlbedoPath = path;
+		mBatchKey = mPath + "|" + mAlbedoPath;
 		mLoadedAlbedo = true;
 	}
 
@@ -146,6 +195,9 @@ namespace Cosmos
 
 			glm::vec4 vectorRotated = initialRotation * glm::vec4(vertex.position, 1.0f);
 			vertex.position = glm::vec3(vectorRotated);
+			mBoundingRadius = std::max(mBoundingRadius, glm::length(vertex.position));
+			mBoundsMin = glm::min(mBoundsMin, vertex.position);
+			mBoundsMax = glm::max(mBoundsMax, vertex.position);
 
 			// color
 			if(mesh->mColors[0]) vertex.color = glm::vec3(mesh->mColors[0][i].r, mesh->mColors[0][i].g, mesh->mColors[0][i].b);
@@ -175,146 +227,131 @@ namespace Cosmos
 
 	void Model::CreateResources()
 	{
-		// ubo's
+		// camera and light are frame-global and the textures are bindless, the albedo is the only resource a model owns
+		mAlbedoTexture = Texture2D::Create(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(), mAlbedoPath.c_str());
+	}
+
+	void Model::CreateOccluderProxy()
+	{
+		struct Candidate
 		{
-			mUniformBuffers.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
-			mUniformBuffersMemory.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
-			mUniformBuffersMapped.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
+			std::array<glm::vec3, 4> vertices;
+			float area;
+			uint32_t triangles;
+		};
 
-			mLightBuffers.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
-			mLightBuffersMemory.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
-			mLightBuffersMapped.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
+		std::vector<Candidate> candidates;
 
-			for (size_t i = 0; i < RENDERER_MAX_FRAMES_IN_FLIGHT; i++)
+		for (Mesh& mesh : mMeshes)
+		{
+			const std::vector<VKVertex>& vertices = mesh.GetVerticesRef();
+			const std::vector<uint32_t>& indices = mesh.GetIndicesRef();
+			uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+
+			auto area = [&](uint32_t t)
+				{
+					const glm::vec3& a = vertices[indices[t * 3 + 0]].position;
+					const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+					const glm::vec3& c = vertices[indices[t * 3 + 2]].position;
+					return glm::length(glm::cross(b - a, c - a)) * 0.5f;
+				};
+
+			// a triangle's neighbour walks their shared edge the other way around
+			std::unordered_map<uint64_t, uint32_t> edges;
+			std::vector<bool> paired(triangleCount, false);
+
+			for (uint32_t t = 0; t < triangleCount; t++)
 			{
-				// camera's ubo
-				BufferCreate
-				(
-					std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(),
-					VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					sizeof(ModelViewProjection_BufferObject),
-					&mUniformBuffers[i],
-					&mUniformBuffersMemory[i]
-				);
-
-				vkMapMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mUniformBuffersMemory[i], 0, sizeof(ModelViewProjection_BufferObject), 0, &mUniformBuffersMapped[i]);
-			
-				// light's ubo
-				BufferCreate
-				(
-					std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(),
-					VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					sizeof(Light_BufferObject),
-					&mLightBuffers[i],
-					&mLightBuffersMemory[i]
-				);
-
-				vkMapMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mLightBuffersMemory[i], 0, sizeof(Light_BufferObject), 0, &mLightBuffersMapped[i]);
+				for (uint32_t e = 0; e < 3; e++)
+				{
+					edges[((uint64_t)indices[t * 3 + e] << 32) | indices[t * 3 + (e + 1) % 3]] = t;
+				}
+			}
 
+			for (uint32_t t = 0; t < triangleCount; t++)
+			{
+				if (paired[t])
+					continue;
+
+				paired[t] = true;
+				bool merged = false;
+
+				for (uint32_t e = 0; e < 3 && !merged; e++)
+				{
+					uint32_t from = indices[t * 3 + e];
+					uint32_t to = indices[t * 3 + (e + 1) % 3];
+					uint32_t opposite = indices[t * 3 + (e + 2) % 3];
+					auto it = edges.find(((uint64_t)to << 32) | from);
+
+					if (it == edges.end() || paired[it->second])
+						continue;
+
+					uint32_t n = it->second;
+					uint32_t other = indices[n * 3];
+
+					for (uint32_t v = 0; v < 3; v++)
+					{
+						if (indices[n * 3 + v] != from && indices[n * 3 + v] != to)
+							other = indices[n * 3 + v];
+					}
+
+					// the shared edge is the quad's diagonal from its first to its third vertex
+					paired[n] = true;
+					merged = true;
+					candidates.push_back({ { vertices[from].position, vertices[other].position, vertices[to].position, vertices[opposite].position }, area(t) + area(n), 2 });
+				}
+
+				if (!merged)
+				{
+					const glm::vec3& last = vertices[indices[t * 3 + 2]].position;
+					candidates.push_back({ { vertices[indices[t * 3]].position, vertices[indices[t * 3 + 1]].position, last, last }, area(t), 1 });
+				}
 			}
 		}
 
-		// textures
-		{
-			mAlbedoTexture = Texture2D::Create(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice(), mAlbedoPath.c_str());
-		}
+		// the biggest ones hide the most, small ones rarely cover a whole pixel of the occlusion buffer
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.area > b.area; });
+
+		mOccluderProxy.clear();
+		uint32_t triangles = 0;
 
-		// create descriptor pool and descriptor sets
+		for (const Candidate& candidate : candidates)
 		{
-			std::array<VkDescriptorPoolSize, 3> poolSizes = {};
-			poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			poolSizes[0].descriptorCount = 2;
-			poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			poolSizes[1].descriptorCount = 2;
-			poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			poolSizes[2].descriptorCount = 2;
-
-			VkDescriptorPoolCreateInfo descPoolCI = {};
-			descPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-			descPoolCI.poolSizeCount = (uint32_t)poolSizes.size();
-			descPoolCI.pPoolSizes = poolSizes.data();
-			descPoolCI.maxSets = 2;
-			VK_ASSERT(vkCreateDescriptorPool(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), &descPoolCI, nullptr, &mDescriptorPool), "Failed to create descriptor pool");
-
-			std::vector<VkDescriptorSetLayout> layouts
-			(
-				RENDERER_MAX_FRAMES_IN_FLIGHT, 
-				std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetPipelinesRef()["Model"]->GetDescriptorSetLayout()
-			);
-
-			VkDescriptorSetAllocateInfo descSetAllocInfo = {};
-			descSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-			descSetAllocInfo.descriptorPool = mDescriptorPool;
-			descSetAllocInfo.descriptorSetCount = (uint32_t)RENDERER_MAX_FRAMES_IN_FLIGHT;
-			descSetAllocInfo.pSetLayouts = layouts.data();
-
-			mDescriptorSets.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
-			VK_ASSERT(vkAllocateDescriptorSets(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), &descSetAllocInfo, mDescriptorSets.data()), "Failed to allocate descriptor sets");
-
-			UpdateDescriptorSets();
+			if (triangles + candidate.triangles > RENDERER_OCCLUSION_PROXY_TRIANGLES)
+				continue;
+
+			mOccluderProxy.insert(mOccluderProxy.end(), candidate.vertices.begin(), candidate.vertices.end());
+			triangles += candidate.triangles;
 		}
 	}
 
-	void Model::UpdateDescriptorSets()
+	void Model::UpdateTextureSlot(uint32_t& slot, const Shared<Texture2D>& texture)
 	{
-		for (size_t i = 0; i < RENDERER_MAX_FRAMES_IN_FLIGHT; i++)
-		{
-			std::vector<VkWriteDescriptorSet> descriptorWrites = {};
-
-			//
-			VkDescriptorBufferInfo cameraUBOInfo = {};
-			cameraUBOInfo.buffer = mUniformBuffers[i];
-			cameraUBOInfo.offset = 0;
-			cameraUBOInfo.range = sizeof(ModelViewProjection_BufferObject);
-
-			VkWriteDescriptorSet cameraUBODesc = {};
-			cameraUBODesc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			cameraUBODesc.dstSet = mDescriptorSets[i];
-			cameraUBODesc.dstBinding = 0;
-			cameraUBODesc.dstArrayElement = 0;
-			cameraUBODesc.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			cameraUBODesc.descriptorCount = 1;
-			cameraUBODesc.pBufferInfo = &cameraUBOInfo;
-
-			descriptorWrites.push_back(cameraUBODesc);
-
-			//
-			VkDescriptorBufferInfo lightUBOInfo = {};
-			lightUBOInfo.buffer = mLightBuffers[i];
-			lightUBOInfo.offset = 0;
-			lightUBOInfo.range = sizeof(Light_BufferObject);
-
-			VkWriteDescriptorSet lightUBODesc = {};
-			lightUBODesc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			lightUBODesc.dstSet = mDescriptorSets[i];
-			lightUBODesc.dstBinding = 1;
-			lightUBODesc.dstArrayElement = 0;
-			lightUBODesc.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			lightUBODesc.descriptorCount = 1;
-			lightUBODesc.pBufferInfo = &lightUBOInfo;
-
-			descriptorWrites.push_back(lightUBODesc);
-
-			//
-			VkDescriptorImageInfo albedoInfo = {};
-			albedoInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			albedoInfo.imageView = mAlbedoTexture->GetView();
-			albedoInfo.sampler = mAlbedoTexture->GetSampler();
-
-			VkWriteDescriptorSet albedoDesc = {};
-			albedoDesc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			albedoDesc.dstSet = mDescriptorSets[i];
-			albedoDesc.dstBinding = 2;
-			albedoDesc.dstArrayElement = 0;
-			albedoDesc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			albedoDesc.descriptorCount = 1;
-			albedoDesc.pImageInfo = &albedoInfo;
-
-			descriptorWrites.push_back(albedoDesc);
-
-			vkUpdateDescriptorSets(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), (uint32_t)descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
-		}
+		VKBindless* bindless = VKBindless::GetInstance();
+
+		if (slot != 0 && bindless->GetTexture(slot) == texture)
+			return;
+
+		bindless->Unregister(slot);
+		slot = texture ? bindless->Register(texture) : 0;
+	}
+
+	void Model::RequestAlbedoResolution(const glm::mat4& transform)
+	{
+		if (!mAlbedoTexture || mBoundingRadius <= 0.0f)
+			return;
+
+		// approximate the model's height on screen by its bounding sphere
+		float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+		float radius = mBoundingRadius * scale;
+		float distance = std::max(glm::distance(mCamera->GetPositionRef(), glm::vec3(transform[3])) - radius, mCamera->GetNear());
+		float viewportHeight = (float)Application::GetInstance()->GetWindow()->GetHeight();
+		float pixels = (radius / (distance * std::tan(glm::radians(mCamera->GetFov()) * 0.5f))) * viewportHeight;
+
+		// texels needed are assumed to match the pixels covered, the uv set spanning the texture once
+		float texels = (float)std::max(mAlbedoTexture->GetWidth(), mAlbedoTexture->GetHeight());
+		int32_t mip = pixels >= texels ? 0 : (int32_t)std::floor(std::log2(texels / std::max(pixels, 1.0f)));
+
+		mAlbedoTexture->RequestMip(mip);
 	}
 }
\ No newline at end of file
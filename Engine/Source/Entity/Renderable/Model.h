@@ -3,6 +3,7 @@
 #include "Entity/Renderable/Mesh.h"
 #include "Renderer/Texture.h"
 #include "Util/Memory.h"
+#include <array>
 #include <vector>
 
 // forward declarations
@@ -16,6 +17,7 @@ namespace Cosmos
 	class Camera;
 	class Material;
 	class Renderer;
+	class VKPipeline;
 
 	class Model
 	{
@@ -44,6 +46,33 @@ namespace Cosmos
 		// returns if the model is loaded
 		inline bool IsLoaded() const { return mLoaded; }
 
+		// returns the transform given on the last update
+		inline const glm::mat4& GetTransform() const { return mTransform; }
+
+		// returns what identifies the model's meshes and material, models with the same key and features are drawn together
+		inline const std::string& GetBatchKey() const { return mBatchKey; }
+
+		// returns the radius of the sphere centered on the model's origin that bounds it
+		inline float GetBoundingRadius() const { return mBoundingRadius; }
+
+		// returns the smallest corner of the box that bounds the model, in its own space
+		inline const glm::vec3& GetBoundsMin() const { return mBoundsMin; }
+
+		// returns the largest corner of the box that bounds the model, in its own space
+		inline const glm::vec3& GetBoundsMax() const { return mBoundsMax; }
+
+		// returns the biggest quads and triangles of the model's surface, four vertices each, rasterized when the model is an occluder
+		inline const std::vector<glm::vec3>& GetOccluderProxy() const { return mOccluderProxy; }
+
+		// returns if the model hides the ones behind it from the cpu occlusion culling
+		inline bool IsOccluder() const { return mOccluder; }
+
+		// sets if the model hides the ones behind it from the cpu occlusion culling
+		inline void SetOccluder(bool value) { mOccluder = value; }
+
+		// returns the features of the model's material
+		uint32_t GetMaterialFeatures() const;
+
 		// sets the loaded flag to false
 		inline void SetLoaded(bool value) { mLoaded = value; }
 
@@ -52,12 +81,16 @@ namespace Cosmos
 		// updates model's logic
 		void OnUpdate(float deltaTime, glm::mat4 transform);
 		
-		// draws the model
-		void OnRender(VkCommandBuffer commandBuffer);
+		// submits the model's batch with one indexed indirect draw per mesh, instances and draws were written by the gpu culling
+		// the instances may belong to other models sharing this one's batch key and features, they're drawn with this model's resources
+		void OnRender(VKRenderQueue& queue, VkBuffer buffer, VkDeviceSize instancesOffset, VkDeviceSize drawsOffset, float depth);
 
 		// free used resources
 		void Destroy();
 
+		// requests the albedo mip level matching the model's size on screen
+		void RequestAlbedoResolution(const glm::mat4& transform);
+
 	public:
 
 		// loads the model from file
@@ -77,34 +110,37 @@ namespace Cosmos
 		// create renderer resources
 		void CreateResources();
 
-		// updates the descriptor set (used when properties has changed)
-		void UpdateDescriptorSets(); 
+		// keeps the model's biggest triangles as its occluder proxy, pairing the ones sharing an edge into quads
+		void CreateOccluderProxy();
+
+		// keeps a bindless slot holding the texture, re-registering it when the texture was replaced (nullptr releases the slot)
+		void UpdateTextureSlot(uint32_t& slot, const Shared<Texture2D>& texture);
 
 	private:
 
 		Shared<Renderer> mRenderer;
 		Shared<Camera> mCamera;
+		Shared<VKPipeline> mPipeline;
 		std::string mPath = {};
+		std::string mBatchKey = {};
+		glm::mat4 mTransform = glm::mat4(1.0f);
 		bool mLoaded = false;
 		
 		std::vector<Mesh> mMeshes;
-		
-		VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
-		std::vector<VkDescriptorSet> mDescriptorSets = {};
-		
-		// camera's ubo
-		std::vector<VkBuffer> mUniformBuffers;
-		std::vector<VkDeviceMemory> mUniformBuffersMemory;
-		std::vector<void*> mUniformBuffersMapped;
-
-		// light's ubo
-		std::vector<VkBuffer> mLightBuffers;
-		std::vector<VkDeviceMemory> mLightBuffersMemory;
-		std::vector<void*> mLightBuffersMapped;
+		float mBoundingRadius = 0.0f;
+		glm::vec3 mBoundsMin = glm::vec3(0.0f);
+		glm::vec3 mBoundsMax = glm::vec3(0.0f);
+		std::vector<glm::vec3> mOccluderProxy = {};
+		bool mOccluder = false;
 
 		Shared<Material> mMaterial;
 		std::string mAlbedoPath;
 		Shared<Texture2D> mAlbedoTexture;
 		bool mLoadedAlbedo = false;
+
+		// bindless slots of the material's textures, 0 is the default texture
+		uint32_t mAlbedoSlot = 0;
+		uint32_t mNormalSlot = 0;
+		uint32_t mEmissiveSlot = 0;
 	};
 }
\ No newline at end of file
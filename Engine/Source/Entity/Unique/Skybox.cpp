@@ -11,6 +11,7 @@ namespace Cosmos
 	Skybox::Skybox(Shared<Renderer> renderer, Shared<Camera> camera)
 		: mRenderer(renderer), mCamera(camera)
 	{
+		mPipeline = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetPipelinesRef()["Skybox"];
 		mCubemodel = CreateShared<Model>(mRenderer, mCamera);
 		mCubemodel->LoadFromFile(GetAssetSubDir("Models/skybox.gltf"));
 
@@ -32,7 +33,7 @@ namespace Cosmos
 		for (size_t i = 0; i < RENDERER_MAX_FRAMES_IN_FLIGHT; i++)
 		{
 			vkDestroyBuffer(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mUniformBuffers[i], nullptr);
-			vkFreeMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mUniformBuffersMemory[i], nullptr);
+			VKAllocator::GetInstance()->Free(mUniformBuffersMemory[i]);
 		}
 		
 		vkDestroyDescriptorPool(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mDescriptorPool, nullptr);
@@ -62,13 +63,17 @@ namespace Cosmos
 		memcpy(mUniformBuffersMapped[mRenderer->GetCurrentFrame()], &ubo, sizeof(ubo));
 	}
 
-	void Skybox::OnRender(VkCommandBuffer commandBuffer)
+	void Skybox::OnRender(VKRenderQueue& queue)
 	{
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetPipelinesRef()["Skybox"]->GetPipeline());
+		VKRenderQueue::Packet packet = {};
+		packet.pipeline = mPipeline->GetPipeline();
+		packet.layout = mPipeline->GetPipelineLayout();
+		packet.sets[0] = mDescriptorSets[mRenderer->GetCurrentFrame()];
+		packet.key = queue.MakeKey(VKRenderQueue::Sky, packet.pipeline, 0, 0.0f);
 
-		for (auto mesh : mCubemodel->GetMeshesRef())
+		for (const Mesh& mesh : mCubemodel->GetMeshesRef())
 		{
-			mesh.Draw(commandBuffer, std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetPipelinesRef()["Skybox"]->GetPipelineLayout(), mDescriptorSets[mRenderer->GetCurrentFrame()]);
+			mesh.Submit(queue, packet);
 		}
 	}
 
@@ -93,7 +98,7 @@ namespace Cosmos
 					&mUniformBuffersMemory[i]
 				);
 		
-				vkMapMemory(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), mUniformBuffersMemory[i], 0, sizeof(ModelViewProjection_BufferObject), 0, &mUniformBuffersMapped[i]);
+				mUniformBuffersMapped[i] = mUniformBuffersMemory[i].mapped;
 			}
 		}
 		
@@ -115,7 +120,7 @@ namespace Cosmos
 			std::vector<VkDescriptorSetLayout> layouts
 			(
 				RENDERER_MAX_FRAMES_IN_FLIGHT,
-				std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetPipelinesRef()["Skybox"]->GetDescriptorSetLayout()
+				mPipeline->GetDescriptorSetLayout()
 			);
 		
 			VkDescriptorSetAllocateInfo descSetAllocInfo = {};
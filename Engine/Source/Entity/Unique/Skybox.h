@@ -31,8 +31,8 @@ namespace Cosmos
 		// updates skybox logic
 		void OnUpdate(float timestep);
 
-		// renders the skybox
-		void OnRender(VkCommandBuffer commandBuffer);
+		// submits the skybox, drawn after every opaque draw
+		void OnRender(VKRenderQueue& queue);
 
 	private:
 
@@ -46,6 +46,7 @@ namespace Cosmos
 
 		Shared<Renderer> mRenderer;
 		Shared<Camera> mCamera;
+		Shared<VKPipeline> mPipeline;
 		Shared<TextureCubemap> mCubemap;
 		Shared<Model> mCubemodel;
 		bool mLoaded = false;
@@ -53,7 +54,7 @@ namespace Cosmos
 	
 		// camera's ubo
 		std::vector<VkBuffer> mUniformBuffers;
-		std::vector<VkDeviceMemory> mUniformBuffersMemory;
+		std::vector<VKAllocation> mUniformBuffersMemory;
 		std::vector<void*> mUniformBuffersMapped;
 
 		// skybox descriptor
@@ -12,11 +12,92 @@ namespace Cosmos
 		alignas(16) glm::mat4 proj;
 	};
 
-	// light buffer
+	// camera shared by every draw of a frame
+	struct Camera_BufferObject
+	{
+		alignas(16) glm::mat4 view;
+		alignas(16) glm::mat4 proj;
+	};
+
+	// clustered lighting shared by every draw of a frame, the lights and their clusters are in the frame allocator
 	struct Light_BufferObject
 	{
-		alignas(16) glm::vec4 light = { 1.0f, 1.0f, 1.0f, 1.0f }; // w is intensity
 		alignas(16) glm::vec4 ambient = { 1.0f, 1.0f, 1.0f, 0.02f }; // w is intensity
-		alignas(16) glm::vec3 position = { 0.0f, 0.0f, 2.5f };
+		alignas(16) glm::uvec4 grid = glm::uvec4(0); // clusters along x, y and z, w is the light count
+		alignas(16) glm::vec4 slicing = glm::vec4(0.0f); // x and y turn the log of a view depth into its slice
+		uint32_t firstLight = 0; // absolute index of the first light in the frame allocator
+		uint32_t firstCluster = 0; // absolute index of the first cluster
+		uint32_t firstIndex = 0; // absolute index of the first light index
+		uint32_t padding = 0;
+	};
+
+	// a light binned into the clusters, mirrors model.frag's Light
+	struct Light_SourceData
+	{
+		alignas(16) glm::vec4 position = glm::vec4(0.0f); // w is range
+		alignas(16) glm::vec4 color = glm::vec4(1.0f); // w is intensity
+		alignas(16) glm::vec4 direction = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f); // spots only, w is the cosine of the outer angle
+		alignas(16) glm::vec4 cone = glm::vec4(0.0f); // x is the cosine of the inner angle, y is 1 for spots
+	};
+
+	// the lights touching a cluster, mirrors model.frag's uvec2
+	struct Light_ClusterData
+	{
+		uint32_t firstIndex = 0; // relative to the first light index
+		uint32_t count = 0;
+	};
+
+	// material parameters, pushed with each draw
+	struct Material_PushConstant
+	{
+		alignas(16) glm::vec4 emissiveFactor = glm::vec4(0.0f);
+		float alphaCutoff = 0.5f;
+		float emissiveStrength = 1.0f;
+		uint32_t albedoTexture = 0; // bindless slots, 0 is the default texture
+		uint32_t normalTexture = 0;
+		uint32_t emissiveTexture = 0;
+	};
+
+	// an object culled on the gpu, mirrors cull.comp's Object
+	struct Cull_ObjectData
+	{
+		alignas(16) glm::mat4 model;
+		alignas(16) glm::vec4 sphere = glm::vec4(0.0f); // local center and radius
+		uint32_t firstDraw = 0; // absolute index of the batch's first indirect draw
+		uint32_t drawCount = 0; // one indirect draw per mesh
+		uint32_t instanceBase = 0; // absolute index of the batch's first instance
+		uint32_t padding = 0;
+	};
+
+	// frustum and occlusion culling parameters
+	struct Cull_PushConstant
+	{
+		alignas(16) glm::mat4 viewProjection;
+		uint32_t firstObject = 0;
+		uint32_t objectCount = 0;
+		uint32_t drawOffset = 0; // added to the objects' draws, each phase draws into its own
+		uint32_t instanceOffset = 0; // added to the objects' instances
+		glm::vec2 pyramidSize = glm::vec2(0.0f);
+		uint32_t pyramidLevels = 0; // 0 skips the occlusion test
+		uint32_t padding = 0;
+	};
+
+	// counters the culling increments, read back once the frame is done
+	struct Cull_Stats
+	{
+		uint32_t frustumCulled = 0;
+		uint32_t occluded = 0;
+		uint32_t drawnEarly = 0;
+		uint32_t drawnLate = 0;
+	};
+
+	// depth pyramid reduction parameters
+	struct DepthPyramid_PushConstant
+	{
+		glm::ivec2 depthSize = glm::ivec2(0);
+		glm::ivec2 pyramidSize = glm::ivec2(0);
+		uint32_t levelCount = 0;
+		uint32_t samples = 1;
+		uint32_t workgroups = 0;
 	};
 }
\ No newline at end of file
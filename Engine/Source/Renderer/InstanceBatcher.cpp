@@ -0,0 +1,24 @@
+#include "epch.h"
+#include "InstanceBatcher.h"
+
+namespace Cosmos
+{
+	void InstanceBatcher::Begin()
+	{
+		mLookup.clear();
+		mInstanceCount = 0;
+		mDrawCount = 0;
+	}
+
+	size_t InstanceBatcher::Add(std::string_view key, uint32_t features, uint32_t meshCount)
+	{
+		auto [it, created] = mLookup.emplace(Key{ key, features }, mLookup.size());
+
+		// the first instance decides how many meshes its batch draws
+		if (created)
+			mDrawCount += meshCount;
+
+		mInstanceCount++;
+		return it->second;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+namespace Cosmos
+{
+	// groups instances that share a batch key and material features, each group is drawn with one instanced draw per mesh
+	// nothing here touches the gpu, the scene keeps what every batch is drawn with under the index it's given
+	class InstanceBatcher
+	{
+	public:
+
+		struct Key
+		{
+			std::string_view key;			// the instances' batch key, must stay valid until the next begin
+			uint32_t features = 0;			// the instances' material features
+
+			// checks if two batches draw the same meshes and material
+			bool operator==(const Key& other) const { return features == other.features && key == other.key; }
+		};
+
+		struct KeyHash
+		{
+			// returns the hash of a batch key
+			size_t operator()(const Key& batch) const { return std::hash<std::string_view>()(batch.key) ^ ((size_t)batch.features * 0x9E3779B97F4A7C15ull); }
+		};
+
+	public:
+
+		// constructor
+		InstanceBatcher() = default;
+
+		// destructor
+		~InstanceBatcher() = default;
+
+	public:
+
+		// returns how many batches were started since the last begin
+		inline size_t GetBatchCount() const { return mLookup.size(); }
+
+		// returns how many instances were added since the last begin
+		inline uint32_t GetInstanceCount() const { return mInstanceCount; }
+
+		// returns how many draws the batches take, one per mesh of each batch instead of one per mesh of each instance
+		inline uint32_t GetDrawCount() const { return mDrawCount; }
+
+	public:
+
+		// forgets the batches of the last frame
+		void Begin();
+
+		// adds an instance drawn with a number of meshes and returns the index of its batch, batches are numbered in the order
+		// they're started, so an index equal to the batch count before the call is a new batch
+		size_t Add(std::string_view key, uint32_t features, uint32_t meshCount);
+
+	private:
+
+		std::unordered_map<Key, size_t, KeyHash> mLookup = {};
+		uint32_t mInstanceCount = 0;
+		uint32_t mDrawCount = 0;
+	};
+}
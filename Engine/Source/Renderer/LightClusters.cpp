@@ -0,0 +1,177 @@
+#include "epch.h"
+#include "LightClusters.h"
+
+#include <cfloat>
+#include <cmath>
+
+namespace Cosmos
+{
+	LightClusters::LightClusters(uint32_t x, uint32_t y, uint32_t z)
+	{
+		mGrid = glm::uvec3(std::max(x, 1u), std::max(y, 1u), std::max(z, 1u));
+		mBounds.resize((size_t)mGrid.x * mGrid.y * mGrid.z);
+		mSliceDepths.resize((size_t)mGrid.z + 1);
+		mLights.reserve(RENDERER_MAX_LIGHTS);
+	}
+
+	void LightClusters::Begin(const glm::mat4& view, const glm::mat4& projection, float zNear, float zFar)
+	{
+		mStart = std::chrono::steady_clock::now();
+		mStats = {};
+		mView = view;
+		mLights.clear();
+
+		if (projection == mProjection && zNear == mNear && zFar == mFar)
+			return;
+
+		mProjection = projection;
+		mNear = zNear;
+		mFar = zFar;
+
+		// a view depth's slice is floor(log(depth) * scale + bias), the slices' depths follow from it
+		float logRatio = std::log(zFar / zNear);
+		mSlicing = glm::vec2((float)mGrid.z / logRatio, -(float)mGrid.z * std::log(zNear) / logRatio);
+
+		for (uint32_t z = 0; z <= mGrid.z; z++)
+		{
+			mSliceDepths[z] = zNear * std::pow(zFar / zNear, (float)z / (float)mGrid.z);
+		}
+
+		// a point at a view depth projects to x = (ndc + projection[2][0]) * depth / projection[0][0], the same goes for y
+		for (uint32_t z = 0; z < mGrid.z; z++)
+		{
+			for (uint32_t y = 0; y < mGrid.y; y++)
+			{
+				for (uint32_t x = 0; x < mGrid.x; x++)
+				{
+					Bounds& bounds = mBounds[((size_t)z * mGrid.y + y) * mGrid.x + x];
+					bounds.minimum = glm::vec3(FLT_MAX, FLT_MAX, -mSliceDepths[z + 1]);
+					bounds.maximum = glm::vec3(-FLT_MAX, -FLT_MAX, -mSliceDepths[z]);
+
+					for (uint32_t corner = 0; corner < 8; corner++)
+					{
+						float ndcX = -1.0f + 2.0f * (float)(x + (corner & 1)) / (float)mGrid.x;
+						float ndcY = -1.0f + 2.0f * (float)(y + ((corner >> 1) & 1)) / (float)mGrid.y;
+						float depth = mSliceDepths[z + (corner >> 2)];
+						glm::vec2 point = glm::vec2((ndcX + projection[2][0]) * depth / projection[0][0], (ndcY + projection[2][1]) * depth / projection[1][1]);
+
+						bounds.minimum = glm::vec3(glm::min(glm::vec2(bounds.minimum), point), bounds.minimum.z);
+						bounds.maximum = glm::vec3(glm::max(glm::vec2(bounds.maximum), point), bounds.maximum.z);
+					}
+				}
+			}
+		}
+	}
+
+	bool LightClusters::AddLight(const Light_SourceData& light)
+	{
+		if (mLights.size() >= RENDERER_MAX_LIGHTS)
+			return false;
+
+		mLights.push_back(light);
+		mStats.lights++;
+		return true;
+	}
+
+	void LightClusters::Bin()
+	{
+		PROFILER_FUNCTION();
+
+		mHits.clear();
+		mClusters.assign(mBounds.size(), {});
+
+		auto slice = [&](float depth) { return (uint32_t)glm::clamp((int32_t)std::floor(std::log(depth) * mSlicing.x + mSlicing.y), 0, (int32_t)mGrid.z - 1); };
+		auto tile = [](float ndc, uint32_t count) { return (uint32_t)glm::clamp((int32_t)std::floor((ndc * 0.5f + 0.5f) * (float)count), 0, (int32_t)count - 1); };
+
+		for (uint32_t i = 0; i < (uint32_t)mLights.size(); i++)
+		{
+			const Light_SourceData& light = mLights[i];
+			glm::vec3 center = glm::vec3(light.position);
+			float radius = light.position.w;
+
+			// a spot narrower than 90 degrees is bound by the smallest sphere around its cone, which has its apex and rim on it
+			if (light.cone.y > 0.5f && light.direction.w >= 0.70710678f)
+			{
+				radius = light.position.w / (2.0f * light.direction.w);
+				center += glm::vec3(light.direction) * radius;
+			}
+
+			glm::vec3 view = glm::vec3(mView * glm::vec4(center, 1.0f));
+			float nearest = -view.z - radius;
+			float farthest = -view.z + radius;
+
+			if (radius <= 0.0f || farthest <= mNear || nearest >= mFar)
+				continue;
+
+			uint32_t firstSlice = nearest <= mNear ? 0 : slice(nearest);
+			uint32_t lastSlice = farthest >= mFar ? mGrid.z - 1 : slice(farthest);
+			bool touched = false;
+
+			for (uint32_t z = firstSlice; z <= lastSlice; z++)
+			{
+				// the tiles are the ones the part of the sphere inside the slice projects to, bound by its widest section there
+				float sliceNear = std::max(mSliceDepths[z], nearest);
+				float sliceFar = std::min(mSliceDepths[z + 1], farthest);
+				float gap = std::max(std::max(sliceNear + view.z, -view.z - sliceFar), 0.0f);
+				float section = std::sqrt(std::max(radius * radius - gap * gap, 0.0f));
+				glm::vec2 minimum = glm::vec2(FLT_MAX);
+				glm::vec2 maximum = glm::vec2(-FLT_MAX);
+
+				for (uint32_t corner = 0; corner < 8; corner++)
+				{
+					float x = view.x + ((corner & 1) ? section : -section);
+					float y = view.y + ((corner & 2) ? section : -section);
+					float depth = (corner & 4) ? sliceFar : sliceNear;
+					glm::vec2 ndc = glm::vec2(mProjection[0][0] * x / depth - mProjection[2][0], mProjection[1][1] * y / depth - mProjection[2][1]);
+
+					minimum = glm::min(minimum, ndc);
+					maximum = glm::max(maximum, ndc);
+				}
+
+				if (maximum.x < -1.0f || maximum.y < -1.0f || minimum.x > 1.0f || minimum.y > 1.0f)
+					continue;
+
+				for (uint32_t y = tile(minimum.y, mGrid.y); y <= tile(maximum.y, mGrid.y); y++)
+				{
+					for (uint32_t x = tile(minimum.x, mGrid.x); x <= tile(maximum.x, mGrid.x); x++)
+					{
+						uint32_t cluster = (z * mGrid.y + y) * mGrid.x + x;
+						const Bounds& bounds = mBounds[cluster];
+						glm::vec3 distance = glm::max(glm::max(bounds.minimum - view, view - bounds.maximum), glm::vec3(0.0f));
+
+						if (glm::dot(distance, distance) > radius * radius)
+							continue;
+
+						mHits.push_back(glm::uvec2(cluster, i));
+						mClusters[cluster].count++;
+						touched = true;
+					}
+				}
+			}
+
+			mStats.visible += touched ? 1 : 0;
+		}
+
+		// each cluster's list follows the previous one's, the counts are rebuilt while the indices are scattered
+		uint32_t offset = 0;
+
+		for (Light_ClusterData& cluster : mClusters)
+		{
+			cluster.firstIndex = offset;
+			offset += cluster.count;
+			mStats.crowded = std::max(mStats.crowded, cluster.count);
+			cluster.count = 0;
+		}
+
+		mIndices.resize(offset);
+
+		for (const glm::uvec2& hit : mHits)
+		{
+			Light_ClusterData& cluster = mClusters[hit.x];
+			mIndices[cluster.firstIndex + cluster.count++] = hit.y;
+		}
+
+		mStats.indices = offset;
+		mStats.milliseconds = (float)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - mStart).count() / 1000.0f;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Defines.h"
+#include "Renderer/Buffer.h"
+#include "Util/Math.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Cosmos
+{
+	// bins lights into the froxels of a view on the cpu, every froxel lists the lights whose bounding sphere touches it
+	// froxels are tiles of the screen split in depth slices spaced exponentially, so that far ones aren't much deeper than they're wide
+	// nothing here touches the gpu, the lists are copied into the frame allocator where model.frag reads them
+	class LightClusters
+	{
+	public:
+
+		struct Stats
+		{
+			uint32_t lights = 0;			// lights added since the last begin
+			uint32_t visible = 0;			// lights touching at least one cluster
+			uint32_t indices = 0;			// light indices written, one per cluster a light touches
+			uint32_t crowded = 0;			// lights touching the most crowded cluster
+			float milliseconds = 0.0f;		// time spent binning the lights
+		};
+
+	public:
+
+		// constructor
+		LightClusters(uint32_t x = RENDERER_LIGHT_CLUSTERS_X, uint32_t y = RENDERER_LIGHT_CLUSTERS_Y, uint32_t z = RENDERER_LIGHT_CLUSTERS_Z);
+
+		// destructor
+		~LightClusters() = default;
+
+	public:
+
+		// returns how many clusters there are along x, y and z
+		inline glm::uvec3 GetGrid() const { return mGrid; }
+
+		// returns the scale and bias turning the log of a view depth into its slice
+		inline glm::vec2 GetSlicing() const { return mSlicing; }
+
+		// returns the statistics since the last begin
+		inline const Stats& GetStats() const { return mStats; }
+
+		// returns the lights added since the last begin
+		inline const std::vector<Light_SourceData>& GetLights() const { return mLights; }
+
+		// returns the lights each cluster lists, x grows first, then y and then the slices
+		inline const std::vector<Light_ClusterData>& GetClusters() const { return mClusters; }
+
+		// returns the lists of light indices the clusters point into
+		inline const std::vector<uint32_t>& GetIndices() const { return mIndices; }
+
+	public:
+
+		// clears the lights, the clusters are laid on the view given, the projection must be a perspective one
+		void Begin(const glm::mat4& view, const glm::mat4& projection, float zNear, float zFar);
+
+		// adds a light, returns false when there are already RENDERER_MAX_LIGHTS
+		bool AddLight(const Light_SourceData& light);
+
+		// bins the lights added into the clusters
+		void Bin();
+
+	private:
+
+		// view space bounds of a cluster
+		struct Bounds
+		{
+			glm::vec3 minimum;
+			glm::vec3 maximum;
+		};
+
+		glm::uvec3 mGrid = glm::uvec3(0);
+		glm::vec2 mSlicing = glm::vec2(0.0f);
+		glm::mat4 mView = glm::mat4(1.0f);
+		glm::mat4 mProjection = glm::mat4(0.0f);
+		float mNear = 0.0f;
+		float mFar = 0.0f;
+
+		// cluster bounds only change with the projection
+		std::vector<Bounds> mBounds = {};
+		std::vector<float> mSliceDepths = {};
+
+		std::vector<Light_SourceData> mLights = {};
+		std::vector<Light_ClusterData> mClusters = {};
+		std::vector<uint32_t> mIndices = {};
+		std::vector<glm::uvec2> mHits = {};
+		std::chrono::steady_clock::time_point mStart = {};
+		Stats mStats = {};
+	};
+}
@@ -0,0 +1,360 @@
+#include "epch.h"
+#include "OcclusionRasterizer.h"
+
+#include "Thread/Pool.h"
+#include "Util/Memory.h"
+
+#include <atomic>
+#include <cfloat>
+
+// pixels are processed 4 at a time with sse, which every x86-64 compiler enables by default
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+	#define OCCLUSION_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace Cosmos
+{
+	OcclusionRasterizer::OcclusionRasterizer(uint32_t width, uint32_t height)
+	{
+		mTilesX = std::max((width + RENDERER_OCCLUSION_TILE_WIDTH - 1) / RENDERER_OCCLUSION_TILE_WIDTH, 1u);
+		mTilesY = std::max((height + RENDERER_OCCLUSION_TILE_HEIGHT - 1) / RENDERER_OCCLUSION_TILE_HEIGHT, 1u);
+		mWidth = mTilesX * RENDERER_OCCLUSION_TILE_WIDTH;
+		mHeight = mTilesY * RENDERER_OCCLUSION_TILE_HEIGHT;
+
+		mDepth.resize((size_t)mWidth * mHeight, FLT_MAX);
+		mBins.resize((size_t)mTilesX * mTilesY);
+	}
+
+	void OcclusionRasterizer::Begin(const glm::mat4& viewProjection)
+	{
+		mStart = std::chrono::steady_clock::now();
+		mViewProjection = viewProjection;
+		mStats = {};
+		mPrimitives.clear();
+
+		for (std::vector<uint32_t>& bin : mBins)
+		{
+			bin.clear();
+		}
+
+		std::fill(mDepth.begin(), mDepth.end(), FLT_MAX);
+	}
+
+	void OcclusionRasterizer::AddOccluder(const std::vector<glm::vec3>& quads, const glm::mat4& transform)
+	{
+		PROFILER_FUNCTION();
+
+		glm::mat4 mvp = mViewProjection * transform;
+		mStats.occluders++;
+
+		for (size_t i = 0; i + 3 < quads.size(); i += 4)
+		{
+			glm::vec3 vertices[4];
+			bool clipped = false;
+
+			for (int v = 0; v < 4; v++)
+			{
+				glm::vec4 clip = mvp * glm::vec4(quads[i + v], 1.0f);
+
+				// clipping against the near plane would only add primitives, dropping the whole primitive stays conservative
+				// depth goes from 0 to 1, vertices behind the eye or between it and the near plane have a negative one
+				if (clip.w <= FLT_EPSILON || clip.z < 0.0f)
+				{
+					clipped = true;
+					break;
+				}
+
+				float inverse = 1.0f / clip.w;
+				vertices[v] = glm::vec3((clip.x * inverse * 0.5f + 0.5f) * (float)mWidth, (clip.y * inverse * 0.5f + 0.5f) * (float)mHeight, clip.z * inverse);
+			}
+
+			if (!clipped)
+				Bin(vertices);
+		}
+	}
+
+	void OcclusionRasterizer::Rasterize()
+	{
+		PROFILER_FUNCTION();
+
+		if (!mPrimitives.empty())
+		{
+			// tiles don't share pixels and are handed out one at a time, the calling thread takes whatever the pool doesn't start
+			// so that a pool busy loading resources never stalls the frame, tasks starting late find no tile left and never touch this
+			struct Progress
+			{
+				std::atomic<uint32_t> next = 0;
+				std::atomic<uint32_t> done = 0;
+			};
+
+			uint32_t tiles = mTilesX * mTilesY;
+			uint32_t tasks = std::min(tiles, std::max(1u, std::thread::hardware_concurrency()));
+			Shared<Progress> progress = CreateShared<Progress>();
+
+			auto rasterizeTiles = [this, progress, tiles]()
+				{
+					for (uint32_t tile = progress->next++; tile < tiles; tile = progress->next++)
+					{
+						RasterizeTile(tile);
+						progress->done++;
+					}
+				};
+
+			for (uint32_t task = 1; task < tasks; task++)
+				thread::PoolManager::GetInstance().GetResourcesPool()->Enqueue(rasterizeTiles);
+
+			rasterizeTiles();
+
+			while (progress->done < tiles)
+				std::this_thread::yield();
+		}
+
+		mStats.milliseconds = (float)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - mStart).count() / 1000.0f;
+	}
+
+	bool OcclusionRasterizer::IsVisible(const glm::vec3& minimum, const glm::vec3& maximum, const glm::mat4& transform)
+	{
+		glm::mat4 mvp = mViewProjection * transform;
+		glm::vec2 screenMin = glm::vec2(FLT_MAX);
+		glm::vec2 screenMax = glm::vec2(-FLT_MAX);
+		float nearest = FLT_MAX;
+
+		mStats.tested++;
+
+		for (int i = 0; i < 8; i++)
+		{
+			glm::vec3 corner = glm::vec3((i & 1) ? maximum.x : minimum.x, (i & 2) ? maximum.y : minimum.y, (i & 4) ? maximum.z : minimum.z);
+			glm::vec4 clip = mvp * glm::vec4(corner, 1.0f);
+
+			// a corner behind the near plane doesn't project where the gpu draws it, the box may cover the whole screen
+			if (clip.w <= FLT_EPSILON || clip.z < 0.0f)
+				return true;
+
+			float inverse = 1.0f / clip.w;
+			glm::vec2 screen = glm::vec2((clip.x * inverse * 0.5f + 0.5f) * (float)mWidth, (clip.y * inverse * 0.5f + 0.5f) * (float)mHeight);
+			screenMin = glm::min(screenMin, screen);
+			screenMax = glm::max(screenMax, screen);
+			nearest = std::min(nearest, clip.z * inverse);
+		}
+
+		// every pixel the box touches must be covered by an occluder nearer than the box, bounds are clamped before they're cast
+		int32_t minX = (int32_t)glm::clamp(std::floor(screenMin.x), 0.0f, (float)mWidth);
+		int32_t minY = (int32_t)glm::clamp(std::floor(screenMin.y), 0.0f, (float)mHeight);
+		int32_t maxX = (int32_t)glm::clamp(std::ceil(screenMax.x), 0.0f, (float)mWidth) - 1;
+		int32_t maxY = (int32_t)glm::clamp(std::ceil(screenMax.y), 0.0f, (float)mHeight) - 1;
+
+		if (minX > maxX || minY > maxY)
+			return true;
+
+		for (int32_t y = minY; y <= maxY; y++)
+		{
+			const float* row = &mDepth[(size_t)y * mWidth];
+			int32_t x = minX;
+
+#ifdef OCCLUSION_SSE
+			__m128 boxDepth = _mm_set1_ps(nearest);
+
+			for (; x + 3 <= maxX; x += 4)
+			{
+				if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)) != 0)
+					return true;
+			}
+#endif
+
+			for (; x <= maxX; x++)
+			{
+				if (row[x] >= nearest)
+					return true;
+			}
+		}
+
+		mStats.occluded++;
+		return false;
+	}
+
+	void OcclusionRasterizer::Bin(const glm::vec3 (&vertices)[4])
+	{
+		auto cross = [](const glm::vec3& origin, const glm::vec3& first, const glm::vec3& second)
+			{
+				return (first.x - origin.x) * (second.y - origin.y) - (first.y - origin.y) * (second.x - origin.x);
+			};
+
+		float area = cross(vertices[0], vertices[1], vertices[2]) + cross(vertices[0], vertices[2], vertices[3]);
+
+		if (std::abs(area) <= FLT_EPSILON)
+			return;
+
+		// both windings occlude, edges are walked counter-clockwise so the inside is positive
+		glm::vec3 ordered[4] = { vertices[0], vertices[1], vertices[2], vertices[3] };
+
+		if (area < 0.0f)
+			std::swap(ordered[1], ordered[3]);
+
+		// the edges only bound the quad when it's convex, a repeated vertex turns it into a triangle
+		for (int i = 0; i < 4; i++)
+		{
+			if (cross(ordered[i], ordered[(i + 1) % 4], ordered[(i + 2) % 4]) < 0.0f)
+			{
+				glm::vec3 first[4] = { vertices[0], vertices[1], vertices[2], vertices[2] };
+				glm::vec3 second[4] = { vertices[0], vertices[2], vertices[3], vertices[3] };
+				Bin(first);
+				Bin(second);
+				return;
+			}
+		}
+
+		// only pixels lying entirely inside the primitive are covered, so they fit in the inner bounds, clamped before they're cast
+		float minX = std::min({ ordered[0].x, ordered[1].x, ordered[2].x, ordered[3].x });
+		float minY = std::min({ ordered[0].y, ordered[1].y, ordered[2].y, ordered[3].y });
+		float maxX = std::max({ ordered[0].x, ordered[1].x, ordered[2].x, ordered[3].x });
+		float maxY = std::max({ ordered[0].y, ordered[1].y, ordered[2].y, ordered[3].y });
+
+		Primitive primitive = {};
+		primitive.minX = (int32_t)glm::clamp(std::ceil(minX), 0.0f, (float)mWidth);
+		primitive.minY = (int32_t)glm::clamp(std::ceil(minY), 0.0f, (float)mHeight);
+		primitive.maxX = (int32_t)glm::clamp(std::floor(maxX), 0.0f, (float)mWidth) - 1;
+		primitive.maxY = (int32_t)glm::clamp(std::floor(maxY), 0.0f, (float)mHeight) - 1;
+
+		if (primitive.minX > primitive.maxX || primitive.minY > primitive.maxY)
+			return;
+
+		// an edge's smallest value over a pixel is at its center minus half its gradient on both axis, a repeated vertex always passes
+		for (int e = 0; e < 4; e++)
+		{
+			const glm::vec3& from = ordered[e];
+			const glm::vec3& to = ordered[(e + 1) % 4];
+
+			primitive.edgeA[e] = from.y - to.y;
+			primitive.edgeB[e] = to.x - from.x;
+			primitive.edgeC[e] = from.x * to.y - from.y * to.x - 0.5f * (std::abs(primitive.edgeA[e]) + std::abs(primitive.edgeB[e]));
+		}
+
+		// depth is affine in screen space over each half, the farthest of both planes bounds a quad that isn't flat
+		// a plane's largest value over a pixel is at its center plus half its gradient on both axis
+		for (int h = 0; h < 2; h++)
+		{
+			const glm::vec3& origin = ordered[0];
+			glm::vec3 first = ordered[h + 1] - origin;
+			glm::vec3 second = ordered[h + 2] - origin;
+			float half = first.x * second.y - first.y * second.x;
+
+			// a triangle's degenerate half takes the other one's plane
+			if (half <= FLT_EPSILON)
+			{
+				first = ordered[(1 - h) + 1] - origin;
+				second = ordered[(1 - h) + 2] - origin;
+				half = first.x * second.y - first.y * second.x;
+			}
+
+			primitive.depthA[h] = (first.z * second.y - second.z * first.y) / half;
+			primitive.depthB[h] = (second.z * first.x - first.z * second.x) / half;
+			primitive.depthC[h] = origin.z - primitive.depthA[h] * origin.x - primitive.depthB[h] * origin.y + 0.5f * (std::abs(primitive.depthA[h]) + std::abs(primitive.depthB[h]));
+		}
+
+		uint32_t index = (uint32_t)mPrimitives.size();
+		mPrimitives.push_back(primitive);
+		mStats.primitives++;
+
+		for (int32_t y = primitive.minY / RENDERER_OCCLUSION_TILE_HEIGHT; y <= primitive.maxY / RENDERER_OCCLUSION_TILE_HEIGHT; y++)
+		{
+			for (int32_t x = primitive.minX / RENDERER_OCCLUSION_TILE_WIDTH; x <= primitive.maxX / RENDERER_OCCLUSION_TILE_WIDTH; x++)
+			{
+				mBins[(size_t)y * mTilesX + x].push_back(index);
+			}
+		}
+	}
+
+	void OcclusionRasterizer::RasterizeTile(uint32_t tile)
+	{
+		int32_t tileMinX = (int32_t)((tile % mTilesX) * RENDERER_OCCLUSION_TILE_WIDTH);
+		int32_t tileMinY = (int32_t)((tile / mTilesX) * RENDERER_OCCLUSION_TILE_HEIGHT);
+		int32_t tileMaxX = tileMinX + RENDERER_OCCLUSION_TILE_WIDTH - 1;
+		int32_t tileMaxY = tileMinY + RENDERER_OCCLUSION_TILE_HEIGHT - 1;
+
+		for (uint32_t index : mBins[tile])
+		{
+			const Primitive& primitive = mPrimitives[index];
+			int32_t minY = std::max(primitive.minY, tileMinY);
+			int32_t maxY = std::min(primitive.maxY, tileMaxY);
+
+			for (int32_t y = minY; y <= maxY; y++)
+			{
+				float centerY = (float)y + 0.5f;
+				float edges[4];
+				float spanMin = (float)std::max(primitive.minX, tileMinX);
+				float spanMax = (float)std::min(primitive.maxX, tileMaxX);
+
+				// the row's span is where every edge is positive, the pixels at its ends are still tested against the edges
+				for (int e = 0; e < 4; e++)
+				{
+					edges[e] = primitive.edgeB[e] * centerY + primitive.edgeC[e];
+
+					if (primitive.edgeA[e] > 0.0f)
+						spanMin = std::max(spanMin, std::floor(-edges[e] / primitive.edgeA[e] - 0.5f));
+
+					else if (primitive.edgeA[e] < 0.0f)
+						spanMax = std::min(spanMax, std::ceil(-edges[e] / primitive.edgeA[e] - 0.5f));
+
+					else if (edges[e] < 0.0f)
+						spanMax = -1.0f;
+				}
+
+				if (spanMin > spanMax)
+					continue;
+
+				// spans start on a multiple of 4 inside the tile, the extra pixels fail the edge tests if the primitive doesn't cover them
+				int32_t minX = (int32_t)spanMin & ~3;
+				int32_t maxX = (int32_t)spanMax;
+				float depth0 = primitive.depthB[0] * centerY + primitive.depthC[0];
+				float depth1 = primitive.depthB[1] * centerY + primitive.depthC[1];
+				float* row = &mDepth[(size_t)y * mWidth];
+
+#ifdef OCCLUSION_SSE
+				const __m128 zero = _mm_setzero_ps();
+				const __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+				for (int32_t x = minX; x <= maxX; x += 4)
+				{
+					__m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+
+					__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(primitive.edgeA[0]), centerX), _mm_set1_ps(edges[0])), zero);
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(primitive.edgeA[1]), centerX), _mm_set1_ps(edges[1])), zero));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(primitive.edgeA[2]), centerX), _mm_set1_ps(edges[2])), zero));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(primitive.edgeA[3]), centerX), _mm_set1_ps(edges[3])), zero));
+
+					if (_mm_movemask_ps(inside) == 0)
+						continue;
+
+					__m128 depth = _mm_max_ps
+					(
+						_mm_add_ps(_mm_mul_ps(_mm_set1_ps(primitive.depthA[0]), centerX), _mm_set1_ps(depth0)),
+						_mm_add_ps(_mm_mul_ps(_mm_set1_ps(primitive.depthA[1]), centerX), _mm_set1_ps(depth1))
+					);
+
+					__m128 previous = _mm_loadu_ps(row + x);
+					__m128 nearest = _mm_min_ps(previous, depth);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+				}
+#else
+				for (int32_t x = minX; x <= maxX; x++)
+				{
+					float centerX = (float)x + 0.5f;
+					bool inside = true;
+
+					for (int e = 0; e < 4; e++)
+					{
+						inside &= primitive.edgeA[e] * centerX + edges[e] >= 0.0f;
+					}
+
+					if (!inside)
+						continue;
+
+					float depth = std::max(primitive.depthA[0] * centerX + depth0, primitive.depthA[1] * centerX + depth1);
+					row[x] = std::min(row[x], depth);
+				}
+#endif
+			}
+		}
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Math.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Cosmos
+{
+	// rasterizes occluders into a small depth buffer on the cpu and tests bounding boxes against it, nothing here touches the gpu
+	// a pixel only takes an occluder's depth when the occluder covers it entirely, at the farthest depth the occluder reaches over it,
+	// so a box reported as occluded is always hidden, while boxes hidden behind occluder edges may still be reported visible
+	class OcclusionRasterizer
+	{
+	public:
+
+		struct Stats
+		{
+			uint32_t occluders = 0;			// occluders binned since the last begin
+			uint32_t primitives = 0;		// occluder quads and triangles binned, the ones crossing the near plane or covering no pixel are dropped
+			uint32_t tested = 0;			// boxes tested since the last begin
+			uint32_t occluded = 0;			// boxes found hidden
+			float milliseconds = 0.0f;		// time spent binning and rasterizing the occluders
+		};
+
+	public:
+
+		// constructor, the size is rounded up to whole tiles
+		OcclusionRasterizer(uint32_t width = RENDERER_OCCLUSION_WIDTH, uint32_t height = RENDERER_OCCLUSION_HEIGHT);
+
+		// destructor
+		~OcclusionRasterizer() = default;
+
+	public:
+
+		// returns the width of the depth buffer
+		inline uint32_t GetWidth() const { return mWidth; }
+
+		// returns the height of the depth buffer
+		inline uint32_t GetHeight() const { return mHeight; }
+
+		// returns the statistics since the last begin
+		inline const Stats& GetStats() const { return mStats; }
+
+		// returns the depth of a pixel, FLT_MAX where no occluder covers it entirely
+		inline float GetDepth(uint32_t x, uint32_t y) const { return mDepth[(size_t)y * mWidth + x]; }
+
+	public:
+
+		// clears the depth buffer and the binned occluders, boxes are tested with the same view projection
+		void Begin(const glm::mat4& viewProjection);
+
+		// bins an occluder given as convex quads of four vertices, triangles repeat their last vertex
+		// quads are rasterized whole so that the diagonal they're made of leaves no crack, primitives with a vertex in front of the near plane are dropped, as the gpu clips them
+		void AddOccluder(const std::vector<glm::vec3>& quads, const glm::mat4& transform);
+
+		// rasterizes the binned occluders, tiles are split across the resources pool and the calling thread
+		void Rasterize();
+
+		// returns if any part of a box may be visible, boxes crossing the near plane or outside the screen are always visible
+		bool IsVisible(const glm::vec3& minimum, const glm::vec3& maximum, const glm::mat4& transform);
+
+	private:
+
+		// bins a primitive given in pixel space, split in two triangles when it's not convex on screen
+		void Bin(const glm::vec3 (&vertices)[4]);
+
+		// rasterizes the primitives binned to a tile
+		void RasterizeTile(uint32_t tile);
+
+	private:
+
+		// edges and the depth planes of both halves in pixel space, evaluated at pixel centers and offset so they hold for the whole pixel
+		struct Primitive
+		{
+			float edgeA[4];
+			float edgeB[4];
+			float edgeC[4];
+			float depthA[2];
+			float depthB[2];
+			float depthC[2];
+			int32_t minX;
+			int32_t minY;
+			int32_t maxX;
+			int32_t maxY;
+		};
+
+		uint32_t mWidth = 0;
+		uint32_t mHeight = 0;
+		uint32_t mTilesX = 0;
+		uint32_t mTilesY = 0;
+		glm::mat4 mViewProjection = glm::mat4(1.0f);
+		std::vector<float> mDepth = {};
+		std::vector<Primitive> mPrimitives = {};
+		std::vector<std::vector<uint32_t>> mBins = {};
+		std::chrono::steady_clock::time_point mStart = {};
+		Stats mStats = {};
+	};
+}
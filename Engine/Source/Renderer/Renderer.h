@@ -37,6 +37,9 @@ namespace Cosmos
 
 	public:
 
+		// waits until the next frame may begin, called before the input it shows is sampled
+		virtual void WaitFrame() = 0;
+
 		// updates the renderer
 		virtual void OnUpdate() = 0;
 
@@ -3,9 +3,17 @@
 
 #include "Vulkan/VKDevice.h"
 #include "Vulkan/VKTexture.h"
+#include "Util/Archive.h"
+
+#include <mutex>
+#include <unordered_map>
 
 namespace Cosmos
 {
+	// textures are only weakly held, they're destroyed as soon as the last user releases them
+	static std::unordered_map<std::string, std::weak_ptr<Texture2D>> sTextureCache;
+	static std::mutex sTextureCacheMutex;
+
 	TextureSampler::AddressMode TextureSampler::WrapMode(int32_t wrap)
 	{
 		switch (wrap)
@@ -37,9 +45,45 @@ namespace Cosmos
 		return Filter::FILTER_NEAREST;
 	}
 
-	Shared<Texture2D> Cosmos::Texture2D::Create(Shared<VKDevice> device, const char* path, MSAA msaa)
+	Shared<Texture2D> Cosmos::Texture2D::Create(Shared<VKDevice> device, const char* path, MSAA msaa, const TextureSampler& sampler)
 	{
-		return CreateShared<VKTexture2D>(device, path, (VkSampleCountFlagBits)msaa);
+		std::ostringstream key;
+		key << Archive::NormalizePath(path) << '|' << (int32_t)msaa << '|' << (int32_t)sampler.mag << (int32_t)sampler.min;
+		key << (int32_t)sampler.u << (int32_t)sampler.v << (int32_t)sampler.w;
+
+		{
+			std::lock_guard<std::mutex> lock(sTextureCacheMutex);
+			auto it = sTextureCache.find(key.str());
+
+			if (it != sTextureCache.end())
+			{
+				if (Shared<Texture2D> texture = it->second.lock())
+					return texture;
+
+				sTextureCache.erase(it);
+			}
+		}
+
+		// loading happens outside the lock so other textures aren't stalled
+		Shared<Texture2D> texture = CreateShared<VKTexture2D>(device, path, (VkSampleCountFlagBits)msaa, sampler);
+
+		std::lock_guard<std::mutex> lock(sTextureCacheMutex);
+
+		// entries of released textures are dropped as new ones come in, so the cache doesn't grow with every texture ever loaded
+		for (auto it = sTextureCache.begin(); it != sTextureCache.end();)
+		{
+			if (it->second.expired()) it = sTextureCache.erase(it);
+			else it++;
+		}
+
+		std::weak_ptr<Texture2D>& entry = sTextureCache[key.str()];
+
+		// another thread may have loaded the same texture meanwhile, keep the first one
+		if (Shared<Texture2D> existing = entry.lock())
+			return existing;
+
+		entry = texture;
+		return texture;
 	}
 
 	Shared<TextureCubemap> TextureCubemap::Create(Shared<VKDevice> device, std::array<std::string, 6> paths, MSAA msaa)
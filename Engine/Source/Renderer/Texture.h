@@ -42,8 +42,11 @@ namespace Cosmos
 		// translates the filter mode for the renderer api
 		static Filter FilterMode(int32_t filter);
 
-		Filter mag = Filter::FILTER_NEAREST;
-		Filter min = Filter::FILTER_NEAREST;
+		// returns if both samplers have the same settings
+		inline bool operator==(const TextureSampler& other) const { return mag == other.mag && min == other.min && u == other.u && v == other.v && w == other.w; }
+
+		Filter mag = Filter::FILTER_LINEAR;
+		Filter min = Filter::FILTER_LINEAR;
 		AddressMode u = AddressMode::ADDRESS_MODE_REPEAT;
 		AddressMode v = AddressMode::ADDRESS_MODE_REPEAT;
 		AddressMode w = AddressMode::ADDRESS_MODE_REPEAT;
@@ -53,8 +56,8 @@ namespace Cosmos
 	{
 	public:
 
-		// creates a texture from an input file
-		static Shared<Texture2D> Create(Shared<VKDevice> device, const char* path, MSAA msaa = MSAA::SAMPLE_1_BIT);
+		// returns a texture from an input file, textures with the same path and settings are shared while alive
+		static Shared<Texture2D> Create(Shared<VKDevice> device, const char* path, MSAA msaa = MSAA::SAMPLE_1_BIT, const TextureSampler& sampler = {});
 
 		// constructor
 		Texture2D() = default;
@@ -70,6 +73,9 @@ namespace Cosmos
 		// returns a reference to the image sampler
 		virtual VkSampler GetSampler() = 0;
 
+		// requests the texture to have at least this mip level resident (0 is the full resolution), only streamed textures care
+		virtual void RequestMip(int32_t mip) {}
+
 	public:
 
 		// returns the texture width
@@ -81,11 +87,27 @@ namespace Cosmos
 		// returns the mip levels
 		inline int32_t GetMipLevels() const { return mMipLevels; }
 
+		// returns the most detailed mip level currently on the gpu
+		inline int32_t GetResidentMip() const { return mResidentMip; }
+
+		// returns the most detailed mip level requested during the last streaming update
+		inline int32_t GetLastRequestedMip() const { return mLastRequestedMip; }
+
+		// returns a counter that changes whenever the view is replaced, descriptors referencing the view must be rewritten
+		inline uint32_t GetVersion() const { return mVersion; }
+
+		// returns the uploader ticket of the current image, frames sampling the texture must require it
+		inline uint64_t GetUploadTicket() const { return mUploadTicket; }
+
 	protected:
 
 		int32_t mWidth = 0;
 		int32_t mHeight = 0;
 		int32_t mMipLevels = 1;
+		int32_t mResidentMip = 0;
+		int32_t mLastRequestedMip = 0;
+		uint32_t mVersion = 0;
+		uint64_t mUploadTicket = 0;
 	};
 
 	class TextureCubemap
@@ -120,10 +142,14 @@ namespace Cosmos
 		// returns the mip levels
 		inline int32_t GetMipLevels() const { return mMipLevels; }
 
+		// returns the uploader ticket of the image, frames sampling the texture must require it
+		inline uint64_t GetUploadTicket() const { return mUploadTicket; }
+
 	protected:
 
 		int32_t mWidth = 0;
 		int32_t mHeight = 0;
 		int32_t mMipLevels = 1;
+		uint64_t mUploadTicket = 0;
 	};
 }
\ No newline at end of file
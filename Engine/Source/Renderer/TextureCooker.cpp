@@ -0,0 +1,518 @@
+#include "epch.h"
+#include "TextureCooker.h"
+
+#include "Thread/Pool.h"
+#include "Util/FileSystem.h"
+#include "wrapper_stb.h"
+
+#include <cmath>
+#include <cstring>
+#include <future>
+
+// sse2 is always available on x86-64, used to find the bounding box of a block in a few instructions
+#if defined(__SSE2__) || defined(_M_X64)
+	#define COOKER_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace Cosmos
+{
+	// srgb <-> linear conversion used while filtering mips
+	static float sSRGBToLinear[256] = {};
+	static bool sSRGBTableReady = false;
+
+	static void BuildSRGBTable()
+	{
+		if (sSRGBTableReady)
+			return;
+
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			float c = (float)i / 255.0f;
+			sSRGBToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+
+		sSRGBTableReady = true;
+	}
+
+	static inline uint8_t LinearToSRGB(float c)
+	{
+		c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		return (uint8_t)std::min(255.0f, std::max(0.0f, c * 255.0f + 0.5f));
+	}
+
+	// gathers a 4x4 rgba block, replicating the edge pixels when the image isn't a multiple of 4
+	static inline void FetchBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t block[64])
+	{
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			uint32_t sy = std::min(by * 4 + y, height - 1);
+
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				uint32_t sx = std::min(bx * 4 + x, width - 1);
+				memcpy(&block[(y * 4 + x) * 4], &pixels[((size_t)sy * width + sx) * 4], 4);
+			}
+		}
+	}
+
+	// per-channel minimum and maximum of the 16 pixels of a block
+	static inline void BlockMinMax(const uint8_t block[64], uint8_t minColor[4], uint8_t maxColor[4])
+	{
+#if defined(COOKER_SSE2)
+		__m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 0));
+		__m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16));
+		__m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 32));
+		__m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 48));
+
+		__m128i lo = _mm_min_epu8(_mm_min_epu8(r0, r1), _mm_min_epu8(r2, r3));
+		__m128i hi = _mm_max_epu8(_mm_max_epu8(r0, r1), _mm_max_epu8(r2, r3));
+
+		// fold the four pixels left in each register into one
+		lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 8));
+		lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+		hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 8));
+		hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+
+		uint32_t packedMin = (uint32_t)_mm_cvtsi128_si32(lo);
+		uint32_t packedMax = (uint32_t)_mm_cvtsi128_si32(hi);
+		memcpy(minColor, &packedMin, 4);
+		memcpy(maxColor, &packedMax, 4);
+#else
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			minColor[c] = 255;
+			maxColor[c] = 0;
+		}
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+				maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+			}
+		}
+#endif
+	}
+
+	static inline uint16_t To565(const uint8_t color[4])
+	{
+		return (uint16_t)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+	}
+
+	static inline void From565(uint16_t packed, int32_t color[3])
+	{
+		int32_t r = (packed >> 11) & 31;
+		int32_t g = (packed >> 5) & 63;
+		int32_t b = packed & 31;
+
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// bc1 color block, range fit on the inset bounding box, always in 4-color mode
+	static void EncodeBC1(const uint8_t block[64], uint8_t* out)
+	{
+		uint8_t minColor[4], maxColor[4];
+		BlockMinMax(block, minColor, maxColor);
+
+		// insetting the box by 1/16 of its extent reduces the error of the interpolated colors
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			uint8_t inset = (uint8_t)((maxColor[c] - minColor[c]) >> 4);
+			minColor[c] = (uint8_t)std::min(255, minColor[c] + inset);
+			maxColor[c] = (uint8_t)(maxColor[c] - inset);
+		}
+
+		uint16_t color0 = To565(maxColor);
+		uint16_t color1 = To565(minColor);
+		uint32_t indices = 0;
+
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		if (color0 != color1)
+		{
+			int32_t palette[4][3];
+			From565(color0, palette[0]);
+			From565(color1, palette[1]);
+
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t best = 0;
+				int32_t bestDistance = INT32_MAX;
+
+				for (uint32_t p = 0; p < 4; p++)
+				{
+					int32_t dr = block[i * 4 + 0] - palette[p][0];
+					int32_t dg = block[i * 4 + 1] - palette[p][1];
+					int32_t db = block[i * 4 + 2] - palette[p][2];
+					int32_t distance = dr * dr + dg * dg + db * db;
+
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+
+				indices |= best << (i * 2);
+			}
+		}
+
+		out[0] = (uint8_t)(color0 & 0xFF);
+		out[1] = (uint8_t)(color0 >> 8);
+		out[2] = (uint8_t)(color1 & 0xFF);
+		out[3] = (uint8_t)(color1 >> 8);
+		memcpy(out + 4, &indices, 4);
+	}
+
+	// bc4 single channel block (used for bc3 alpha and both bc5 channels), always in 8-value mode
+	static void EncodeBC4(const uint8_t block[64], uint32_t channel, uint8_t minValue, uint8_t maxValue, uint8_t* out)
+	{
+		uint64_t indices = 0;
+
+		if (maxValue > minValue)
+		{
+			int32_t palette[8];
+			palette[0] = maxValue;
+			palette[1] = minValue;
+
+			for (int32_t i = 1; i < 7; i++)
+				palette[i + 1] = ((7 - i) * maxValue + i * minValue) / 7;
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint64_t best = 0;
+				int32_t bestDistance = INT32_MAX;
+
+				for (uint32_t p = 0; p < 8; p++)
+				{
+					int32_t distance = std::abs(block[i * 4 + channel] - palette[p]);
+
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+
+				indices |= best << (i * 3);
+			}
+		}
+
+		out[0] = maxValue;
+		out[1] = minValue;
+
+		for (uint32_t i = 0; i < 6; i++)
+			out[2 + i] = (uint8_t)(indices >> (i * 8));
+	}
+
+	bool TextureCooker::Cook(std::string input, std::string output, Format format, bool mipmaps)
+	{
+		PROFILER_FUNCTION();
+
+		std::vector<uint8_t> file = ReadFromBinary(input);
+		int32_t width = 0, height = 0, channels = 0;
+		stbi_uc* pixels = stbi_load_from_memory(file.data(), (int32_t)file.size(), &width, &height, &channels, STBI_rgb_alpha);
+
+		if (pixels == nullptr)
+		{
+			LOG_TO_TERMINAL(Logger::Error, "Failed to cook %s, could not decode the image", input.c_str());
+			return false;
+		}
+
+		std::vector<uint8_t> level(pixels, pixels + (size_t)width * height * 4);
+		stbi_image_free(pixels);
+
+		// opaque images don't need the extra alpha block
+		if (format == Format::Auto)
+		{
+			bool opaque = true;
+
+			for (size_t i = 3; i < level.size() && opaque; i += 4)
+				opaque = level[i] == 255;
+
+			format = opaque ? Format::BC1 : Format::BC3;
+		}
+
+		Header header = {};
+		header.format = format;
+		header.width = (uint32_t)width;
+		header.height = (uint32_t)height;
+		header.mipLevels = mipmaps ? (uint32_t)(std::floor(std::log2(std::max(width, height)))) + 1 : 1;
+		header.mipLevels = std::min(header.mipLevels, (uint32_t)COOKED_TEXTURE_MAX_MIPS);
+
+		// build and encode the whole mip chain
+		std::vector<std::vector<uint8_t>> encoded(header.mipLevels);
+		uint32_t mipWidth = header.width;
+		uint32_t mipHeight = header.height;
+		uint64_t offset = sizeof(Header);
+
+		for (uint32_t i = 0; i < header.mipLevels; i++)
+		{
+			encoded[i] = format == Format::RGBA8 ? level : Encode(level, mipWidth, mipHeight, format);
+
+			offset = (offset + 15) & ~15ull; // keeps every level aligned for the buffer to image copy
+			header.levels[i].offset = offset;
+			header.levels[i].size = encoded[i].size();
+			header.levels[i].width = mipWidth;
+			header.levels[i].height = mipHeight;
+			offset += encoded[i].size();
+
+			if (i + 1 < header.mipLevels)
+			{
+				level = Downsample(level, mipWidth, mipHeight, format != Format::BC5);
+				mipWidth = std::max(1u, mipWidth / 2);
+				mipHeight = std::max(1u, mipHeight / 2);
+			}
+		}
+
+		// write into a temporary file and swap it in place only when done
+		std::string temporary = output + ".tmp";
+		std::ofstream stream(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+
+		if (!stream.is_open())
+		{
+			LOG_TO_TERMINAL(Logger::Error, "Error when opening file %s for writting", temporary.c_str());
+			return false;
+		}
+
+		const char padding[16] = {};
+		uint64_t written = sizeof(Header);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+		for (uint32_t i = 0; i < header.mipLevels; i++)
+		{
+			stream.write(padding, header.levels[i].offset - written);
+			stream.write(reinterpret_cast<const char*>(encoded[i].data()), encoded[i].size());
+			written = header.levels[i].offset + encoded[i].size();
+		}
+
+		stream.close();
+
+		std::error_code error;
+		std::filesystem::rename(temporary, output, error);
+
+		if (error)
+		{
+			LOG_TO_TERMINAL(Logger::Error, "Failed to move cooked texture %s into %s: %s", temporary.c_str(), output.c_str(), error.message().c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	uint32_t TextureCooker::CookFolder(std::string folder, Format format)
+	{
+		PROFILER_FUNCTION();
+
+		const char* extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp" };
+		uint32_t cooked = 0;
+
+		for (const std::filesystem::directory_entry& dirEntry : std::filesystem::recursive_directory_iterator(folder))
+		{
+			if (!dirEntry.is_regular_file())
+				continue;
+
+			std::string extension = dirEntry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower(c); });
+
+			if (std::find_if(std::begin(extensions), std::end(extensions), [&](const char* e) { return extension == e; }) == std::end(extensions))
+				continue;
+
+			std::string source = dirEntry.path().string();
+			std::string destination = GetCookedPath(source);
+
+			// skip textures already cooked after their last modification
+			std::error_code error;
+			if (std::filesystem::exists(destination) && std::filesystem::last_write_time(destination, error) >= dirEntry.last_write_time())
+				continue;
+
+			if (Cook(source, destination, format))
+				cooked++;
+		}
+
+		LOG_TO_TERMINAL(Logger::Info, "Cooked %d textures inside %s", cooked, folder.c_str());
+		return cooked;
+	}
+
+	bool TextureCooker::Parse(const std::vector<uint8_t>& file, Header& header, bool headerOnly)
+	{
+		if (file.size() < sizeof(Header))
+			return false;
+
+		memcpy(&header, file.data(), sizeof(Header));
+
+		if (memcmp(header.magic, "CTEX", 4) != 0 || header.version != Header().version)
+			return false;
+
+		if (header.format == Format::Auto || header.format > Format::BC5)
+			return false;
+
+		if (header.mipLevels == 0 || header.mipLevels > COOKED_TEXTURE_MAX_MIPS)
+			return false;
+
+		for (uint32_t i = 0; i < header.mipLevels; i++)
+		{
+			const Level& level = header.levels[i];
+
+			if (level.size != GetLevelSize(header.format, level.width, level.height))
+				return false;
+
+			if (!headerOnly && level.offset + level.size > file.size())
+				return false;
+
+			// levels are stored from the biggest to the smallest, streaming relies on it
+			if (i > 0 && level.offset < header.levels[i - 1].offset + header.levels[i - 1].size)
+				return false;
+		}
+
+		return true;
+	}
+
+	std::string TextureCooker::GetCookedPath(std::string path)
+	{
+		return std::filesystem::path(path).replace_extension(COOKED_TEXTURE_EXTENSION).generic_string();
+	}
+
+	uint64_t TextureCooker::GetLevelSize(Format format, uint32_t width, uint32_t height)
+	{
+		uint64_t blocks = (uint64_t)std::max(1u, (width + 3) / 4) * std::max(1u, (height + 3) / 4);
+
+		switch (format)
+		{
+			case Format::RGBA8: return (uint64_t)width * height * 4;
+			case Format::BC1: return blocks * 8;
+			case Format::BC3: return blocks * 16;
+			case Format::BC5: return blocks * 16;
+			default: return 0;
+		}
+	}
+
+	std::vector<uint8_t> TextureCooker::Downsample(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, bool srgb)
+	{
+		BuildSRGBTable();
+
+		uint32_t newWidth = std::max(1u, width / 2);
+		uint32_t newHeight = std::max(1u, height / 2);
+		std::vector<uint8_t> result((size_t)newWidth * newHeight * 4);
+
+		for (uint32_t y = 0; y < newHeight; y++)
+		{
+			uint32_t y0 = std::min(y * 2, height - 1);
+			uint32_t y1 = std::min(y * 2 + 1, height - 1);
+
+			for (uint32_t x = 0; x < newWidth; x++)
+			{
+				uint32_t x0 = std::min(x * 2, width - 1);
+				uint32_t x1 = std::min(x * 2 + 1, width - 1);
+
+				const uint8_t* p[4] =
+				{
+					&pixels[((size_t)y0 * width + x0) * 4],
+					&pixels[((size_t)y0 * width + x1) * 4],
+					&pixels[((size_t)y1 * width + x0) * 4],
+					&pixels[((size_t)y1 * width + x1) * 4]
+				};
+
+				uint8_t* dst = &result[((size_t)y * newWidth + x) * 4];
+
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					// color is filtered in linear space, alpha is always linear
+					if (srgb && c < 3)
+					{
+						float sum = sSRGBToLinear[p[0][c]] + sSRGBToLinear[p[1][c]] + sSRGBToLinear[p[2][c]] + sSRGBToLinear[p[3][c]];
+						dst[c] = LinearToSRGB(sum * 0.25f);
+					}
+
+					else
+					{
+						dst[c] = (uint8_t)((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+					}
+				}
+			}
+		}
+
+		return result;
+	}
+
+	std::vector<uint8_t> TextureCooker::Encode(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, Format format)
+	{
+		uint32_t blocksX = std::max(1u, (width + 3) / 4);
+		uint32_t blocksY = std::max(1u, (height + 3) / 4);
+		uint32_t blockSize = format == Format::BC1 ? 8 : 16;
+		std::vector<uint8_t> result((size_t)blocksX * blocksY * blockSize);
+
+		auto encodeRows = [&](uint32_t firstRow, uint32_t lastRow)
+		{
+			uint8_t block[64];
+			uint8_t minColor[4], maxColor[4];
+
+			for (uint32_t by = firstRow; by < lastRow; by++)
+			{
+				for (uint32_t bx = 0; bx < blocksX; bx++)
+				{
+					uint8_t* out = &result[((size_t)by * blocksX + bx) * blockSize];
+					FetchBlock(pixels.data(), width, height, bx, by, block);
+
+					switch (format)
+					{
+						case Format::BC1:
+						{
+							EncodeBC1(block, out);
+							break;
+						}
+
+						case Format::BC3:
+						{
+							BlockMinMax(block, minColor, maxColor);
+							EncodeBC4(block, 3, minColor[3], maxColor[3], out);
+							EncodeBC1(block, out + 8);
+							break;
+						}
+
+						case Format::BC5:
+						{
+							BlockMinMax(block, minColor, maxColor);
+							EncodeBC4(block, 0, minColor[0], maxColor[0], out);
+							EncodeBC4(block, 1, minColor[1], maxColor[1], out + 8);
+							break;
+						}
+
+						default: break;
+					}
+				}
+			}
+		};
+
+		// small levels aren't worth the dispatch
+		if (blocksY < 16)
+		{
+			encodeRows(0, blocksY);
+			return result;
+		}
+
+		// split the rows of blocks across the resources pool
+		uint32_t tasks = std::min(blocksY / 8, std::max(1u, std::thread::hardware_concurrency()));
+		uint32_t rowsPerTask = (blocksY + tasks - 1) / tasks;
+		std::vector<std::future<void>> futures;
+
+		for (uint32_t first = 0; first < blocksY; first += rowsPerTask)
+			futures.push_back(thread::PoolManager::GetInstance().GetResourcesPool()->Enqueue(encodeRows, first, std::min(first + rowsPerTask, blocksY)));
+
+		for (auto& future : futures)
+			future.wait();
+
+		return result;
+	}
+}
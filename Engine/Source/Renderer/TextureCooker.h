@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// maximum amount of mip levels a cooked texture may have (enough for 32k textures)
+#define COOKED_TEXTURE_MAX_MIPS 16
+
+// file extension used by cooked textures
+#define COOKED_TEXTURE_EXTENSION ".ctex"
+
+namespace Cosmos
+{
+	// converts source images (png, jpg, ...) into gpu-ready files with the full mip chain, optionally block compressed
+	class TextureCooker
+	{
+	public:
+
+		typedef enum Format : uint32_t
+		{
+			Auto = 0,	// picks BC1 for opaque images and BC3 otherwise, never stored on disk
+			RGBA8,		// uncompressed srgb
+			BC1,		// 4 bpp srgb, 1-bit alpha
+			BC3,		// 8 bpp srgb, interpolated alpha
+			BC5			// 8 bpp unorm, two channels (normal maps)
+		} Format;
+
+		struct Level
+		{
+			uint64_t offset = 0;	// offset of the level data from the begining of the file
+			uint64_t size = 0;		// size of the level data
+			uint32_t width = 0;
+			uint32_t height = 0;
+		};
+
+		struct Header
+		{
+			char magic[4] = { 'C', 'T', 'E', 'X' };
+			uint32_t version = 1;
+			Format format = Format::RGBA8;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t mipLevels = 0;
+			Level levels[COOKED_TEXTURE_MAX_MIPS] = {};
+		};
+
+	public:
+
+		// cooks a source image into a cooked texture file, returns false on failure
+		static bool Cook(std::string input, std::string output, Format format = Format::Auto, bool mipmaps = true);
+
+		// cooks every image inside a folder (recursively) next to their sources, returns how many were cooked
+		static uint32_t CookFolder(std::string folder, Format format = Format::Auto);
+
+		// validates a cooked texture file loaded in memory, filling the header on success
+		// headerOnly skips the level bounds checks, allowing the levels to be read later in ranges
+		static bool Parse(const std::vector<uint8_t>& file, Header& header, bool headerOnly = false);
+
+		// returns the path of the cooked version of a source image
+		static std::string GetCookedPath(std::string path);
+
+		// returns the size in bytes of a mip level with the given format and dimensions
+		static uint64_t GetLevelSize(Format format, uint32_t width, uint32_t height);
+
+		// returns true if the format is block compressed
+		static inline bool IsCompressed(Format format) { return format == Format::BC1 || format == Format::BC3 || format == Format::BC5; }
+
+	private:
+
+		// generates the next mip level from the previous one using a 2x2 box filter
+		static std::vector<uint8_t> Downsample(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, bool srgb);
+
+		// encodes a rgba8 level into the requested format, spreading rows of blocks across the resources pool
+		static std::vector<uint8_t> Encode(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, Format format);
+	};
+}
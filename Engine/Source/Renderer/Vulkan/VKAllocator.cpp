@@ -0,0 +1,380 @@
+#include "epch.h"
+#include "VKAllocator.h"
+
+#include "VKBuffer.h"
+#include "VKDevice.h"
+
+namespace Cosmos
+{
+	VKAllocator* VKAllocator::sAllocator = nullptr;
+
+	VKAllocator::VKAllocator(Shared<VKDevice> device)
+		: mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Allocator");
+		sAllocator = this;
+
+		const VkPhysicalDeviceMemoryProperties& properties = mDevice->GetMemoryProperties();
+		mPools.resize((size_t)properties.memoryTypeCount * 2);
+		mHeapUsage.resize(properties.memoryHeapCount, 0);
+
+		for (uint32_t i = 0; i < (uint32_t)mPools.size(); i++)
+			mPools[i].memoryType = i / 2;
+	}
+
+	VKAllocator::~VKAllocator()
+	{
+		LogStats();
+
+		for (Pool& pool : mPools)
+		{
+			for (Unique<Block>& block : pool.blocks)
+			{
+				if (!block->tlsf.IsEmpty())
+				{
+					LOG_TO_TERMINAL(Logger::Severity::Warn, "Memory block of type %d destroyed with %d allocations alive", pool.memoryType, block->tlsf.GetAllocationCount());
+				}
+
+				FreeMemory(block->memory, block->tlsf.GetSize(), pool.memoryType, block->mapped != nullptr);
+			}
+
+			pool.blocks.clear();
+		}
+
+		if (mDedicatedCount > 0)
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "Allocator destroyed with %d dedicated allocations alive", mDedicatedCount);
+		}
+
+		sAllocator = nullptr;
+	}
+
+	VkResult VKAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, Resource resource, VKAllocation* allocation)
+	{
+		VkBool32 found = VK_FALSE;
+		uint32_t memoryType = mDevice->GetMemoryType(requirements.memoryTypeBits, properties, &found);
+
+		if (!found)
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Error, "No memory type supports the requested properties %d", (int32_t)properties);
+			return VK_ERROR_FEATURE_NOT_PRESENT;
+		}
+
+		VkMemoryPropertyFlags typeFlags = mDevice->GetMemoryProperties().memoryTypes[memoryType].propertyFlags;
+		VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+		VkDeviceSize size = requirements.size;
+
+		// flushes work on whole atoms, so non-coherent allocations must never share one
+		if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && (typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
+		{
+			VkDeviceSize atom = std::max<VkDeviceSize>(mDevice->GetProperties().limits.nonCoherentAtomSize, 1);
+			alignment = std::max(alignment, atom);
+			size = (size + atom - 1) & ~(atom - 1);
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		*allocation = {};
+		allocation->memoryType = memoryType;
+		allocation->size = size;
+
+		VkDeviceSize blockSize = GetBlockSize(memoryType);
+
+		// big resources (mostly render targets) get their own memory object, they would only waste most of a block
+		if (size > blockSize / 2)
+		{
+			VkResult res = AllocateMemory(size, memoryType, &allocation->memory, &allocation->mapped);
+
+			if (res != VK_SUCCESS)
+				return res;
+
+			mDedicatedCount++;
+			mDedicatedBytes += size;
+			return VK_SUCCESS;
+		}
+
+		Pool& pool = GetPool(memoryType, resource);
+
+		for (Unique<Block>& block : pool.blocks)
+		{
+			uint64_t offset = 0;
+			uint32_t handle = block->tlsf.Allocate(size, alignment, &offset);
+
+			if (handle == TLSF::Null)
+				continue;
+
+			allocation->memory = block->memory;
+			allocation->offset = offset;
+			allocation->mapped = block->mapped ? (uint8_t*)block->mapped + offset : nullptr;
+			allocation->handle = handle;
+			allocation->block = block.get();
+			return VK_SUCCESS;
+		}
+
+		// every block is full, create a new one and retry with smaller blocks if the driver is out of memory
+		// the smallest block tried still fits the resource at any alignment
+		Unique<Block> block = CreateUnique<Block>();
+		VkResult res = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+		for (; blockSize >= size + alignment; blockSize /= 2)
+		{
+			res = AllocateMemory(blockSize, memoryType, &block->memory, &block->mapped);
+
+			if (res == VK_SUCCESS)
+				break;
+		}
+
+		if (res != VK_SUCCESS)
+			return res;
+
+		block->tlsf.Reset(blockSize);
+
+		uint64_t offset = 0;
+		uint32_t handle = block->tlsf.Allocate(size, alignment, &offset);
+
+		if (handle == TLSF::Null)
+		{
+			FreeMemory(block->memory, blockSize, memoryType, block->mapped != nullptr);
+			*allocation = {};
+			return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+		}
+
+		allocation->memory = block->memory;
+		allocation->offset = offset;
+		allocation->mapped = block->mapped ? (uint8_t*)block->mapped + offset : nullptr;
+		allocation->handle = handle;
+		allocation->block = block.get();
+
+		pool.blocks.push_back(std::move(block));
+		return VK_SUCCESS;
+	}
+
+	void VKAllocator::Free(VKAllocation& allocation)
+	{
+		if (allocation.memory == VK_NULL_HANDLE)
+			return;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if (allocation.block == nullptr)
+		{
+			FreeMemory(allocation.memory, allocation.size, allocation.memoryType, allocation.mapped != nullptr);
+			mDedicatedCount--;
+			mDedicatedBytes -= allocation.size;
+			allocation = {};
+			return;
+		}
+
+		Block* owner = (Block*)allocation.block;
+		owner->tlsf.Free(allocation.handle);
+
+		// keep a single empty block per pool around, so allocating and freeing a resource every frame doesn't hit the driver
+		if (owner->tlsf.IsEmpty())
+		{
+			for (Pool& pool : mPools)
+			{
+				if (pool.memoryType != allocation.memoryType)
+					continue;
+
+				auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [owner](const Unique<Block>& block) { return block.get() == owner; });
+
+				if (it == pool.blocks.end())
+					continue;
+
+				uint32_t emptyCount = (uint32_t)std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const Unique<Block>& block) { return block->tlsf.IsEmpty(); });
+
+				if (emptyCount > 1)
+				{
+					FreeMemory(owner->memory, owner->tlsf.GetSize(), pool.memoryType, owner->mapped != nullptr);
+					pool.blocks.erase(it);
+				}
+
+				break;
+			}
+		}
+
+		allocation = {};
+	}
+
+	void VKAllocator::Flush(const VKAllocation& allocation)
+	{
+		VkMemoryPropertyFlags typeFlags = mDevice->GetMemoryProperties().memoryTypes[allocation.memoryType].propertyFlags;
+
+		if (allocation.mapped == nullptr || (typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0)
+			return;
+
+		// non-coherent allocations are aligned to whole atoms, see Allocate
+		VkMappedMemoryRange mappedRange = {};
+		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		mappedRange.memory = allocation.memory;
+		mappedRange.offset = allocation.offset;
+		mappedRange.size = allocation.block ? allocation.size : VK_WHOLE_SIZE;
+		vkFlushMappedMemoryRanges(mDevice->GetDevice(), 1, &mappedRange);
+	}
+
+	VKAllocator::Stats VKAllocator::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		Stats stats = {};
+		stats.dedicatedCount = mDedicatedCount;
+		stats.dedicatedBytes = mDedicatedBytes;
+
+		for (Pool& pool : mPools)
+		{
+			for (Unique<Block>& block : pool.blocks)
+			{
+				stats.blockCount++;
+				stats.allocationCount += block->tlsf.GetAllocationCount();
+				stats.blockBytes += block->tlsf.GetSize();
+				stats.usedBytes += block->tlsf.GetUsed();
+				stats.freeRangeCount += block->tlsf.GetFreeRangeCount();
+			}
+		}
+
+		return stats;
+	}
+
+	VkDeviceSize VKAllocator::GetHeapUsage(uint32_t heap)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return heap < mHeapUsage.size() ? mHeapUsage[heap] : 0;
+	}
+
+	void VKAllocator::LogStats()
+	{
+		Stats stats = GetStats();
+
+		LOG_TO_TERMINAL
+		(
+			Logger::Severity::Info,
+			"Allocator: %d blocks (%.1f MB, %.1f MB used, %d allocations, %d free ranges), %d dedicated (%.1f MB)",
+			stats.blockCount,
+			stats.blockBytes / (1024.0 * 1024.0),
+			stats.usedBytes / (1024.0 * 1024.0),
+			stats.allocationCount,
+			stats.freeRangeCount,
+			stats.dedicatedCount,
+			stats.dedicatedBytes / (1024.0 * 1024.0)
+		);
+	}
+
+	VkResult VKAllocator::AllocateMemory(VkDeviceSize size, uint32_t memoryType, VkDeviceMemory* memory, void** mapped)
+	{
+		if (mMemoryObjectCount >= mDevice->GetProperties().limits.maxMemoryAllocationCount)
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Error, "Reached the device limit of %d memory allocations", mMemoryObjectCount);
+			return VK_ERROR_TOO_MANY_OBJECTS;
+		}
+
+		VkMemoryAllocateInfo memoryAllocInfo = {};
+		memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocInfo.pNext = nullptr;
+		memoryAllocInfo.allocationSize = size;
+		memoryAllocInfo.memoryTypeIndex = memoryType;
+
+		VkResult res = vkAllocateMemory(mDevice->GetDevice(), &memoryAllocInfo, nullptr, memory);
+
+		if (res != VK_SUCCESS)
+			return res;
+
+		// host visible memory stays mapped for its whole life, mapping a memory object twice isn't allowed and sub-allocations share it
+		if (mDevice->GetMemoryProperties().memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			res = vkMapMemory(mDevice->GetDevice(), *memory, 0, VK_WHOLE_SIZE, 0, mapped);
+
+			if (res != VK_SUCCESS)
+			{
+				vkFreeMemory(mDevice->GetDevice(), *memory, nullptr);
+				*memory = VK_NULL_HANDLE;
+				return res;
+			}
+		}
+
+		mMemoryObjectCount++;
+		mHeapUsage[mDevice->GetMemoryProperties().memoryTypes[memoryType].heapIndex] += size;
+		return VK_SUCCESS;
+	}
+
+	void VKAllocator::FreeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType, bool mapped)
+	{
+		if (mapped)
+			vkUnmapMemory(mDevice->GetDevice(), memory);
+
+		vkFreeMemory(mDevice->GetDevice(), memory, nullptr);
+
+		mMemoryObjectCount--;
+		mHeapUsage[mDevice->GetMemoryProperties().memoryTypes[memoryType].heapIndex] -= size;
+	}
+
+	VkDeviceSize VKAllocator::GetBlockSize(uint32_t memoryType)
+	{
+		const VkPhysicalDeviceMemoryProperties& properties = mDevice->GetMemoryProperties();
+		VkDeviceSize heapSize = properties.memoryHeaps[properties.memoryTypes[memoryType].heapIndex].size;
+		VkDeviceSize blockSize = (VkDeviceSize)RENDERER_MEMORY_BLOCK_SIZE_MB * 1024 * 1024;
+
+		// small heaps (like the 256 MB host-visible device-local one) use smaller blocks
+		if (heapSize <= 1024ull * 1024 * 1024)
+			blockSize = std::min(blockSize, heapSize / 8);
+
+		return blockSize;
+	}
+
+	VKAllocator::Pool& VKAllocator::GetPool(uint32_t memoryType, Resource resource)
+	{
+		// linear and optimal resources only need to be kept apart when the device has a granularity between them
+		if (mDevice->GetProperties().limits.bufferImageGranularity <= 1)
+			resource = Resource::Linear;
+
+		return mPools[(size_t)memoryType * 2 + resource];
+	}
+
+	VKLinearAllocator::VKLinearAllocator(Shared<VKDevice> device, VkBufferUsageFlags usage, VkDeviceSize sizePerFrame)
+		: mDevice(device), mSizePerFrame(sizePerFrame)
+	{
+		VK_ASSERT
+		(
+			BufferCreate
+			(
+				mDevice,
+				usage,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				mSizePerFrame * RENDERER_MAX_FRAMES_IN_FLIGHT,
+				&mBuffer,
+				&mAllocation
+			),
+			"Failed to create linear allocator buffer"
+		);
+
+		Reset(0);
+	}
+
+	VKLinearAllocator::~VKLinearAllocator()
+	{
+		vkDestroyBuffer(mDevice->GetDevice(), mBuffer, nullptr);
+		VKAllocator::GetInstance()->Free(mAllocation);
+	}
+
+	void VKLinearAllocator::Reset(uint32_t frame)
+	{
+		mBegin = (VkDeviceSize)frame * mSizePerFrame;
+		mHead = mBegin;
+	}
+
+	bool VKLinearAllocator::Allocate(VkDeviceSize size, VkDeviceSize alignment, Range& range)
+	{
+		alignment = std::max<VkDeviceSize>(alignment, 1);
+
+		// the buffer offset is aligned, not the memory offset, as that's what descriptors and bindings use
+		VkDeviceSize offset = (mHead + alignment - 1) / alignment * alignment;
+
+		if (offset + size > mBegin + mSizePerFrame)
+			return false;
+
+		range.buffer = mBuffer;
+		range.offset = offset;
+		range.mapped = (uint8_t*)mAllocation.mapped + offset;
+		mHead = offset + size;
+		return true;
+	}
+}
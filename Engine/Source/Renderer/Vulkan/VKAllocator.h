@@ -0,0 +1,166 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include "Util/TLSF.h"
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+
+	// a range of device memory handed out by the allocator
+	struct VKAllocation
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;	// memory object holding the allocation, shared with other allocations unless dedicated
+		VkDeviceSize offset = 0;				// offset of the allocation inside the memory object
+		VkDeviceSize size = 0;					// size of the allocation
+		void* mapped = nullptr;					// host address of the allocation, only when the memory is host visible
+		uint32_t memoryType = 0;				// memory type index the allocation was made from
+		uint32_t handle = TLSF::Null;			// allocator handle inside the block, Null for dedicated allocations
+		void* block = nullptr;					// block the allocation belongs to, nullptr for dedicated allocations
+	};
+
+	// sub-allocates buffers and images from big per-memory-type blocks instead of one vkAllocateMemory per resource
+	class VKAllocator
+	{
+	public:
+
+		typedef enum Resource
+		{
+			Linear = 0,		// buffers and linear tiled images
+			Optimal			// optimal tiled images, kept apart from linear resources to respect bufferImageGranularity
+		} Resource;
+
+		struct Stats
+		{
+			uint32_t blockCount = 0;			// memory blocks alive
+			uint32_t dedicatedCount = 0;		// resources owning their memory object
+			uint32_t allocationCount = 0;		// sub-allocations alive inside the blocks
+			VkDeviceSize blockBytes = 0;		// bytes reserved by the blocks
+			VkDeviceSize usedBytes = 0;			// bytes used inside the blocks
+			VkDeviceSize dedicatedBytes = 0;	// bytes used by dedicated allocations
+			uint32_t freeRangeCount = 0;		// free ranges inside the blocks, grows with fragmentation
+		};
+
+	public:
+
+		// constructor
+		VKAllocator(Shared<VKDevice> device);
+
+		// destructor
+		~VKAllocator();
+
+		// returns the allocator singleton
+		inline static VKAllocator* GetInstance() { return sAllocator; }
+
+	public:
+
+		// allocates memory for a resource, the memory is bound by the caller at allocation.offset
+		VkResult Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, Resource resource, VKAllocation* allocation);
+
+		// returns the memory of an allocation to its block (or to the driver when dedicated), resetting the allocation
+		void Free(VKAllocation& allocation);
+
+		// makes host writes to non-coherent memory visible to the device
+		void Flush(const VKAllocation& allocation);
+
+		// returns the allocator statistics
+		Stats GetStats();
+
+		// returns the bytes allocated from a given memory heap
+		VkDeviceSize GetHeapUsage(uint32_t heap);
+
+		// prints the allocator statistics
+		void LogStats();
+
+	private:
+
+		struct Block
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			void* mapped = nullptr;
+			TLSF tlsf;
+		};
+
+		struct Pool
+		{
+			uint32_t memoryType = 0;
+			std::vector<Unique<Block>> blocks = {};
+		};
+
+	private:
+
+		// allocates a memory object straight from the driver, mapping it if host visible
+		VkResult AllocateMemory(VkDeviceSize size, uint32_t memoryType, VkDeviceMemory* memory, void** mapped);
+
+		// releases a memory object allocated with AllocateMemory
+		void FreeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType, bool mapped);
+
+		// returns the size of the blocks created for a memory type
+		VkDeviceSize GetBlockSize(uint32_t memoryType);
+
+		// returns the pool used for a memory type and resource kind
+		Pool& GetPool(uint32_t memoryType, Resource resource);
+
+	private:
+
+		static VKAllocator* sAllocator;
+		Shared<VKDevice> mDevice;
+
+		std::mutex mMutex;
+		std::vector<Pool> mPools = {};
+		std::vector<VkDeviceSize> mHeapUsage = {};
+		uint32_t mMemoryObjectCount = 0;
+		uint32_t mDedicatedCount = 0;
+		VkDeviceSize mDedicatedBytes = 0;
+	};
+
+	// hands out transient host-visible ranges of a single buffer, each frame in flight owns a slice that is reset once its fence is signaled
+	class VKLinearAllocator
+	{
+	public:
+
+		struct Range
+		{
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			void* mapped = nullptr;
+		};
+
+	public:
+
+		// constructor
+		VKLinearAllocator(Shared<VKDevice> device, VkBufferUsageFlags usage, VkDeviceSize sizePerFrame);
+
+		// destructor
+		~VKLinearAllocator();
+
+		// returns the buffer every range lives in
+		inline VkBuffer GetBuffer() const { return mBuffer; }
+
+		// returns how many bytes the current frame has used
+		inline VkDeviceSize GetUsed() const { return mHead - mBegin; }
+
+	public:
+
+		// starts handing out ranges from the slice owned by a frame, everything previously allocated from it is discarded
+		void Reset(uint32_t frame);
+
+		// allocates a range from the current frame's slice, returns false when the slice is exhausted
+		bool Allocate(VkDeviceSize size, VkDeviceSize alignment, Range& range);
+
+	private:
+
+		Shared<VKDevice> mDevice;
+		VkBuffer mBuffer = VK_NULL_HANDLE;
+		VKAllocation mAllocation = {};
+		VkDeviceSize mSizePerFrame = 0;
+		VkDeviceSize mBegin = 0;
+		VkDeviceSize mHead = 0;
+	};
+}
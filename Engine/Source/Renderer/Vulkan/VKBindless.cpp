@@ -0,0 +1,165 @@
+#include "epch.h"
+#include "VKBindless.h"
+
+#include "VKDeletionQueue.h"
+#include "VKDevice.h"
+
+#include "Renderer/Texture.h"
+#include "Util/FileSystem.h"
+
+namespace Cosmos
+{
+	VKBindless* VKBindless::sBindless = nullptr;
+
+	VKBindless::VKBindless(Shared<VKDevice> device, uint32_t capacity)
+		: mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Bindless");
+		sBindless = this;
+
+		// the array is indexed by a push constant, dynamically uniform indexing is a core feature but still optional
+		LOG_ASSERT(mDevice->GetFeatures().shaderSampledImageArrayDynamicIndexing == VK_TRUE, "Device can't index arrays of sampled images");
+
+		const VkPhysicalDeviceLimits& limits = mDevice->GetProperties().limits;
+		mCapacity = std::min({ capacity, limits.maxPerStageDescriptorSamplers, limits.maxPerStageDescriptorSampledImages, limits.maxDescriptorSetSamplers, limits.maxDescriptorSetSampledImages });
+
+		if (mCapacity < capacity)
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "Device limits bindless textures to %u out of %u", mCapacity, capacity);
+
+		VkDescriptorSetLayoutBinding binding = {};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = mCapacity;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		binding.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutCreateInfo descSetLayoutCI = {};
+		descSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		descSetLayoutCI.pNext = nullptr;
+		descSetLayoutCI.flags = 0;
+		descSetLayoutCI.bindingCount = 1;
+		descSetLayoutCI.pBindings = &binding;
+		VK_ASSERT(vkCreateDescriptorSetLayout(mDevice->GetDevice(), &descSetLayoutCI, nullptr, &mDescriptorSetLayout), "Failed to create bindless descriptor set layout");
+
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSize.descriptorCount = mCapacity * RENDERER_MAX_FRAMES_IN_FLIGHT;
+
+		VkDescriptorPoolCreateInfo descPoolCI = {};
+		descPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descPoolCI.poolSizeCount = 1;
+		descPoolCI.pPoolSizes = &poolSize;
+		descPoolCI.maxSets = RENDERER_MAX_FRAMES_IN_FLIGHT;
+		VK_ASSERT(vkCreateDescriptorPool(mDevice->GetDevice(), &descPoolCI, nullptr, &mDescriptorPool), "Failed to create bindless descriptor pool");
+
+		std::vector<VkDescriptorSetLayout> layouts(RENDERER_MAX_FRAMES_IN_FLIGHT, mDescriptorSetLayout);
+
+		VkDescriptorSetAllocateInfo descSetAllocInfo = {};
+		descSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descSetAllocInfo.descriptorPool = mDescriptorPool;
+		descSetAllocInfo.descriptorSetCount = (uint32_t)RENDERER_MAX_FRAMES_IN_FLIGHT;
+		descSetAllocInfo.pSetLayouts = layouts.data();
+		VK_ASSERT(vkAllocateDescriptorSets(mDevice->GetDevice(), &descSetAllocInfo, mDescriptorSets.data()), "Failed to allocate bindless descriptor sets");
+
+		// nothing was written yet, every slot of every set is outdated
+		mSlots.resize(mCapacity);
+
+		for (Slot& slot : mSlots)
+		{
+			slot.written.fill(UINT64_MAX);
+		}
+
+		// slots are handed out from the lowest, the default texture takes the first one
+		for (uint32_t i = mCapacity; i > 0; i--)
+		{
+			mFreeSlots.push_back(i - 1);
+		}
+
+		Register(Texture2D::Create(mDevice, GetAssetSubDir("Textures/dev/colors/orange.png").c_str()));
+	}
+
+	VKBindless::~VKBindless()
+	{
+		vkDestroyDescriptorPool(mDevice->GetDevice(), mDescriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(mDevice->GetDevice(), mDescriptorSetLayout, nullptr);
+
+		if (sBindless == this)
+			sBindless = nullptr;
+	}
+
+	uint32_t VKBindless::Register(Shared<Texture2D> texture)
+	{
+		if (mFreeSlots.empty())
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "All %u bindless textures are in use, sampling the default texture instead", mCapacity);
+			return 0;
+		}
+
+		uint32_t slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+
+		mSlots[slot].texture = texture;
+		mSlots[slot].generation++;
+
+		return slot;
+	}
+
+	void VKBindless::Unregister(uint32_t slot)
+	{
+		if (slot == 0 || slot >= mCapacity || mSlots[slot].texture == nullptr)
+			return;
+
+		// frames in flight may still sample it
+		Shared<Texture2D> texture = mSlots[slot].texture;
+		VKDeletionQueue::GetInstance()->Push([texture]() {});
+
+		mSlots[slot].texture.reset();
+		mSlots[slot].generation++;
+		mFreeSlots.push_back(slot);
+	}
+
+	void VKBindless::OnUpdate(uint32_t frame)
+	{
+		PROFILER_FUNCTION();
+
+		std::vector<VkDescriptorImageInfo> imageInfos = {};
+		std::vector<VkWriteDescriptorSet> writes = {};
+		imageInfos.reserve(mCapacity);
+		writes.reserve(mCapacity);
+
+		for (uint32_t i = 0; i < mCapacity; i++)
+		{
+			Slot& slot = mSlots[i];
+			Shared<Texture2D>& texture = slot.texture ? slot.texture : mSlots[0].texture;
+
+			// a streamed texture changes its view along with its version
+			uint64_t key = ((uint64_t)slot.generation << 32) | texture->GetVersion();
+
+			if (slot.written[frame] == key)
+				continue;
+
+			VkDescriptorImageInfo imageInfo = {};
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageInfo.imageView = texture->GetView();
+			imageInfo.sampler = texture->GetSampler();
+			imageInfos.push_back(imageInfo);
+
+			VkWriteDescriptorSet write = {};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = mDescriptorSets[frame];
+			write.dstBinding = 0;
+			write.dstArrayElement = i;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			write.descriptorCount = 1;
+			write.pImageInfo = &imageInfos.back();
+			writes.push_back(write);
+
+			slot.written[frame] = key;
+		}
+
+		if (!writes.empty())
+		{
+			vkUpdateDescriptorSets(mDevice->GetDevice(), (uint32_t)writes.size(), writes.data(), 0, nullptr);
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class Texture2D;
+	class VKDevice;
+
+	// a global array of textures shaders index into, so draws select their textures through push constants instead of switching sets
+	// textures register into free slots and unused slots sample the default texture, as every element of the array must stay valid
+	// each frame in flight owns a copy of the set, rewritten at the start of the frame for the slots whose texture or view has changed
+	class VKBindless
+	{
+	public:
+
+		struct Slot
+		{
+			Shared<Texture2D> texture = nullptr;
+			uint32_t generation = 0;											// changes whenever the slot is registered or unregistered
+			std::array<uint64_t, RENDERER_MAX_FRAMES_IN_FLIGHT> written = {};	// generation and texture version each frame's set holds
+		};
+
+	public:
+
+		// constructor, the capacity is clamped to the device limits
+		VKBindless(Shared<VKDevice> device, uint32_t capacity);
+
+		// destructor
+		~VKBindless();
+
+		// returns the bindless singleton
+		inline static VKBindless* GetInstance() { return sBindless; }
+
+		// returns how many textures the array holds, shaders must declare it with this size
+		inline uint32_t GetCapacity() const { return mCapacity; }
+
+		// returns how many slots are in use, the default texture's included
+		inline uint32_t GetRegisteredCount() const { return mCapacity - (uint32_t)mFreeSlots.size(); }
+
+		// returns the texture a slot holds, nullptr for free slots
+		inline const Shared<Texture2D>& GetTexture(uint32_t slot) const { return mSlots[slot].texture; }
+
+		// returns the layout of the set, for pipelines sampling the array
+		inline VkDescriptorSetLayout GetDescriptorSetLayout() const { return mDescriptorSetLayout; }
+
+		// returns a frame's set, pipelines sampling the array declare it after their own
+		inline VkDescriptorSet GetDescriptorSet(uint32_t frame) const { return mDescriptorSets[frame]; }
+
+	public:
+
+		// puts a texture in a free slot and returns it, the default texture's slot (0) when the array is full (main thread only)
+		uint32_t Register(Shared<Texture2D> texture);
+
+		// releases a slot, the texture is kept alive until no frame in flight can sample it (main thread only)
+		void Unregister(uint32_t slot);
+
+		// rewrites the slots of a frame's set that changed since it was last written, before any of its command buffers is recorded
+		void OnUpdate(uint32_t frame);
+
+	private:
+
+		static VKBindless* sBindless;
+		Shared<VKDevice> mDevice;
+		uint32_t mCapacity = 0;
+
+		VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+		std::array<VkDescriptorSet, RENDERER_MAX_FRAMES_IN_FLIGHT> mDescriptorSets = {};
+
+		std::vector<Slot> mSlots = {};
+		std::vector<uint32_t> mFreeSlots = {};
+	};
+}
@@ -5,7 +5,7 @@
 
 namespace Cosmos
 {
-	VkResult BufferCreate(std::shared_ptr<VKDevice> device, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory, void* data)
+	VkResult BufferCreate(std::shared_ptr<VKDevice> device, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, VkBuffer* buffer, VKAllocation* allocation, void* data)
 	{
 		// specify buffer
 		VkBufferCreateInfo bufferCI = {};
@@ -15,40 +15,23 @@ namespace Cosmos
 		bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		VK_ASSERT(vkCreateBuffer(device->GetDevice(), &bufferCI, nullptr, buffer), "Failed to create buffer");
 
-		// alocate memory for specified buffer 
+		// sub-allocate memory for specified buffer
 		VkMemoryRequirements memoryReqs;
 		vkGetBufferMemoryRequirements(device->GetDevice(), *buffer, &memoryReqs);
+		VK_ASSERT(VKAllocator::GetInstance()->Allocate(memoryReqs, properties, VKAllocator::Resource::Linear, allocation), "Failed to allocate memory for buffer");
 
-		VkMemoryAllocateInfo memoryAllocInfo = {};
-		memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memoryAllocInfo.pNext = nullptr;
-		memoryAllocInfo.allocationSize = memoryReqs.size;
-		memoryAllocInfo.memoryTypeIndex = device->GetMemoryType(memoryReqs.memoryTypeBits, properties);
-		VK_ASSERT(vkAllocateMemory(device->GetDevice(), &memoryAllocInfo, nullptr, memory), "Failed to allocate memory for buffer");
-
-		// data is not null, must map the buffer and copy the data
+		// data is not null, must copy the data into the (persistently mapped) memory
 		if (data != nullptr)
 		{
-			void* mapped;
-			VK_ASSERT(vkMapMemory(device->GetDevice(), *memory, 0, size, 0, &mapped), "Faled to map memory");
-			memcpy(mapped, data, size);
+			LOG_ASSERT(allocation->mapped != nullptr, "Initial data requires host-visible memory");
+			memcpy(allocation->mapped, data, size);
 
 			// if host coherency hasn't been requested, do a manual flush to make writes visible
-			if ((properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
-			{
-				VkMappedMemoryRange mappedRange = {};
-				mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-				mappedRange.memory = *memory;
-				mappedRange.offset = 0;
-				mappedRange.size = size;
-				vkFlushMappedMemoryRanges(device->GetDevice(), 1, &mappedRange);
-			}
-
-			vkUnmapMemory(device->GetDevice(), *memory);
+			VKAllocator::GetInstance()->Flush(*allocation);
 		}
 
 		// link buffer with allocated memory
-		VK_ASSERT(vkBindBufferMemory(device->GetDevice(), *buffer, *memory, 0), "Failed to bind buffer with memory");
+		VK_ASSERT(vkBindBufferMemory(device->GetDevice(), *buffer, allocation->memory, allocation->offset), "Failed to bind buffer with memory");
 
 		return VK_SUCCESS;
 	}
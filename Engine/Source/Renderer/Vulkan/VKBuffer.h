@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Renderer/Buffer.h"
+#include "VKAllocator.h"
 #include <vulkan/vulkan.h>
 
 namespace Cosmos
@@ -10,7 +11,8 @@ namespace Cosmos
 
 	// still used in texture and model class, when testing remove this and rework VKBuffer to support staging only when required
 	// creates a buffer on the gpu, used for buffers without staging (as VKBuffer class uses them)
-	VkResult BufferCreate(std::shared_ptr<VKDevice> device, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory, void* data = nullptr);
+	// the memory comes from the VKAllocator and must be released with VKAllocator::Free, host-visible allocations are already mapped
+	VkResult BufferCreate(std::shared_ptr<VKDevice> device, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, VkBuffer* buffer, VKAllocation* allocation, void* data = nullptr);
 
 	// command buffer will be handled with a class, using functions at the momment
 	// starts the recording of a once-used command buffer
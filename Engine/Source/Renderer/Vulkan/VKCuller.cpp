@@ -0,0 +1,315 @@
+#include "epch.h"
+#include "VKCuller.h"
+
+#include "VKAllocator.h"
+#include "VKBuffer.h"
+#include "VKDeletionQueue.h"
+#include "VKDepthPyramid.h"
+#include "VKDevice.h"
+#include "VKGpuProfiler.h"
+#include "VKShader.h"
+
+#include "Renderer/Buffer.h"
+#include "Util/FileSystem.h"
+
+namespace Cosmos
+{
+	VKCuller* VKCuller::sCuller = nullptr;
+
+	VKCuller::VKCuller(Shared<VKDevice> device, Shared<VKLinearAllocator> frameAllocator, VkPipelineCache cache)
+		: mDevice(device), mFrameAllocator(frameAllocator)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Culler");
+		sCuller = this;
+
+		mShader = CreateShared<VKShader>(mDevice, VKShader::Type::Compute, "Cull.comp", GetAssetSubDir("Shaders/cull.comp"));
+		LOG_ASSERT(mShader->IsValid(), "Failed to compile shader %s. Details: %s", mShader->GetPathRef().c_str(), mShader->GetErrorRef().c_str());
+
+		mLateShader = CreateShared<VKShader>(mDevice, VKShader::Type::Compute, "CullLate.comp", GetAssetSubDir("Shaders/cull.comp"), { "LATE" });
+		LOG_ASSERT(mLateShader->IsValid(), "Failed to compile shader %s. Details: %s", mLateShader->GetPathRef().c_str(), mLateShader->GetErrorRef().c_str());
+
+		// objects, draws, instances, visibility, statistics and the depth pyramid (only the late phase samples it)
+		std::array<VkDescriptorSetLayoutBinding, 6> bindings = {};
+
+		for (uint32_t i = 0; i < (uint32_t)bindings.size(); i++)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorType = i == 5 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			bindings[i].pImmutableSamplers = nullptr;
+		}
+
+		VkDescriptorSetLayoutCreateInfo descSetLayoutCI = {};
+		descSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		descSetLayoutCI.pNext = nullptr;
+		descSetLayoutCI.flags = 0;
+		descSetLayoutCI.bindingCount = (uint32_t)bindings.size();
+		descSetLayoutCI.pBindings = bindings.data();
+		VK_ASSERT(vkCreateDescriptorSetLayout(mDevice->GetDevice(), &descSetLayoutCI, nullptr, &mDescriptorSetLayout), "Failed to create culling descriptor set layout");
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(Cull_PushConstant);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutCI = {};
+		pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutCI.pNext = nullptr;
+		pipelineLayoutCI.flags = 0;
+		pipelineLayoutCI.setLayoutCount = 1;
+		pipelineLayoutCI.pSetLayouts = &mDescriptorSetLayout;
+		pipelineLayoutCI.pushConstantRangeCount = 1;
+		pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+		VK_ASSERT(vkCreatePipelineLayout(mDevice->GetDevice(), &pipelineLayoutCI, nullptr, &mPipelineLayout), "Failed to create culling pipeline layout");
+
+		VkComputePipelineCreateInfo computePipelineCI = {};
+		computePipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		computePipelineCI.pNext = nullptr;
+		computePipelineCI.flags = 0;
+		computePipelineCI.stage = mShader->GetShaderStageCreateInfoRef();
+		computePipelineCI.layout = mPipelineLayout;
+		VK_ASSERT(vkCreateComputePipelines(mDevice->GetDevice(), cache, 1, &computePipelineCI, nullptr, &mPipelines[Phase::Early]), "Failed to create culling pipeline");
+
+		computePipelineCI.stage = mLateShader->GetShaderStageCreateInfoRef();
+		VK_ASSERT(vkCreateComputePipelines(mDevice->GetDevice(), cache, 1, &computePipelineCI, nullptr, &mPipelines[Phase::Late]), "Failed to create late culling pipeline");
+
+		// each phase of each frame in flight rewrites its own set, the visibility and the pyramid are replaced while running
+		std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes[0].descriptorCount = 5 * 2 * RENDERER_MAX_FRAMES_IN_FLIGHT;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[1].descriptorCount = 2 * RENDERER_MAX_FRAMES_IN_FLIGHT;
+
+		VkDescriptorPoolCreateInfo descPoolCI = {};
+		descPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descPoolCI.poolSizeCount = (uint32_t)poolSizes.size();
+		descPoolCI.pPoolSizes = poolSizes.data();
+		descPoolCI.maxSets = 2 * RENDERER_MAX_FRAMES_IN_FLIGHT;
+		VK_ASSERT(vkCreateDescriptorPool(mDevice->GetDevice(), &descPoolCI, nullptr, &mDescriptorPool), "Failed to create culling descriptor pool");
+
+		std::vector<VkDescriptorSetLayout> layouts(RENDERER_MAX_FRAMES_IN_FLIGHT, mDescriptorSetLayout);
+
+		for (std::array<VkDescriptorSet, RENDERER_MAX_FRAMES_IN_FLIGHT>& sets : mDescriptorSets)
+		{
+			VkDescriptorSetAllocateInfo descSetAllocInfo = {};
+			descSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			descSetAllocInfo.descriptorPool = mDescriptorPool;
+			descSetAllocInfo.descriptorSetCount = (uint32_t)RENDERER_MAX_FRAMES_IN_FLIGHT;
+			descSetAllocInfo.pSetLayouts = layouts.data();
+			VK_ASSERT(vkAllocateDescriptorSets(mDevice->GetDevice(), &descSetAllocInfo, sets.data()), "Failed to allocate culling descriptor sets");
+		}
+
+		// the statistics are read on the host once each frame's fence is waited, storage buffer ranges must be aligned
+		VkDeviceSize alignment = std::max<VkDeviceSize>(mDevice->GetProperties().limits.minStorageBufferOffsetAlignment, 1);
+		mStatsStride = (sizeof(Cull_Stats) + alignment - 1) / alignment * alignment;
+
+		BufferCreate(mDevice, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mStatsStride * RENDERER_MAX_FRAMES_IN_FLIGHT, &mStatsBuffer, &mStatsMemory);
+		memset(mStatsMemory.mapped, 0, (size_t)(mStatsStride * RENDERER_MAX_FRAMES_IN_FLIGHT));
+	}
+
+	VKCuller::~VKCuller()
+	{
+		VkDevice device = mDevice->GetDevice();
+		VkBuffer visibility = mVisibility;
+		VKAllocation visibilityMemory = mVisibilityMemory;
+		VkBuffer statsBuffer = mStatsBuffer;
+		VKAllocation statsMemory = mStatsMemory;
+
+		// frames in flight may still be culling with them
+		std::function<void()> deleter = [device, visibility, visibilityMemory, statsBuffer, statsMemory]() mutable
+			{
+				if (visibility != VK_NULL_HANDLE)
+				{
+					vkDestroyBuffer(device, visibility, nullptr);
+					VKAllocator::GetInstance()->Free(visibilityMemory);
+				}
+
+				vkDestroyBuffer(device, statsBuffer, nullptr);
+				VKAllocator::GetInstance()->Free(statsMemory);
+			};
+
+		if (VKDeletionQueue::GetInstance())
+			VKDeletionQueue::GetInstance()->Push(std::move(deleter));
+
+		else
+			deleter();
+
+		vkDestroyDescriptorPool(mDevice->GetDevice(), mDescriptorPool, nullptr);
+		vkDestroyPipeline(mDevice->GetDevice(), mPipelines[Phase::Late], nullptr);
+		vkDestroyPipeline(mDevice->GetDevice(), mPipelines[Phase::Early], nullptr);
+		vkDestroyPipelineLayout(mDevice->GetDevice(), mPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(mDevice->GetDevice(), mDescriptorSetLayout, nullptr);
+
+		if (sCuller == this)
+			sCuller = nullptr;
+	}
+
+	void VKCuller::OnUpdate(uint32_t frame)
+	{
+		Cull_Stats* counters = (Cull_Stats*)((uint8_t*)mStatsMemory.mapped + mStatsStride * frame);
+
+		mStats.objects = mObjectCounts[frame];
+		mStats.frustumCulled = counters->frustumCulled;
+		mStats.occluded = counters->occluded;
+		mStats.drawnEarly = counters->drawnEarly;
+		mStats.drawnLate = counters->drawnLate;
+
+		// host writes are visible to the frame's submission
+		*counters = {};
+		mObjectCounts[frame] = 0;
+	}
+
+	void VKCuller::Dispatch(VkCommandBuffer commandBuffer, uint32_t frame, Phase phase, const glm::mat4& viewProjection, VkDeviceSize objectsOffset, uint32_t objectCount, uint32_t drawOffset, uint32_t instanceOffset)
+	{
+		PROFILER_FUNCTION();
+
+		if (objectCount == 0)
+			return;
+
+		GPU_PROFILER_SCOPE(commandBuffer, phase == Phase::Early ? "Cull Early" : "Cull Late");
+
+		if (phase == Phase::Early)
+		{
+			if (objectCount > mVisibilityCapacity)
+			{
+				GrowVisibility(commandBuffer, objectCount);
+			}
+
+			mObjectCounts[frame] = objectCount;
+		}
+
+		VKDepthPyramid* pyramid = VKDepthPyramid::GetInstance();
+		LOG_ASSERT(phase == Phase::Early || (pyramid != nullptr && pyramid->GetView() != VK_NULL_HANDLE), "The late culling phase requires the depth pyramid to be built first");
+
+		// the set was last used by this frame's previous submission, which is done
+		{
+			VkDescriptorBufferInfo frameInfo = {};
+			frameInfo.buffer = mFrameAllocator->GetBuffer();
+			frameInfo.offset = 0;
+			frameInfo.range = VK_WHOLE_SIZE;
+
+			VkDescriptorBufferInfo visibilityInfo = {};
+			visibilityInfo.buffer = mVisibility;
+			visibilityInfo.offset = 0;
+			visibilityInfo.range = VK_WHOLE_SIZE;
+
+			VkDescriptorBufferInfo statsInfo = {};
+			statsInfo.buffer = mStatsBuffer;
+			statsInfo.offset = mStatsStride * frame;
+			statsInfo.range = sizeof(Cull_Stats);
+
+			VkDescriptorImageInfo pyramidInfo = {};
+			pyramidInfo.sampler = phase == Phase::Late ? pyramid->GetSampler() : VK_NULL_HANDLE;
+			pyramidInfo.imageView = phase == Phase::Late ? pyramid->GetView() : VK_NULL_HANDLE;
+			pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			const VkDescriptorBufferInfo* bufferInfos[] = { &frameInfo, &frameInfo, &frameInfo, &visibilityInfo, &statsInfo };
+			std::array<VkWriteDescriptorSet, 6> writes = {};
+
+			for (uint32_t i = 0; i < (uint32_t)writes.size(); i++)
+			{
+				writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[i].dstSet = mDescriptorSets[phase][frame];
+				writes[i].dstBinding = i;
+				writes[i].dstArrayElement = 0;
+				writes[i].descriptorCount = 1;
+
+				if (i == 5)
+				{
+					writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+					writes[i].pImageInfo = &pyramidInfo;
+				}
+
+				else
+				{
+					writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					writes[i].pBufferInfo = bufferInfos[i];
+				}
+			}
+
+			// the early phase never samples the pyramid, which may not exist yet
+			vkUpdateDescriptorSets(mDevice->GetDevice(), phase == Phase::Late ? 6 : 5, writes.data(), 0, nullptr);
+		}
+
+		// the previous frame's late phase wrote the visibility, a grown buffer was just cleared
+		if (phase == Phase::Early)
+		{
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.pNext = nullptr;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+			vkCmdPipelineBarrier
+			(
+				commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				1, &barrier,
+				0, nullptr,
+				0, nullptr
+			);
+		}
+
+		Cull_PushConstant cull = {};
+		cull.viewProjection = viewProjection;
+		cull.firstObject = (uint32_t)(objectsOffset / sizeof(Cull_ObjectData));
+		cull.objectCount = objectCount;
+		cull.drawOffset = drawOffset;
+		cull.instanceOffset = instanceOffset;
+
+		if (phase == Phase::Late)
+		{
+			cull.pyramidSize = glm::vec2(pyramid->GetExtent().width, pyramid->GetExtent().height);
+			cull.pyramidLevels = pyramid->GetLevels();
+		}
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelines[phase]);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mDescriptorSets[phase][frame], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Cull_PushConstant), &cull);
+		vkCmdDispatch(commandBuffer, (objectCount + 63) / 64, 1, 1);
+
+		// the draws read their instance counts and the vertex stage the instances written above, the host reads the statistics
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.pNext = nullptr;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+		vkCmdPipelineBarrier
+		(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+			0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr
+		);
+	}
+
+	void VKCuller::GrowVisibility(VkCommandBuffer commandBuffer, uint32_t objectCount)
+	{
+		if (mVisibility != VK_NULL_HANDLE)
+		{
+			// frames in flight may still be culling with it
+			VkDevice device = mDevice->GetDevice();
+			VkBuffer buffer = mVisibility;
+			VKAllocation memory = mVisibilityMemory;
+
+			VKDeletionQueue::GetInstance()->Push([device, buffer, memory]() mutable
+				{
+					vkDestroyBuffer(device, buffer, nullptr);
+					VKAllocator::GetInstance()->Free(memory);
+				});
+		}
+
+		mVisibilityCapacity = std::max({ objectCount, mVisibilityCapacity * 2, 1024u });
+		BufferCreate(mDevice, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mVisibilityCapacity * sizeof(uint32_t), &mVisibility, &mVisibilityMemory);
+
+		// nothing was visible, the late phase draws every object this frame
+		vkCmdFillBuffer(commandBuffer, mVisibility, 0, VK_WHOLE_SIZE, 0);
+	}
+}
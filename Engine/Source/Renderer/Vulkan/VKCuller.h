@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Math.h"
+#include "Util/Memory.h"
+#include "VKAllocator.h"
+#include <vulkan/vulkan.h>
+
+#include <array>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+	class VKLinearAllocator;
+	class VKShader;
+
+	// culls objects against the camera's frustum and the depth pyramid on the gpu, the visible ones are packed into their batch's instances and
+	// counted into the batch's indirect draws, so the cpu never learns (nor waits to learn) what is visible
+	// it runs in two phases: the early one draws the objects visible last frame, the pyramid is then built from the depth they left and the
+	// late one tests every object against it, drawing the visible ones the early phase didn't and remembering them for the next frame
+	// objects, draws and instances all live in the frame allocator, each addressed by its index counted from the buffer's start
+	class VKCuller
+	{
+	public:
+
+		enum Phase : uint32_t
+		{
+			Early = 0,
+			Late = 1
+		};
+
+		struct Stats
+		{
+			uint32_t objects = 0;				// objects culled
+			uint32_t frustumCulled = 0;			// objects outside the frustum
+			uint32_t occluded = 0;				// objects behind the depth pyramid
+			uint32_t drawnEarly = 0;			// objects visible last frame and drawn before the pyramid was built
+			uint32_t drawnLate = 0;				// objects disoccluded this frame, drawn after it
+		};
+
+	public:
+
+		// constructor
+		VKCuller(Shared<VKDevice> device, Shared<VKLinearAllocator> frameAllocator, VkPipelineCache cache);
+
+		// destructor
+		~VKCuller();
+
+		// returns the culler singleton
+		inline static VKCuller* GetInstance() { return sCuller; }
+
+		// returns the statistics of the last frame the gpu finished
+		inline const Stats& GetStats() const { return mStats; }
+
+	public:
+
+		// reads back the statistics the frame's previous culling left and clears them, once the frame's fence was waited
+		void OnUpdate(uint32_t frame);
+
+		// records a phase of the culling, must be recorded outside a render pass and before the draws consuming it
+		// the late phase draws into the draws and instances offset (in elements) from the objects' ones, its draws' instance counts must also start at zero
+		// the objects' offset must be a multiple of their size and both phases of a frame must cull the same objects
+		void Dispatch(VkCommandBuffer commandBuffer, uint32_t frame, Phase phase, const glm::mat4& viewProjection, VkDeviceSize objectsOffset, uint32_t objectCount, uint32_t drawOffset = 0, uint32_t instanceOffset = 0);
+
+	private:
+
+		// replaces the visibility buffer with a bigger one, every object is then considered hidden last frame
+		void GrowVisibility(VkCommandBuffer commandBuffer, uint32_t objectCount);
+
+	private:
+
+		static VKCuller* sCuller;
+		Shared<VKDevice> mDevice;
+		Shared<VKLinearAllocator> mFrameAllocator;
+		Shared<VKShader> mShader;
+		Shared<VKShader> mLateShader;
+
+		VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+		std::array<VkPipeline, 2> mPipelines = {};
+		VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+		std::array<std::array<VkDescriptorSet, RENDERER_MAX_FRAMES_IN_FLIGHT>, 2> mDescriptorSets = {};
+
+		// whether each object was visible, indexed by its position in the dispatch
+		VkBuffer mVisibility = VK_NULL_HANDLE;
+		VKAllocation mVisibilityMemory = {};
+		uint32_t mVisibilityCapacity = 0;
+
+		// each frame in flight counts into its own range of the host-visible statistics
+		VkBuffer mStatsBuffer = VK_NULL_HANDLE;
+		VKAllocation mStatsMemory = {};
+		VkDeviceSize mStatsStride = 0;
+		std::array<uint32_t, RENDERER_MAX_FRAMES_IN_FLIGHT> mObjectCounts = {};
+		Stats mStats = {};
+	};
+}
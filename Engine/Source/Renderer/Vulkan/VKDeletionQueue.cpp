@@ -0,0 +1,75 @@
+#include "epch.h"
+#include "VKDeletionQueue.h"
+
+#include "VKDevice.h"
+
+namespace Cosmos
+{
+	VKDeletionQueue* VKDeletionQueue::sDeletionQueue = nullptr;
+
+	VKDeletionQueue::VKDeletionQueue(Shared<VKDevice> device)
+		: mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Deletion Queue");
+		sDeletionQueue = this;
+	}
+
+	VKDeletionQueue::~VKDeletionQueue()
+	{
+		vkDeviceWaitIdle(mDevice->GetDevice());
+
+		// a deleter may push others, so the queue is drained until empty
+		while (!mEntries.empty())
+		{
+			std::vector<Entry> entries = std::move(mEntries);
+			mEntries.clear();
+
+			for (Entry& entry : entries)
+			{
+				entry.deleter();
+			}
+		}
+
+		sDeletionQueue = nullptr;
+	}
+
+	void VKDeletionQueue::OnUpdate()
+	{
+		PROFILER_FUNCTION();
+
+		std::vector<Entry> expired = {};
+
+		// deleters run outside the lock, they may release objects that push deleters of their own
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mFrame++;
+
+			for (auto it = mEntries.begin(); it != mEntries.end();)
+			{
+				if (mFrame < it->frame + RENDERER_MAX_FRAMES_IN_FLIGHT)
+				{
+					it++;
+					continue;
+				}
+
+				expired.push_back(std::move(*it));
+				it = mEntries.erase(it);
+			}
+		}
+
+		for (Entry& entry : expired)
+		{
+			entry.deleter();
+		}
+	}
+
+	void VKDeletionQueue::Push(std::function<void()>&& deleter)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		Entry entry = {};
+		entry.frame = mFrame;
+		entry.deleter = std::move(deleter);
+		mEntries.push_back(std::move(entry));
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+
+	// defers the destruction of gpu objects until every frame in flight that could reference them has finished, so replacing
+	// a resource never stalls the device
+	class VKDeletionQueue
+	{
+	public:
+
+		struct Entry
+		{
+			uint64_t frame = 0;
+			std::function<void()> deleter;
+		};
+
+	public:
+
+		// constructor
+		VKDeletionQueue(Shared<VKDevice> device);
+
+		// destructor, waits for the device and runs every pending deleter
+		~VKDeletionQueue();
+
+		// returns the deletion queue singleton
+		inline static VKDeletionQueue* GetInstance() { return sDeletionQueue; }
+
+		// returns the amount of updates done so far
+		inline uint64_t GetFrame() const { return mFrame; }
+
+	public:
+
+		// must be called once per frame after the frame's fence was waited on, runs the deleters no frame in flight depends on anymore
+		void OnUpdate();
+
+		// queues a deleter to run once the frames recorded so far have finished, safe to be called from any thread
+		void Push(std::function<void()>&& deleter);
+
+	private:
+
+		static VKDeletionQueue* sDeletionQueue;
+		Shared<VKDevice> mDevice;
+		uint64_t mFrame = 0;
+
+		std::mutex mMutex;
+		std::vector<Entry> mEntries = {};
+	};
+}
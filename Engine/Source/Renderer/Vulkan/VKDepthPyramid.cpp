@@ -0,0 +1,403 @@
+#include "epch.h"
+#include "VKDepthPyramid.h"
+
+#include "VKBuffer.h"
+#include "VKDeletionQueue.h"
+#include "VKDevice.h"
+#include "VKGpuProfiler.h"
+#include "VKImage.h"
+#include "VKRenderGraph.h"
+#include "VKShader.h"
+
+#include "Renderer/Buffer.h"
+#include "Util/FileSystem.h"
+
+namespace Cosmos
+{
+	VKDepthPyramid* VKDepthPyramid::sDepthPyramid = nullptr;
+
+	VKDepthPyramid::VKDepthPyramid(Shared<VKDevice> device, VkPipelineCache cache)
+		: mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Depth Pyramid");
+		sDepthPyramid = this;
+
+		// multisampled depth images are reduced over all their samples
+		mShader = CreateShared<VKShader>(mDevice, VKShader::Type::Compute, "DepthPyramid.comp", GetAssetSubDir("Shaders/depthpyramid.comp"));
+		LOG_ASSERT(mShader->IsValid(), "Failed to compile shader %s. Details: %s", mShader->GetPathRef().c_str(), mShader->GetErrorRef().c_str());
+
+		mMultisampledShader = CreateShared<VKShader>(mDevice, VKShader::Type::Compute, "DepthPyramidMS.comp", GetAssetSubDir("Shaders/depthpyramid.comp"), { "MULTISAMPLED" });
+		LOG_ASSERT(mMultisampledShader->IsValid(), "Failed to compile shader %s. Details: %s", mMultisampledShader->GetPathRef().c_str(), mMultisampledShader->GetErrorRef().c_str());
+
+		// depth image, every level of the pyramid and the workgroup counter
+		std::array<VkDescriptorSetLayoutBinding, 3> bindings = {};
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[0].descriptorCount = 1;
+		bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[0].pImmutableSamplers = nullptr;
+
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		bindings[1].descriptorCount = RENDERER_DEPTH_PYRAMID_LEVELS;
+		bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[1].pImmutableSamplers = nullptr;
+
+		bindings[2].binding = 2;
+		bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[2].descriptorCount = 1;
+		bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[2].pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutCreateInfo descSetLayoutCI = {};
+		descSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		descSetLayoutCI.pNext = nullptr;
+		descSetLayoutCI.flags = 0;
+		descSetLayoutCI.bindingCount = (uint32_t)bindings.size();
+		descSetLayoutCI.pBindings = bindings.data();
+		VK_ASSERT(vkCreateDescriptorSetLayout(mDevice->GetDevice(), &descSetLayoutCI, nullptr, &mDescriptorSetLayout), "Failed to create depth pyramid descriptor set layout");
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(DepthPyramid_PushConstant);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutCI = {};
+		pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutCI.pNext = nullptr;
+		pipelineLayoutCI.flags = 0;
+		pipelineLayoutCI.setLayoutCount = 1;
+		pipelineLayoutCI.pSetLayouts = &mDescriptorSetLayout;
+		pipelineLayoutCI.pushConstantRangeCount = 1;
+		pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+		VK_ASSERT(vkCreatePipelineLayout(mDevice->GetDevice(), &pipelineLayoutCI, nullptr, &mPipelineLayout), "Failed to create depth pyramid pipeline layout");
+
+		VkComputePipelineCreateInfo computePipelineCI = {};
+		computePipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		computePipelineCI.pNext = nullptr;
+		computePipelineCI.flags = 0;
+		computePipelineCI.stage = mShader->GetShaderStageCreateInfoRef();
+		computePipelineCI.layout = mPipelineLayout;
+		VK_ASSERT(vkCreateComputePipelines(mDevice->GetDevice(), cache, 1, &computePipelineCI, nullptr, &mPipeline), "Failed to create depth pyramid pipeline");
+
+		computePipelineCI.stage = mMultisampledShader->GetShaderStageCreateInfoRef();
+		VK_ASSERT(vkCreateComputePipelines(mDevice->GetDevice(), cache, 1, &computePipelineCI, nullptr, &mMultisampledPipeline), "Failed to create multisampled depth pyramid pipeline");
+
+		// each frame in flight rewrites its own set, as the depth image changes whenever the render graph is compiled
+		std::array<VkDescriptorPoolSize, 3> poolSizes = {};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[0].descriptorCount = RENDERER_MAX_FRAMES_IN_FLIGHT;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		poolSizes[1].descriptorCount = RENDERER_DEPTH_PYRAMID_LEVELS * RENDERER_MAX_FRAMES_IN_FLIGHT;
+		poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes[2].descriptorCount = RENDERER_MAX_FRAMES_IN_FLIGHT;
+
+		VkDescriptorPoolCreateInfo descPoolCI = {};
+		descPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descPoolCI.poolSizeCount = (uint32_t)poolSizes.size();
+		descPoolCI.pPoolSizes = poolSizes.data();
+		descPoolCI.maxSets = RENDERER_MAX_FRAMES_IN_FLIGHT;
+		VK_ASSERT(vkCreateDescriptorPool(mDevice->GetDevice(), &descPoolCI, nullptr, &mDescriptorPool), "Failed to create depth pyramid descriptor pool");
+
+		std::vector<VkDescriptorSetLayout> layouts(RENDERER_MAX_FRAMES_IN_FLIGHT, mDescriptorSetLayout);
+
+		VkDescriptorSetAllocateInfo descSetAllocInfo = {};
+		descSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descSetAllocInfo.descriptorPool = mDescriptorPool;
+		descSetAllocInfo.descriptorSetCount = (uint32_t)RENDERER_MAX_FRAMES_IN_FLIGHT;
+		descSetAllocInfo.pSetLayouts = layouts.data();
+		VK_ASSERT(vkAllocateDescriptorSets(mDevice->GetDevice(), &descSetAllocInfo, mDescriptorSets.data()), "Failed to allocate depth pyramid descriptor sets");
+
+		// texels are fetched, never filtered
+		mSampler = CreateSampler(mDevice, VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, (float)RENDERER_DEPTH_PYRAMID_LEVELS);
+
+		BufferCreate(mDevice, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sizeof(uint32_t), &mCounter, &mCounterMemory);
+	}
+
+	VKDepthPyramid::~VKDepthPyramid()
+	{
+		ReleasePyramid();
+
+		vkDestroyBuffer(mDevice->GetDevice(), mCounter, nullptr);
+		VKAllocator::GetInstance()->Free(mCounterMemory);
+
+		vkDestroySampler(mDevice->GetDevice(), mSampler, nullptr);
+		vkDestroyDescriptorPool(mDevice->GetDevice(), mDescriptorPool, nullptr);
+		vkDestroyPipeline(mDevice->GetDevice(), mMultisampledPipeline, nullptr);
+		vkDestroyPipeline(mDevice->GetDevice(), mPipeline, nullptr);
+		vkDestroyPipelineLayout(mDevice->GetDevice(), mPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(mDevice->GetDevice(), mDescriptorSetLayout, nullptr);
+
+		if (sDepthPyramid == this)
+			sDepthPyramid = nullptr;
+	}
+
+	bool VKDepthPyramid::CanSample(Shared<VKDevice> device, VkFormat format, VkSampleCountFlagBits samples)
+	{
+		VkFormatProperties properties = {};
+		vkGetPhysicalDeviceFormatProperties(device->GetPhysicalDevice(), format, &properties);
+
+		if ((properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0)
+			return false;
+
+		return samples == VK_SAMPLE_COUNT_1_BIT || (device->GetProperties().limits.sampledImageDepthSampleCounts & samples) != 0;
+	}
+
+	void VKDepthPyramid::Build(VkCommandBuffer commandBuffer, uint32_t frame, const std::string& depth)
+	{
+		PROFILER_FUNCTION();
+
+		const VKRenderGraph::Transient* description = VKRenderGraph::GetInstance()->GetTransient(depth);
+		VkImage depthImage = VKRenderGraph::GetInstance()->GetImage(depth, 0);
+		VkExtent2D depthExtent = VKRenderGraph::GetInstance()->GetExtent();
+
+		if (mImage == VK_NULL_HANDLE || depthExtent.width != mDepthExtent.width || depthExtent.height != mDepthExtent.height)
+		{
+			CreatePyramid(depthExtent);
+		}
+
+		GPU_PROFILER_SCOPE(commandBuffer, "Depth Pyramid");
+
+		// the culling still binds the pyramid when it can't be built, its levels are then reported as none
+		bool buildable = description != nullptr && depthImage != VK_NULL_HANDLE && (description->usage & VK_IMAGE_USAGE_SAMPLED_BIT) != 0;
+		VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+		if (buildable && HasStencilComponent(description->format))
+			depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+		if (!mCounterCleared)
+		{
+			vkCmdFillBuffer(commandBuffer, mCounter, 0, sizeof(uint32_t), 0);
+			mCounterCleared = true;
+		}
+
+		// the previous contents are discarded, the depth image is read once its writes are done
+		{
+			std::array<VkImageMemoryBarrier, 2> imageBarriers = {};
+			imageBarriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarriers[0].srcAccessMask = 0;
+			imageBarriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			imageBarriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageBarriers[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			imageBarriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarriers[0].image = mImage;
+			imageBarriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mLevelCount, 0, 1 };
+
+			imageBarriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			imageBarriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			imageBarriers[1].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			imageBarriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageBarriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarriers[1].image = depthImage;
+			imageBarriers[1].subresourceRange = { depthAspect, 0, 1, 0, 1 };
+
+			// the counter's reset and the previous frame's culling reads of the pyramid
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+			vkCmdPipelineBarrier
+			(
+				commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				1, &memoryBarrier,
+				0, nullptr,
+				buildable ? 2 : 1, imageBarriers.data()
+			);
+		}
+
+		mBuilt = buildable;
+
+		if (!buildable)
+			return;
+
+		// the set is rewritten every build, the frame's previous build is done with it
+		{
+			VkDescriptorImageInfo depthInfo = {};
+			depthInfo.sampler = mSampler;
+			depthInfo.imageView = VKRenderGraph::GetInstance()->GetView(depth, 0);
+			depthInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+			// levels past the last one repeat it, every element of the array must be valid
+			std::array<VkDescriptorImageInfo, RENDERER_DEPTH_PYRAMID_LEVELS> levelInfos = {};
+
+			for (uint32_t i = 0; i < RENDERER_DEPTH_PYRAMID_LEVELS; i++)
+			{
+				levelInfos[i].sampler = VK_NULL_HANDLE;
+				levelInfos[i].imageView = mLevelViews[std::min(i, mLevelCount - 1)];
+				levelInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			}
+
+			VkDescriptorBufferInfo counterInfo = {};
+			counterInfo.buffer = mCounter;
+			counterInfo.offset = 0;
+			counterInfo.range = VK_WHOLE_SIZE;
+
+			std::array<VkWriteDescriptorSet, 3> writes = {};
+
+			for (uint32_t i = 0; i < (uint32_t)writes.size(); i++)
+			{
+				writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[i].dstSet = mDescriptorSets[frame];
+				writes[i].dstBinding = i;
+				writes[i].dstArrayElement = 0;
+				writes[i].descriptorCount = 1;
+			}
+
+			writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[0].pImageInfo = &depthInfo;
+			writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			writes[1].descriptorCount = RENDERER_DEPTH_PYRAMID_LEVELS;
+			writes[1].pImageInfo = levelInfos.data();
+			writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[2].pBufferInfo = &counterInfo;
+
+			vkUpdateDescriptorSets(mDevice->GetDevice(), (uint32_t)writes.size(), writes.data(), 0, nullptr);
+		}
+
+		// every workgroup reduces a 64x64 tile of the first level
+		uint32_t groupsX = (mExtent.width + 63) / 64;
+		uint32_t groupsY = (mExtent.height + 63) / 64;
+
+		DepthPyramid_PushConstant pyramid = {};
+		pyramid.depthSize = glm::ivec2(depthExtent.width, depthExtent.height);
+		pyramid.pyramidSize = glm::ivec2(mExtent.width, mExtent.height);
+		pyramid.levelCount = mLevelCount;
+		pyramid.samples = (uint32_t)description->samples;
+		pyramid.workgroups = groupsX * groupsY;
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, description->samples == VK_SAMPLE_COUNT_1_BIT ? mPipeline : mMultisampledPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mDescriptorSets[frame], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthPyramid_PushConstant), &pyramid);
+		vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+
+		// the culling reads the pyramid and the depth image goes back to being drawn on
+		{
+			VkImageMemoryBarrier imageBarrier = {};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			imageBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			imageBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = depthImage;
+			imageBarrier.subresourceRange = { depthAspect, 0, 1, 0, 1 };
+
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier
+			(
+				commandBuffer,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				0,
+				1, &memoryBarrier,
+				0, nullptr,
+				1, &imageBarrier
+			);
+		}
+	}
+
+	void VKDepthPyramid::CreatePyramid(VkExtent2D extent)
+	{
+		ReleasePyramid();
+
+		// the largest power of two fitting the depth image, so a texel of the first level never covers less than a depth texel
+		auto previousPowerOfTwo = [](uint32_t value)
+			{
+				uint32_t power = 1;
+
+				while (power * 2 <= value)
+					power *= 2;
+
+				return power;
+			};
+
+		const uint32_t maxSize = 1u << (RENDERER_DEPTH_PYRAMID_LEVELS - 1);
+		mDepthExtent = extent;
+		mExtent.width = std::min(previousPowerOfTwo(std::max(extent.width, 1u)), maxSize);
+		mExtent.height = std::min(previousPowerOfTwo(std::max(extent.height, 1u)), maxSize);
+		mLevelCount = 1;
+
+		while ((std::max(mExtent.width, mExtent.height) >> mLevelCount) > 0)
+			mLevelCount++;
+
+		CreateImage
+		(
+			mDevice,
+			mExtent.width,
+			mExtent.height,
+			mLevelCount,
+			1,
+			VK_SAMPLE_COUNT_1_BIT,
+			VK_FORMAT_R32_SFLOAT,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			mImage,
+			mMemory
+		);
+
+		mView = CreateImageView(mDevice, mImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, mLevelCount);
+		mLevelViews.resize(mLevelCount);
+
+		for (uint32_t i = 0; i < mLevelCount; i++)
+		{
+			VkImageViewCreateInfo imageViewCI = {};
+			imageViewCI.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			imageViewCI.image = mImage;
+			imageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			imageViewCI.format = VK_FORMAT_R32_SFLOAT;
+			imageViewCI.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1 };
+			VK_ASSERT(vkCreateImageView(mDevice->GetDevice(), &imageViewCI, nullptr, &mLevelViews[i]), "Failed to create depth pyramid level view");
+		}
+
+		mBuilt = false;
+	}
+
+	void VKDepthPyramid::ReleasePyramid()
+	{
+		if (mImage == VK_NULL_HANDLE)
+			return;
+
+		// frames in flight may still be culling against it
+		VkDevice device = mDevice->GetDevice();
+		VkImage image = mImage;
+		VKAllocation memory = mMemory;
+		std::vector<VkImageView> views = mLevelViews;
+		views.push_back(mView);
+
+		std::function<void()> deleter = [device, image, memory, views]() mutable
+			{
+				for (VkImageView view : views)
+				{
+					vkDestroyImageView(device, view, nullptr);
+				}
+
+				vkDestroyImage(device, image, nullptr);
+				VKAllocator::GetInstance()->Free(memory);
+			};
+
+		if (VKDeletionQueue::GetInstance())
+			VKDeletionQueue::GetInstance()->Push(std::move(deleter));
+
+		else
+			deleter();
+
+		mImage = VK_NULL_HANDLE;
+		mMemory = {};
+		mView = VK_NULL_HANDLE;
+		mLevelViews.clear();
+		mLevelCount = 0;
+	}
+}
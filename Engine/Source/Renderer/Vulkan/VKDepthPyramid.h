@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include "VKAllocator.h"
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+	class VKShader;
+
+	// a mip chain of the depth buffer whose texels hold the farthest depth they cover, objects behind it are occluded
+	// the whole chain is reduced by a single dispatch, every workgroup reduces a tile and the last one to finish reduces what the others left
+	// its size is the depth buffer's rounded down to a power of two, so that each level halves the previous one exactly
+	class VKDepthPyramid
+	{
+	public:
+
+		// constructor
+		VKDepthPyramid(Shared<VKDevice> device, VkPipelineCache cache);
+
+		// destructor
+		~VKDepthPyramid();
+
+		// returns the depth pyramid singleton
+		inline static VKDepthPyramid* GetInstance() { return sDepthPyramid; }
+
+		// returns the view of every level, the pyramid stays in VK_IMAGE_LAYOUT_GENERAL
+		inline VkImageView GetView() const { return mView; }
+
+		// returns the sampler the pyramid is fetched with
+		inline VkSampler GetSampler() const { return mSampler; }
+
+		// returns the size of the first level
+		inline VkExtent2D GetExtent() const { return mExtent; }
+
+		// returns how many levels the last build filled, 0 when it couldn't read the depth image
+		inline uint32_t GetLevels() const { return mBuilt ? mLevelCount : 0; }
+
+	public:
+
+		// returns if a depth image can be reduced, the device must sample its format at its sample count
+		static bool CanSample(Shared<VKDevice> device, VkFormat format, VkSampleCountFlagBits samples);
+
+		// records the reduction of a render graph's depth image, which is expected and left in VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+		// must be recorded outside a render pass, the pyramid is recreated when the depth image's size changes
+		void Build(VkCommandBuffer commandBuffer, uint32_t frame, const std::string& depth);
+
+	private:
+
+		// creates the pyramid and the views of its levels for a depth image's size
+		void CreatePyramid(VkExtent2D extent);
+
+		// destroys the pyramid once no frame in flight uses it
+		void ReleasePyramid();
+
+	private:
+
+		static VKDepthPyramid* sDepthPyramid;
+		Shared<VKDevice> mDevice;
+		Shared<VKShader> mShader;
+		Shared<VKShader> mMultisampledShader;
+
+		VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline mPipeline = VK_NULL_HANDLE;
+		VkPipeline mMultisampledPipeline = VK_NULL_HANDLE;
+		VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+		std::array<VkDescriptorSet, RENDERER_MAX_FRAMES_IN_FLIGHT> mDescriptorSets = {};
+		VkSampler mSampler = VK_NULL_HANDLE;
+
+		// counts the workgroups done with their tile, zeroed once and reset by the last workgroup
+		VkBuffer mCounter = VK_NULL_HANDLE;
+		VKAllocation mCounterMemory = {};
+		bool mCounterCleared = false;
+
+		VkImage mImage = VK_NULL_HANDLE;
+		VKAllocation mMemory = {};
+		VkImageView mView = VK_NULL_HANDLE;
+		std::vector<VkImageView> mLevelViews = {};
+		VkExtent2D mDepthExtent = {};
+		VkExtent2D mExtent = {};
+		uint32_t mLevelCount = 0;
+		bool mBuilt = false;
+	};
+}
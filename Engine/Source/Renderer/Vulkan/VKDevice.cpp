@@ -5,6 +5,8 @@
 #include "VKInstance.h"
 #include "Platform/Window.h"
 
+#include <cstring>
+
 namespace Cosmos
 {
 	std::shared_ptr<VKDevice> VKDevice::Create(std::shared_ptr<VKInstance> instance)
@@ -81,11 +83,21 @@ namespace Cosmos
 		return mComputeQueue;
 	}
 
+	VkQueue& VKDevice::GetTransferQueue()
+	{
+		return mTransferQueue;
+	}
+
 	VkSampleCountFlagBits VKDevice::GetMSAA()
 	{
 		return mMSAACount;
 	}
 
+	VkPhysicalDeviceMemoryProperties& VKDevice::GetMemoryProperties()
+	{
+		return mMemoryProperties;
+	}
+
 	VKDevice::QueueFamilyIndices VKDevice::FindQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface)
 	{
 		QueueFamilyIndices indices;
@@ -128,6 +140,18 @@ namespace Cosmos
 			LOG_TO_TERMINAL(Logger::Severity::Warn, "A compute queue was not found");
 		}
 
+		// a family with transfer but no graphics nor compute usually maps to the dedicated copy engines
+		for (uint32_t family = 0; family < queueFamilyCount; family++)
+		{
+			VkQueueFlags flags = queueFamilies[family].queueFlags;
+
+			if ((flags & VK_QUEUE_TRANSFER_BIT) && (flags & VK_QUEUE_GRAPHICS_BIT) == 0 && (flags & VK_QUEUE_COMPUTE_BIT) == 0)
+			{
+				indices.transfer = family;
+				break;
+			}
+		}
+
 		return indices;
 	}
 
@@ -179,6 +203,23 @@ namespace Cosmos
 		return VK_SAMPLE_COUNT_1_BIT;
 	}
 
+	bool VKDevice::IsExtensionSupported(const char* name)
+	{
+		uint32_t count = 0;
+		vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &count, nullptr);
+
+		std::vector<VkExtensionProperties> available(count);
+		vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &count, available.data());
+
+		for (const VkExtensionProperties& extension : available)
+		{
+			if (strcmp(extension.extensionName, name) == 0)
+				return true;
+		}
+
+		return false;
+	}
+
 	void VKDevice::SelectPhysicalDevice()
 	{
 		uint32_t gpuCount = 0;
@@ -220,6 +261,9 @@ namespace Cosmos
 		std::vector<VkDeviceQueueCreateInfo> deviceQueueCIs;
 		std::set<uint32_t> uniqueQueueFamilies = { indices.graphics.value(), indices.present.value(), indices.compute.value() };
 
+		if (indices.transfer.has_value())
+			uniqueQueueFamilies.insert(indices.transfer.value());
+
 		for (uint32_t queueFamily : uniqueQueueFamilies)
 		{
 			VkDeviceQueueCreateInfo deviceQueueCI = {};
@@ -235,6 +279,61 @@ namespace Cosmos
 		std::vector<const char*> extensions = {};
 		extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+		// optional, allows querying the real heap usage and budget
+		if (IsExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+		{
+			extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+			mMemoryBudgetSupported = true;
+		}
+
+		// optional, lets the uploader signal progress on the transfer queue without a fence per consumer
+		VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+		timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+		if (IsExtensionSupported(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+		{
+			PFN_vkGetPhysicalDeviceFeatures2KHR getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(mInstance->GetInstance(), "vkGetPhysicalDeviceFeatures2KHR");
+
+			if (getFeatures2)
+			{
+				VkPhysicalDeviceFeatures2KHR features2 = {};
+				features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+				features2.pNext = &timelineFeatures;
+				getFeatures2(mPhysicalDevice, &features2);
+			}
+
+			if (timelineFeatures.timelineSemaphore == VK_TRUE)
+			{
+				extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+				mTimelineSemaphoreSupported = true;
+			}
+		}
+
+		// optional, lets the gpu profiler place its timestamps on the cpu's timeline
+		if (IsExtensionSupported(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME))
+		{
+			PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT getTimeDomains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)vkGetInstanceProcAddr(mInstance->GetInstance(), "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+			uint32_t domainCount = 0;
+
+			if (getTimeDomains)
+			{
+				getTimeDomains(mPhysicalDevice, &domainCount, nullptr);
+			}
+
+			std::vector<VkTimeDomainEXT> domains(domainCount);
+
+			if (domainCount > 0)
+			{
+				getTimeDomains(mPhysicalDevice, &domainCount, domains.data());
+			}
+
+			if (std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end())
+			{
+				extensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+				mCalibratedTimestampsSupported = true;
+			}
+		}
+
 		std::vector<const char*> validations = mInstance->GetValidationsList();
 
 #if defined VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME
@@ -243,7 +342,7 @@ namespace Cosmos
 
 		VkDeviceCreateInfo deviceCI = {};
 		deviceCI.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-		deviceCI.pNext = nullptr;
+		deviceCI.pNext = mTimelineSemaphoreSupported ? &timelineFeatures : nullptr;
 		deviceCI.flags = 0;
 		deviceCI.queueCreateInfoCount = (uint32_t)deviceQueueCIs.size();
 		deviceCI.pQueueCreateInfos = deviceQueueCIs.data();
@@ -268,5 +367,6 @@ namespace Cosmos
 		vkGetDeviceQueue(mDevice, indices.graphics.value(), 0, &mGraphicsQueue);
 		vkGetDeviceQueue(mDevice, indices.present.value(), 0, &mPresentQueue);
 		vkGetDeviceQueue(mDevice, indices.compute.value(), 0, &mComputeQueue);
+		vkGetDeviceQueue(mDevice, indices.transfer.value_or(indices.graphics.value()), 0, &mTransferQueue);
 	}
 }
\ No newline at end of file
@@ -21,6 +21,7 @@ namespace Cosmos
 			std::optional<uint32_t> graphics;
 			std::optional<uint32_t> present;
 			std::optional<uint32_t> compute;
+			std::optional<uint32_t> transfer; // only set when a family dedicated to transfers exists
 
 			// returns if found all queues
 			inline bool IsComplete() const { return graphics.has_value() && present.has_value() && compute.has_value(); }
@@ -61,9 +62,24 @@ namespace Cosmos
 		// returns the compute queue
 		VkQueue& GetComputeQueue();
 
+		// returns the transfer queue, the graphics queue if the device has no queue family dedicated to transfers
+		VkQueue& GetTransferQueue();
+
 		// returns the sampling in use
 		VkSampleCountFlagBits GetMSAA();
 
+		// returns a reference to the vulkan physical device memory properties
+		VkPhysicalDeviceMemoryProperties& GetMemoryProperties();
+
+		// returns if VK_EXT_memory_budget was enabled
+		inline bool IsMemoryBudgetSupported() const { return mMemoryBudgetSupported; }
+
+		// returns if VK_KHR_timeline_semaphore was enabled
+		inline bool IsTimelineSemaphoreSupported() const { return mTimelineSemaphoreSupported; }
+
+		// returns if VK_EXT_calibrated_timestamps was enabled and can read the device's clock
+		inline bool IsCalibratedTimestampsSupported() const { return mCalibratedTimestampsSupported; }
+
 	public:
 
 		// returns the queue indices for all available queues
@@ -75,6 +91,9 @@ namespace Cosmos
 		// returns the maximum MSAA sample the physical device handles
 		VkSampleCountFlagBits GetMaxUsableSamples();
 
+		// returns if the physical device supports a given device extension
+		bool IsExtensionSupported(const char* name);
+
 	private:
 
 		// selects the most suitable physical device available
@@ -96,6 +115,10 @@ namespace Cosmos
 		VkQueue mGraphicsQueue;
 		VkQueue mPresentQueue;
 		VkQueue mComputeQueue;
+		VkQueue mTransferQueue;
 		VkSampleCountFlagBits mMSAACount;
+		bool mMemoryBudgetSupported = false;
+		bool mTimelineSemaphoreSupported = false;
+		bool mCalibratedTimestampsSupported = false;
 	};
 }
\ No newline at end of file
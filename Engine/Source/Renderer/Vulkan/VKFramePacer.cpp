@@ -0,0 +1,187 @@
+#include "epch.h"
+#include "VKFramePacer.h"
+
+#include "VKDevice.h"
+#include "VKGpuProfiler.h"
+
+#include <cmath>
+#include <thread>
+
+namespace Cosmos
+{
+	VKFramePacer* VKFramePacer::sFramePacer = nullptr;
+
+	// microseconds on the clock the gpu profiler places its timestamps on
+	static double SteadyMicroseconds()
+	{
+		return std::chrono::duration<double, std::micro>{ std::chrono::steady_clock::now().time_since_epoch() }.count();
+	}
+
+	// moves a smoothed timing towards its last sample
+	static void Smooth(float& value, double sample)
+	{
+		value += ((float)sample - value) * 0.1f;
+	}
+
+	VKFramePacer::VKFramePacer(Shared<VKDevice> device)
+		: mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Frame Pacer");
+		sFramePacer = this;
+	}
+
+	VKFramePacer::~VKFramePacer()
+	{
+		if (sFramePacer == this)
+			sFramePacer = nullptr;
+	}
+
+	void VKFramePacer::Wait(uint32_t frame, uint32_t framesInFlight, const std::vector<VkFence>& fences)
+	{
+		PROFILER_FUNCTION();
+
+		double start = SteadyMicroseconds();
+		Slot& slot = mSlots[frame];
+
+		// the slot's previous frame must be done before its resources are reused, when it wasn't the wait's end is when it finished
+		bool signaled = vkGetFenceStatus(mDevice->GetDevice(), fences[frame]) == VK_SUCCESS;
+		vkWaitForFences(mDevice->GetDevice(), 1, &fences[frame], VK_TRUE, UINT64_MAX);
+
+		if (slot.pending)
+		{
+			mCompleted = slot;
+			mCompleted.signaled = signaled ? 0.0 : SteadyMicroseconds();
+			slot.pending = false;
+		}
+
+		// every frame but the last submitted is waited on, the new one starts recording so that it's submitted as the last one ends
+		if (mLowLatency && framesInFlight > 1)
+		{
+			uint32_t previous = (frame + framesInFlight - 1) % framesInFlight;
+			std::vector<VkFence> others = {};
+
+			for (uint32_t i = 0; i < framesInFlight; i++)
+			{
+				if (i != frame && i != previous)
+					others.push_back(fences[i]);
+			}
+
+			if (!others.empty())
+				vkWaitForFences(mDevice->GetDevice(), (uint32_t)others.size(), others.data(), VK_TRUE, UINT64_MAX);
+
+			// the last frame runs alone on the gpu from when it was submitted or the ones before it finished
+			if (mSlots[previous].pending && vkGetFenceStatus(mDevice->GetDevice(), fences[previous]) == VK_NOT_READY)
+			{
+				double now = SteadyMicroseconds();
+				double end = std::max(now, mSlots[previous].submit) + mStats.gpuMilliseconds * 1000.0;
+				double due = end - mStats.cpuMilliseconds * 1000.0 - RENDERER_LOW_LATENCY_MARGIN_US;
+
+				// a frame's worth of delay at most, a bad prediction mustn't stall
+				if (due > now)
+					std::this_thread::sleep_for(std::chrono::microseconds((int64_t)std::min(due - now, (double)mStats.frameMilliseconds * 1000.0)));
+			}
+		}
+
+		// the input is sampled right after this returns, the time between samples is the frame time
+		slot.input = SteadyMicroseconds();
+		Smooth(mStats.waitMilliseconds, (slot.input - start) / 1000.0);
+
+		if (mLastInput > 0.0)
+		{
+			mFrameTimes[mFrameCount % RENDERER_FRAME_PACING_HISTORY] = (float)((slot.input - mLastInput) / 1000.0);
+			mFrameCount++;
+
+			uint32_t count = std::min(mFrameCount, (uint32_t)RENDERER_FRAME_PACING_HISTORY);
+			double sum = 0.0;
+			double squares = 0.0;
+			float maximum = 0.0f;
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				sum += mFrameTimes[i];
+				squares += (double)mFrameTimes[i] * mFrameTimes[i];
+				maximum = std::max(maximum, mFrameTimes[i]);
+			}
+
+			double mean = sum / count;
+			mStats.frameMilliseconds = (float)mean;
+			mStats.frameDeviation = (float)std::sqrt(std::max(squares / count - mean * mean, 0.0));
+			mStats.frameMaximum = maximum;
+		}
+
+		mLastInput = slot.input;
+	}
+
+	void VKFramePacer::AddTime(Phase phase, std::chrono::steady_clock::time_point start)
+	{
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		switch (phase)
+		{
+			case Phase::Acquire:
+			{
+				Smooth(mStats.acquireMilliseconds, milliseconds);
+				break;
+			}
+
+			case Phase::Present:
+			{
+				Smooth(mStats.presentMilliseconds, milliseconds);
+				break;
+			}
+		}
+	}
+
+	void VKFramePacer::OnSubmit(uint32_t frame)
+	{
+		Slot& slot = mSlots[frame];
+		slot.submit = SteadyMicroseconds();
+		slot.pending = true;
+
+		Smooth(mStats.cpuMilliseconds, (slot.submit - slot.input) / 1000.0);
+	}
+
+	void VKFramePacer::OnGpuFrame(bool timed)
+	{
+		if (mCompleted.submit <= 0.0)
+			return;
+
+		VKGpuProfiler* profiler = VKGpuProfiler::GetInstance();
+		double gpu = timed ? profiler->GetFrameMilliseconds() : 0.0;
+		double end = 0.0;
+
+		if (timed)
+			Smooth(mStats.gpuMilliseconds, gpu);
+
+		// calibrated timestamps or a fence that had to be waited on tell when the gpu finished, otherwise the gpu is assumed to start
+		// each frame once it was submitted and the one before it finished
+		if (timed && profiler->IsCalibrated())
+			end = profiler->GetFrameEndTime();
+
+		else if (mCompleted.signaled > 0.0)
+			end = mCompleted.signaled;
+
+		else
+			end = std::max(mCompleted.submit, mLastEnd) + gpu * 1000.0;
+
+		mStats.latencyEstimated = !(timed && profiler->IsCalibrated()) && mCompleted.signaled <= 0.0;
+		mLastEnd = end;
+
+		if (end > mCompleted.input)
+			Smooth(mStats.latencyMilliseconds, (end - mCompleted.input) / 1000.0);
+
+		mCompleted = {};
+	}
+
+	void VKFramePacer::Reset()
+	{
+		for (Slot& slot : mSlots)
+		{
+			slot = {};
+		}
+
+		mCompleted = {};
+		mLastInput = 0.0;
+		mLastEnd = 0.0;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+
+	// paces the frames in flight and measures where their time goes, from sampling the input to the gpu finishing the frame showing it
+	// the low latency mode keeps at most one frame queued on the gpu and delays the next one so it's submitted just as the gpu frees up,
+	// sampling the input as late as it can at the cost of the throughput a deeper queue gives
+	class VKFramePacer
+	{
+	public:
+
+		enum Phase
+		{
+			Acquire = 0,
+			Present
+		};
+
+		struct Stats
+		{
+			float frameMilliseconds = 0.0f;		// average time between frames over the history
+			float frameDeviation = 0.0f;		// standard deviation of the time between frames, how uneven they are
+			float frameMaximum = 0.0f;			// longest time between frames in the history
+			float cpuMilliseconds = 0.0f;		// from sampling the input to submitting the frame
+			float gpuMilliseconds = 0.0f;		// the frame's timestamps, 0 when the device can't write them
+			float waitMilliseconds = 0.0f;		// blocked on the fences and the low latency delay before sampling the input
+			float acquireMilliseconds = 0.0f;	// blocked acquiring the swapchain image
+			float presentMilliseconds = 0.0f;	// blocked presenting it
+			float latencyMilliseconds = 0.0f;	// from sampling the input to the gpu finishing the frame, the display adds up to a refresh and its queue
+			bool latencyEstimated = true;		// the gpu's finish was estimated from the submissions rather than measured
+		};
+
+	public:
+
+		// constructor
+		VKFramePacer(Shared<VKDevice> device);
+
+		// destructor
+		~VKFramePacer();
+
+		// returns the frame pacer singleton
+		inline static VKFramePacer* GetInstance() { return sFramePacer; }
+
+		// returns if the low latency mode is enabled
+		inline bool IsLowLatency() const { return mLowLatency; }
+
+		// enables or disables the low latency mode
+		inline void SetLowLatency(bool enabled) { mLowLatency = enabled; }
+
+		// returns the timings, smoothed over the last frames
+		inline const Stats& GetStats() const { return mStats; }
+
+	public:
+
+		// waits until the frame may begin and marks its input as sampled, the fences are the frames in flight in the order they're cycled
+		void Wait(uint32_t frame, uint32_t framesInFlight, const std::vector<VkFence>& fences);
+
+		// adds the time since start to the frame's acquire or present
+		void AddTime(Phase phase, std::chrono::steady_clock::time_point start);
+
+		// marks the frame as submitted
+		void OnSubmit(uint32_t frame);
+
+		// takes the gpu timings of the frame the last wait found done, once the gpu profiler read them or found none
+		void OnGpuFrame(bool timed);
+
+		// forgets the frames in flight, the device must be idle
+		void Reset();
+
+	private:
+
+		struct Slot
+		{
+			double input = 0.0;					// microseconds on the steady clock the frame's input was sampled at
+			double submit = 0.0;				// and it was submitted at
+			double signaled = 0.0;				// and its fence was seen signaled at, 0 when it was already signaled
+			bool pending = false;				// submitted and not waited on yet
+		};
+
+	private:
+
+		static VKFramePacer* sFramePacer;
+		Shared<VKDevice> mDevice;
+		bool mLowLatency = false;
+
+		std::array<Slot, RENDERER_MAX_FRAMES_IN_FLIGHT> mSlots = {};
+		Slot mCompleted = {};					// the frame the last wait found done, until its gpu timings are taken
+		double mLastInput = 0.0;
+		double mLastEnd = 0.0;
+
+		std::array<float, RENDERER_FRAME_PACING_HISTORY> mFrameTimes = {};
+		uint32_t mFrameCount = 0;
+		Stats mStats = {};
+	};
+}
@@ -0,0 +1,94 @@
+#include "epch.h"
+#include "VKFrameUniforms.h"
+
+#include "VKAllocator.h"
+#include "VKDevice.h"
+
+#include "Renderer/Buffer.h"
+
+namespace Cosmos
+{
+	VKFrameUniforms* VKFrameUniforms::sFrameUniforms = nullptr;
+
+	VKFrameUniforms::VKFrameUniforms(Shared<VKDevice> device, Shared<VKLinearAllocator> frameAllocator, VkDescriptorSetLayout layout)
+		: mDevice(device), mFrameAllocator(frameAllocator)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Frame Uniforms");
+		sFrameUniforms = this;
+
+		// camera and lighting, then the lights, clusters and light indices
+		std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		poolSizes[0].descriptorCount = 2;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes[1].descriptorCount = 3;
+
+		VkDescriptorPoolCreateInfo descPoolCI = {};
+		descPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descPoolCI.poolSizeCount = (uint32_t)poolSizes.size();
+		descPoolCI.pPoolSizes = poolSizes.data();
+		descPoolCI.maxSets = 1;
+		VK_ASSERT(vkCreateDescriptorPool(mDevice->GetDevice(), &descPoolCI, nullptr, &mDescriptorPool), "Failed to create frame uniforms descriptor pool");
+
+		VkDescriptorSetAllocateInfo descSetAllocInfo = {};
+		descSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descSetAllocInfo.descriptorPool = mDescriptorPool;
+		descSetAllocInfo.descriptorSetCount = 1;
+		descSetAllocInfo.pSetLayouts = &layout;
+		VK_ASSERT(vkAllocateDescriptorSets(mDevice->GetDevice(), &descSetAllocInfo, &mDescriptorSet), "Failed to allocate frame uniforms descriptor set");
+
+		// the frame allocator's buffer never changes, the offsets select each frame's copy when binding
+		// the storage buffers view all of it, the lighting uniforms tell where each frame's lights and clusters are
+		std::array<VkDescriptorBufferInfo, 5> bufferInfos = {};
+
+		for (uint32_t i = 0; i < (uint32_t)bufferInfos.size(); i++)
+		{
+			bufferInfos[i].buffer = mFrameAllocator->GetBuffer();
+			bufferInfos[i].offset = 0;
+			bufferInfos[i].range = VK_WHOLE_SIZE;
+		}
+
+		bufferInfos[0].range = sizeof(Camera_BufferObject);
+		bufferInfos[1].range = sizeof(Light_BufferObject);
+
+		std::array<VkWriteDescriptorSet, 5> writes = {};
+
+		for (uint32_t i = 0; i < (uint32_t)writes.size(); i++)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = mDescriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].dstArrayElement = 0;
+			writes[i].descriptorType = i < 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(mDevice->GetDevice(), (uint32_t)writes.size(), writes.data(), 0, nullptr);
+	}
+
+	VKFrameUniforms::~VKFrameUniforms()
+	{
+		vkDestroyDescriptorPool(mDevice->GetDevice(), mDescriptorPool, nullptr);
+
+		if (sFrameUniforms == this)
+			sFrameUniforms = nullptr;
+	}
+
+	bool VKFrameUniforms::Write(const Camera_BufferObject& camera, const Light_BufferObject& light)
+	{
+		VkDeviceSize alignment = mDevice->GetProperties().limits.minUniformBufferOffsetAlignment;
+		VKLinearAllocator::Range cameraRange = {};
+		VKLinearAllocator::Range lightRange = {};
+
+		if (!mFrameAllocator->Allocate(sizeof(Camera_BufferObject), alignment, cameraRange) || !mFrameAllocator->Allocate(sizeof(Light_BufferObject), alignment, lightRange))
+			return false;
+
+		memcpy(cameraRange.mapped, &camera, sizeof(Camera_BufferObject));
+		memcpy(lightRange.mapped, &light, sizeof(Light_BufferObject));
+
+		mCameraOffset = (uint32_t)cameraRange.offset;
+		mLightOffset = (uint32_t)lightRange.offset;
+		return true;
+	}
+}
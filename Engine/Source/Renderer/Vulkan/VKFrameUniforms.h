@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include <vulkan/vulkan.h>
+
+#include <array>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+	class VKLinearAllocator;
+	struct Camera_BufferObject;
+	struct Light_BufferObject;
+
+	// the camera and lighting every draw of a frame shares, written once per frame into the frame allocator
+	// a single set with dynamic uniform buffers views the frame allocator's buffer, each frame binds it with the offsets of its own copy
+	// the set's storage buffers view the whole frame allocator, the lighting holds where the frame's lights and clusters were allocated
+	class VKFrameUniforms
+	{
+	public:
+
+		// constructor, the set is allocated with the layout of the pipelines reading it (set 0)
+		VKFrameUniforms(Shared<VKDevice> device, Shared<VKLinearAllocator> frameAllocator, VkDescriptorSetLayout layout);
+
+		// destructor
+		~VKFrameUniforms();
+
+		// returns the frame uniforms singleton
+		inline static VKFrameUniforms* GetInstance() { return sFrameUniforms; }
+
+		// returns the set, the same for every frame
+		inline VkDescriptorSet GetDescriptorSet() const { return mDescriptorSet; }
+
+		// returns the offsets of the frame's last write, in binding order
+		inline std::array<uint32_t, 2> GetDynamicOffsets() const { return { mCameraOffset, mLightOffset }; }
+
+	public:
+
+		// copies the frame's camera and lighting into the frame allocator, returns false when it's exhausted (main thread only)
+		bool Write(const Camera_BufferObject& camera, const Light_BufferObject& light);
+
+	private:
+
+		static VKFrameUniforms* sFrameUniforms;
+		Shared<VKDevice> mDevice;
+		Shared<VKLinearAllocator> mFrameAllocator;
+
+		VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSet mDescriptorSet = VK_NULL_HANDLE;
+		uint32_t mCameraOffset = 0;
+		uint32_t mLightOffset = 0;
+	};
+}
@@ -0,0 +1,324 @@
+#include "epch.h"
+#include "VKGeometryPool.h"
+
+#include "VKBuffer.h"
+#include "VKCommander.h"
+#include "VKDeletionQueue.h"
+#include "VKDevice.h"
+#include "VKUploader.h"
+#include "VKVertex.h"
+
+namespace Cosmos
+{
+	VKGeometryPool* VKGeometryPool::sGeometryPool = nullptr;
+
+	VKGeometryPool::VKGeometryPool(Shared<VKDevice> device, uint32_t vertexCapacity, uint32_t indexCapacity)
+		: mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Geometry Pool");
+		sGeometryPool = this;
+
+		CreateBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, (VkDeviceSize)vertexCapacity * sizeof(VKVertex), mVertexBuffer, mVertexMemory);
+		CreateBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, (VkDeviceSize)indexCapacity * sizeof(uint32_t), mIndexBuffer, mIndexMemory);
+
+		mFreeVertices[0] = vertexCapacity;
+		mFreeIndices[0] = indexCapacity;
+		mStats.vertexCapacity = vertexCapacity;
+		mStats.indexCapacity = indexCapacity;
+	}
+
+	VKGeometryPool::~VKGeometryPool()
+	{
+		vkDestroyBuffer(mDevice->GetDevice(), mVertexBuffer, nullptr);
+		VKAllocator::GetInstance()->Free(mVertexMemory);
+
+		vkDestroyBuffer(mDevice->GetDevice(), mIndexBuffer, nullptr);
+		VKAllocator::GetInstance()->Free(mIndexMemory);
+
+		sGeometryPool = nullptr;
+	}
+
+	uint32_t VKGeometryPool::Allocate(uint32_t vertexCount, uint32_t indexCount)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		Range range = {};
+		range.vertexCount = vertexCount;
+		range.indexCount = indexCount;
+
+		bool fits = Take(mFreeVertices, vertexCount, range.firstVertex);
+
+		if (fits && !Take(mFreeIndices, indexCount, range.firstIndex))
+		{
+			Give(mFreeVertices, range.firstVertex, vertexCount);
+			fits = false;
+		}
+
+		// packing the live ranges may be enough, otherwise the full buffers double
+		if (!fits)
+		{
+			uint32_t vertexCapacity = mStats.vertexCapacity;
+			uint32_t indexCapacity = mStats.indexCapacity;
+
+			if (mStats.usedVertices + vertexCount > vertexCapacity)
+				vertexCapacity = std::max(vertexCapacity * 2, mStats.usedVertices + vertexCount);
+
+			if (mStats.usedIndices + indexCount > indexCapacity)
+				indexCapacity = std::max(indexCapacity * 2, mStats.usedIndices + indexCount);
+
+			if (vertexCapacity != mStats.vertexCapacity || indexCapacity != mStats.indexCapacity)
+				LOG_TO_TERMINAL(Logger::Severity::Info, "Growing geometry pool to %u vertices and %u indices", vertexCapacity, indexCapacity);
+
+			lock.unlock();
+			Defragment(vertexCapacity, indexCapacity);
+			lock.lock();
+
+			fits = Take(mFreeVertices, vertexCount, range.firstVertex) && Take(mFreeIndices, indexCount, range.firstIndex);
+			LOG_ASSERT(fits, "Geometry pool has no room for %u vertices and %u indices after defragmenting", vertexCount, indexCount);
+		}
+
+		uint32_t id = mNextId++;
+		mRanges[id] = range;
+
+		mStats.ranges++;
+		mStats.usedVertices += vertexCount;
+		mStats.usedIndices += indexCount;
+
+		return id;
+	}
+
+	void VKGeometryPool::Free(uint32_t id)
+	{
+		// the ranges stay live until then, so a defragmentation in between still moves them
+		VKDeletionQueue::GetInstance()->Push([this, id]() { Release(id); });
+	}
+
+	VKGeometryPool::Range VKGeometryPool::GetRange(uint32_t id)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto it = mRanges.find(id);
+		return it != mRanges.end() ? it->second : Range{};
+	}
+
+	uint64_t VKGeometryPool::Upload(uint32_t id, const void* vertices, const void* indices)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto it = mRanges.find(id);
+
+		if (it == mRanges.end())
+			return 0;
+
+		const Range& range = it->second;
+		uint64_t ticket = 0;
+
+		if (range.vertexCount > 0)
+			ticket = VKUploader::GetInstance()->UploadBuffer(mVertexBuffer, (VkDeviceSize)range.firstVertex * sizeof(VKVertex), vertices, (VkDeviceSize)range.vertexCount * sizeof(VKVertex));
+
+		if (range.indexCount > 0)
+			ticket = VKUploader::GetInstance()->UploadBuffer(mIndexBuffer, (VkDeviceSize)range.firstIndex * sizeof(uint32_t), indices, (VkDeviceSize)range.indexCount * sizeof(uint32_t));
+
+		mLastTicket = std::max(mLastTicket, ticket);
+		return ticket;
+	}
+
+	void VKGeometryPool::Bind(VkCommandBuffer commandBuffer)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mVertexBuffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, mIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void VKGeometryPool::Defragment(uint32_t vertexCapacity, uint32_t indexCapacity)
+	{
+		PROFILER_FUNCTION();
+
+		// uploads still heading to the current buffers must land before they're copied, including ones issued while waiting
+		std::unique_lock<std::mutex> lock(mMutex);
+		uint64_t lastTicket = 0;
+
+		while (lastTicket != mLastTicket)
+		{
+			lastTicket = mLastTicket;
+
+			lock.unlock();
+			VKUploader::GetInstance()->Wait(lastTicket);
+			lock.lock();
+		}
+
+		vertexCapacity = std::max(vertexCapacity > 0 ? vertexCapacity : mStats.vertexCapacity, mStats.usedVertices);
+		indexCapacity = std::max(indexCapacity > 0 ? indexCapacity : mStats.indexCapacity, mStats.usedIndices);
+
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		VKAllocation vertexMemory = {};
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		VKAllocation indexMemory = {};
+		CreateBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, (VkDeviceSize)vertexCapacity * sizeof(VKVertex), vertexBuffer, vertexMemory);
+		CreateBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, (VkDeviceSize)indexCapacity * sizeof(uint32_t), indexBuffer, indexMemory);
+
+		// ranges are packed in the order they were allocated
+		std::vector<VkBufferCopy> vertexRegions = {};
+		std::vector<VkBufferCopy> indexRegions = {};
+		uint32_t vertexHead = 0;
+		uint32_t indexHead = 0;
+
+		for (auto& [id, range] : mRanges)
+		{
+			if (range.vertexCount > 0)
+			{
+				vertexRegions.push_back({ (VkDeviceSize)range.firstVertex * sizeof(VKVertex), (VkDeviceSize)vertexHead * sizeof(VKVertex), (VkDeviceSize)range.vertexCount * sizeof(VKVertex) });
+				range.firstVertex = vertexHead;
+				vertexHead += range.vertexCount;
+			}
+
+			if (range.indexCount > 0)
+			{
+				indexRegions.push_back({ (VkDeviceSize)range.firstIndex * sizeof(uint32_t), (VkDeviceSize)indexHead * sizeof(uint32_t), (VkDeviceSize)range.indexCount * sizeof(uint32_t) });
+				range.firstIndex = indexHead;
+				indexHead += range.indexCount;
+			}
+		}
+
+		VkCommandBuffer commandBuffer = BeginSingleTimeCommand(mDevice, VKCommander::GetInstance()->GetMainRef()->commandPool);
+
+		if (!vertexRegions.empty())
+			vkCmdCopyBuffer(commandBuffer, mVertexBuffer, vertexBuffer, (uint32_t)vertexRegions.size(), vertexRegions.data());
+
+		if (!indexRegions.empty())
+			vkCmdCopyBuffer(commandBuffer, mIndexBuffer, indexBuffer, (uint32_t)indexRegions.size(), indexRegions.data());
+
+		// the copies are visible to every draw submitted afterwards
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		EndSingleTimeCommand(mDevice, VKCommander::GetInstance()->GetMainRef()->commandPool, commandBuffer);
+
+		// frames in flight may still read the old buffers
+		Shared<VKDevice> device = mDevice;
+		VkBuffer oldVertexBuffer = mVertexBuffer;
+		VKAllocation oldVertexMemory = mVertexMemory;
+		VkBuffer oldIndexBuffer = mIndexBuffer;
+		VKAllocation oldIndexMemory = mIndexMemory;
+
+		VKDeletionQueue::GetInstance()->Push([device, oldVertexBuffer, oldVertexMemory, oldIndexBuffer, oldIndexMemory]()
+		{
+			vkDestroyBuffer(device->GetDevice(), oldVertexBuffer, nullptr);
+			VKAllocator::GetInstance()->Free(oldVertexMemory);
+
+			vkDestroyBuffer(device->GetDevice(), oldIndexBuffer, nullptr);
+			VKAllocator::GetInstance()->Free(oldIndexMemory);
+		});
+
+		mVertexBuffer = vertexBuffer;
+		mVertexMemory = vertexMemory;
+		mIndexBuffer = indexBuffer;
+		mIndexMemory = indexMemory;
+
+		// all the free space is now after the packed ranges
+		mFreeVertices.clear();
+		mFreeIndices.clear();
+		Give(mFreeVertices, vertexHead, vertexCapacity - vertexHead);
+		Give(mFreeIndices, indexHead, indexCapacity - indexHead);
+
+		mStats.vertexCapacity = vertexCapacity;
+		mStats.indexCapacity = indexCapacity;
+		mStats.defragmentations++;
+	}
+
+	void VKGeometryPool::CreateBuffer(VkBufferUsageFlags usage, VkDeviceSize size, VkBuffer& buffer, VKAllocation& allocation)
+	{
+		// buffers are copied from when defragmenting
+		VK_ASSERT
+		(
+			BufferCreate
+			(
+				mDevice,
+				usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				std::max<VkDeviceSize>(size, 4),
+				&buffer,
+				&allocation
+			),
+			"Failed to create geometry pool buffer"
+		);
+	}
+
+	bool VKGeometryPool::Take(std::map<uint32_t, uint32_t>& freeList, uint32_t count, uint32_t& offset)
+	{
+		if (count == 0)
+		{
+			offset = 0;
+			return true;
+		}
+
+		for (auto it = freeList.begin(); it != freeList.end(); it++)
+		{
+			if (it->second < count)
+				continue;
+
+			offset = it->first;
+			uint32_t remaining = it->second - count;
+			freeList.erase(it);
+
+			if (remaining > 0)
+				freeList[offset + count] = remaining;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	void VKGeometryPool::Give(std::map<uint32_t, uint32_t>& freeList, uint32_t offset, uint32_t count)
+	{
+		if (count == 0)
+			return;
+
+		auto next = freeList.lower_bound(offset);
+
+		// merges with the following range
+		if (next != freeList.end() && offset + count == next->first)
+		{
+			count += next->second;
+			next = freeList.erase(next);
+		}
+
+		// merges with the preceding range
+		if (next != freeList.begin())
+		{
+			auto previous = std::prev(next);
+
+			if (previous->first + previous->second == offset)
+			{
+				previous->second += count;
+				return;
+			}
+		}
+
+		freeList[offset] = count;
+	}
+
+	void VKGeometryPool::Release(uint32_t id)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto it = mRanges.find(id);
+
+		if (it == mRanges.end())
+			return;
+
+		Give(mFreeVertices, it->second.firstVertex, it->second.vertexCount);
+		Give(mFreeIndices, it->second.firstIndex, it->second.indexCount);
+
+		mStats.ranges--;
+		mStats.usedVertices -= it->second.vertexCount;
+		mStats.usedIndices -= it->second.indexCount;
+		mRanges.erase(it);
+	}
+}
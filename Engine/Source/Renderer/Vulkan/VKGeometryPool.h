@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include "VKAllocator.h"
+#include <vulkan/vulkan.h>
+
+#include <map>
+#include <mutex>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+
+	// a device-local vertex buffer and index buffer every mesh takes its ranges from, so a pass binds them once and each draw
+	// only selects its vertexOffset and firstIndex
+	// ranges are handed out first-fit from free lists whose neighbours merge when released, released ranges are reused once no
+	// frame in flight can read them, and defragmenting copies the live ranges packed into new buffers (also how the pool grows)
+	class VKGeometryPool
+	{
+	public:
+
+		struct Range
+		{
+			uint32_t firstVertex = 0;
+			uint32_t vertexCount = 0;
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+		};
+
+		struct Stats
+		{
+			uint32_t ranges = 0;				// live ranges
+			uint32_t usedVertices = 0;			// vertices taken by the live ranges
+			uint32_t usedIndices = 0;			// indices taken by the live ranges
+			uint32_t vertexCapacity = 0;		// vertices the vertex buffer holds
+			uint32_t indexCapacity = 0;			// indices the index buffer holds
+			uint32_t defragmentations = 0;		// times the live ranges were packed into new buffers
+		};
+
+	public:
+
+		// constructor
+		VKGeometryPool(Shared<VKDevice> device, uint32_t vertexCapacity, uint32_t indexCapacity);
+
+		// destructor
+		~VKGeometryPool();
+
+		// returns the geometry pool singleton
+		inline static VKGeometryPool* GetInstance() { return sGeometryPool; }
+
+		// returns the pool statistics
+		inline const Stats& GetStats() const { return mStats; }
+
+	public:
+
+		// takes the ranges of a mesh, defragmenting and growing the pool when they don't fit (main thread only)
+		// returns the id the ranges are known by, as defragmenting moves them
+		uint32_t Allocate(uint32_t vertexCount, uint32_t indexCount);
+
+		// releases the ranges of a mesh, they're reused once no frame in flight can read them
+		void Free(uint32_t id);
+
+		// returns where the ranges of a mesh currently are
+		Range GetRange(uint32_t id);
+
+		// copies a mesh's vertices and indices into its ranges, returns the ticket of the upload
+		uint64_t Upload(uint32_t id, const void* vertices, const void* indices);
+
+		// binds the vertex and index buffers, every mesh drawn afterwards on the command buffer reads from them
+		void Bind(VkCommandBuffer commandBuffer);
+
+		// copies every live range packed into new buffers, 0 keeps a buffer's capacity (main thread only)
+		void Defragment(uint32_t vertexCapacity = 0, uint32_t indexCapacity = 0);
+
+	private:
+
+		// creates a buffer able to hold a capacity of elements
+		void CreateBuffer(VkBufferUsageFlags usage, VkDeviceSize size, VkBuffer& buffer, VKAllocation& allocation);
+
+		// takes the first free range big enough for a count of elements, returns false if none is
+		static bool Take(std::map<uint32_t, uint32_t>& freeList, uint32_t count, uint32_t& offset);
+
+		// gives back a range, merging it with its free neighbours
+		static void Give(std::map<uint32_t, uint32_t>& freeList, uint32_t offset, uint32_t count);
+
+		// returns the ranges of a mesh to the free lists once it's freed and no frame in flight reads them
+		void Release(uint32_t id);
+
+	private:
+
+		static VKGeometryPool* sGeometryPool;
+		Shared<VKDevice> mDevice;
+		std::mutex mMutex;
+
+		VkBuffer mVertexBuffer = VK_NULL_HANDLE;
+		VKAllocation mVertexMemory = {};
+		VkBuffer mIndexBuffer = VK_NULL_HANDLE;
+		VKAllocation mIndexMemory = {};
+
+		std::map<uint32_t, Range> mRanges = {};
+		std::map<uint32_t, uint32_t> mFreeVertices = {};	// offset and count of each free vertex range
+		std::map<uint32_t, uint32_t> mFreeIndices = {};		// offset and count of each free index range
+		uint32_t mNextId = 1;
+		uint64_t mLastTicket = 0;
+		Stats mStats = {};
+	};
+}
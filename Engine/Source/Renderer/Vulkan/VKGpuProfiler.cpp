@@ -0,0 +1,234 @@
+#include "epch.h"
+#include "VKGpuProfiler.h"
+
+#include "VKDevice.h"
+
+namespace Cosmos
+{
+	VKGpuProfiler* VKGpuProfiler::sGpuProfiler = nullptr;
+
+	// microseconds on the clock the cpu scopes are timed with
+	static double SteadyMicroseconds()
+	{
+		return std::chrono::duration<double, std::micro>{ std::chrono::steady_clock::now().time_since_epoch() }.count();
+	}
+
+	VKGpuProfiler::VKGpuProfiler(Shared<VKDevice> device)
+		: mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Gpu Profiler");
+		sGpuProfiler = this;
+
+		// timestamps are only valid on queue families reporting valid bits for them
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(mDevice->GetPhysicalDevice(), &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(mDevice->GetPhysicalDevice(), &familyCount, families.data());
+
+		VKDevice::QueueFamilyIndices indices = mDevice->FindQueueFamilies(mDevice->GetPhysicalDevice(), mDevice->GetSurface());
+		uint32_t validBits = indices.graphics.has_value() ? families[indices.graphics.value()].timestampValidBits : 0;
+		mTimestampPeriod = (double)mDevice->GetProperties().limits.timestampPeriod;
+
+		if (validBits == 0 || mTimestampPeriod <= 0.0)
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "Device can't write timestamps on the graphics queue, gpu scopes won't be timed");
+			return;
+		}
+
+		mSupported = true;
+		mTimestampMask = validBits >= 64 ? UINT64_MAX : ((uint64_t)1 << validBits) - 1;
+
+		for (Frame& frame : mFrames)
+		{
+			VkQueryPoolCreateInfo queryPoolCI = {};
+			queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolCI.pNext = nullptr;
+			queryPoolCI.flags = 0;
+			queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolCI.queryCount = RENDERER_GPU_PROFILER_SCOPES * 2;
+			VK_ASSERT(vkCreateQueryPool(mDevice->GetDevice(), &queryPoolCI, nullptr, &frame.queryPool), "Failed to create timestamp query pool");
+		}
+
+		// without reading the device's clock, a frame's first timestamp is placed where the frame started recording
+		if (mDevice->IsCalibratedTimestampsSupported())
+		{
+			mGetCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(mDevice->GetDevice(), "vkGetCalibratedTimestampsEXT");
+			mCalibrated = mGetCalibratedTimestamps != nullptr;
+		}
+	}
+
+	VKGpuProfiler::~VKGpuProfiler()
+	{
+		for (Frame& frame : mFrames)
+		{
+			if (frame.queryPool != VK_NULL_HANDLE)
+			{
+				vkDestroyQueryPool(mDevice->GetDevice(), frame.queryPool, nullptr);
+			}
+		}
+
+		sGpuProfiler = nullptr;
+	}
+
+	bool VKGpuProfiler::OnUpdate(uint32_t frame)
+	{
+		PROFILER_FUNCTION();
+
+		mCurrentFrame = frame;
+
+		if (!mSupported)
+			return false;
+
+		if (!mOpenScopes.empty())
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "%u gpu scopes were never ended", (uint32_t)mOpenScopes.size());
+			mOpenScopes.clear();
+		}
+
+		Frame& current = mFrames[frame];
+		bool read = false;
+
+		if (current.queryCount > 0)
+		{
+			std::vector<uint64_t> timestamps(current.queryCount);
+			VkResult res = vkGetQueryPoolResults(mDevice->GetDevice(), current.queryPool, 0, current.queryCount, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+			// not ready when a scope was left open, its end was never written
+			if (res == VK_SUCCESS)
+			{
+				if (mCalibrated)
+				{
+					Calibrate();
+				}
+
+				// scopes begin in submission order, the first one is the earliest
+				uint64_t first = timestamps[current.timings[0].begin] & mTimestampMask;
+				double firstTime = current.recordTime;
+
+				if (mCalibrated)
+				{
+					firstTime = mCalibrationTime + (double)(int64_t)(first - mCalibrationTicks) * mTimestampPeriod / 1000.0;
+				}
+
+				mResults.clear();
+				mFrameMilliseconds = 0.0;
+
+				for (const Timing& timing : current.timings)
+				{
+					uint64_t begin = timestamps[timing.begin] & mTimestampMask;
+					uint64_t end = timestamps[timing.end] & mTimestampMask;
+					double start = (double)((begin - first) & mTimestampMask) * mTimestampPeriod / 1000.0;
+					double duration = (double)((end - begin) & mTimestampMask) * mTimestampPeriod / 1000.0;
+
+					Result result = {};
+					result.name = timing.name;
+					result.depth = timing.depth;
+					result.start = start / 1000.0;
+					result.milliseconds = duration / 1000.0;
+					mResults.push_back(result);
+
+					mFrameMilliseconds = std::max(mFrameMilliseconds, result.start + result.milliseconds);
+					Profiler::Get().WriteGpu(timing.name, firstTime + start, duration);
+				}
+
+				mFrameEndTime = firstTime + mFrameMilliseconds * 1000.0;
+				read = true;
+			}
+		}
+
+		current.timings.clear();
+		current.queryCount = 0;
+		current.reset = false;
+		current.recordTime = SteadyMicroseconds();
+		return read;
+	}
+
+	void VKGpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const char* name)
+	{
+		if (!mSupported)
+			return;
+
+		Frame& current = mFrames[mCurrentFrame];
+
+		// kept balanced with the ends even when it can't be timed
+		if (current.queryCount + 2 > RENDERER_GPU_PROFILER_SCOPES * 2)
+		{
+			mOpenScopes.push_back(UINT32_MAX);
+			return;
+		}
+
+		// the frame's command buffers are submitted in the order they're recorded, the first scope resets the pool for all of them
+		if (!current.reset)
+		{
+			vkCmdResetQueryPool(commandBuffer, current.queryPool, 0, RENDERER_GPU_PROFILER_SCOPES * 2);
+			current.reset = true;
+		}
+
+		Timing timing = {};
+		timing.name = name;
+		timing.depth = (uint32_t)mOpenScopes.size();
+		timing.begin = current.queryCount;
+		timing.end = current.queryCount + 1;
+		current.queryCount += 2;
+
+		// both ends wait for the work recorded before them, so consecutive scopes read back to back instead of overlapping
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current.queryPool, timing.begin);
+
+		mOpenScopes.push_back((uint32_t)current.timings.size());
+		current.timings.push_back(timing);
+	}
+
+	void VKGpuProfiler::EndScope(VkCommandBuffer commandBuffer)
+	{
+		if (!mSupported || mOpenScopes.empty())
+			return;
+
+		uint32_t index = mOpenScopes.back();
+		mOpenScopes.pop_back();
+
+		if (index == UINT32_MAX)
+			return;
+
+		Frame& current = mFrames[mCurrentFrame];
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current.queryPool, current.timings[index].end);
+	}
+
+	void VKGpuProfiler::Calibrate()
+	{
+		VkCalibratedTimestampInfoEXT timestampInfo = {};
+		timestampInfo.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		timestampInfo.pNext = nullptr;
+		timestampInfo.timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+
+		uint64_t ticks = 0;
+		uint64_t deviation = 0;
+
+		// the steady clock isn't one of the host domains on every platform, it's read on both sides of the device's clock instead
+		double before = SteadyMicroseconds();
+
+		if (mGetCalibratedTimestamps(mDevice->GetDevice(), 1, &timestampInfo, &ticks, &deviation) != VK_SUCCESS)
+			return;
+
+		double after = SteadyMicroseconds();
+
+		mCalibrationTicks = ticks & mTimestampMask;
+		mCalibrationTime = (before + after) / 2.0;
+	}
+
+	VKGpuProfiler::Scope::Scope(VkCommandBuffer commandBuffer, const char* name)
+		: commandBuffer(commandBuffer)
+	{
+		if (sGpuProfiler)
+		{
+			sGpuProfiler->BeginScope(commandBuffer, name);
+		}
+	}
+
+	VKGpuProfiler::Scope::~Scope()
+	{
+		if (sGpuProfiler)
+		{
+			sGpuProfiler->EndScope(commandBuffer);
+		}
+	}
+}
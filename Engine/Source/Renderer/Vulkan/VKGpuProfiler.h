@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+
+	// times the render graph's passes and any scope recorded in them with timestamp queries, each frame in flight owning a query pool
+	// a frame's timestamps are read once its fence is signaled, so nothing stalls, and are placed on the cpu's clock for the profiler's trace
+	// devices that can't write timestamps on the graphics queue leave every scope untimed
+	class VKGpuProfiler
+	{
+	public:
+
+		struct Result
+		{
+			std::string name = {};
+			uint32_t depth = 0;			// how many scopes enclose it
+			double start = 0.0;			// milliseconds since the frame's first scope began
+			double milliseconds = 0.0;
+		};
+
+		// times a scope from construction to destruction
+		struct Scope
+		{
+			VkCommandBuffer commandBuffer;
+
+			// constructor
+			Scope(VkCommandBuffer commandBuffer, const char* name);
+
+			// destructor
+			~Scope();
+		};
+
+	public:
+
+		// constructor
+		VKGpuProfiler(Shared<VKDevice> device);
+
+		// destructor
+		~VKGpuProfiler();
+
+		// returns the gpu profiler singleton
+		inline static VKGpuProfiler* GetInstance() { return sGpuProfiler; }
+
+		// returns if the device can time scopes
+		inline bool IsSupported() const { return mSupported; }
+
+		// returns if the timestamps are placed on the cpu's clock by the device rather than estimated
+		inline bool IsCalibrated() const { return mCalibrated; }
+
+		// returns the scopes of the last frame read, in the order they began
+		inline const std::vector<Result>& GetResults() const { return mResults; }
+
+		// returns the milliseconds between the first scope beginning and the last one ending in the last frame read
+		inline double GetFrameMilliseconds() const { return mFrameMilliseconds; }
+
+		// returns the microseconds on the steady clock the last frame read ended at, only exact when the timestamps are calibrated
+		inline double GetFrameEndTime() const { return mFrameEndTime; }
+
+	public:
+
+		// reads the timestamps the frame wrote the last time it was rendered, after its fence was waited on, returns if there were any
+		bool OnUpdate(uint32_t frame);
+
+		// begins a scope, nested in the ones still open (main thread only, outside render passes for the frame's first scope)
+		void BeginScope(VkCommandBuffer commandBuffer, const char* name);
+
+		// ends the innermost open scope
+		void EndScope(VkCommandBuffer commandBuffer);
+
+	private:
+
+		// reads the device's clock along with the cpu's
+		void Calibrate();
+
+	private:
+
+		struct Timing
+		{
+			std::string name = {};
+			uint32_t depth = 0;
+			uint32_t begin = 0;							// queries holding the timestamps
+			uint32_t end = UINT32_MAX;					// not written when the scope is never ended
+		};
+
+		struct Frame
+		{
+			VkQueryPool queryPool = VK_NULL_HANDLE;
+			std::vector<Timing> timings = {};
+			uint32_t queryCount = 0;
+			bool reset = false;							// the pool was reset in this frame's command buffers
+			double recordTime = 0.0;					// microseconds on the steady clock when the frame started recording
+		};
+
+	private:
+
+		static VKGpuProfiler* sGpuProfiler;
+		Shared<VKDevice> mDevice;
+		bool mSupported = false;
+		bool mCalibrated = false;
+		uint64_t mTimestampMask = UINT64_MAX;
+		double mTimestampPeriod = 1.0;					// nanoseconds per tick
+		PFN_vkGetCalibratedTimestampsEXT mGetCalibratedTimestamps = nullptr;
+		uint64_t mCalibrationTicks = 0;
+		double mCalibrationTime = 0.0;
+
+		uint32_t mCurrentFrame = 0;
+		std::array<Frame, RENDERER_MAX_FRAMES_IN_FLIGHT> mFrames = {};
+		std::vector<uint32_t> mOpenScopes = {};
+		std::vector<Result> mResults = {};
+		double mFrameMilliseconds = 0.0;
+		double mFrameEndTime = 0.0;
+	};
+}
+
+// times the rest of the enclosing block on the gpu
+#define GPU_PROFILER_SCOPE(commandBuffer, name) Cosmos::VKGpuProfiler::Scope gpuScope##__LINE__(commandBuffer, name);
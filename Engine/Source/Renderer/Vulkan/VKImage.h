@@ -1,5 +1,6 @@
 #pragma once
 
+#include "VKAllocator.h"
 #include <vulkan/vulkan.h>
 #include <memory>
 #include <vector>
@@ -9,7 +10,7 @@ namespace Cosmos
 	// forward declarations
 	class VKDevice;
 
-	// creates an image
+	// creates an image, its memory comes from the VKAllocator and must be released with VKAllocator::Free
 	void CreateImage
 	(
 		std::shared_ptr<VKDevice> device,
@@ -23,7 +24,7 @@ namespace Cosmos
 		VkImageUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkImage& image,
-		VkDeviceMemory& memory,
+		VKAllocation& allocation,
 		VkImageCreateFlags flags = 0
 	);
 
@@ -48,9 +49,15 @@ namespace Cosmos
 	// creates an image memory barrier
 	void InsertImageMemoryBarrier(VkCommandBuffer cmdbuffer, VkImage image, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkImageLayout oldImageLayout, VkImageLayout newImageLayout, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, VkImageSubresourceRange subresourceRange);
 
+	// records the blits filling every mip level from the first one, the levels must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL and end up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	void GenerateMipmaps(VkCommandBuffer cmdBuffer, VkImage image, int32_t width, int32_t height, uint32_t mipLevels);
+
 	// returns a optimal format given the specification
 	VkFormat FindSuitableFormat(std::shared_ptr<VKDevice> device, const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
 	// returns the optimal depth format
 	VkFormat FindDepthFormat(std::shared_ptr<VKDevice> device);
+
+	// returns if a depth format also holds stencil, its layout transitions must then include the stencil aspect
+	bool HasStencilComponent(VkFormat format);
 }
\ No newline at end of file
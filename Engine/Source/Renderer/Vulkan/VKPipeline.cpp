@@ -2,12 +2,19 @@
 #include "VKPipeline.h"
 
 #include "VKCommander.h"
+#include "VKPipelineCache.h"
+#include "Thread/Pool.h"
+
+#include <chrono>
 
 namespace Cosmos
 {
     VKPipeline::VKPipeline(Shared<VKDevice> device, VKPipelineSpecification specification)
         : mDevice(device), mSpecification(specification)
     {
+        LOG_ASSERT(mSpecification.vertexShader->IsValid(), "Failed to compile shader %s. Details: %s", mSpecification.vertexShader->GetPathRef().c_str(), mSpecification.vertexShader->GetErrorRef().c_str());
+        LOG_ASSERT(mSpecification.fragmentShader->IsValid(), "Failed to compile shader %s. Details: %s", mSpecification.fragmentShader->GetPathRef().c_str(), mSpecification.fragmentShader->GetErrorRef().c_str());
+
         // descriptor set and pipeline layout
         VkDescriptorSetLayoutCreateInfo descSetLayoutCI = {};
         descSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -17,12 +24,17 @@ namespace Cosmos
         descSetLayoutCI.pBindings = mSpecification.bindings.data();
         VK_ASSERT(vkCreateDescriptorSetLayout(device->GetDevice(), &descSetLayoutCI, nullptr, &mDescriptorSetLayout), "Failed to create descriptor set layout");
 
+        std::vector<VkDescriptorSetLayout> setLayouts = { mDescriptorSetLayout };
+        setLayouts.insert(setLayouts.end(), mSpecification.sharedSetLayouts.begin(), mSpecification.sharedSetLayouts.end());
+
         VkPipelineLayoutCreateInfo pipelineLayoutCI = {};
         pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutCI.pNext = nullptr;
         pipelineLayoutCI.flags = 0;
-        pipelineLayoutCI.setLayoutCount = 1;
-        pipelineLayoutCI.pSetLayouts = &mDescriptorSetLayout;
+        pipelineLayoutCI.setLayoutCount = (uint32_t)setLayouts.size();
+        pipelineLayoutCI.pSetLayouts = setLayouts.data();
+        pipelineLayoutCI.pushConstantRangeCount = (uint32_t)mSpecification.pushConstants.size();
+        pipelineLayoutCI.pPushConstantRanges = mSpecification.pushConstants.data();
         VK_ASSERT(vkCreatePipelineLayout(mDevice->GetDevice(), &pipelineLayoutCI, nullptr, &mPipelineLayout), "Failed to create pipeline layout");
 
         // shader stages
@@ -33,8 +45,22 @@ namespace Cosmos
         };
 
         // pipeline default configuration
-        // vertex input state
+        // vertex input state, the descriptions are kept with the pipeline as VKVertex's are overwritten by the next pipeline created
+        mSpecification.vertexBindings = VKVertex::GetBindingDescriptions();
+        mSpecification.vertexAttributes = VKVertex::GetAttributeDescriptions(mSpecification.vertexComponents);
+
+        if (mSpecification.instanced)
+        {
+            std::vector<VkVertexInputAttributeDescription> instanceAttributes = VKVertex::GetInstanceAttributeDescriptions((uint32_t)mSpecification.vertexComponents.size());
+            mSpecification.vertexBindings.push_back(VKVertex::GetInstanceBindingDescription());
+            mSpecification.vertexAttributes.insert(mSpecification.vertexAttributes.end(), instanceAttributes.begin(), instanceAttributes.end());
+        }
+
         mSpecification.VISCI = VKVertex::GetPipelineVertexInputState(mSpecification.vertexComponents);
+        mSpecification.VISCI.vertexBindingDescriptionCount = (uint32_t)mSpecification.vertexBindings.size();
+        mSpecification.VISCI.pVertexBindingDescriptions = mSpecification.vertexBindings.data();
+        mSpecification.VISCI.vertexAttributeDescriptionCount = (uint32_t)mSpecification.vertexAttributes.size();
+        mSpecification.VISCI.pVertexAttributeDescriptions = mSpecification.vertexAttributes.data();
 
         // input assembly state
         mSpecification.IASCI.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -108,19 +134,80 @@ namespace Cosmos
         vkDeviceWaitIdle(mDevice->GetDevice());
 
         vkDestroyPipeline(mDevice->GetDevice(), mPipeline, nullptr);
+
+        for (auto& variant : mVariants)
+        {
+            vkDestroyPipeline(mDevice->GetDevice(), variant.second, nullptr);
+        }
+
         vkDestroyPipelineLayout(mDevice->GetDevice(), mPipelineLayout, nullptr);
         vkDestroyDescriptorSetLayout(mDevice->GetDevice(), mDescriptorSetLayout, nullptr);
     }
 
     void VKPipeline::Build()
     {
+        VK_ASSERT(CreatePipeline(mSpecification.shaderStagesCI, 0, mPipeline), "Failed to create graphics pipeline");
+    }
+
+    uint32_t VKPipeline::GetKeywordMask(const std::string& keyword) const
+    {
+        for (size_t i = 0; i < mSpecification.keywords.size(); i++)
+        {
+            if (mSpecification.keywords[i] == keyword)
+                return 1u << i;
+        }
+
+        return 0;
+    }
+
+    std::vector<uint32_t> VKPipeline::GetVariants()
+    {
+        std::lock_guard<std::mutex> lock(mVariantsMutex);
+        std::vector<uint32_t> variants = {};
+
+        for (auto& variant : mVariants)
+        {
+            variants.push_back(variant.first);
+        }
+
+        return variants;
+    }
+
+    VkResult VKPipeline::CreatePipeline(const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages, uint32_t variant, VkPipeline& pipeline) const
+    {
+        // every keyword is specialized on every stage, constants a stage doesn't declare are ignored by it
+        std::vector<VkSpecializationMapEntry> specializationEntries(mSpecification.keywords.size());
+        std::vector<VkBool32> specializationData(mSpecification.keywords.size());
+
+        for (size_t i = 0; i < mSpecification.keywords.size(); i++)
+        {
+            specializationEntries[i].constantID = (uint32_t)i;
+            specializationEntries[i].offset = (uint32_t)(i * sizeof(VkBool32));
+            specializationEntries[i].size = sizeof(VkBool32);
+            specializationData[i] = (variant & (1u << i)) ? VK_TRUE : VK_FALSE;
+        }
+
+        VkSpecializationInfo specializationInfo = {};
+        specializationInfo.mapEntryCount = (uint32_t)specializationEntries.size();
+        specializationInfo.pMapEntries = specializationEntries.data();
+        specializationInfo.dataSize = specializationData.size() * sizeof(VkBool32);
+        specializationInfo.pData = specializationData.data();
+
+        std::vector<VkPipelineShaderStageCreateInfo> stages = shaderStages;
+
+        if (!mSpecification.keywords.empty())
+        {
+            for (VkPipelineShaderStageCreateInfo& stage : stages)
+                stage.pSpecializationInfo = &specializationInfo;
+        }
+
         // pipeline creation
         VkGraphicsPipelineCreateInfo pipelineCI = {};
         pipelineCI.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipelineCI.pNext = nullptr;
         pipelineCI.flags = 0;
-        pipelineCI.stageCount = (uint32_t)mSpecification.shaderStagesCI.size();
-        pipelineCI.pStages = mSpecification.shaderStagesCI.data();
+        pipelineCI.stageCount = (uint32_t)stages.size();
+        pipelineCI.pStages = stages.data();
         pipelineCI.pVertexInputState = &mSpecification.VISCI;
         pipelineCI.pInputAssemblyState = &mSpecification.IASCI;
         pipelineCI.pViewportState = &mSpecification.VSCI;
@@ -132,6 +219,134 @@ namespace Cosmos
         pipelineCI.layout = mPipelineLayout;
         pipelineCI.renderPass = VKCommander::GetInstance()->GetMainRef()->renderPass;
         pipelineCI.subpass = 0;
-        VK_ASSERT(vkCreateGraphicsPipelines(mDevice->GetDevice(), mSpecification.cache, 1, &pipelineCI, nullptr, &mPipeline), "Failed to create graphics pipeline");
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        VkResult res = vkCreateGraphicsPipelines(mDevice->GetDevice(), mSpecification.cache, 1, &pipelineCI, nullptr, &pipeline);
+
+        if (VKPipelineCache::GetInstance())
+            VKPipelineCache::GetInstance()->AddBuild(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+
+        return res;
+    }
+
+    VkPipeline VKPipeline::GetVariant(uint32_t variant)
+    {
+        if (variant == 0)
+            return mPipeline;
+
+        {
+            std::lock_guard<std::mutex> lock(mVariantsMutex);
+            auto it = mVariants.find(variant);
+
+            if (it != mVariants.end())
+                return it->second;
+        }
+
+        // variants nobody prewarmed are built on first use, stalling this frame once
+        PROFILER_SCOPE("Pipeline Variant Build");
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VK_ASSERT(CreatePipeline(mSpecification.shaderStagesCI, variant, pipeline), "Failed to create graphics pipeline variant");
+
+        std::lock_guard<std::mutex> lock(mVariantsMutex);
+        mVariants[variant] = pipeline;
+
+        return pipeline;
+    }
+
+    void VKPipeline::BuildVariants(const std::vector<uint32_t>& variants)
+    {
+        PROFILER_FUNCTION();
+
+        std::vector<std::future<void>> builds = {};
+
+        for (uint32_t variant : variants)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mVariantsMutex);
+
+                if (variant == 0 || mVariants.find(variant) != mVariants.end())
+                    continue;
+            }
+
+            builds.push_back(thread::PoolManager::GetInstance().GetResourcesPool()->Enqueue([this, variant]()
+            {
+                VkPipeline pipeline = VK_NULL_HANDLE;
+                VK_ASSERT(CreatePipeline(mSpecification.shaderStagesCI, variant, pipeline), "Failed to create graphics pipeline variant");
+
+                std::lock_guard<std::mutex> lock(mVariantsMutex);
+                mVariants[variant] = pipeline;
+            }));
+        }
+
+        for (std::future<void>& build : builds)
+            build.get();
+    }
+
+    std::vector<VkPipeline> VKPipeline::Swap(Shared<VKShader> vertexShader, Shared<VKShader> fragmentShader, VkPipeline pipeline)
+    {
+        mSpecification.vertexShader = vertexShader;
+        mSpecification.fragmentShader = fragmentShader;
+        mSpecification.shaderStagesCI =
+        {
+            mSpecification.vertexShader->GetShaderStageCreateInfoRef(),
+            mSpecification.fragmentShader->GetShaderStageCreateInfoRef()
+        };
+
+        std::vector<VkPipeline> previous = { mPipeline };
+        mPipeline = pipeline;
+
+        // variants were specialized from the previous shaders, they're built again once requested
+        std::lock_guard<std::mutex> lock(mVariantsMutex);
+
+        for (auto& variant : mVariants)
+        {
+            previous.push_back(variant.second);
+        }
+
+        mVariants.clear();
+
+        return previous;
+    }
+
+    std::vector<VkPipeline> VKPipeline::Rebuild()
+    {
+        PROFILER_FUNCTION();
+
+        mSpecification.MSCI.rasterizationSamples = VKCommander::GetInstance()->GetMainRef()->msaa;
+
+        std::vector<VkPipeline> previous = { mPipeline };
+        std::vector<uint32_t> variants = {};
+        {
+            std::lock_guard<std::mutex> lock(mVariantsMutex);
+
+            for (auto& variant : mVariants)
+            {
+                previous.push_back(variant.second);
+                variants.push_back(variant.first);
+            }
+
+            mVariants.clear();
+        }
+
+        // the variants in use are built again upfront, so the next frames don't stall on them
+        Build();
+        BuildVariants(variants);
+
+        return previous;
+    }
+
+    void VKPipeline::BuildParallel(const std::vector<Shared<VKPipeline>>& pipelines)
+    {
+        PROFILER_FUNCTION();
+
+        // pipeline caches are internally synchronized, the builds only share the cache
+        std::vector<std::future<void>> builds = {};
+
+        for (const Shared<VKPipeline>& pipeline : pipelines)
+            builds.push_back(thread::PoolManager::GetInstance().GetResourcesPool()->Enqueue([pipeline]() { pipeline->Build(); }));
+
+        for (std::future<void>& build : builds)
+            build.get();
     }
 }
\ No newline at end of file
@@ -6,6 +6,9 @@
 #include "VKShader.h"
 #include "VKVertex.h"
 
+#include <mutex>
+#include <unordered_map>
+
 namespace Cosmos
 {
     struct VKPipelineSpecification
@@ -15,11 +18,20 @@ namespace Cosmos
         Shared<VKShader> vertexShader;
         Shared<VKShader> fragmentShader;
         std::vector<VKVertex::Component> vertexComponents = {};
+        bool instanced = false; // model matrices are read per instance from binding 1, right after the vertex components
         std::vector<VkDescriptorSetLayoutBinding> bindings = {};
+        std::vector<VkDescriptorSetLayout> sharedSetLayouts = {}; // sets after the pipeline's own (set 0), their layouts are owned elsewhere
+        std::vector<VkPushConstantRange> pushConstants = {};
+
+        // feature keywords the shaders are specialized with, each one a boolean specialization constant whose constant_id is its index
+        // a variant is a mask of the enabled keywords, the pipeline object itself being the variant without any
+        std::vector<std::string> keywords = {};
         
         // these will be auto generated, but can be previously modified between VKPipeline::VKPipeline and VKPipeline::Build for customization
         std::vector<VkDynamicState> dynamicStates { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
         std::vector<VkPipelineShaderStageCreateInfo> shaderStagesCI = {};
+        std::vector<VkVertexInputBindingDescription> vertexBindings = {};
+        std::vector<VkVertexInputAttributeDescription> vertexAttributes = {};
         VkPipelineVertexInputStateCreateInfo VISCI = {};
         VkPipelineInputAssemblyStateCreateInfo IASCI = {};
         VkPipelineViewportStateCreateInfo VSCI = {};
@@ -53,11 +65,38 @@ namespace Cosmos
         // returns the pipeline
         inline VkPipeline GetPipeline() const { return mPipeline; }
 
+        // returns the mask of a keyword, 0 if the pipeline doesn't declare it
+        uint32_t GetKeywordMask(const std::string& keyword) const;
+
+        // returns the masks of every variant built so far, besides the pipeline itself
+        std::vector<uint32_t> GetVariants();
+
     public:
 
         // creates a pipeline object given previously configured struct VKPiplineSpecification
         void Build();
 
+        // creates a pipeline object from the specification but other shader stages, without touching this pipeline
+        // only reads the specification, so it may run on any thread as long as the specification isn't modified meanwhile
+        VkResult CreatePipeline(const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages, uint32_t variant, VkPipeline& pipeline) const;
+
+        // returns the pipeline object of a variant, building it the first time it's requested (main thread only)
+        VkPipeline GetVariant(uint32_t variant);
+
+        // builds several variants at once on the resources pool, returning once all of them are done
+        void BuildVariants(const std::vector<uint32_t>& variants);
+
+        // replaces the shaders and the pipeline object, keeping the layouts so that descriptor sets remain valid
+        // returns the previous pipeline objects, variants included, which the caller must destroy once no frame in flight uses them
+        std::vector<VkPipeline> Swap(Shared<VKShader> vertexShader, Shared<VKShader> fragmentShader, VkPipeline pipeline);
+
+        // builds the pipeline object and its variants again for the current main render pass and its samples, keeping the layouts
+        // returns the previous pipeline objects, which the caller must destroy once no frame in flight uses them
+        std::vector<VkPipeline> Rebuild();
+
+        // builds several pipelines at once on the resources pool, returning once all of them are done
+        static void BuildParallel(const std::vector<Shared<VKPipeline>>& pipelines);
+
     private:
 
         Shared<VKDevice> mDevice;
@@ -65,5 +104,8 @@ namespace Cosmos
         VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
         VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
         VkPipeline mPipeline = VK_NULL_HANDLE;
+
+        std::mutex mVariantsMutex;
+        std::unordered_map<uint32_t, VkPipeline> mVariants = {};
     };
 }
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "epch.h"
+#include "VKPipelineCache.h"
+
+#include "VKDevice.h"
+#include "Util/FileSystem.h"
+
+#include <cstring>
+
+namespace Cosmos
+{
+	VKPipelineCache* VKPipelineCache::sPipelineCache = nullptr;
+
+	VKPipelineCache::VKPipelineCache(Shared<VKDevice> device, std::string path)
+		: mDevice(device), mPath(path)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Pipeline Cache");
+		sPipelineCache = this;
+
+		std::vector<uint8_t> data = {};
+
+		if (FileExists(mPath))
+			data = ReadFromBinary(mPath);
+
+		mStats.hit = !data.empty() && Validate(data);
+
+		if (!data.empty() && !mStats.hit)
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "Pipeline cache %s was written by another driver or device, starting empty", mPath.c_str());
+
+		VkPipelineCacheCreateInfo pipelineCacheCI = {};
+		pipelineCacheCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		pipelineCacheCI.pNext = nullptr;
+		pipelineCacheCI.flags = 0;
+		pipelineCacheCI.initialDataSize = mStats.hit ? data.size() : 0;
+		pipelineCacheCI.pInitialData = mStats.hit ? data.data() : nullptr;
+		VkResult res = vkCreatePipelineCache(mDevice->GetDevice(), &pipelineCacheCI, nullptr, &mCache);
+
+		// the driver may still refuse data that passed the header check
+		if (res != VK_SUCCESS && mStats.hit)
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "Driver rejected pipeline cache %s, starting empty", mPath.c_str());
+
+			mStats.hit = false;
+			pipelineCacheCI.initialDataSize = 0;
+			pipelineCacheCI.pInitialData = nullptr;
+			res = vkCreatePipelineCache(mDevice->GetDevice(), &pipelineCacheCI, nullptr, &mCache);
+		}
+
+		VK_ASSERT(res, "Failed to create pipeline cache");
+
+		mStats.loadedBytes = mStats.hit ? data.size() : 0;
+		mStats.savedBytes = mStats.loadedBytes;
+		mLastSave = std::chrono::steady_clock::now();
+	}
+
+	VKPipelineCache::~VKPipelineCache()
+	{
+		Save();
+
+		vkDestroyPipelineCache(mDevice->GetDevice(), mCache, nullptr);
+		sPipelineCache = nullptr;
+	}
+
+	void VKPipelineCache::OnUpdate()
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		if (now - mLastSave < std::chrono::seconds(RENDERER_PIPELINE_CACHE_SAVE_INTERVAL))
+			return;
+
+		mLastSave = now;
+		Save();
+	}
+
+	bool VKPipelineCache::Save()
+	{
+		PROFILER_FUNCTION();
+
+		size_t size = 0;
+		VK_ASSERT(vkGetPipelineCacheData(mDevice->GetDevice(), mCache, &size, nullptr), "Failed to query pipeline cache size");
+
+		// the cache only grows, same size means nothing new was built
+		if (size == 0 || size == mStats.savedBytes)
+			return true;
+
+		std::vector<uint8_t> data(size);
+		VK_ASSERT(vkGetPipelineCacheData(mDevice->GetDevice(), mCache, &size, data.data()), "Failed to retrieve pipeline cache data");
+
+		if (!WriteToBinaryAtomic(mPath, data.data(), size))
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Error, "Failed to save pipeline cache %s", mPath.c_str());
+			return false;
+		}
+
+		mStats.savedBytes = size;
+		return true;
+	}
+
+	void VKPipelineCache::AddBuild(std::chrono::microseconds duration)
+	{
+		mStats.builds++;
+		mStats.buildMicroseconds += (uint64_t)duration.count();
+	}
+
+	void VKPipelineCache::LogStats()
+	{
+		LOG_TO_TERMINAL
+		(
+			Logger::Severity::Info,
+			"Pipeline cache %s (%zu bytes loaded), %u pipelines built in %.2fms",
+			mStats.hit ? "hit" : "miss",
+			mStats.loadedBytes,
+			mStats.builds.load(),
+			(double)mStats.buildMicroseconds.load() / 1000.0
+		);
+	}
+
+	bool VKPipelineCache::Validate(const std::vector<uint8_t>& data)
+	{
+		// the data starts with a VkPipelineCacheHeaderVersionOne, read field by field as the file may not be aligned
+		constexpr size_t headerSize = 16 + VK_UUID_SIZE;
+
+		if (data.size() < headerSize)
+			return false;
+
+		uint32_t length = 0;
+		uint32_t version = 0;
+		uint32_t vendor = 0;
+		uint32_t device = 0;
+		uint8_t uuid[VK_UUID_SIZE] = {};
+
+		memcpy(&length, data.data() + 0, sizeof(uint32_t));
+		memcpy(&version, data.data() + 4, sizeof(uint32_t));
+		memcpy(&vendor, data.data() + 8, sizeof(uint32_t));
+		memcpy(&device, data.data() + 12, sizeof(uint32_t));
+		memcpy(uuid, data.data() + 16, VK_UUID_SIZE);
+
+		const VkPhysicalDeviceProperties& properties = mDevice->GetProperties();
+
+		if (length < headerSize || length > data.size() || version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+			return false;
+
+		if (vendor != properties.vendorID || device != properties.deviceID)
+			return false;
+
+		return memcmp(uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+
+	// the pipeline cache persisted on disk between runs, letting the driver skip the compilation of pipelines it has already built
+	// the file is only used when it was written by the same driver and device, otherwise the cache starts empty
+	class VKPipelineCache
+	{
+	public:
+
+		struct Stats
+		{
+			bool hit = false;						// the file on disk was valid and loaded into the cache
+			size_t loadedBytes = 0;					// bytes loaded from disk
+			size_t savedBytes = 0;					// bytes written to disk by the last save
+			std::atomic<uint32_t> builds = 0;		// pipelines built through VKPipeline::Build
+			std::atomic<uint64_t> buildMicroseconds = 0;	// time spent inside VKPipeline::Build
+		};
+
+	public:
+
+		// constructor
+		VKPipelineCache(Shared<VKDevice> device, std::string path);
+
+		// destructor, saves the cache one last time
+		~VKPipelineCache();
+
+		// returns the pipeline cache singleton
+		inline static VKPipelineCache* GetInstance() { return sPipelineCache; }
+
+		// returns the vulkan pipeline cache
+		inline VkPipelineCache GetCache() const { return mCache; }
+
+		// returns the cache statistics
+		inline const Stats& GetStats() const { return mStats; }
+
+	public:
+
+		// saves the cache every RENDERER_PIPELINE_CACHE_SAVE_INTERVAL seconds, so that a crash keeps what was built until then
+		void OnUpdate();
+
+		// writes the cache to disk if it has grown since the last save, returns false if the write failed
+		bool Save();
+
+		// accounts a pipeline build, safe to be called from any thread
+		void AddBuild(std::chrono::microseconds duration);
+
+		// prints the cache statistics
+		void LogStats();
+
+	private:
+
+		// returns if the data was written by this driver and device
+		bool Validate(const std::vector<uint8_t>& data);
+
+	private:
+
+		static VKPipelineCache* sPipelineCache;
+		Shared<VKDevice> mDevice;
+		std::string mPath = {};
+		VkPipelineCache mCache = VK_NULL_HANDLE;
+		Stats mStats = {};
+		std::chrono::steady_clock::time_point mLastSave = {};
+	};
+}
@@ -0,0 +1,844 @@
+#include "epch.h"
+#include "VKRenderGraph.h"
+
+#include "VKCommander.h"
+#include "VKDeletionQueue.h"
+#include "VKDevice.h"
+#include "VKGpuProfiler.h"
+#include "VKImage.h"
+
+#include <unordered_set>
+
+namespace Cosmos
+{
+	VKRenderGraph* VKRenderGraph::sRenderGraph = nullptr;
+
+	VKRenderGraph::VKRenderGraph(Shared<VKDevice> device)
+		: mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Render Graph");
+		sRenderGraph = this;
+	}
+
+	VKRenderGraph::~VKRenderGraph()
+	{
+		Release();
+
+		sRenderGraph = nullptr;
+	}
+
+	void VKRenderGraph::SetExtent(VkExtent2D extent)
+	{
+		mExtent = extent;
+		mDirty = true;
+	}
+
+	void VKRenderGraph::SetOutput(const std::string& resource)
+	{
+		mOutput = resource;
+		mDirty = true;
+	}
+
+	void VKRenderGraph::Import(const std::string& name, const std::vector<VkImage>& images, const std::vector<VkImageView>& views, VkImageAspectFlags aspect)
+	{
+		LOG_ASSERT(!images.empty() && images.size() == views.size(), "Imported images must come with a view each");
+
+		Resource& resource = mResources[name];
+		LOG_ASSERT(!resource.transient, "A transient image can't be imported");
+
+		resource.images = images;
+		resource.views = views;
+		resource.aspect = aspect;
+		mDirty = true;
+	}
+
+	void VKRenderGraph::CreateTransient(const std::string& name, const Transient& description)
+	{
+		// the previous images may be bound to the framebuffers
+		Release();
+
+		Resource& resource = mResources[name];
+		resource.transient = true;
+		resource.description = description;
+		resource.aspect = description.aspect;
+		mDirty = true;
+	}
+
+	void VKRenderGraph::RemoveResource(const std::string& name)
+	{
+		Release();
+
+		for (Pass& pass : mPasses)
+		{
+			auto uses = [&name](const Access& access) { return access.resource == name; };
+			pass.reads.erase(std::remove_if(pass.reads.begin(), pass.reads.end(), uses), pass.reads.end());
+			pass.writes.erase(std::remove_if(pass.writes.begin(), pass.writes.end(), uses), pass.writes.end());
+		}
+
+		mResources.erase(name);
+		mDirty = true;
+	}
+
+	void VKRenderGraph::AddPass(const Pass& pass)
+	{
+		auto it = std::find_if(mPasses.begin(), mPasses.end(), [&pass](const Pass& other) { return other.name == pass.name; });
+
+		if (it != mPasses.end())
+			*it = pass;
+
+		else
+			mPasses.push_back(pass);
+
+		mDirty = true;
+	}
+
+	void VKRenderGraph::AddRead(const std::string& pass, const Access& access)
+	{
+		auto it = std::find_if(mPasses.begin(), mPasses.end(), [&pass](const Pass& other) { return other.name == pass; });
+
+		if (it == mPasses.end())
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "Render graph has no pass %s to read %s", pass.c_str(), access.resource.c_str());
+			return;
+		}
+
+		it->reads.push_back(access);
+		mDirty = true;
+	}
+
+	void VKRenderGraph::RemovePass(const std::string& name)
+	{
+		// the compiled passes refer to the others by index
+		Release();
+
+		mPasses.erase(std::remove_if(mPasses.begin(), mPasses.end(), [&name](const Pass& pass) { return pass.name == name; }), mPasses.end());
+		mDirty = true;
+	}
+
+	const VKRenderGraph::Transient* VKRenderGraph::GetTransient(const std::string& name) const
+	{
+		auto it = mResources.find(name);
+
+		if (it == mResources.end() || !it->second.transient)
+			return nullptr;
+
+		return &it->second.description;
+	}
+
+	VkImage VKRenderGraph::GetImage(const std::string& name, uint32_t imageIndex) const
+	{
+		auto it = mResources.find(name);
+
+		if (it == mResources.end() || it->second.images.empty())
+			return VK_NULL_HANDLE;
+
+		return it->second.images[imageIndex % it->second.images.size()];
+	}
+
+	VkImageView VKRenderGraph::GetView(const std::string& name, uint32_t imageIndex) const
+	{
+		auto it = mResources.find(name);
+
+		if (it == mResources.end() || it->second.views.empty())
+			return VK_NULL_HANDLE;
+
+		return it->second.views[imageIndex % it->second.views.size()];
+	}
+
+	void VKRenderGraph::Execute(uint32_t frame, uint32_t imageIndex)
+	{
+		PROFILER_FUNCTION();
+
+		if (mDirty)
+		{
+			Compile();
+		}
+
+		mCommandBuffers.clear();
+
+		for (Compiled& compiled : mCompiled)
+		{
+			Pass& pass = mPasses[compiled.pass];
+			Shared<VKCommandEntry>& entry = VKCommander::GetInstance()->GetEntriesRef()[pass.name];
+			VkCommandBuffer cmdBuffer = entry->commandBuffers[frame];
+
+			vkResetCommandBuffer(cmdBuffer, /*VkCommandBufferResetFlagBits*/ 0);
+
+			VkCommandBufferBeginInfo cmdBeginInfo = {};
+			cmdBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			cmdBeginInfo.pNext = nullptr;
+			cmdBeginInfo.flags = 0;
+			VK_ASSERT(vkBeginCommandBuffer(cmdBuffer, &cmdBeginInfo), "Failed to begin command buffer recording");
+
+			// the pass is timed as a whole, its barrier included
+			VKGpuProfiler::GetInstance()->BeginScope(cmdBuffer, pass.name.c_str());
+
+			// compute work can't be recorded inside the render pass
+			if (pass.prepare)
+			{
+				pass.prepare(cmdBuffer);
+			}
+
+			// every dependency of the pass is waited on by a single barrier
+			if (compiled.srcStage != 0 || !compiled.transitions.empty())
+			{
+				VkMemoryBarrier memoryBarrier = {};
+				memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+				memoryBarrier.srcAccessMask = compiled.srcAccess;
+				memoryBarrier.dstAccessMask = compiled.dstAccess;
+
+				std::vector<VkImageMemoryBarrier> imageBarriers = {};
+				imageBarriers.reserve(compiled.transitions.size());
+
+				for (const Transition& transition : compiled.transitions)
+				{
+					const Resource& resource = mResources[transition.resource];
+					VkImageAspectFlags aspect = resource.aspect;
+
+					// views of depth and stencil images only see the depth, their layouts change for both
+					if (resource.transient && (aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0 && HasStencilComponent(resource.description.format))
+						aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+					VkImageMemoryBarrier imageBarrier = {};
+					imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+					imageBarrier.srcAccessMask = transition.srcAccess;
+					imageBarrier.dstAccessMask = transition.dstAccess;
+					imageBarrier.oldLayout = transition.oldLayout;
+					imageBarrier.newLayout = transition.newLayout;
+					imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.image = resource.images[imageIndex % resource.images.size()];
+					imageBarrier.subresourceRange = { aspect, 0, 1, 0, 1 };
+					imageBarriers.push_back(imageBarrier);
+				}
+
+				vkCmdPipelineBarrier
+				(
+					cmdBuffer,
+					compiled.srcStage != 0 ? compiled.srcStage : (VkPipelineStageFlags)VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+					compiled.dstStage,
+					0,
+					compiled.srcStage != 0 ? 1 : 0,
+					&memoryBarrier,
+					0,
+					nullptr,
+					(uint32_t)imageBarriers.size(),
+					imageBarriers.data()
+				);
+			}
+
+			if (pass.attachments.empty())
+			{
+				if (pass.record)
+				{
+					pass.record(cmdBuffer);
+				}
+			}
+
+			else
+			{
+				VkRenderPassBeginInfo renderPassBeginInfo = {};
+				renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				renderPassBeginInfo.renderPass = entry->renderPass;
+				renderPassBeginInfo.framebuffer = compiled.framebuffers[imageIndex % compiled.framebuffers.size()];
+				renderPassBeginInfo.renderArea.offset = { 0, 0 };
+				renderPassBeginInfo.renderArea.extent = mExtent;
+				renderPassBeginInfo.clearValueCount = (uint32_t)pass.clearValues.size();
+				renderPassBeginInfo.pClearValues = pass.clearValues.data();
+				vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+				// set frame commandbuffer viewport
+				VkViewport viewport = {};
+				viewport.x = 0.0f;
+				viewport.y = 0.0f;
+				viewport.width = (float)mExtent.width;
+				viewport.height = (float)mExtent.height;
+				viewport.minDepth = 0.0f;
+				viewport.maxDepth = 1.0f;
+				vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+				// set frame commandbuffer scissor
+				VkRect2D scissor = {};
+				scissor.offset = { 0, 0 };
+				scissor.extent = mExtent;
+				vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+				if (pass.record)
+				{
+					pass.record(cmdBuffer);
+				}
+
+				vkCmdEndRenderPass(cmdBuffer);
+			}
+
+			VKGpuProfiler::GetInstance()->EndScope(cmdBuffer);
+
+			VK_ASSERT(vkEndCommandBuffer(cmdBuffer), "Failed to end command buffer recording");
+			mCommandBuffers.push_back(cmdBuffer);
+		}
+	}
+
+	void VKRenderGraph::Compile()
+	{
+		PROFILER_FUNCTION();
+
+		Release();
+		mStats = {};
+
+		for (uint32_t index : Schedule())
+		{
+			LOG_ASSERT(VKCommander::GetInstance()->Exists(mPasses[index].name), "Render graph pass %s has no command entry", mPasses[index].name.c_str());
+
+			Compiled compiled = {};
+			compiled.pass = index;
+			mCompiled.push_back(compiled);
+		}
+
+		std::vector<uint32_t> order = {};
+
+		for (const Compiled& compiled : mCompiled)
+		{
+			order.push_back(compiled.pass);
+		}
+
+		CreateTransients(order);
+		PlanBarriers();
+		CreateFramebuffers();
+
+		mStats.passes = (uint32_t)mCompiled.size();
+		mDirty = false;
+
+		LOG_TO_TERMINAL
+		(
+			Logger::Severity::Trace,
+			"Render graph compiled: %u passes (%u culled), %u barriers, %u transient images (%u aliased) in %.2fKB",
+			mStats.passes,
+			mStats.culled,
+			mStats.barriers,
+			mStats.transients,
+			mStats.aliased,
+			(double)mStats.transientBytes / 1024.0
+		);
+	}
+
+	std::vector<uint32_t> VKRenderGraph::Schedule()
+	{
+		uint32_t count = (uint32_t)mPasses.size();
+
+		// walking back from the output, a pass is kept when it writes something the output or a kept pass reads
+		std::vector<bool> kept(count, false);
+		std::unordered_set<std::string> needed = { mOutput };
+		bool changed = true;
+
+		while (changed)
+		{
+			changed = false;
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (kept[i])
+					continue;
+
+				bool contributes = mPasses[i].sideEffect;
+
+				for (const Access& write : mPasses[i].writes)
+				{
+					contributes |= needed.count(write.resource) > 0;
+				}
+
+				if (!contributes)
+					continue;
+
+				kept[i] = true;
+				changed = true;
+
+				for (const Access& read : mPasses[i].reads)
+				{
+					needed.insert(read.resource);
+				}
+			}
+		}
+
+		// writers of a resource run in the order they were added, passes only reading it run once all of them have
+		std::unordered_map<std::string, std::vector<uint32_t>> writers = {};
+		std::vector<std::vector<uint32_t>> dependents(count);
+		std::vector<uint32_t> dependencies(count, 0);
+		uint32_t keptCount = 0;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (!kept[i])
+				continue;
+
+			keptCount++;
+
+			for (const Access& write : mPasses[i].writes)
+			{
+				std::vector<uint32_t>& list = writers[write.resource];
+
+				if (list.empty() || list.back() != i)
+					list.push_back(i);
+			}
+		}
+
+		for (auto& [resource, list] : writers)
+		{
+			for (size_t i = 1; i < list.size(); i++)
+			{
+				dependents[list[i - 1]].push_back(list[i]);
+				dependencies[list[i]]++;
+			}
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (!kept[i])
+				continue;
+
+			for (const Access& read : mPasses[i].reads)
+			{
+				auto it = writers.find(read.resource);
+
+				// imported images nothing writes, or a resource the pass writes itself and is already ordered by
+				if (it == writers.end() || std::find(it->second.begin(), it->second.end(), i) != it->second.end())
+					continue;
+
+				for (uint32_t writer : it->second)
+				{
+					dependents[writer].push_back(i);
+					dependencies[i]++;
+				}
+			}
+		}
+
+		// among the passes ready to run, the one added first goes first
+		std::vector<uint32_t> order = {};
+		std::vector<bool> scheduled(count, false);
+
+		while (order.size() < keptCount)
+		{
+			uint32_t next = UINT32_MAX;
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (kept[i] && !scheduled[i] && dependencies[i] == 0)
+				{
+					next = i;
+					break;
+				}
+			}
+
+			if (next == UINT32_MAX)
+			{
+				LOG_ASSERT(false, "Render graph passes depend on each other in a cycle");
+				break;
+			}
+
+			scheduled[next] = true;
+			order.push_back(next);
+
+			for (uint32_t dependent : dependents[next])
+			{
+				dependencies[dependent]--;
+			}
+		}
+
+		mStats.culled = count - keptCount;
+		return order;
+	}
+
+	void VKRenderGraph::CreateTransients(const std::vector<uint32_t>& order)
+	{
+		struct Lifetime
+		{
+			std::string name = {};
+			uint32_t first = UINT32_MAX;
+			uint32_t last = 0;
+			VkMemoryRequirements requirements = {};
+		};
+
+		struct Slot
+		{
+			VkMemoryRequirements requirements = {};
+			std::vector<std::pair<uint32_t, uint32_t>> lifetimes = {};
+		};
+
+		// the positions of the first and last passes using each transient image, unused ones aren't created
+		std::vector<Lifetime> lifetimes = {};
+		std::unordered_map<std::string, uint32_t> indices = {};
+
+		for (uint32_t position = 0; position < (uint32_t)order.size(); position++)
+		{
+			const Pass& pass = mPasses[order[position]];
+
+			for (const std::vector<Access>* accesses : { &pass.reads, &pass.writes })
+			{
+				for (const Access& access : *accesses)
+				{
+					auto it = mResources.find(access.resource);
+
+					if (it == mResources.end() || !it->second.transient)
+						continue;
+
+					auto [index, inserted] = indices.emplace(access.resource, (uint32_t)lifetimes.size());
+
+					if (inserted)
+					{
+						lifetimes.push_back({ access.resource });
+					}
+
+					Lifetime& lifetime = lifetimes[index->second];
+					lifetime.first = std::min(lifetime.first, position);
+					lifetime.last = std::max(lifetime.last, position);
+				}
+			}
+		}
+
+		for (Lifetime& lifetime : lifetimes)
+		{
+			Resource& resource = mResources[lifetime.name];
+
+			VkImageCreateInfo imageCI = {};
+			imageCI.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageCI.imageType = VK_IMAGE_TYPE_2D;
+			imageCI.extent.width = mExtent.width;
+			imageCI.extent.height = mExtent.height;
+			imageCI.extent.depth = 1;
+			imageCI.mipLevels = 1;
+			imageCI.arrayLayers = 1;
+			imageCI.format = resource.description.format;
+			imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageCI.usage = resource.description.usage;
+			imageCI.samples = resource.description.samples;
+			imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			resource.images.resize(1);
+			VK_ASSERT(vkCreateImage(mDevice->GetDevice(), &imageCI, nullptr, &resource.images[0]), "Failed to create transient image");
+			vkGetImageMemoryRequirements(mDevice->GetDevice(), resource.images[0], &lifetime.requirements);
+		}
+
+		// biggest first, each image goes to the first slot of a compatible memory type none of whose images is alive at the same time
+		std::sort(lifetimes.begin(), lifetimes.end(), [](const Lifetime& a, const Lifetime& b) { return a.requirements.size > b.requirements.size; });
+		std::vector<Slot> slots = {};
+
+		for (Lifetime& lifetime : lifetimes)
+		{
+			uint32_t chosen = UINT32_MAX;
+
+			for (uint32_t i = 0; i < (uint32_t)slots.size() && chosen == UINT32_MAX; i++)
+			{
+				if ((slots[i].requirements.memoryTypeBits & lifetime.requirements.memoryTypeBits) == 0)
+					continue;
+
+				bool overlaps = false;
+
+				for (const auto& [first, last] : slots[i].lifetimes)
+				{
+					overlaps |= lifetime.first <= last && first <= lifetime.last;
+				}
+
+				if (!overlaps)
+					chosen = i;
+			}
+
+			if (chosen == UINT32_MAX)
+			{
+				chosen = (uint32_t)slots.size();
+				slots.push_back({ lifetime.requirements });
+			}
+
+			else
+			{
+				VkMemoryRequirements& requirements = slots[chosen].requirements;
+				requirements.size = std::max(requirements.size, lifetime.requirements.size);
+				requirements.alignment = std::max(requirements.alignment, lifetime.requirements.alignment);
+				requirements.memoryTypeBits &= lifetime.requirements.memoryTypeBits;
+				mStats.aliased++;
+			}
+
+			slots[chosen].lifetimes.push_back({ lifetime.first, lifetime.last });
+			mResources[lifetime.name].slot = chosen;
+		}
+
+		mSlots.resize(slots.size());
+
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			VK_ASSERT(VKAllocator::GetInstance()->Allocate(slots[i].requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VKAllocator::Resource::Optimal, &mSlots[i]), "Failed to allocate memory for transient images");
+			mStats.transientBytes += slots[i].requirements.size;
+		}
+
+		for (Lifetime& lifetime : lifetimes)
+		{
+			Resource& resource = mResources[lifetime.name];
+			const VKAllocation& allocation = mSlots[resource.slot];
+
+			vkBindImageMemory(mDevice->GetDevice(), resource.images[0], allocation.memory, allocation.offset);
+			resource.views = { CreateImageView(mDevice, resource.images[0], resource.description.format, resource.description.aspect) };
+		}
+
+		mStats.transients = (uint32_t)lifetimes.size();
+	}
+
+	void VKRenderGraph::PlanBarriers()
+	{
+		struct State
+		{
+			VkPipelineStageFlags writeStage = 0;		// stages of the last write, 0 when nothing wrote
+			VkAccessFlags writeAccess = 0;
+			VkPipelineStageFlags readStage = 0;			// stages reading since the last write
+			VkPipelineStageFlags visibleStage = 0;		// stages the last write was made visible to
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			std::string owner = {};						// image whose contents the memory holds
+		};
+
+		const VkAccessFlags writeMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+		// transient images sharing memory share its hazards
+		std::unordered_map<std::string, State> states = {};
+
+		// the first walk leaves every state as the previous frame does, only the second one records barriers
+		for (uint32_t walk = 0; walk < 2; walk++)
+		{
+			// the hazards of the previous frame remain, a transient image's contents don't
+			for (auto& [key, state] : states)
+			{
+				state.owner.clear();
+			}
+
+			for (Compiled& compiled : mCompiled)
+			{
+				const Pass& pass = mPasses[compiled.pass];
+
+				// a resource both read and written by the pass is a single access
+				std::vector<std::pair<Access, bool>> accesses = {};
+
+				for (const std::vector<Access>* list : { &pass.reads, &pass.writes })
+				{
+					bool write = list == &pass.writes;
+
+					for (const Access& access : *list)
+					{
+						auto it = std::find_if(accesses.begin(), accesses.end(), [&access](const std::pair<Access, bool>& other) { return other.first.resource == access.resource; });
+
+						if (it == accesses.end())
+						{
+							accesses.push_back({ access, write });
+							continue;
+						}
+
+						it->first.stage |= access.stage;
+						it->first.access |= access.access;
+						it->second |= write;
+
+						if (it->first.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+							it->first.layout = access.layout;
+
+						if (access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED)
+							it->first.finalLayout = access.finalLayout;
+					}
+				}
+
+				for (auto& [access, write] : accesses)
+				{
+					auto it = mResources.find(access.resource);
+
+					if (it == mResources.end())
+						continue;
+
+					const Resource& resource = it->second;
+					State& state = states[resource.transient ? "#" + std::to_string(resource.slot) : access.resource];
+
+					// a transient image's contents don't survive another image using its memory
+					bool discard = resource.transient && state.owner != access.resource;
+					VkImageLayout current = discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+					bool transition = access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != current;
+
+					VkPipelineStageFlags srcStage = 0;
+					VkAccessFlags srcAccess = 0;
+
+					// write after write and write after read, a layout transition writes too
+					if (write || transition)
+					{
+						srcStage = state.writeStage | state.readStage;
+						srcAccess = state.writeAccess;
+					}
+
+					// read after write, reads after reads need nothing
+					else if (state.writeStage != 0 && (access.stage & ~state.visibleStage) != 0)
+					{
+						srcStage = state.writeStage;
+						srcAccess = state.writeAccess;
+					}
+
+					if (walk == 1)
+					{
+						if (transition)
+						{
+							Transition imageTransition = {};
+							imageTransition.resource = access.resource;
+							imageTransition.oldLayout = current;
+							imageTransition.newLayout = access.layout;
+							imageTransition.srcAccess = srcAccess;
+							imageTransition.dstAccess = access.access;
+							compiled.transitions.push_back(imageTransition);
+						}
+
+						else if (srcStage != 0)
+						{
+							compiled.srcAccess |= srcAccess;
+							compiled.dstAccess |= access.access;
+						}
+
+						if (srcStage != 0 || transition)
+						{
+							compiled.srcStage |= srcStage;
+							compiled.dstStage |= access.stage;
+						}
+					}
+
+					if (write || transition)
+					{
+						state.writeStage = access.stage;
+						state.writeAccess = write ? access.access & writeMask : 0;
+						state.readStage = 0;
+						state.visibleStage = access.stage;
+					}
+
+					else
+					{
+						state.readStage |= access.stage;
+						state.visibleStage |= srcStage != 0 ? access.stage : 0;
+					}
+
+					if (access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED)
+						state.layout = access.finalLayout;
+
+					else if (access.layout != VK_IMAGE_LAYOUT_UNDEFINED)
+						state.layout = access.layout;
+
+					else if (write)
+						state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+					state.owner = access.resource;
+				}
+			}
+		}
+
+		for (const Compiled& compiled : mCompiled)
+		{
+			if (compiled.srcStage != 0 || !compiled.transitions.empty())
+				mStats.barriers++;
+		}
+	}
+
+	void VKRenderGraph::CreateFramebuffers()
+	{
+		// imported images either come one per swapchain image or as a single one
+		size_t imageCount = 1;
+
+		for (auto& [name, resource] : mResources)
+		{
+			imageCount = std::max(imageCount, resource.views.size());
+		}
+
+		for (Compiled& compiled : mCompiled)
+		{
+			const Pass& pass = mPasses[compiled.pass];
+
+			if (pass.attachments.empty())
+				continue;
+
+			compiled.framebuffers.resize(imageCount);
+
+			for (size_t i = 0; i < imageCount; i++)
+			{
+				std::vector<VkImageView> attachments = {};
+
+				for (const std::string& attachment : pass.attachments)
+				{
+					auto it = mResources.find(attachment);
+					LOG_ASSERT(it != mResources.end() && !it->second.views.empty(), "Render graph pass %s has no image %s to attach", pass.name.c_str(), attachment.c_str());
+
+					attachments.push_back(it->second.views[i % it->second.views.size()]);
+				}
+
+				VkFramebufferCreateInfo framebufferCI = {};
+				framebufferCI.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+				framebufferCI.renderPass = VKCommander::GetInstance()->GetEntriesRef()[pass.name]->renderPass;
+				framebufferCI.attachmentCount = (uint32_t)attachments.size();
+				framebufferCI.pAttachments = attachments.data();
+				framebufferCI.width = mExtent.width;
+				framebufferCI.height = mExtent.height;
+				framebufferCI.layers = 1;
+				VK_ASSERT(vkCreateFramebuffer(mDevice->GetDevice(), &framebufferCI, nullptr, &compiled.framebuffers[i]), "Failed to create framebuffer");
+			}
+		}
+	}
+
+	void VKRenderGraph::Release()
+	{
+		std::vector<VkFramebuffer> framebuffers = {};
+		std::vector<VkImage> images = {};
+		std::vector<VkImageView> views = {};
+
+		for (Compiled& compiled : mCompiled)
+		{
+			framebuffers.insert(framebuffers.end(), compiled.framebuffers.begin(), compiled.framebuffers.end());
+		}
+
+		for (auto& [name, resource] : mResources)
+		{
+			if (!resource.transient)
+				continue;
+
+			images.insert(images.end(), resource.images.begin(), resource.images.end());
+			views.insert(views.end(), resource.views.begin(), resource.views.end());
+
+			resource.images.clear();
+			resource.views.clear();
+			resource.slot = UINT32_MAX;
+		}
+
+		if (!framebuffers.empty() || !images.empty() || !mSlots.empty())
+		{
+			// frames in flight may still be using them
+			VkDevice device = mDevice->GetDevice();
+			std::vector<VKAllocation> slots = std::move(mSlots);
+
+			std::function<void()> deleter = [device, framebuffers, images, views, slots]() mutable
+				{
+					for (VkFramebuffer framebuffer : framebuffers)
+					{
+						vkDestroyFramebuffer(device, framebuffer, nullptr);
+					}
+
+					for (VkImageView view : views)
+					{
+						vkDestroyImageView(device, view, nullptr);
+					}
+
+					for (VkImage image : images)
+					{
+						vkDestroyImage(device, image, nullptr);
+					}
+
+					for (VKAllocation& slot : slots)
+					{
+						VKAllocator::GetInstance()->Free(slot);
+					}
+				};
+
+			if (VKDeletionQueue::GetInstance())
+				VKDeletionQueue::GetInstance()->Push(std::move(deleter));
+
+			else
+				deleter();
+		}
+
+		mCompiled.clear();
+		mSlots.clear();
+		mDirty = true;
+	}
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include "VKAllocator.h"
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+
+	// passes declare the images they read and write instead of being recorded in a fixed order by the renderer, the graph orders them,
+	// drops the ones the presented image doesn't depend on, records the barriers between them and builds their framebuffers
+	// transient images only live inside a frame and are created by the graph, the ones whose passes never overlap share their memory
+	class VKRenderGraph
+	{
+	public:
+
+		struct Access
+		{
+			std::string resource = {};
+			VkPipelineStageFlags stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			VkAccessFlags access = 0;
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;		// layout the pass expects, undefined discards the contents
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;	// layout the pass leaves, undefined when it's the expected one
+		};
+
+		struct Pass
+		{
+			std::string name = {};									// command entry the pass records into, along with its render pass
+			std::vector<Access> reads = {};							// reads see the resource once every pass writing it has run
+			std::vector<Access> writes = {};						// passes writing the same resource run in the order they were added
+			std::vector<std::string> attachments = {};				// framebuffer attachments in render pass order, none records without a render pass
+			std::vector<VkClearValue> clearValues = {};
+			bool sideEffect = false;								// kept even if the presented image doesn't depend on it
+			std::function<void(VkCommandBuffer)> prepare = nullptr;	// recorded ahead of the barriers and the render pass, may be empty
+			std::function<void(VkCommandBuffer)> record = nullptr;	// recorded inside the render pass
+		};
+
+		struct Transient
+		{
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+			VkImageUsageFlags usage = 0;
+			VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		};
+
+		struct Stats
+		{
+			uint32_t passes = 0;				// passes recorded every frame
+			uint32_t culled = 0;				// passes the presented image doesn't depend on
+			uint32_t barriers = 0;				// pipeline barriers recorded every frame
+			uint32_t transients = 0;			// transient images in use
+			uint32_t aliased = 0;				// transient images placed in another one's memory
+			VkDeviceSize transientBytes = 0;	// memory backing the transient images
+		};
+
+	public:
+
+		// constructor
+		VKRenderGraph(Shared<VKDevice> device);
+
+		// destructor
+		~VKRenderGraph();
+
+		// returns the render graph singleton
+		inline static VKRenderGraph* GetInstance() { return sRenderGraph; }
+
+		// returns the statistics of the last compilation
+		inline const Stats& GetStats() const { return mStats; }
+
+		// returns the command buffers of the last execution, in submission order
+		inline const std::vector<VkCommandBuffer>& GetCommandBuffers() const { return mCommandBuffers; }
+
+		// returns the size of the framebuffers and the transient images
+		inline VkExtent2D GetExtent() const { return mExtent; }
+
+	public:
+
+		// sets the size of the framebuffers and the transient images
+		void SetExtent(VkExtent2D extent);
+
+		// sets the resource presented at the end of the frame, passes it doesn't depend on are culled
+		void SetOutput(const std::string& resource);
+
+		// adds images owned elsewhere, either one per swapchain image or a single one, importing again replaces them
+		// they must already be in the layout their last access of a frame leaves them
+		void Import(const std::string& name, const std::vector<VkImage>& images, const std::vector<VkImageView>& views, VkImageAspectFlags aspect);
+
+		// adds an image the graph creates with the extent, its contents don't survive the frame
+		void CreateTransient(const std::string& name, const Transient& description);
+
+		// removes a resource and every access passes have of it
+		void RemoveResource(const std::string& name);
+
+		// adds a pass, replacing the one with the same name
+		void AddPass(const Pass& pass);
+
+		// adds a read to a pass, for resources its owner doesn't know about
+		void AddRead(const std::string& pass, const Access& access);
+
+		// removes a pass
+		void RemovePass(const std::string& name);
+
+		// returns the description of a transient image, nullptr for imported images and unknown resources
+		const Transient* GetTransient(const std::string& name) const;
+
+		// returns a resource's image for a swapchain image, null when it doesn't exist, transient images only do once the graph is compiled
+		VkImage GetImage(const std::string& name, uint32_t imageIndex) const;
+
+		// returns a resource's view for a swapchain image, null when it doesn't exist
+		VkImageView GetView(const std::string& name, uint32_t imageIndex) const;
+
+		// compiles the graph if it changed and records every pass of the frame (main thread only)
+		void Execute(uint32_t frame, uint32_t imageIndex);
+
+	private:
+
+		struct Resource
+		{
+			bool transient = false;
+			Transient description = {};
+			std::vector<VkImage> images = {};			// one per swapchain image or a single one
+			std::vector<VkImageView> views = {};
+			VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+			uint32_t slot = UINT32_MAX;					// memory slot of transient images
+		};
+
+		struct Transition
+		{
+			std::string resource = {};
+			VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkImageLayout newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkAccessFlags srcAccess = 0;
+			VkAccessFlags dstAccess = 0;
+		};
+
+		struct Compiled
+		{
+			uint32_t pass = 0;
+			VkPipelineStageFlags srcStage = 0;			// no barrier when 0
+			VkPipelineStageFlags dstStage = 0;
+			VkAccessFlags srcAccess = 0;
+			VkAccessFlags dstAccess = 0;
+			std::vector<Transition> transitions = {};
+			std::vector<VkFramebuffer> framebuffers = {};
+		};
+
+	private:
+
+		// culls and orders the passes, places the transient images and plans the barriers
+		void Compile();
+
+		// returns the kept passes in execution order
+		std::vector<uint32_t> Schedule();
+
+		// creates the transient images the kept passes use, sharing memory between the ones never alive at once
+		void CreateTransients(const std::vector<uint32_t>& order);
+
+		// computes the barrier each pass records, from the accesses of the previous frame onwards
+		void PlanBarriers();
+
+		// creates the framebuffers of each pass with a render pass
+		void CreateFramebuffers();
+
+		// destroys the compiled objects once no frame in flight uses them
+		void Release();
+
+	private:
+
+		static VKRenderGraph* sRenderGraph;
+		Shared<VKDevice> mDevice;
+		VkExtent2D mExtent = {};
+		std::string mOutput = {};
+		bool mDirty = true;
+
+		std::vector<Pass> mPasses = {};
+		std::unordered_map<std::string, Resource> mResources = {};
+
+		std::vector<Compiled> mCompiled = {};
+		std::vector<VKAllocation> mSlots = {};
+		std::vector<VkCommandBuffer> mCommandBuffers = {};
+		Stats mStats = {};
+	};
+}
@@ -0,0 +1,232 @@
+#include "epch.h"
+#include "VKRenderQueue.h"
+
+namespace Cosmos
+{
+	VKRenderQueue* VKRenderQueue::sRenderQueue = nullptr;
+
+	VKRenderQueue::VKRenderQueue()
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Render Queue");
+		sRenderQueue = this;
+	}
+
+	VKRenderQueue::~VKRenderQueue()
+	{
+		if (sRenderQueue == this)
+			sRenderQueue = nullptr;
+	}
+
+	uint64_t VKRenderQueue::MakeKey(Pass pass, VkPipeline pipeline, uint32_t material, float depth)
+	{
+		// pipelines are numbered in the order they're first seen this frame, only grouping them matters
+		auto it = mPipelineIds.find(pipeline);
+
+		if (it == mPipelineIds.end())
+			it = mPipelineIds.emplace(pipeline, (uint32_t)mPipelineIds.size()).first;
+
+		// a positive float's bits sort the same way as its value
+		uint32_t depthBits = 0;
+		depth = std::max(depth, 0.0f);
+		memcpy(&depthBits, &depth, sizeof(uint32_t));
+
+		// pass (4 bits), pipeline (12 bits), material (16 bits), depth (32 bits)
+		return ((uint64_t)(pass & 0xF) << 60) | ((uint64_t)(std::min(it->second, 0xFFFu)) << 48) | ((uint64_t)(material & 0xFFFF) << 32) | (uint64_t)depthBits;
+	}
+
+	uint32_t VKRenderQueue::PushConstant(VkShaderStageFlags stages, const void* data, uint32_t size)
+	{
+		PushRange range = {};
+		range.stages = stages;
+		range.offset = (uint32_t)mPushData.size();
+		range.size = size;
+
+		mPushData.insert(mPushData.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+		mPushRanges.push_back(range);
+
+		return (uint32_t)mPushRanges.size() - 1;
+	}
+
+	void VKRenderQueue::Submit(const Packet& packet)
+	{
+		Entry entry = {};
+		entry.key = packet.key;
+		entry.packet = (uint32_t)mPackets.size();
+
+		mPackets.push_back(packet);
+		mEntries.push_back(entry);
+	}
+
+	void VKRenderQueue::Record(VkCommandBuffer commandBuffer)
+	{
+		PROFILER_FUNCTION();
+
+		Sort();
+
+		// the state the command buffer is left with by the previous packet
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		std::array<VkDescriptorSet, 2> sets = {};
+		std::array<uint32_t, 2> dynamicOffsets = {};
+		uint32_t pushConstant = UINT32_MAX;
+		VkBuffer instanceBuffer = VK_NULL_HANDLE;
+		VkDeviceSize instanceOffset = 0;
+
+		for (const Entry& entry : mEntries)
+		{
+			const Packet& packet = mPackets[entry.packet];
+
+			if (packet.pipeline != pipeline)
+			{
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline);
+				pipeline = packet.pipeline;
+				mStats.pipelineBinds++;
+			}
+
+			else
+			{
+				mStats.skipped++;
+			}
+
+			// sets and push constants recorded with another layout may be disturbed by this one
+			if (packet.layout != layout)
+			{
+				layout = packet.layout;
+				sets = {};
+				pushConstant = UINT32_MAX;
+			}
+
+			for (uint32_t i = 0; i < (uint32_t)sets.size(); i++)
+			{
+				if (packet.sets[i] == VK_NULL_HANDLE)
+					continue;
+
+				uint32_t offsetCount = i == 0 ? packet.dynamicOffsetCount : 0;
+				bool offsetsChanged = offsetCount > 0 && memcmp(packet.dynamicOffsets.data(), dynamicOffsets.data(), offsetCount * sizeof(uint32_t)) != 0;
+
+				if (packet.sets[i] == sets[i] && !offsetsChanged)
+				{
+					mStats.skipped++;
+					continue;
+				}
+
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, i, 1, &packet.sets[i], offsetCount, packet.dynamicOffsets.data());
+				sets[i] = packet.sets[i];
+				mStats.descriptorBinds++;
+
+				if (i == 0)
+					dynamicOffsets = packet.dynamicOffsets;
+			}
+
+			if (packet.pushConstant != UINT32_MAX)
+			{
+				const PushRange& range = mPushRanges[packet.pushConstant];
+				bool same = pushConstant == packet.pushConstant;
+
+				// different packets often push the same material
+				if (!same && pushConstant != UINT32_MAX)
+				{
+					const PushRange& previous = mPushRanges[pushConstant];
+					same = previous.stages == range.stages && previous.size == range.size && memcmp(&mPushData[previous.offset], &mPushData[range.offset], range.size) == 0;
+				}
+
+				if (same)
+				{
+					mStats.skipped++;
+				}
+
+				else
+				{
+					vkCmdPushConstants(commandBuffer, layout, range.stages, 0, range.size, &mPushData[range.offset]);
+					mStats.pushConstants++;
+				}
+
+				pushConstant = packet.pushConstant;
+			}
+
+			if (packet.instanceBuffer != VK_NULL_HANDLE)
+			{
+				if (packet.instanceBuffer == instanceBuffer && packet.instanceOffset == instanceOffset)
+				{
+					mStats.skipped++;
+				}
+
+				else
+				{
+					vkCmdBindVertexBuffers(commandBuffer, 1, 1, &packet.instanceBuffer, &packet.instanceOffset);
+					instanceBuffer = packet.instanceBuffer;
+					instanceOffset = packet.instanceOffset;
+					mStats.vertexBufferBinds++;
+				}
+			}
+
+			if (packet.indirectBuffer != VK_NULL_HANDLE)
+			{
+				vkCmdDrawIndexedIndirect(commandBuffer, packet.indirectBuffer, packet.indirectOffset, 1, sizeof(VkDrawIndexedIndirectCommand));
+			}
+
+			else if (packet.indexCount > 0)
+			{
+				vkCmdDrawIndexed(commandBuffer, packet.indexCount, packet.instanceCount, packet.firstIndex, (int32_t)packet.firstVertex, 0);
+			}
+
+			else
+			{
+				vkCmdDraw(commandBuffer, packet.vertexCount, packet.instanceCount, packet.firstVertex, 0);
+			}
+
+			mStats.packets++;
+		}
+
+		mPackets.clear();
+		mEntries.clear();
+		mPushRanges.clear();
+		mPushData.clear();
+		mPipelineIds.clear();
+	}
+
+	void VKRenderQueue::Sort()
+	{
+		if (mEntries.size() < 2)
+			return;
+
+		// every byte's histogram is counted in a single read of the keys
+		std::array<std::array<uint32_t, 256>, 8> counts = {};
+
+		for (const Entry& entry : mEntries)
+		{
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				counts[i][(entry.key >> (i * 8)) & 0xFF]++;
+			}
+		}
+
+		mScratch.resize(mEntries.size());
+
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			std::array<uint32_t, 256>& count = counts[i];
+			uint32_t shift = i * 8;
+
+			// every key has the same byte, the pass wouldn't move anything
+			if (count[(mEntries[0].key >> shift) & 0xFF] == (uint32_t)mEntries.size())
+				continue;
+
+			uint32_t sum = 0;
+
+			for (uint32_t& bucket : count)
+			{
+				uint32_t size = bucket;
+				bucket = sum;
+				sum += size;
+			}
+
+			for (const Entry& entry : mEntries)
+			{
+				mScratch[count[(entry.key >> shift) & 0xFF]++] = entry;
+			}
+
+			mEntries.swap(mScratch);
+		}
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace Cosmos
+{
+	// the draws of a pass are submitted as packets carrying every state they need, ordered by a 64-bit key and only then recorded
+	// the key sorts by pass, pipeline, material and depth, so that the recorder finds consecutive packets sharing their state and
+	// skips the pipeline, descriptor set, vertex buffer and push constant binds the previous packet already made
+	class VKRenderQueue
+	{
+	public:
+
+		enum Pass : uint32_t
+		{
+			Opaque = 0,
+			Sky = 1
+		};
+
+		struct Packet
+		{
+			uint64_t key = 0;
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			VkPipelineLayout layout = VK_NULL_HANDLE;
+			std::array<VkDescriptorSet, 2> sets = {};			// sets 0 and 1, null ones are left as they are
+			std::array<uint32_t, 2> dynamicOffsets = {};		// offsets of set 0's dynamic buffers, in binding order
+			uint32_t dynamicOffsetCount = 0;
+			uint32_t pushConstant = UINT32_MAX;					// the push constant recorded before the draw, UINT32_MAX for none
+			VkBuffer instanceBuffer = VK_NULL_HANDLE;			// vertex binding 1, null for pipelines without instances
+			VkDeviceSize instanceOffset = 0;
+			VkBuffer indirectBuffer = VK_NULL_HANDLE;			// an indexed indirect draw when set, the direct draw parameters are ignored
+			VkDeviceSize indirectOffset = 0;
+			uint32_t indexCount = 0;							// 0 draws the vertices without indices
+			uint32_t vertexCount = 0;
+			uint32_t instanceCount = 1;
+			uint32_t firstIndex = 0;
+			uint32_t firstVertex = 0;
+		};
+
+		struct Stats
+		{
+			uint32_t packets = 0;				// draws recorded
+			uint32_t pipelineBinds = 0;			// pipelines bound
+			uint32_t descriptorBinds = 0;		// descriptor sets bound
+			uint32_t vertexBufferBinds = 0;		// instance buffers bound
+			uint32_t pushConstants = 0;			// push constants recorded
+			uint32_t skipped = 0;				// binds and pushes a previous packet already made
+		};
+
+	public:
+
+		// constructor
+		VKRenderQueue();
+
+		// destructor
+		~VKRenderQueue();
+
+		// returns the render queue singleton
+		inline static VKRenderQueue* GetInstance() { return sRenderQueue; }
+
+		// returns the statistics of the recordings since they were last reset
+		inline const Stats& GetStats() const { return mStats; }
+
+		// clears the statistics, once per frame as a frame may record the queue more than once
+		inline void ResetStats() { mStats = {}; }
+
+	public:
+
+		// returns a sort key, depth must not be negative and is sorted front to back
+		uint64_t MakeKey(Pass pass, VkPipeline pipeline, uint32_t material, float depth);
+
+		// stores push constant data the packets may reference, returns its index
+		uint32_t PushConstant(VkShaderStageFlags stages, const void* data, uint32_t size);
+
+		// adds a packet to the queue
+		void Submit(const Packet& packet);
+
+		// sorts the packets and records them, the vertex binding 0 and the index buffer must already be bound
+		// the queue is emptied afterwards (main thread only)
+		void Record(VkCommandBuffer commandBuffer);
+
+	private:
+
+		// orders the entries by key with an lsd radix sort, a byte every key shares skips its pass
+		void Sort();
+
+	private:
+
+		struct Entry
+		{
+			uint64_t key = 0;
+			uint32_t packet = 0;
+		};
+
+		struct PushRange
+		{
+			VkShaderStageFlags stages = 0;
+			uint32_t offset = 0;
+			uint32_t size = 0;
+		};
+
+		static VKRenderQueue* sRenderQueue;
+		std::vector<Packet> mPackets = {};
+		std::vector<Entry> mEntries = {};
+		std::vector<Entry> mScratch = {};
+		std::vector<PushRange> mPushRanges = {};
+		std::vector<uint8_t> mPushData = {};
+		std::unordered_map<VkPipeline, uint32_t> mPipelineIds = {};
+		Stats mStats = {};
+	};
+}
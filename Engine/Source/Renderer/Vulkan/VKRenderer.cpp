@@ -12,15 +12,28 @@
 #include "UI/GUI.h"
 #include "Util/FileSystem.h"
 
+#include <chrono>
+
 namespace Cosmos
 {
 	VKRenderer::VKRenderer()
 	{
 		mInstance = VKInstance::Create("Cosmos Application", "Cosmos", true);
 		mDevice = VKDevice::Create(mInstance);
+		mAllocator = CreateShared<VKAllocator>(mDevice);
+		mDeletionQueue = CreateShared<VKDeletionQueue>(mDevice);
+		mUploader = CreateShared<VKUploader>(mDevice);
+		mGeometryPool = CreateShared<VKGeometryPool>(mDevice, RENDERER_GEOMETRY_POOL_VERTICES, RENDERER_GEOMETRY_POOL_INDICES);
+		mGpuProfiler = CreateShared<VKGpuProfiler>(mDevice);
+		mFramePacer = CreateShared<VKFramePacer>(mDevice);
 		mCommander = CreateShared<VKCommander>();
+		mRenderGraph = CreateShared<VKRenderGraph>(mDevice);
+		mResidency = CreateShared<VKResidency>(mInstance, mDevice);
+		mTextureStreamer = CreateShared<VKTextureStreamer>(mDevice);
 		mSwapchain = VKSwapchain::Create(mInstance, mDevice);
+		mFrameAllocator = CreateShared<VKLinearAllocator>(mDevice, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, (VkDeviceSize)RENDERER_FRAME_ALLOCATOR_SIZE_KB * 1024);
 
+		CreateRenderGraph();
 		CreateResources();
 		CreateGlobalStates();
 	}
@@ -29,7 +42,7 @@ namespace Cosmos
 	{
 		vkDeviceWaitIdle(mDevice->GetDevice());
 
-		vkDestroyPipelineCache(mDevice->GetDevice(), mPipelineCache, nullptr);
+		RecordVariants();
 
 		for (size_t i = 0; i < RENDERER_MAX_FRAMES_IN_FLIGHT; i++)
 		{
@@ -39,6 +52,23 @@ namespace Cosmos
 		}
 	}
 
+	void VKRenderer::WaitFrame()
+	{
+		PROFILER_FUNCTION();
+
+		// the frames in flight change between frames, once none is left on the gpu
+		if (mRequestedFramesInFlight != mFramesInFlight)
+		{
+			vkDeviceWaitIdle(mDevice->GetDevice());
+
+			mFramesInFlight = mRequestedFramesInFlight;
+			mCurrentFrame = 0;
+			mFramePacer->Reset();
+		}
+
+		mFramePacer->Wait(mCurrentFrame, mFramesInFlight, mInFlightFences);
+	}
+
 	void VKRenderer::OnUpdate()
 	{
 		PROFILER_FUNCTION();
@@ -50,7 +80,9 @@ namespace Cosmos
 			PROFILER_SCOPE("Swapchain Next Image");
 			vkWaitForFences(mDevice->GetDevice(), 1, &mInFlightFences[mCurrentFrame], VK_TRUE, UINT64_MAX);
 
+			std::chrono::steady_clock::time_point acquireStart = std::chrono::steady_clock::now();
 			res = vkAcquireNextImageKHR(mDevice->GetDevice(), mSwapchain->GetSwapchain(), UINT64_MAX, mImageAvailableSemaphores[mCurrentFrame], VK_NULL_HANDLE, &mImageIndex);
+			mFramePacer->AddTime(VKFramePacer::Phase::Acquire, acquireStart);
 
 			if (res == VK_ERROR_OUT_OF_DATE_KHR)
 			{
@@ -66,32 +98,62 @@ namespace Cosmos
 			vkResetFences(mDevice->GetDevice(), 1, &mInFlightFences[mCurrentFrame]);
 		}
 
-		ManageRenderPasses(mImageIndex);
+		// the gpu is done with this frame's transient data, and with objects retired frames in flight ago
+		mFrameAllocator->Reset(mCurrentFrame);
+		mDeletionQueue->OnUpdate();
+		bool timed = mGpuProfiler->OnUpdate(mCurrentFrame);
+		mFramePacer->OnGpuFrame(timed);
+		mCuller->OnUpdate(mCurrentFrame);
+		mRenderQueue->ResetStats();
+
+		// streamed textures may swap their views now, before any command buffer of this frame is recorded
+		mResidency->OnUpdate();
+		mTextureStreamer->OnUpdate();
+		mBindless->OnUpdate(mCurrentFrame);
+
+		// uploads requested so far are submitted ahead of this frame's command buffers
+		mUploader->Flush();
+
+		// edited shaders swap their pipelines before this frame binds them
+		if (mShaderReloader)
+		{
+			mShaderReloader->OnUpdate();
+		}
+
+		// the passes are recorded in the order their reads and writes require
+		mRenderGraph->Execute(mCurrentFrame, mImageIndex);
+
+		// uploads made on the transfer queue are handed to the graphics queue ahead of the frame's command buffers
+		uint64_t uploadWaitValue = 0;
+		VkCommandBuffer acquireCommandBuffer = mUploader->RecordAcquires(mCurrentFrame, uploadWaitValue);
 
 		VkSwapchainKHR swapChains[] = { mSwapchain->GetSwapchain() };
-		VkSemaphore waitSemaphores[] = { mImageAvailableSemaphores[mCurrentFrame] };
+		VkSemaphore waitSemaphores[] = { mImageAvailableSemaphores[mCurrentFrame], mUploader->GetTimeline() };
 		VkSemaphore signalSemaphores[] = { mRenderFinishedSemaphores[mCurrentFrame] };
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT };
+		uint64_t waitValues[] = { 0, uploadWaitValue };
 
 		// submits to graphics queue
 		{
-			// 
-			std::vector<VkCommandBuffer> submitCommandBuffers = { mCommander->GetEntriesRef()["Swapchain"]->commandBuffers[mCurrentFrame] };
+			std::vector<VkCommandBuffer> submitCommandBuffers = {};
 
-			if (mCommander->Exists("Viewport"))
+			if (acquireCommandBuffer != VK_NULL_HANDLE)
 			{
-				submitCommandBuffers.push_back(mCommander->GetEntriesRef()["Viewport"]->commandBuffers[mCurrentFrame]);
+				submitCommandBuffers.push_back(acquireCommandBuffer);
 			}
 
-			if (mCommander->Exists("ImGui"))
-			{
-				submitCommandBuffers.push_back(mCommander->GetEntriesRef()["ImGui"]->commandBuffers[mCurrentFrame]);
-			}
+			submitCommandBuffers.insert(submitCommandBuffers.end(), mRenderGraph->GetCommandBuffers().begin(), mRenderGraph->GetCommandBuffers().end());
+
+			// the binary semaphore's value is ignored
+			VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+			timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+			timelineInfo.waitSemaphoreValueCount = 2;
+			timelineInfo.pWaitSemaphoreValues = waitValues;
 
 			VkSubmitInfo submitInfo = {};
 			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-			submitInfo.pNext = nullptr;
-			submitInfo.waitSemaphoreCount = 1;
+			submitInfo.pNext = uploadWaitValue > 0 ? &timelineInfo : nullptr;
+			submitInfo.waitSemaphoreCount = uploadWaitValue > 0 ? 2 : 1;
 			submitInfo.pWaitSemaphores = waitSemaphores;
 			submitInfo.pWaitDstStageMask = waitStages;
 			submitInfo.commandBufferCount = (uint32_t)submitCommandBuffers.size();
@@ -99,6 +161,7 @@ namespace Cosmos
 			submitInfo.signalSemaphoreCount = 1;
 			submitInfo.pSignalSemaphores = signalSemaphores;
 			VK_ASSERT(vkQueueSubmit(mDevice->GetGraphicsQueue(), 1, &submitInfo, mInFlightFences[mCurrentFrame]), "Failed to submit draw command");
+			mFramePacer->OnSubmit(mCurrentFrame);
 		}
 
 		// presents the image
@@ -111,11 +174,15 @@ namespace Cosmos
 			presentInfo.pSwapchains = swapChains;
 			presentInfo.pImageIndices = &mImageIndex;
 
+			std::chrono::steady_clock::time_point presentStart = std::chrono::steady_clock::now();
 			res = vkQueuePresentKHR(mDevice->GetPresentQueue(), &presentInfo);
+			mFramePacer->AddTime(VKFramePacer::Phase::Present, presentStart);
 
-			if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR || Application::GetInstance()->GetWindow()->ShouldResizeWindow())
+			// a new present mode also needs a new swapchain
+			if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR || Application::GetInstance()->GetWindow()->ShouldResizeWindow() || mRecreateSwapchain)
 			{
 				Application::GetInstance()->GetWindow()->HintResizeWindow(false);
+				mRecreateSwapchain = false;
 				mSwapchain->Recreate();
 
 				Application::GetInstance()->GetCamera()->SetAspectRatio(Application::GetInstance()->GetWindow()->GetAspectRatio());
@@ -134,153 +201,101 @@ namespace Cosmos
 			}
 		}
 
-		mCurrentFrame = (mCurrentFrame + 1) % RENDERER_MAX_FRAMES_IN_FLIGHT;
+		mPipelineCache->OnUpdate();
+
+		mCurrentFrame = (mCurrentFrame + 1) % mFramesInFlight;
 	}
 
-	void VKRenderer::ManageRenderPasses(uint32_t& imageIndex)
+	void VKRenderer::CreateRenderGraph()
 	{
-		PROFILER_FUNCTION();
-
-		std::array<VkClearValue, 2> clearValues = {};
-		clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-		clearValues[1].depthStencil = { 1.0f, 0 };
-
-		// color and depth render pass
-		if (mCommander->Exists("Swapchain"))
+		// multisampled color and depth, resolved into the backbuffer
+		VKRenderGraph::Transient color = {};
+		color.format = mSwapchain->GetSurfaceFormat().format;
+		color.samples = mDevice->GetMSAA();
+		color.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		color.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		mRenderGraph->CreateTransient("SwapchainColor", color);
+
+		// the depth pyramid is reduced from it when the device can sample it
+		VKRenderGraph::Transient depth = {};
+		depth.format = FindDepthFormat(mDevice);
+		depth.samples = mDevice->GetMSAA();
+		depth.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		depth.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+		if (VKDepthPyramid::CanSample(mDevice, depth.format, depth.samples))
+			depth.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+
+		mRenderGraph->CreateTransient("SwapchainDepth", depth);
+
+		// the early pass draws the objects visible last frame
+		VKRenderGraph::Pass pass = {};
+		pass.name = "Swapchain";
+		pass.writes =
 		{
-			VkCommandBuffer& cmdBuffer = mCommander->GetEntriesRef()["Swapchain"]->commandBuffers[mCurrentFrame];
-			VkFramebuffer& frameBuffer = mCommander->GetEntriesRef()["Swapchain"]->frameBuffers[imageIndex];
-			VkRenderPass& renderPass = mCommander->GetEntriesRef()["Swapchain"]->renderPass;
-
-			vkResetCommandBuffer(cmdBuffer, /*VkCommandBufferResetFlagBits*/ 0);
-
-			VkCommandBufferBeginInfo cmdBeginInfo = {};
-			cmdBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			cmdBeginInfo.pNext = nullptr;
-			cmdBeginInfo.flags = 0;
-			VK_ASSERT(vkBeginCommandBuffer(cmdBuffer, &cmdBeginInfo), "Failed to begin command buffer recording");
-
-			VkRenderPassBeginInfo renderPassBeginInfo = {};
-			renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassBeginInfo.renderPass = renderPass;
-			renderPassBeginInfo.framebuffer = frameBuffer;
-			renderPassBeginInfo.renderArea.offset = { 0, 0 };
-			renderPassBeginInfo.renderArea.extent = mSwapchain->GetExtent();
-			renderPassBeginInfo.clearValueCount = (uint32_t)clearValues.size();
-			renderPassBeginInfo.pClearValues = clearValues.data();
-			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			// set frame commandbuffer viewport
-			VkViewport viewport = {};
-			viewport.x = 0.0f;
-			viewport.y = 0.0f;
-			viewport.width = (float)mSwapchain->GetExtent().width;
-			viewport.height = (float)mSwapchain->GetExtent().height;
-			viewport.minDepth = 0.0f;
-			viewport.maxDepth = 1.0f;
-			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-
-			// set frame commandbuffer scissor
-			VkRect2D scissor = {};
-			scissor.offset = { 0, 0 };
-			scissor.extent = mSwapchain->GetExtent();
-			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
-
-			// render scene, only if not on viewport
-			if (!mCommander->Exists("Viewport"))
+			{ "SwapchainColor", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+			{ "SwapchainDepth", VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL }
+		};
+		pass.attachments = { "SwapchainColor", "SwapchainDepth" };
+		pass.clearValues.resize(2);
+		pass.clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+		pass.clearValues[1].depthStencil = { 1.0f, 0 };
+
+		// the scene is drawn here only when no other pass draws it
+		pass.prepare = [this](VkCommandBuffer cmdBuffer)
 			{
-				Application::GetInstance()->GetActiveScene()->OnRender();
-			}
+				if (!mCommander->Exists("Viewport"))
+				{
+					Application::GetInstance()->GetActiveScene()->OnPrepareRender();
+				}
+			};
 
-			vkCmdEndRenderPass(cmdBuffer);
+		pass.record = [this](VkCommandBuffer cmdBuffer)
+			{
+				if (!mCommander->Exists("Viewport"))
+				{
+					Application::GetInstance()->GetActiveScene()->OnRender();
+				}
+			};
 
-			// end command buffer
-			VK_ASSERT(vkEndCommandBuffer(cmdBuffer), "Failed to end command buffer recording");
-		}
+		mRenderGraph->AddPass(pass);
 
-		// viewport
-		if (mCommander->Exists("Viewport"))
+		// the late pass draws the objects the depth pyramid of the early one finds disoccluded, then resolves into the backbuffer
+		VKRenderGraph::Pass latePass = {};
+		latePass.name = "SwapchainLate";
+		latePass.reads =
 		{
-			VkCommandBuffer& cmdBuffer = mCommander->GetEntriesRef()["Viewport"]->commandBuffers[mCurrentFrame];
-			VkFramebuffer& frameBuffer = mCommander->GetEntriesRef()["Viewport"]->frameBuffers[imageIndex];
-			VkRenderPass& renderPass = mCommander->GetEntriesRef()["Viewport"]->renderPass;
-
-			vkResetCommandBuffer(cmdBuffer, /*VkCommandBufferResetFlagBits*/ 0);
-
-			VkCommandBufferBeginInfo cmdBeginInfo = {};
-			cmdBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			cmdBeginInfo.pNext = nullptr;
-			cmdBeginInfo.flags = 0;
-			VK_ASSERT(vkBeginCommandBuffer(cmdBuffer, &cmdBeginInfo), "Failed to begin command buffer recording");
-
-			VkRenderPassBeginInfo renderPassBeginInfo = {};
-			renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassBeginInfo.renderPass = renderPass;
-			renderPassBeginInfo.framebuffer = frameBuffer;
-			renderPassBeginInfo.renderArea.offset = { 0, 0 };
-			renderPassBeginInfo.renderArea.extent = mSwapchain->GetExtent();
-			renderPassBeginInfo.clearValueCount = (uint32_t)clearValues.size();
-			renderPassBeginInfo.pClearValues = clearValues.data();
-			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			// set frame commandbuffer viewport
-			VkViewport viewport = {};
-			viewport.x = 0.0f;
-			viewport.y = 0.0f;
-			viewport.width = (float)mSwapchain->GetExtent().width;
-			viewport.height = (float)mSwapchain->GetExtent().height;
-			viewport.minDepth = 0.0f;
-			viewport.maxDepth = 1.0f;
-			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-
-			// set frame commandbuffer scissor
-			VkRect2D scissor = {};
-			scissor.offset = { 0, 0 };
-			scissor.extent = mSwapchain->GetExtent();
-			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
-
-			// render scene and special widgets
-			Application::GetInstance()->GetActiveScene()->OnRender();
-
-			vkCmdEndRenderPass(cmdBuffer);
-
-			// end command buffer
-			VK_ASSERT(vkEndCommandBuffer(cmdBuffer), "Failed to end command buffer recording");
-		}
-
-		// user interface
-		if (mCommander->Exists("ImGui"))
+			{ "SwapchainColor", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+			{ "SwapchainDepth", VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL }
+		};
+		latePass.writes =
 		{
-			VkCommandBuffer& cmdBuffer = mCommander->GetEntriesRef()["ImGui"]->commandBuffers[mCurrentFrame];
-			VkFramebuffer& frameBuffer = mCommander->GetEntriesRef()["ImGui"]->frameBuffers[imageIndex];
-			VkRenderPass& renderPass = mCommander->GetEntriesRef()["ImGui"]->renderPass;
-
-			vkResetCommandBuffer(cmdBuffer, /*VkCommandBufferResetFlagBits*/ 0);
-
-			VkCommandBufferBeginInfo cmdBeginInfo = {};
-			cmdBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			cmdBeginInfo.pNext = nullptr;
-			cmdBeginInfo.flags = 0;
-			VK_ASSERT(vkBeginCommandBuffer(cmdBuffer, &cmdBeginInfo), "Failed to begin command buffer recording");
-
-			VkClearValue clearValue = { 0.0f, 0.0f, 0.0f, 1.0f };
-
-			VkRenderPassBeginInfo renderPassBeginInfo = {};
-			renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassBeginInfo.renderPass = renderPass;
-			renderPassBeginInfo.framebuffer = frameBuffer;
-			renderPassBeginInfo.renderArea.offset = { 0, 0 };
-			renderPassBeginInfo.renderArea.extent = mSwapchain->GetExtent();
-			renderPassBeginInfo.clearValueCount = 1;
-			renderPassBeginInfo.pClearValues = &clearValue;
-			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			Application::GetInstance()->GetGUI()->Draw(cmdBuffer);
+			{ "SwapchainColor", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+			{ "SwapchainDepth", VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL },
+			{ "Backbuffer", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL }
+		};
+		latePass.attachments = { "SwapchainColor", "SwapchainDepth", "Backbuffer" };
+		latePass.clearValues.resize(3);
+
+		latePass.prepare = [this](VkCommandBuffer cmdBuffer)
+			{
+				if (!mCommander->Exists("Viewport"))
+				{
+					mDepthPyramid->Build(cmdBuffer, mCurrentFrame, "SwapchainDepth");
+					Application::GetInstance()->GetActiveScene()->OnPrepareLateRender(cmdBuffer);
+				}
+			};
 
-			vkCmdEndRenderPass(cmdBuffer);
+		latePass.record = [this](VkCommandBuffer cmdBuffer)
+			{
+				if (!mCommander->Exists("Viewport"))
+				{
+					Application::GetInstance()->GetActiveScene()->OnLateRender(cmdBuffer);
+				}
+			};
 
-			VK_ASSERT(vkEndCommandBuffer(cmdBuffer), "Failed to end command buffer recording");
-		}
+		mRenderGraph->AddPass(latePass);
+		mRenderGraph->SetOutput("Backbuffer");
 	}
 
 	void VKRenderer::CreateResources()
@@ -309,67 +324,129 @@ namespace Cosmos
 			}
 		}
 
-		// pipeline cache
+		// pipeline cache, persisted between runs
+		mPipelineCache = CreateShared<VKPipelineCache>(mDevice, GetBinDir() + "/" + RENDERER_PIPELINE_CACHE_PATH);
+	}
+
+	void VKRenderer::CreateGlobalStates()
+	{
+		PROFILER_FUNCTION();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		// called again when the main render pass changes, each singleton below is replaced before the previous one is destroyed
+
+		// the texture array's size depends on the device, shaders sampling it are compiled with it
+		mBindless = CreateShared<VKBindless>(mDevice, RENDERER_BINDLESS_TEXTURES);
+		std::string bindlessDefine = "BINDLESS_TEXTURES=" + std::to_string(mBindless->GetCapacity());
+
+		// the scene keeps the pipelines it resolved, so once created they're rebuilt in place for the new main render pass
+		if (mPipelines.empty())
+		{
+			CreatePipelines(bindlessDefine);
+		}
+
+		else
+		{
+			RebuildPipelines();
+		}
+
+		// the models' set 0, shared by all of them
+		mFrameUniforms = CreateShared<VKFrameUniforms>(mDevice, mFrameAllocator, mPipelines["Model"]->GetDescriptorSetLayout());
+
+		// compute pipelines culling the models, their instances are written to the frame allocator and the occluded ones are
+		// found with the depth pyramid built between both culling phases
+		mDepthPyramid = CreateShared<VKDepthPyramid>(mDevice, mPipelineCache->GetCache());
+		mCuller = CreateShared<VKCuller>(mDevice, mFrameAllocator, mPipelineCache->GetCache());
+		mRenderQueue = CreateShared<VKRenderQueue>();
+
+		LOG_TO_TERMINAL(Logger::Severity::Info, "Renderer global states created in %.2fms", (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0);
+		VKShader::LogStats();
+		mPipelineCache->LogStats();
+
+		// packed shaders can't be edited
+		if (RENDERER_SHADER_HOT_RELOAD && !IsArchiveMounted())
 		{
-			VkPipelineCacheCreateInfo pipelineCacheCI = {};
-			pipelineCacheCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-			pipelineCacheCI.pNext = nullptr;
-			pipelineCacheCI.flags = 0;
-			VK_ASSERT(vkCreatePipelineCache(mDevice->GetDevice(), &pipelineCacheCI, nullptr, &mPipelineCache), "Failed to create pipeline cache");
+			mShaderReloader = CreateShared<VKShaderReloader>(mDevice, mPipelines, GetAssetSubDir("Shaders"));
 		}
 	}
 
-	void VKRenderer::CreateGlobalStates()
+	void VKRenderer::CreatePipelines(const std::string& bindlessDefine)
 	{
+		PROFILER_FUNCTION();
+
+		// every shader compiles at once on the resources pool, each pipeline only waits for its own
+		std::future<Shared<VKShader>> modelVert = VKShader::CreateAsync(mDevice, VKShader::Type::Vertex, "Model.vert", GetAssetSubDir("Shaders/model.vert"));
+		std::future<Shared<VKShader>> modelFrag = VKShader::CreateAsync(mDevice, VKShader::Type::Fragment, "Model.frag", GetAssetSubDir("Shaders/model.frag"), { bindlessDefine });
+		std::future<Shared<VKShader>> skyboxVert = VKShader::CreateAsync(mDevice, VKShader::Type::Vertex, "Skybox.vert", GetAssetSubDir("Shaders/skybox.vert"));
+		std::future<Shared<VKShader>> skyboxFrag = VKShader::CreateAsync(mDevice, VKShader::Type::Fragment, "Skybox.frag", GetAssetSubDir("Shaders/skybox.frag"));
+		std::future<Shared<VKShader>> primitiveVert = VKShader::CreateAsync(mDevice, VKShader::Type::Vertex, "Primitive.vert", GetAssetSubDir("Shaders/primitive.vert"));
+		std::future<Shared<VKShader>> primitiveFrag = VKShader::CreateAsync(mDevice, VKShader::Type::Fragment, "Primitive.frag", GetAssetSubDir("Shaders/primitive.frag"));
+
 		// model pipeline
 		{
 			VKPipelineSpecification modelSpecification = {};
-			modelSpecification.cache = mPipelineCache;
-			modelSpecification.vertexShader = CreateShared<VKShader>(mDevice, VKShader::Type::Vertex, "Model.vert", GetAssetSubDir("Shaders/model.vert"));
-			modelSpecification.fragmentShader = CreateShared<VKShader>(mDevice, VKShader::Type::Fragment, "Model.frag", GetAssetSubDir("Shaders/model.frag"));
+			modelSpecification.cache = mPipelineCache->GetCache();
+			modelSpecification.vertexShader = modelVert.get();
+			modelSpecification.fragmentShader = modelFrag.get();
 			modelSpecification.vertexComponents =
 			{
 				VKVertex::Component::POSITION, VKVertex::Component::COLOR, VKVertex::Component::NORMAL, VKVertex::Component::UV0
 			};
+			modelSpecification.instanced = true;
 
-			modelSpecification.bindings.resize(3);
-			// global ubo
+			// camera and lighting are frame-global, each frame binds them at its own offsets
+			modelSpecification.bindings.resize(5);
+			// camera ubo
 			modelSpecification.bindings[0].binding = 0;
-			modelSpecification.bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			modelSpecification.bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 			modelSpecification.bindings[0].descriptorCount = 1;
 			modelSpecification.bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 			modelSpecification.bindings[0].pImmutableSamplers = nullptr;
 
 			// light ubo
 			modelSpecification.bindings[1].binding = 1;
-			modelSpecification.bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			modelSpecification.bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 			modelSpecification.bindings[1].descriptorCount = 1;
 			modelSpecification.bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 			modelSpecification.bindings[1].pImmutableSamplers = nullptr;
 
-			// albedo
-			modelSpecification.bindings[2].binding = 2;
-			modelSpecification.bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			modelSpecification.bindings[2].descriptorCount = 1;
-			modelSpecification.bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-			modelSpecification.bindings[2].pImmutableSamplers = nullptr;
+			// lights, clusters and light indices, every one of them views the whole frame allocator
+			for (uint32_t i = 2; i < 5; i++)
+			{
+				modelSpecification.bindings[i].binding = i;
+				modelSpecification.bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				modelSpecification.bindings[i].descriptorCount = 1;
+				modelSpecification.bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+				modelSpecification.bindings[i].pImmutableSamplers = nullptr;
+			}
+
+			// textures are sampled from the bindless array (set 1)
+			modelSpecification.sharedSetLayouts = { mBindless->GetDescriptorSetLayout() };
+
+			// material parameters
+			VkPushConstantRange materialRange = {};
+			materialRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+			materialRange.offset = 0;
+			materialRange.size = sizeof(Material_PushConstant);
+			modelSpecification.pushConstants.push_back(materialRange);
+
+			// in the same order as Material::Feature
+			modelSpecification.keywords = { "NORMAL_MAP", "EMISSIVE", "ALPHA_MASK", "UNLIT" };
 
 			// create
 			mPipelines["Model"] = CreateShared<VKPipeline>(mDevice, modelSpecification);
 
 			// modify parameters after initial creation
 			mPipelines["Model"]->GetSpecificationRef().RSCI.cullMode = VK_CULL_MODE_BACK_BIT;
-
-			// build the pipeline
-			mPipelines["Model"]->Build();
 		}
 
 		// skybox pipeline
 		{
 			VKPipelineSpecification skyboxSpecification = {};
-			skyboxSpecification.cache = mPipelineCache;
-			skyboxSpecification.vertexShader = CreateShared<VKShader>(mDevice, VKShader::Type::Vertex, "Skybox.vert", GetAssetSubDir("Shaders/skybox.vert"));
-			skyboxSpecification.fragmentShader = CreateShared<VKShader>(mDevice, VKShader::Type::Fragment, "Skybox.frag", GetAssetSubDir("Shaders/skybox.frag"));
+			skyboxSpecification.cache = mPipelineCache->GetCache();
+			skyboxSpecification.vertexShader = skyboxVert.get();
+			skyboxSpecification.fragmentShader = skyboxFrag.get();
 			skyboxSpecification.vertexComponents =
 			{
 				VKVertex::Component::POSITION
@@ -395,17 +472,14 @@ namespace Cosmos
 
 			// modify parameters after initial creation
 			mPipelines["Skybox"]->GetSpecificationRef().RSCI.cullMode = VK_CULL_MODE_FRONT_BIT;
-
-			// build the pipeline
-			mPipelines["Skybox"]->Build();
 		}
 
 		// primitive pipeline
 		{
 			VKPipelineSpecification primitiveSpecification = {};
-			primitiveSpecification.cache = mPipelineCache;
-			primitiveSpecification.vertexShader = CreateShared<VKShader>(mDevice, VKShader::Type::Vertex, "Primitive.vert", GetAssetSubDir("Shaders/primitive.vert"));
-			primitiveSpecification.fragmentShader = CreateShared<VKShader>(mDevice, VKShader::Type::Fragment, "Primitive.frag", GetAssetSubDir("Shaders/primitive.frag"));
+			primitiveSpecification.cache = mPipelineCache->GetCache();
+			primitiveSpecification.vertexShader = primitiveVert.get();
+			primitiveSpecification.fragmentShader = primitiveFrag.get();
 			primitiveSpecification.vertexComponents =
 			{
 				VKVertex::Component::POSITION, VKVertex::Component::COLOR, VKVertex::Component::UV0
@@ -431,9 +505,107 @@ namespace Cosmos
 
 			// modify parameters after initial creation
 			mPipelines["Primitive"]->GetSpecificationRef().RSCI.cullMode = VK_CULL_MODE_BACK_BIT;
+		}
+
+		// the pipelines don't depend on each other either
+		VKPipeline::BuildParallel({ mPipelines["Model"], mPipelines["Skybox"], mPipelines["Primitive"] });
+		PrewarmVariants();
+	}
+
+	void VKRenderer::RebuildPipelines()
+	{
+		PROFILER_FUNCTION();
+
+		// their layouts are kept, the texture array replaced meanwhile has an identically defined one so its sets stay compatible
+		VkDevice device = mDevice->GetDevice();
+		std::vector<VkPipeline> previous = {};
+
+		for (auto& [name, pipeline] : mPipelines)
+		{
+			std::vector<VkPipeline> rebuilt = pipeline->Rebuild();
+			previous.insert(previous.end(), rebuilt.begin(), rebuilt.end());
+		}
+
+		// frames in flight may still be drawing with them
+		mDeletionQueue->Push([device, previous]()
+		{
+			for (VkPipeline pipeline : previous)
+				vkDestroyPipeline(device, pipeline, nullptr);
+		});
+	}
+
+	void VKRenderer::PrewarmVariants()
+	{
+		PROFILER_FUNCTION();
+
+		std::string path = GetBinDir() + "/" + RENDERER_PIPELINE_VARIANTS_PATH;
+
+		if (!std::filesystem::exists(path))
+			return;
+
+		// each line is a pipeline name followed by the keywords of one of its variants
+		std::unordered_map<std::string, std::vector<uint32_t>> variants = {};
+		std::ifstream file(path);
+		std::string line;
+
+		while (std::getline(file, line))
+		{
+			std::istringstream stream(line);
+			std::string name;
+			std::string keyword;
+
+			if (!(stream >> name) || mPipelines.find(name) == mPipelines.end())
+				continue;
+
+			uint32_t variant = 0;
+			bool known = true;
 
-			// build the pipeline
-			mPipelines["Primitive"]->Build();
+			while (stream >> keyword)
+			{
+				uint32_t mask = mPipelines[name]->GetKeywordMask(keyword);
+				known &= mask != 0;
+				variant |= mask;
+			}
+
+			// keywords a shader no longer declares make the variant meaningless
+			if (known && variant != 0)
+				variants[name].push_back(variant);
+		}
+
+		for (auto& [name, list] : variants)
+		{
+			mPipelines[name]->BuildVariants(list);
+		}
+	}
+
+	void VKRenderer::RecordVariants()
+	{
+		std::ostringstream stream;
+
+		for (auto& [name, pipeline] : mPipelines)
+		{
+			const std::vector<std::string>& keywords = pipeline->GetSpecificationRef().keywords;
+
+			for (uint32_t variant : pipeline->GetVariants())
+			{
+				stream << name;
+
+				for (size_t i = 0; i < keywords.size(); i++)
+				{
+					if (variant & (1u << i))
+						stream << " " << keywords[i];
+				}
+
+				stream << "\n";
+			}
+		}
+
+		std::string content = stream.str();
+		std::string path = GetBinDir() + "/" + RENDERER_PIPELINE_VARIANTS_PATH;
+
+		if (!WriteToBinaryAtomic(path, content.data(), content.size()))
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Error, "Failed to save pipeline variants %s", path.c_str());
 		}
 	}
 }
\ No newline at end of file
@@ -7,12 +7,28 @@
 
 #include "Entity/Entity.h"
 
+#include "VKAllocator.h"
+#include "VKBindless.h"
 #include "VKBuffer.h"
 #include "VKCommander.h"
+#include "VKCuller.h"
+#include "VKDeletionQueue.h"
+#include "VKDepthPyramid.h"
 #include "VKInstance.h"
 #include "VKDevice.h"
+#include "VKFramePacer.h"
+#include "VKFrameUniforms.h"
+#include "VKGeometryPool.h"
+#include "VKGpuProfiler.h"
 #include "VKPipeline.h"
+#include "VKPipelineCache.h"
+#include "VKRenderGraph.h"
+#include "VKRenderQueue.h"
+#include "VKResidency.h"
+#include "VKShaderReloader.h"
 #include "VKSwapchain.h"
+#include "VKTextureStreamer.h"
+#include "VKUploader.h"
 
 #include "Util/Memory.h"
 
@@ -44,13 +60,64 @@ namespace Cosmos
 		// returns the backend swapchain class object
 		inline Shared<VKSwapchain> GetSwapchain() { return mSwapchain; }
 
+		// returns the device memory allocator
+		inline Shared<VKAllocator> GetAllocator() { return mAllocator; }
+
+		// returns the allocator for transient per-frame data, reset every frame
+		inline Shared<VKLinearAllocator> GetFrameAllocator() { return mFrameAllocator; }
+
+		// returns the pool holding every mesh's vertices and indices
+		inline Shared<VKGeometryPool> GetGeometryPool() { return mGeometryPool; }
+
+		// returns the staging uploader
+		inline Shared<VKUploader> GetUploader() { return mUploader; }
+
+		// returns the memory residency tracker
+		inline Shared<VKResidency> GetResidency() { return mResidency; }
+
+		// returns the queue destroying objects once no frame in flight uses them
+		inline Shared<VKDeletionQueue> GetDeletionQueue() { return mDeletionQueue; }
+
+		// returns the global texture array
+		inline Shared<VKBindless> GetBindless() { return mBindless; }
+
+		// returns the frame-global camera and light
+		inline Shared<VKFrameUniforms> GetFrameUniforms() { return mFrameUniforms; }
+
+		// returns the profiler timing the passes on the gpu
+		inline Shared<VKGpuProfiler> GetGpuProfiler() { return mGpuProfiler; }
+
+		// returns the frame pacer and its timings
+		inline Shared<VKFramePacer> GetFramePacer() { return mFramePacer; }
+
+		// returns how many frames are simultaniously rendered on gpu
+		inline uint32_t GetFramesInFlight() const { return mFramesInFlight; }
+
+		// sets how many frames are simultaniously rendered on gpu, applied before the next frame begins
+		inline void SetFramesInFlight(uint32_t count) { mRequestedFramesInFlight = std::clamp(count, 1u, (uint32_t)RENDERER_MAX_FRAMES_IN_FLIGHT); }
+
+		// sets the present mode the swapchain asks for, it's recreated after the current frame is presented
+		inline void SetPresentMode(VkPresentModeKHR mode) { mSwapchain->SetRequestedPresentMode(mode); mRecreateSwapchain = true; }
+
+		// returns the graph ordering the passes of a frame
+		inline Shared<VKRenderGraph> GetRenderGraph() { return mRenderGraph; }
+
+		// returns the queue the scene's draws are sorted in
+		inline Shared<VKRenderQueue> GetRenderQueue() { return mRenderQueue; }
+
+		// returns the gpu frustum and occlusion culler
+		inline Shared<VKCuller> GetCuller() { return mCuller; }
+
+		// returns the depth pyramid the occlusion culling tests against
+		inline Shared<VKDepthPyramid> GetDepthPyramid() { return mDepthPyramid; }
+
 		// returns a reference to the pipelines
         inline std::unordered_map<std::string, Shared<VKPipeline>>& GetPipelinesRef() { return mPipelines; }
 
 	public:
 
 		// returns the vulkan pipeline cache
-		inline virtual VkPipelineCache GetPipelineCache() override { return mPipelineCache; }
+		inline virtual VkPipelineCache GetPipelineCache() override { return mPipelineCache->GetCache(); }
 
 		// returns the current in-process frame
 		inline virtual uint32_t GetCurrentFrame() override { return mCurrentFrame; }
@@ -60,6 +127,9 @@ namespace Cosmos
 
 	public:
 
+		// waits until the next frame may begin, called before the input it shows is sampled
+		virtual void WaitFrame() override;
+
 		// updates the renderer
 		virtual void OnUpdate() override;
 
@@ -68,26 +138,57 @@ namespace Cosmos
 
 	private:
 
-		// submit all render passes
-		void ManageRenderPasses(uint32_t& imageIndex);
+		// declares the swapchain passes and their transient attachments
+		void CreateRenderGraph();
 
 		// creates renderer resources
 		void CreateResources();
 
+		// compiles the shaders and builds the pipelines the first time the global states are created
+		void CreatePipelines(const std::string& bindlessDefine);
+
+		// builds the pipelines again for the current main render pass, keeping the objects handed out
+		void RebuildPipelines();
+
+		// builds the pipeline variants listed by the previous run
+		void PrewarmVariants();
+
+		// lists the pipeline variants built so far, for the next run to prewarm them
+		void RecordVariants();
+
 	private:
 
 		Shared<VKInstance> mInstance;
 		Shared<VKDevice> mDevice;
+		Shared<VKAllocator> mAllocator;
+		Shared<VKGeometryPool> mGeometryPool;
+		Shared<VKDeletionQueue> mDeletionQueue;
+		Shared<VKUploader> mUploader;
 		Shared<VKSwapchain> mSwapchain;
+		Shared<VKLinearAllocator> mFrameAllocator;
 
+		Shared<VKGpuProfiler> mGpuProfiler;
+		Shared<VKFramePacer> mFramePacer;
 		Shared<VKCommander> mCommander;
-		VkPipelineCache mPipelineCache;
+		Shared<VKRenderGraph> mRenderGraph;
+		Shared<VKResidency> mResidency;
+		Shared<VKTextureStreamer> mTextureStreamer;
+		Shared<VKPipelineCache> mPipelineCache;
 		std::unordered_map<std::string, Shared<VKPipeline>> mPipelines = {};
+		Shared<VKShaderReloader> mShaderReloader;
+		Shared<VKDepthPyramid> mDepthPyramid;
+		Shared<VKCuller> mCuller;
+		Shared<VKBindless> mBindless;
+		Shared<VKFrameUniforms> mFrameUniforms;
+		Shared<VKRenderQueue> mRenderQueue;
 
 		std::vector<VkSemaphore> mImageAvailableSemaphores;
 		std::vector<VkSemaphore> mRenderFinishedSemaphores;
 		std::vector<VkFence> mInFlightFences;
 		uint32_t mCurrentFrame = 0;
 		uint32_t mImageIndex = 0;
+		uint32_t mFramesInFlight = RENDERER_FRAMES_IN_FLIGHT;
+		uint32_t mRequestedFramesInFlight = RENDERER_FRAMES_IN_FLIGHT;
+		bool mRecreateSwapchain = false;
 	};
 }
\ No newline at end of file
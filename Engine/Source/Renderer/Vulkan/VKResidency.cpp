@@ -0,0 +1,110 @@
+#include "epch.h"
+#include "VKResidency.h"
+
+#include "VKAllocator.h"
+#include "VKDevice.h"
+#include "VKInstance.h"
+
+namespace Cosmos
+{
+	VKResidency* VKResidency::sResidency = nullptr;
+
+	VKResidency::VKResidency(Shared<VKInstance> instance, Shared<VKDevice> device)
+		: mInstance(instance), mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Residency");
+		sResidency = this;
+
+		// without a device the heaps are only the ones given to SetHeaps, which lets the budget be exercised without a gpu
+		if (!mDevice)
+			return;
+
+		if (mDevice->IsMemoryBudgetSupported())
+		{
+			mGetMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(mInstance->GetInstance(), "vkGetPhysicalDeviceMemoryProperties2KHR");
+		}
+
+		if (mGetMemoryProperties2 == nullptr)
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "VK_EXT_memory_budget is not available, only the engine's own allocations count towards the budget");
+		}
+
+		OnUpdate();
+	}
+
+	VKResidency::~VKResidency()
+	{
+		sResidency = nullptr;
+	}
+
+	void VKResidency::OnUpdate()
+	{
+		if (!mDevice)
+			return;
+
+		const VkPhysicalDeviceMemoryProperties& properties = mDevice->GetMemoryProperties();
+		std::vector<Heap> heaps(properties.memoryHeapCount);
+
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+		if (mGetMemoryProperties2)
+		{
+			VkPhysicalDeviceMemoryProperties2 properties2 = {};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			properties2.pNext = &budgetProperties;
+			mGetMemoryProperties2(mDevice->GetPhysicalDevice(), &properties2);
+		}
+
+		for (uint32_t i = 0; i < properties.memoryHeapCount; i++)
+		{
+			heaps[i].size = properties.memoryHeaps[i].size;
+			heaps[i].deviceLocal = (properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+			heaps[i].budget = mGetMemoryProperties2 ? budgetProperties.heapBudget[i] : (heaps[i].size / 10) * 8;
+			heaps[i].usage = mGetMemoryProperties2 ? budgetProperties.heapUsage[i] : VKAllocator::GetInstance()->GetHeapUsage(i);
+		}
+
+		SetHeaps(heaps);
+	}
+
+	void VKResidency::SetHeaps(const std::vector<Heap>& heaps)
+	{
+		mHeaps = heaps;
+		mPendingBytes = 0;
+	}
+
+	void VKResidency::SetBudget(VkDeviceSize bytes)
+	{
+		mBudgetOverride = bytes;
+	}
+
+	VkDeviceSize VKResidency::GetBudget() const
+	{
+		VkDeviceSize budget = 0;
+
+		for (const Heap& heap : mHeaps)
+		{
+			if (heap.deviceLocal)
+				budget += heap.budget;
+		}
+
+		// a custom budget can only be tighter than what the driver allows
+		if (mBudgetOverride > 0)
+			budget = std::min(budget, mBudgetOverride);
+
+		return budget;
+	}
+
+	VkDeviceSize VKResidency::GetUsage() const
+	{
+		VkDeviceSize usage = 0;
+
+		for (const Heap& heap : mHeaps)
+		{
+			if (heap.deviceLocal)
+				usage += heap.usage;
+		}
+
+		return usage;
+	}
+}
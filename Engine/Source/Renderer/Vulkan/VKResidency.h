@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+	class VKInstance;
+
+	// tracks device-local memory against a budget, the texture streamer uses it to decide when to drop or load mips
+	class VKResidency
+	{
+	public:
+
+		struct Heap
+		{
+			VkDeviceSize size = 0;		// total size of the heap
+			VkDeviceSize budget = 0;	// how much the process may use, as reported by the driver
+			VkDeviceSize usage = 0;		// how much the process is using, as reported by the driver
+			bool deviceLocal = false;
+		};
+
+	public:
+
+		// constructor
+		VKResidency(Shared<VKInstance> instance, Shared<VKDevice> device);
+
+		// destructor
+		~VKResidency();
+
+		// returns the residency singleton
+		inline static VKResidency* GetInstance() { return sResidency; }
+
+		// returns the memory heaps, refreshed every update
+		inline const std::vector<Heap>& GetHeaps() const { return mHeaps; }
+
+		// returns the bytes loads started since the last refresh are about to allocate
+		inline VkDeviceSize GetPending() const { return mPendingBytes; }
+
+	public:
+
+		// refreshes the heaps usage and budget
+		void OnUpdate();
+
+		// replaces the heaps with the given ones and forgets the pending bytes, as their allocations are now part of the usage
+		void SetHeaps(const std::vector<Heap>& heaps);
+
+		// counts bytes a load is about to allocate, so that the loads started before the next refresh don't spend the same headroom
+		inline void AddPending(VkDeviceSize bytes) { mPendingBytes += bytes; }
+
+		// overrides the device-local budget, 0 restores the driver's budget
+		void SetBudget(VkDeviceSize bytes);
+
+		// returns the effective device-local budget
+		VkDeviceSize GetBudget() const;
+
+		// returns the device-local usage, from the driver if VK_EXT_memory_budget is available or from the allocator otherwise
+		VkDeviceSize GetUsage() const;
+
+		// returns if the usage is above the budget
+		inline bool IsOverBudget() const { return GetUsage() > GetBudget(); }
+
+		// returns if extra bytes may be allocated on top of the pending ones without going over budget
+		inline bool CanAfford(VkDeviceSize bytes) const { return GetUsage() + mPendingBytes + bytes <= GetBudget(); }
+
+	private:
+
+		static VKResidency* sResidency;
+		Shared<VKInstance> mInstance;
+		Shared<VKDevice> mDevice;
+		PFN_vkGetPhysicalDeviceMemoryProperties2KHR mGetMemoryProperties2 = nullptr;
+
+		std::vector<Heap> mHeaps = {};
+		VkDeviceSize mPendingBytes = 0;
+		VkDeviceSize mBudgetOverride = (VkDeviceSize)RENDERER_VRAM_BUDGET_MB * 1024 * 1024;
+	};
+}
@@ -2,6 +2,13 @@
 #include "VKShader.h"
 
 #include "VKDevice.h"
+#include "Thread/Pool.h"
+#include "Util/FileSystem.h"
+
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <unordered_set>
 
 // stupid visual studio propagating warnings from thirdparty libraries
 #if defined(_MSC_VER)
@@ -13,32 +20,163 @@
 	# pragma warning(pop)
 #endif
 
+// bumped whenever the way shaders are compiled changes, invalidating every cached binary
+#define SHADER_CACHE_VERSION 1
+
+// debug builds keep the spir-v unoptimized, so that debuggers show readable shaders
+#if defined(ENGINE_RELEASE)
+	#define SHADER_OPTIMIZE true
+#else
+	#define SHADER_OPTIMIZE false
+#endif
+
 namespace Cosmos
 {
-	VKShader::VKShader(Shared<VKDevice> device, Type type, std::string name, std::string path)
-		: mDevice(device), mType(type), mName(name), mPath(path)
+	// returns the path of an include relative to the file requesting it
+	static std::string ResolveInclude(const std::string& requesting, const std::string& requested)
+	{
+		std::filesystem::path base = std::filesystem::path(requesting).parent_path();
+		return (base / requested).lexically_normal().generic_string();
+	}
+
+	// accumulates data into a fnv-1a hash
+	static void HashBytes(uint64_t& hash, const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	}
+
+	// accumulates the path and content of every file a source includes, recursively
+	static void HashIncludes(uint64_t& hash, const std::string& path, const std::string& source, std::unordered_set<std::string>& visited)
+	{
+		std::istringstream stream(source);
+		std::string line;
+
+		while (std::getline(stream, line))
+		{
+			size_t start = line.find_first_not_of(" \t");
+
+			if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+				continue;
+
+			size_t open = line.find_first_of("\"<", start + 8);
+			size_t close = open == std::string::npos ? std::string::npos : line.find(line[open] == '"' ? '"' : '>', open + 1);
+
+			if (close == std::string::npos)
+				continue;
+
+			std::string include = ResolveInclude(path, line.substr(open + 1, close - open - 1));
+
+			if (!visited.insert(include).second)
+				continue;
+
+			std::vector<uint8_t> raw = FileExists(include) ? ReadFromBinary(include) : std::vector<uint8_t>();
+			std::string content(raw.begin(), raw.end());
+
+			HashBytes(hash, include.data(), include.size());
+			HashBytes(hash, content.data(), content.size());
+			HashIncludes(hash, include, content, visited);
+		}
+	}
+
+	// resolves #include directives relative to the including file, reading from the mounted archive or from disk
+	class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface
+	{
+	private:
+
+		struct Include
+		{
+			std::string path;
+			std::string content;
+			shaderc_include_result result;
+		};
+
+	public:
+
+		// returns the content of an included file, an empty path tells shaderc it wasn't found
+		virtual shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type, const char* requestingSource, size_t includeDepth) override
+		{
+			Include* include = new Include();
+			std::string path = ResolveInclude(requestingSource, requestedSource);
+
+			if (FileExists(path))
+			{
+				std::vector<uint8_t> raw = ReadFromBinary(path);
+				include->path = path;
+				include->content.assign(raw.begin(), raw.end());
+			}
+
+			else
+			{
+				include->content = "Failed to find included file " + path;
+			}
+
+			include->result.source_name = include->path.c_str();
+			include->result.source_name_length = include->path.size();
+			include->result.content = include->content.c_str();
+			include->result.content_length = include->content.size();
+			include->result.user_data = include;
+
+			return &include->result;
+		}
+
+		// releases an include returned by GetInclude
+		virtual void ReleaseInclude(shaderc_include_result* data) override
+		{
+			delete (Include*)data->user_data;
+		}
+	};
+
+	VKShader::Stats VKShader::sStats;
+
+	VKShader::VKShader(Shared<VKDevice> device, Type type, std::string name, std::string path, std::vector<std::string> defines)
+		: mDevice(device), mType(type), mName(name), mPath(path), mDefines(defines)
 	{
 		Logger() << "Creating VKShader";
 
-		// reads raw shader
-		std::ifstream read(path);
-		std::stringstream buffer;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-		buffer << read.rdbuf();
-		read.close();
+		// reads raw shader, either from the mounted archive or from disk
+		std::vector<uint8_t> raw = ReadFromBinary(path);
+		std::string source(raw.begin(), raw.end());
+
+		// the spir-v is only compiled when nothing it depends on was compiled before
+		std::string cachePath = GetCachePath(source, SHADER_OPTIMIZE);
+		std::vector<uint32_t> binary = ReadCache(cachePath);
+
+		if (binary.empty())
+		{
+			binary = Compile(source.c_str(), type, SHADER_OPTIMIZE);
+
+			if (!binary.empty())
+			{
+				std::error_code error;
+				std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+				WriteToBinaryAtomic(cachePath, binary.data(), binary.size() * sizeof(uint32_t));
+			}
 
-		std::string auxname = path;
-		auxname += ".spv";
+			sStats.compiled++;
+		}
 
-		// writes compiled shared
-		std::vector<uint32_t> bin = Compile(buffer.str().c_str(), type, false);
-		std::ofstream write(auxname.c_str(), std::ios::out | std::ios::binary);
+		else
+		{
+			sStats.hits++;
+		}
 
-		write.write(reinterpret_cast<char*>(&bin[0]), bin.size() * sizeof(bin[0]));
-		write.close();
+		// a shader that failed to compile has no module, its owner decides if that's fatal
+		if (!binary.empty())
+		{
+			CreateShaderModule(binary);
+		}
 
-		CreateShaderModule(ReadSPIRV());
 		CreateShaderStage();
+
+		sStats.microseconds += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
 	}
 
 	VKShader::~VKShader()
@@ -46,51 +184,117 @@ namespace Cosmos
 		vkDestroyShaderModule(mDevice->GetDevice(), mShaderModule, nullptr);
 	}
 
-	std::vector<char> VKShader::ReadSPIRV()
+	std::future<Shared<VKShader>> VKShader::CreateAsync(Shared<VKDevice> device, Type type, std::string name, std::string path, std::vector<std::string> defines)
+	{
+		// shaderc compilers aren't shared and vkCreateShaderModule needs no external synchronization
+		return thread::PoolManager::GetInstance().GetResourcesPool()->Enqueue([device, type, name, path, defines]()
+		{
+			return CreateShared<VKShader>(device, type, name, path, defines);
+		});
+	}
+
+	void VKShader::LogStats()
+	{
+		LOG_TO_TERMINAL
+		(
+			Logger::Severity::Info,
+			"Shaders: %u loaded from cache, %u compiled, %.2fms",
+			sStats.hits.load(),
+			sStats.compiled.load(),
+			(double)sStats.microseconds.load() / 1000.0
+		);
+	}
+
+	std::string VKShader::GetCachePath(const std::string& source, bool optimize)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		uint32_t version = SHADER_CACHE_VERSION;
+		uint32_t spirvVersion = 0;
+		uint32_t spirvRevision = 0;
+		shaderc_get_spv_version(&spirvVersion, &spirvRevision);
+
+		HashBytes(hash, &version, sizeof(version));
+		HashBytes(hash, &spirvVersion, sizeof(spirvVersion));
+		HashBytes(hash, &spirvRevision, sizeof(spirvRevision));
+		HashBytes(hash, &optimize, sizeof(optimize));
+		HashBytes(hash, &mType, sizeof(mType));
+		HashBytes(hash, source.data(), source.size());
+
+		for (const std::string& define : mDefines)
+		{
+			HashBytes(hash, define.data(), define.size() + 1); // the terminator keeps {"AB"} apart from {"A", "B"}
+		}
+
+		std::unordered_set<std::string> visited = {};
+		HashIncludes(hash, mPath, source, visited);
+
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.spv", (unsigned long long)hash);
+
+		return GetBinDir() + "/" + RENDERER_SHADER_CACHE_DIR + "/" + name;
+	}
+
+	std::vector<uint32_t> VKShader::ReadCache(const std::string& path)
 	{
-		std::string name = mPath;
-		name += ".spv";
+		if (!std::filesystem::exists(path))
+			return {};
+
+		std::vector<uint8_t> raw = ReadFromBinary(path);
 
-		std::ifstream bin(name, std::ios::ate | std::ios::binary);
+		// spir-v is a stream of words starting with its magic number
+		if (raw.size() < 20 || raw.size() % sizeof(uint32_t) != 0)
+			return {};
 
-		size_t fileSize = (size_t)bin.tellg();
-		std::vector<char> buffer(fileSize);
+		std::vector<uint32_t> binary(raw.size() / sizeof(uint32_t));
+		memcpy(binary.data(), raw.data(), raw.size());
 
-		bin.seekg(0);
-		bin.read(buffer.data(), fileSize);
-		bin.close();
+		if (binary[0] != 0x07230203)
+			return {};
 
-		return buffer;
+		return binary;
 	}
 
 	std::vector<uint32_t> VKShader::Compile(const char* source, Type type, bool optimize)
 	{
 		shaderc::Compiler compiler;
 		shaderc::CompileOptions options;
+		options.SetIncluder(CreateUnique<ShaderIncluder>());
+
+		for (const std::string& define : mDefines)
+		{
+			size_t equal = define.find('=');
+
+			if (equal == std::string::npos)
+				options.AddMacroDefinition(define);
+
+			else
+				options.AddMacroDefinition(define.substr(0, equal), define.substr(equal + 1));
+		}
 
 		if (optimize)
 		{
-			options.SetOptimizationLevel(shaderc_optimization_level_size);
+			options.SetOptimizationLevel(shaderc_optimization_level_performance);
 		}
 
 		shaderc::SpvCompilationResult res = compiler.CompileGlslToSpv(source, (shaderc_shader_kind)type, mPath.c_str(), options);
 
 		if (res.GetCompilationStatus() != shaderc_compilation_status_success)
 		{
-			LOG_TO_TERMINAL(Logger::Severity::Assert, "Failed to Compile shader %s. Details: %s", mPath.c_str(), res.GetErrorMessage().c_str());
+			mError = res.GetErrorMessage();
+			return {};
 		}
 
 		return { res.cbegin(), res.cend() };
 	}
 
-	void VKShader::CreateShaderModule(const std::vector<char>& binary)
+	void VKShader::CreateShaderModule(const std::vector<uint32_t>& binary)
 	{
 		VkShaderModuleCreateInfo shaderModuleCI = {};
 		shaderModuleCI.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 		shaderModuleCI.pNext = nullptr;
 		shaderModuleCI.flags = 0;
-		shaderModuleCI.codeSize = binary.size();
-		shaderModuleCI.pCode = reinterpret_cast<const uint32_t*>(binary.data());
+		shaderModuleCI.codeSize = binary.size() * sizeof(uint32_t);
+		shaderModuleCI.pCode = binary.data();
 
 		VK_ASSERT(vkCreateShaderModule(mDevice->GetDevice(), &shaderModuleCI, nullptr, &mShaderModule), "Failed to create shader module");
 	}
@@ -2,6 +2,9 @@
 
 #include "VKDefines.h"
 #include "Util/Memory.h"
+#include <atomic>
+#include <future>
+#include <string>
 #include <vector>
 
 namespace Cosmos
@@ -23,14 +26,24 @@ namespace Cosmos
 			TessEvaluation = 5
 		};
 
+		struct Stats
+		{
+			std::atomic<uint32_t> hits = 0;					// shaders loaded from the spir-v cache
+			std::atomic<uint32_t> compiled = 0;				// shaders compiled from source
+			std::atomic<uint64_t> microseconds = 0;			// time spent creating shaders, including the compilations
+		};
+
 	public:
 
-		// constructor
-		VKShader(Shared<VKDevice> device, Type type, std::string name, std::string path);
+		// constructor, defines are either NAME or NAME=VALUE
+		VKShader(Shared<VKDevice> device, Type type, std::string name, std::string path, std::vector<std::string> defines = {});
 
 		// destructor
 		~VKShader();
 
+		// creates the shader on the resources pool, so that several shaders compile at once
+		static std::future<Shared<VKShader>> CreateAsync(Shared<VKDevice> device, Type type, std::string name, std::string path, std::vector<std::string> defines = {});
+
 		// returns the shader type
 		inline Type GetType() { return mType; }
 
@@ -40,32 +53,53 @@ namespace Cosmos
 		// returns a reference to the shader path
 		inline std::string& GetPathRef() { return mPath; }
 
+		// returns a reference to the shader defines
+		inline std::vector<std::string>& GetDefinesRef() { return mDefines; }
+
 		// returns the shader module
 		inline VkShaderModule GetModule() { return mShaderModule; }
 
+		// returns if the shader compiled, otherwise the module is null and the error tells why
+		inline bool IsValid() const { return mShaderModule != VK_NULL_HANDLE; }
+
+		// returns a reference to the compilation error, empty when the shader is valid
+		inline std::string& GetErrorRef() { return mError; }
+
 		// returns a reference to the shader stage info
 		VkPipelineShaderStageCreateInfo& GetShaderStageCreateInfoRef() { return mShaderStageCI; }
 
+		// returns the statistics of every shader created so far
+		inline static const Stats& GetStats() { return sStats; }
+
+		// prints the statistics of every shader created so far
+		static void LogStats();
+
 	private:
 
-		// reads and returns shader's binary
-		std::vector<char> ReadSPIRV();
+		// returns the path of the cached spir-v for the source, hashing everything the compilation depends on
+		std::string GetCachePath(const std::string& source, bool optimize);
+
+		// reads a cached spir-v binary, returns an empty vector if missing or invalid
+		std::vector<uint32_t> ReadCache(const std::string& path);
 
-		// compiles and returns a source shader
+		// compiles and returns a source shader, an empty binary means it failed and the error was stored
 		std::vector<uint32_t> Compile(const char* source, Type type, bool optimize = false);
 
 		// creates the shader's module of the spir-v binary
-		void CreateShaderModule(const std::vector<char>& binary);
+		void CreateShaderModule(const std::vector<uint32_t>& binary);
 
 		// creates the shaders tage specification
 		void CreateShaderStage();
 
 	private:
 
+		static Stats sStats;
 		Shared<VKDevice> mDevice;
 		Type mType;
 		std::string mName;
 		std::string mPath;
+		std::vector<std::string> mDefines;
+		std::string mError;
 		VkShaderModule mShaderModule = VK_NULL_HANDLE;
 		VkPipelineShaderStageCreateInfo mShaderStageCI = {};
 	};
@@ -0,0 +1,163 @@
+#include "epch.h"
+#include "VKShaderReloader.h"
+
+#include "VKDeletionQueue.h"
+#include "VKDevice.h"
+#include "VKPipeline.h"
+#include "VKShader.h"
+#include "Thread/Pool.h"
+#include "Util/FileWatcher.h"
+
+namespace Cosmos
+{
+	// returns if two paths point to the same file, regardless of how they were written
+	static bool SamePath(const std::string& a, const std::string& b)
+	{
+		return std::filesystem::path(a).lexically_normal() == std::filesystem::path(b).lexically_normal();
+	}
+
+	VKShaderReloader::VKShaderReloader(Shared<VKDevice> device, std::unordered_map<std::string, Shared<VKPipeline>>& pipelines, std::string directory)
+		: mDevice(device), mPipelines(pipelines)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Watching %s for shader changes", directory.c_str());
+		mWatcher = CreateUnique<FileWatcher>(directory);
+	}
+
+	VKShaderReloader::~VKShaderReloader()
+	{
+		// pipelines built but never swapped in were never used
+		for (auto& rebuild : mRebuilds)
+		{
+			Result result = rebuild.second.get();
+
+			if (result.pipeline != VK_NULL_HANDLE)
+				vkDestroyPipeline(mDevice->GetDevice(), result.pipeline, nullptr);
+		}
+	}
+
+	void VKShaderReloader::OnUpdate()
+	{
+		PROFILER_FUNCTION();
+
+		// an edited file that no pipeline uses directly may be included by them, so every pipeline is rebuilt
+		// the spir-v cache key hashes the includes, shaders not depending on the file are loaded from it instead of compiled
+		for (const std::string& path : mWatcher->Poll())
+		{
+			bool used = false;
+
+			for (auto& [name, pipeline] : mPipelines)
+			{
+				VKPipelineSpecification& specification = pipeline->GetSpecificationRef();
+
+				if (SamePath(specification.vertexShader->GetPathRef(), path) || SamePath(specification.fragmentShader->GetPathRef(), path))
+				{
+					mDirty.insert(name);
+					used = true;
+				}
+			}
+
+			if (!used)
+			{
+				for (auto& [name, pipeline] : mPipelines)
+					mDirty.insert(name);
+			}
+		}
+
+		// swap the finished rebuilds, this frame is the first to bind them
+		for (auto it = mRebuilds.begin(); it != mRebuilds.end();)
+		{
+			if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				it++;
+				continue;
+			}
+
+			Result result = it->second.get();
+
+			if (result.pipeline == VK_NULL_HANDLE)
+			{
+				LOG_TO_TERMINAL(Logger::Severity::Error, "Failed to reload pipeline %s. Details: %s", it->first.c_str(), result.error.c_str());
+			}
+
+			else
+			{
+				VkDevice device = mDevice->GetDevice();
+				std::vector<VkPipeline> previous = mPipelines[it->first]->Swap(result.vertexShader, result.fragmentShader, result.pipeline);
+
+				VKDeletionQueue::GetInstance()->Push([device, previous]()
+				{
+					for (VkPipeline pipeline : previous)
+						vkDestroyPipeline(device, pipeline, nullptr);
+				});
+
+				LOG_TO_TERMINAL(Logger::Severity::Info, "Reloaded pipeline %s", it->first.c_str());
+			}
+
+			it = mRebuilds.erase(it);
+		}
+
+		// a pipeline edited again while rebuilding waits for the running rebuild, so that the newest one is always swapped last
+		for (auto it = mDirty.begin(); it != mDirty.end();)
+		{
+			if (mRebuilds.find(*it) != mRebuilds.end())
+			{
+				it++;
+				continue;
+			}
+
+			Rebuild(*it);
+			it = mDirty.erase(it);
+		}
+	}
+
+	void VKShaderReloader::Rebuild(const std::string& name)
+	{
+		Shared<VKPipeline> pipeline = mPipelines[name];
+		Shared<VKDevice> device = mDevice;
+
+		// the shaders are described here, the worker must not read what the main thread may swap
+		Shared<VKShader> vertex = pipeline->GetSpecificationRef().vertexShader;
+		Shared<VKShader> fragment = pipeline->GetSpecificationRef().fragmentShader;
+		VKShader::Type vertexType = vertex->GetType();
+		VKShader::Type fragmentType = fragment->GetType();
+		std::string vertexName = vertex->GetNameRef();
+		std::string fragmentName = fragment->GetNameRef();
+		std::string vertexPath = vertex->GetPathRef();
+		std::string fragmentPath = fragment->GetPathRef();
+		std::vector<std::string> vertexDefines = vertex->GetDefinesRef();
+		std::vector<std::string> fragmentDefines = fragment->GetDefinesRef();
+
+		mRebuilds[name] = thread::PoolManager::GetInstance().GetResourcesPool()->Enqueue([=]()
+		{
+			Result result = {};
+			result.vertexShader = CreateShared<VKShader>(device, vertexType, vertexName, vertexPath, vertexDefines);
+			result.fragmentShader = CreateShared<VKShader>(device, fragmentType, fragmentName, fragmentPath, fragmentDefines);
+
+			if (!result.vertexShader->IsValid())
+			{
+				result.error = result.vertexShader->GetErrorRef();
+				return result;
+			}
+
+			if (!result.fragmentShader->IsValid())
+			{
+				result.error = result.fragmentShader->GetErrorRef();
+				return result;
+			}
+
+			std::vector<VkPipelineShaderStageCreateInfo> shaderStages =
+			{
+				result.vertexShader->GetShaderStageCreateInfoRef(),
+				result.fragmentShader->GetShaderStageCreateInfoRef()
+			};
+
+			if (pipeline->CreatePipeline(shaderStages, 0, result.pipeline) != VK_SUCCESS)
+			{
+				result.pipeline = VK_NULL_HANDLE;
+				result.error = "Failed to create graphics pipeline";
+			}
+
+			return result;
+		});
+	}
+}
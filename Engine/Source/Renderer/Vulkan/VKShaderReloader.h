@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include <vulkan/vulkan.h>
+
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Cosmos
+{
+	// forward declarations
+	class FileWatcher;
+	class VKDevice;
+	class VKPipeline;
+	class VKShader;
+
+	// watches the shaders folder and rebuilds the pipelines whose shaders were edited, on the resources pool
+	// rebuilt pipelines are swapped in between frames and the replaced ones are destroyed through the deletion queue
+	// a shader that fails to compile is reported and the pipeline keeps its previous version
+	class VKShaderReloader
+	{
+	public:
+
+		struct Result
+		{
+			Shared<VKShader> vertexShader;
+			Shared<VKShader> fragmentShader;
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			std::string error = {};
+		};
+
+	public:
+
+		// constructor, the pipelines must outlive the reloader
+		VKShaderReloader(Shared<VKDevice> device, std::unordered_map<std::string, Shared<VKPipeline>>& pipelines, std::string directory);
+
+		// destructor, waits for the rebuilds still running
+		~VKShaderReloader();
+
+	public:
+
+		// swaps the finished rebuilds and starts new ones for the edited shaders, must be called before the frame is recorded
+		void OnUpdate();
+
+	private:
+
+		// starts rebuilding a pipeline on the resources pool
+		void Rebuild(const std::string& name);
+
+	private:
+
+		Shared<VKDevice> mDevice;
+		std::unordered_map<std::string, Shared<VKPipeline>>& mPipelines;
+		Unique<FileWatcher> mWatcher;
+		std::unordered_map<std::string, std::future<Result>> mRebuilds = {};
+		std::unordered_set<std::string> mDirty = {};
+	};
+}
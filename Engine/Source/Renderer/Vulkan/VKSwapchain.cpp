@@ -5,6 +5,7 @@
 #include "VKDevice.h"
 #include "VKInstance.h"
 #include "VKImage.h"
+#include "VKRenderGraph.h"
 #include "Core/Application.h"
 
 namespace Cosmos
@@ -23,11 +24,15 @@ namespace Cosmos
 		VKCommander::GetInstance()->SetMain("Swapchain");
 		VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->msaa = mDevice->GetMSAA();
 
+		// draws the objects the occlusion culling found disoccluded over the early pass
+		VKCommander::GetInstance()->Insert("SwapchainLate", mDevice->GetDevice());
+		VKCommander::GetInstance()->GetEntriesRef()["SwapchainLate"]->msaa = mDevice->GetMSAA();
+
 		CreateSwapchain();
 		CreateImageViews();
 
 		CreateRenderPass();
-		CreateFramebuffers();
+		ImportImages();
 
 		CreateCommandPool();
 		CreateCommandBuffers();
@@ -35,14 +40,6 @@ namespace Cosmos
 
 	VKSwapchain::~VKSwapchain()
 	{
-		vkDestroyImageView(mDevice->GetDevice(), mDepthView, nullptr);
-		vkDestroyImage(mDevice->GetDevice(), mDepthImage, nullptr);
-		vkFreeMemory(mDevice->GetDevice(), mDepthMemory, nullptr);
-
-		vkDestroyImageView(mDevice->GetDevice(), mColorView, nullptr);
-		vkDestroyImage(mDevice->GetDevice(), mColorImage, nullptr);
-		vkFreeMemory(mDevice->GetDevice(), mColorMemory, nullptr);
-
 		for (auto imageView : mImageViews)
 		{
 			vkDestroyImageView(mDevice->GetDevice(), imageView, nullptr);
@@ -81,92 +78,98 @@ namespace Cosmos
 		return mPresentMode;
 	}
 
-	VkExtent2D& VKSwapchain::GetExtent()
+	VkPresentModeKHR VKSwapchain::GetRequestedPresentMode()
 	{
-		return mExtent;
+		return mRequestedPresentMode;
 	}
 
-	VkImageView& VKSwapchain::GetColorView()
+	void VKSwapchain::SetRequestedPresentMode(VkPresentModeKHR mode)
 	{
-		return mColorView;
+		mRequestedPresentMode = mode;
 	}
 
-	VkImageView& VKSwapchain::GetDepthView()
+	VkExtent2D& VKSwapchain::GetExtent()
 	{
-		return mDepthView;
+		return mExtent;
 	}
 
 	void VKSwapchain::CreateRenderPass()
 	{
-		// attachments descriptions
-		std::array<VkAttachmentDescription, 3> attachments = {};
-
-		// color
-		attachments[0].format = mSurfaceFormat.format;
-		attachments[0].samples = mDevice->GetMSAA();
-		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-		// depth
-		attachments[1].format = FindDepthFormat(mDevice);
-		attachments[1].samples = mDevice->GetMSAA();
-		attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-		// resolve
-		attachments[2].format = mSurfaceFormat.format;
-		attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
-		attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		attachments[2].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachments[2].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attachments[2].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[2].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		// finalLayout should not be VK_IMAGE_LAYOUT_PRESENT_SRC_KHR as ui is a post render pass that will present
-
-		// attachments references
-		std::array<VkAttachmentReference, 3> references = {};
-
-		references[0].attachment = 0;
-		references[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		references[1].attachment = 1;
-		references[1].layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		references[2].attachment = 2;
-		references[2].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-		// subpass
-		VkSubpassDescription subpass = {};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.colorAttachmentCount = 1;
-		subpass.pColorAttachments = &references[0];
-		subpass.pDepthStencilAttachment = &references[1];
-		subpass.pResolveAttachments = &references[2];
-
-		VkSubpassDependency dependency = {};
-		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependency.dstSubpass = 0;
-		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-		dependency.srcAccessMask = 0;
-		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-		VkRenderPassCreateInfo renderPassCI = {};
-		renderPassCI.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		renderPassCI.attachmentCount = (uint32_t)attachments.size();
-		renderPassCI.pAttachments = attachments.data();
-		renderPassCI.subpassCount = 1;
-		renderPassCI.pSubpasses = &subpass;
-		renderPassCI.dependencyCount = 1;
-		renderPassCI.pDependencies = &dependency;
-		VK_ASSERT(vkCreateRenderPass(mDevice->GetDevice(), &renderPassCI, nullptr, &VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->renderPass), "Failed to create render pass");
+		// the early pass clears and keeps color and depth, the late one draws over them and resolves into the backbuffer
+		for (const char* name : { "Swapchain", "SwapchainLate" })
+		{
+			bool late = strcmp(name, "SwapchainLate") == 0;
+
+			// attachments descriptions
+			std::array<VkAttachmentDescription, 3> attachments = {};
+
+			// color
+			attachments[0].format = mSurfaceFormat.format;
+			attachments[0].samples = mDevice->GetMSAA();
+			attachments[0].loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[0].storeOp = late ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[0].initialLayout = late ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+			attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			// depth, the depth pyramid is built from the early pass' one
+			attachments[1].format = FindDepthFormat(mDevice);
+			attachments[1].samples = mDevice->GetMSAA();
+			attachments[1].loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[1].storeOp = late ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].initialLayout = late ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			// resolve, only the late pass has it and its pipelines stay compatible with the early one as both have a single subpass
+			attachments[2].format = mSurfaceFormat.format;
+			attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[2].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[2].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[2].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			attachments[2].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			// finalLayout should not be VK_IMAGE_LAYOUT_PRESENT_SRC_KHR as ui is a post render pass that will present
+
+			// attachments references
+			std::array<VkAttachmentReference, 3> references = {};
+
+			references[0].attachment = 0;
+			references[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			references[1].attachment = 1;
+			references[1].layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			references[2].attachment = 2;
+			references[2].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			// subpass
+			VkSubpassDescription subpass = {};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &references[0];
+			subpass.pDepthStencilAttachment = &references[1];
+			subpass.pResolveAttachments = late ? &references[2] : nullptr;
+
+			VkSubpassDependency dependency = {};
+			dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+			dependency.dstSubpass = 0;
+			dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+			dependency.srcAccessMask = 0;
+			dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+			dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+			VkRenderPassCreateInfo renderPassCI = {};
+			renderPassCI.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			renderPassCI.attachmentCount = late ? 3 : 2;
+			renderPassCI.pAttachments = attachments.data();
+			renderPassCI.subpassCount = 1;
+			renderPassCI.pSubpasses = &subpass;
+			renderPassCI.dependencyCount = 1;
+			renderPassCI.pDependencies = &dependency;
+			VK_ASSERT(vkCreateRenderPass(mDevice->GetDevice(), &renderPassCI, nullptr, &VKCommander::GetInstance()->GetEntriesRef()[name]->renderPass), "Failed to create render pass");
+		}
 	}
 
 	void VKSwapchain::CreateSwapchain()
@@ -240,90 +243,15 @@ namespace Cosmos
 		}
 	}
 
-	void VKSwapchain::CreateFramebuffers()
+	void VKSwapchain::ImportImages()
 	{
-		// create frame color resources
-		{
-			VkFormat format = mSurfaceFormat.format;
-
-			CreateImage
-			(
-				mDevice,
-				mExtent.width,
-				mExtent.height,
-				1,
-				1,
-				mDevice->GetMSAA(),
-				format,
-				VK_IMAGE_TILING_OPTIMAL,
-				VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				mColorImage,
-				mColorMemory
-			);
-
-			mColorView = CreateImageView(mDevice, mColorImage, format, VK_IMAGE_ASPECT_COLOR_BIT);
-		}
-
-		// create frame depth resources
-		{
-			VkFormat format = FindDepthFormat(mDevice);
-
-			CreateImage
-			(
-				mDevice,
-				mExtent.width,
-				mExtent.height,
-				1,
-				1,
-				mDevice->GetMSAA(),
-				format,
-				VK_IMAGE_TILING_OPTIMAL,
-				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				mDepthImage,
-				mDepthMemory
-			);
-
-			mDepthView = CreateImageView(mDevice, mDepthImage, format, VK_IMAGE_ASPECT_DEPTH_BIT);
-		}
-
-		// create frame buffers
-		{
-			VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->frameBuffers.resize(mImageViews.size());
-
-			for (size_t i = 0; i < mImageViews.size(); i++)
-			{
-				std::array<VkImageView, 3> attachments = { mColorView, mDepthView, mImageViews[i] };
-
-				VkFramebufferCreateInfo framebufferCI = {};
-				framebufferCI.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-				framebufferCI.renderPass = VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->renderPass;
-				framebufferCI.attachmentCount = (uint32_t)attachments.size();
-				framebufferCI.pAttachments = attachments.data();
-				framebufferCI.width = mExtent.width;
-				framebufferCI.height = mExtent.height;
-				framebufferCI.layers = 1;
-				VK_ASSERT(vkCreateFramebuffer(mDevice->GetDevice(), &framebufferCI, nullptr, &VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->frameBuffers[i]), "Failed to create framebuffer");
-			}
-		}
+		// the render graph builds the framebuffers of the passes drawing to them
+		VKRenderGraph::GetInstance()->SetExtent(mExtent);
+		VKRenderGraph::GetInstance()->Import("Backbuffer", mImages, mImageViews, VK_IMAGE_ASPECT_COLOR_BIT);
 	}
 
 	void VKSwapchain::Cleanup()
 	{
-		vkDestroyImageView(mDevice->GetDevice(), mDepthView, nullptr);
-		vkDestroyImage(mDevice->GetDevice(), mDepthImage, nullptr);
-		vkFreeMemory(mDevice->GetDevice(), mDepthMemory, nullptr);
-
-		vkDestroyImageView(mDevice->GetDevice(), mColorView, nullptr);
-		vkDestroyImage(mDevice->GetDevice(), mColorImage, nullptr);
-		vkFreeMemory(mDevice->GetDevice(), mColorMemory, nullptr);
-
-		for (uint32_t i = 0; i < VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->frameBuffers.size(); i++)
-		{
-			vkDestroyFramebuffer(mDevice->GetDevice(), VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->frameBuffers[i], nullptr);
-		}
-
 		for (auto imageView : mImageViews)
 		{
 			vkDestroyImageView(mDevice->GetDevice(), imageView, nullptr);
@@ -352,7 +280,7 @@ namespace Cosmos
 
 		CreateSwapchain();
 		CreateImageViews();
-		CreateFramebuffers();
+		ImportImages();
 	}
 
 	VKSwapchain::Details VKSwapchain::QueryDetails()
@@ -385,23 +313,30 @@ namespace Cosmos
 	{
 		VKDevice::QueueFamilyIndices indices = mDevice->FindQueueFamilies(mDevice->GetPhysicalDevice(), mDevice->GetSurface());
 
-		VkCommandPoolCreateInfo cmdPoolInfo = {};
-		cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		cmdPoolInfo.queueFamilyIndex = indices.graphics.value();
-		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-		VK_ASSERT(vkCreateCommandPool(mDevice->GetDevice(), &cmdPoolInfo, nullptr, &VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->commandPool), "Failed to create command pool");
+		for (const char* name : { "Swapchain", "SwapchainLate" })
+		{
+			VkCommandPoolCreateInfo cmdPoolInfo = {};
+			cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			cmdPoolInfo.queueFamilyIndex = indices.graphics.value();
+			cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+			VK_ASSERT(vkCreateCommandPool(mDevice->GetDevice(), &cmdPoolInfo, nullptr, &VKCommander::GetInstance()->GetEntriesRef()[name]->commandPool), "Failed to create command pool");
+		}
 	}
 
 	void VKSwapchain::CreateCommandBuffers()
 	{
-		VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->commandBuffers.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
-
-		VkCommandBufferAllocateInfo cmdBufferAllocInfo = {};
-		cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		cmdBufferAllocInfo.commandPool = VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->commandPool;
-		cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		cmdBufferAllocInfo.commandBufferCount = (uint32_t)VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->commandBuffers.size();
-		VK_ASSERT(vkAllocateCommandBuffers(mDevice->GetDevice(), &cmdBufferAllocInfo, VKCommander::GetInstance()->GetEntriesRef()["Swapchain"]->commandBuffers.data()), "Failed to create command buffers");
+		for (const char* name : { "Swapchain", "SwapchainLate" })
+		{
+			Shared<VKCommandEntry>& entry = VKCommander::GetInstance()->GetEntriesRef()[name];
+			entry->commandBuffers.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
+
+			VkCommandBufferAllocateInfo cmdBufferAllocInfo = {};
+			cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			cmdBufferAllocInfo.commandPool = entry->commandPool;
+			cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			cmdBufferAllocInfo.commandBufferCount = (uint32_t)entry->commandBuffers.size();
+			VK_ASSERT(vkAllocateCommandBuffers(mDevice->GetDevice(), &cmdBufferAllocInfo, entry->commandBuffers.data()), "Failed to create command buffers");
+		}
 	}
 
 	VkSurfaceFormatKHR VKSwapchain::ChooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
@@ -419,16 +354,18 @@ namespace Cosmos
 
 	VkPresentModeKHR VKSwapchain::ChoosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
 	{
-		for (const auto& availablePresentMode : availablePresentModes)
+		// the requested mode, then triple-buffer, then render as is, fifo (vsync) is the only one always supported
+		VkPresentModeKHR preferences[] = { mRequestedPresentMode, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+
+		for (VkPresentModeKHR preference : preferences)
 		{
-			if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) // triple-buffer
+			if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preference) != availablePresentModes.end())
 			{
-				return availablePresentMode;
+				return preference;
 			}
 		}
 
-		return VK_PRESENT_MODE_IMMEDIATE_KHR; // render as is
-		//return VK_PRESENT_MODE_FIFO_KHR; // vsync
+		return VK_PRESENT_MODE_FIFO_KHR;
 	}
 
 	VkExtent2D VKSwapchain::ChooseExtent(const VkSurfaceCapabilitiesKHR& capabilities)
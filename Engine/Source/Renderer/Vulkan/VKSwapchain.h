@@ -1,6 +1,7 @@
 #pragma once
 
 #include "VKDefines.h"
+#include "VKAllocator.h"
 #include "Util/Memory.h"
 #include <vector>
 
@@ -56,18 +57,18 @@ namespace Cosmos
 		// returns swapchain's presentation mode
 		VkPresentModeKHR& GetPresentMode();
 
-		// returns swapchain's extent
-		VkExtent2D& GetExtent();
+		// returns the presentation mode asked for, the swapchain uses it when the surface supports it
+		VkPresentModeKHR GetRequestedPresentMode();
 
-		// returns the swapchain's color view
-		VkImageView& GetColorView();
+		// sets the presentation mode asked for, taking effect when the swapchain is recreated
+		void SetRequestedPresentMode(VkPresentModeKHR mode);
 
-		// returns the swapchain's depth view
-		VkImageView& GetDepthView();
+		// returns swapchain's extent
+		VkExtent2D& GetExtent();
 
 	public:
 
-		// creates the swapchain render pass, a render pass containing the backbuffer
+		// creates the swapchain render passes, the early one and the late one resolving into the backbuffer
 		void CreateRenderPass();
 
 		// creates the swapchain
@@ -76,8 +77,8 @@ namespace Cosmos
 		// creates the swapchain image views
 		void CreateImageViews();
 
-		// creates the swapchain framebuffers
-		void CreateFramebuffers();
+		// imports the swapchain images into the render graph
+		void ImportImages();
 
 		// cleans the current swapchain
 		void Cleanup();
@@ -90,10 +91,10 @@ namespace Cosmos
 
 	public:
 
-		// creates the swapchain command pool
+		// creates the command pools of both swapchain passes
 		void CreateCommandPool();
 
-		// creates teh swapchain command buffers
+		// creates the command buffers of both swapchain passes
 		void CreateCommandBuffers();
 
 	public:
@@ -118,13 +119,7 @@ namespace Cosmos
 		uint32_t mImageCount;
 		VkSurfaceFormatKHR mSurfaceFormat = {};
 		VkPresentModeKHR mPresentMode = {};
+		VkPresentModeKHR mRequestedPresentMode = RENDERER_PRESENT_MODE;
 		VkExtent2D mExtent = {};
-
-		VkImage mColorImage;
-		VkDeviceMemory mColorMemory;
-		VkImageView mColorView;
-		VkImage mDepthImage;
-		VkDeviceMemory mDepthMemory;
-		VkImageView mDepthView;
 	};
 }
\ No newline at end of file
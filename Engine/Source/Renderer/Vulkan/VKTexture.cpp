@@ -2,88 +2,96 @@
 #include "VKTexture.h"
 
 #include "VKBuffer.h"
-#include "VKCommander.h"
 #include "VKDevice.h"
 #include "VKImage.h"
+#include "VKResidency.h"
+#include "VKTextureStreamer.h"
+#include "VKUploader.h"
+#include "Renderer/TextureCooker.h"
+#include "Thread/Pool.h"
+#include "Util/FileSystem.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "wrapper_stb.h"
 
 namespace Cosmos
 {
-	VKTexture2D::VKTexture2D(Shared<VKDevice> device, const char* path, VkSampleCountFlagBits msaa)
-		: mDevice(device), mPath(path), mMSAA(msaa)
+	VKTexture2D::VKTexture2D(Shared<VKDevice> device, const char* path, VkSampleCountFlagBits msaa, const TextureSampler& sampler)
+		: mDevice(device), mPath(path), mMSAA(msaa), mSamplerSettings(sampler)
 	{
 		LoadTexture();
 
-		// image view
-		mView = CreateImageView
-		(
-			mDevice,
-			mImage,
-			VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			mMipLevels
-		);
+		// image view, cooked textures already have theirs
+		if (mView == VK_NULL_HANDLE)
+		{
+			mView = CreateImageView
+			(
+				mDevice,
+				mImage,
+				mFormat,
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				mMipLevels
+			);
+		}
 		
-		// sampler
+		// sampler, the settings enums match vulkan's values
 		mSampler = CreateSampler
 		(
 			mDevice,
-			VK_FILTER_LINEAR,
-			VK_FILTER_LINEAR,
-			VK_SAMPLER_ADDRESS_MODE_REPEAT,
-			VK_SAMPLER_ADDRESS_MODE_REPEAT,
-			VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			(VkFilter)mSamplerSettings.min,
+			(VkFilter)mSamplerSettings.mag,
+			(VkSamplerAddressMode)mSamplerSettings.u,
+			(VkSamplerAddressMode)mSamplerSettings.v,
+			(VkSamplerAddressMode)mSamplerSettings.w,
 			(float)mMipLevels
 		);
 	}
 
 	VKTexture2D::~VKTexture2D()
 	{
+		if (mStreamed && VKTextureStreamer::GetInstance())
+			VKTextureStreamer::GetInstance()->Unregister(this);
+
+		// a pending load still owns an image that may be in the middle of its upload
+		if (mStreamingLoad.valid())
+			mStreamingLoad.get();
+
+		if (mPendingImage != VK_NULL_HANDLE)
+		{
+			VKUploader::GetInstance()->Wait(mPendingTicket);
+			vkDestroyImage(mDevice->GetDevice(), mPendingImage, nullptr);
+			VKAllocator::GetInstance()->Free(mPendingMemory);
+		}
+
 		vkDeviceWaitIdle(mDevice->GetDevice());
 
 		vkDestroyImageView(mDevice->GetDevice(), mView, nullptr);
 		vkDestroyImage(mDevice->GetDevice(), mImage, nullptr);
-		vkFreeMemory(mDevice->GetDevice(), mMemory, nullptr);
+		VKAllocator::GetInstance()->Free(mMemory);
 		vkDestroySampler(mDevice->GetDevice(), mSampler, nullptr);
 	}
 
 	void VKTexture2D::LoadTexture()
 	{
+		// prefer the cooked version of the texture when available, it needs no decoding nor blits
+		std::string cooked = TextureCooker::GetCookedPath(mPath);
+
+		if (FileExists(cooked) && LoadCookedTexture(cooked))
+			return;
+
 		int32_t channels;
-		stbi_uc* pixels = stbi_load(mPath, &mWidth, &mHeight, &channels, STBI_rgb_alpha);
+		std::vector<uint8_t> file = ReadFromBinary(mPath);
+		stbi_uc* pixels = stbi_load_from_memory(file.data(), (int32_t)file.size(), &mWidth, &mHeight, &channels, STBI_rgb_alpha);
 
 		if (pixels == nullptr)
 		{
-			LOG_TO_TERMINAL(Logger::Severity::Assert, "Failed to load %s texture", mPath);
+			LOG_TO_TERMINAL(Logger::Severity::Assert, "Failed to load %s texture", mPath.c_str());
 			return;
 		}
 		
 		mMipLevels = (uint32_t)(std::floor(std::log2(std::max(mWidth, mHeight)))) + 1;
 		VkDeviceSize imgSize = (VkDeviceSize)(mWidth * mHeight * 4); // enforce 4 channels
 
-		// create staging buffer for image
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		BufferCreate
-		(
-			mDevice,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			imgSize,
-			&stagingBuffer,
-			&stagingMemory
-		);
-
-		void* data = nullptr;
-		vkMapMemory(mDevice->GetDevice(), stagingMemory, 0, imgSize, 0, &data);
-		memcpy(data, pixels, (size_t)imgSize);
-		vkUnmapMemory(mDevice->GetDevice(), stagingMemory);
-
-		stbi_image_free(pixels);
-
 		// create image resource
 		CreateImage
 		(
@@ -101,127 +109,268 @@ namespace Cosmos
 			mMemory
 		);
 
-		// transition layout to transfer data
-		TransitionImageLayout
+		VkBufferImageCopy region = {};
+		region.bufferOffset = 0;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset.x = 0;
+		region.imageOffset.y = 0;
+		region.imageOffset.z = 0;
+		region.imageExtent.width = mWidth;
+		region.imageExtent.height = mHeight;
+		region.imageExtent.depth = 1;
+
+		VkImageSubresourceRange range = {};
+		range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		range.baseMipLevel = 0;
+		range.levelCount = (uint32_t)mMipLevels;
+		range.baseArrayLayer = 0;
+		range.layerCount = 1;
+
+		// the first level is uploaded and the remaining ones blitted from it without blocking, the texture is bound to descriptors right away
+		mUploadTicket = VKUploader::GetInstance()->UploadImage(mImage, pixels, imgSize, { region }, range, true);
+		VKUploader::GetInstance()->Require(mUploadTicket);
+
+		stbi_image_free(pixels);
+	}
+
+	bool VKTexture2D::LoadCookedTexture(std::string path)
+	{
+		PROFILER_FUNCTION();
+
+		std::vector<uint8_t> headerData = ReadFromBinary(path, 0, sizeof(TextureCooker::Header));
+
+		if (!TextureCooker::Parse(headerData, mCookedHeader, true))
+		{
+			LOG_TO_TERMINAL(Logger::Warn, "%s is not a valid cooked texture, using the source image", path.c_str());
+			return false;
+		}
+
+		if (TextureCooker::IsCompressed(mCookedHeader.format) && mDevice->GetFeatures().textureCompressionBC == VK_FALSE)
+		{
+			LOG_TO_TERMINAL(Logger::Warn, "Device doesn't support BC textures, using the source image of %s", path.c_str());
+			return false;
+		}
+
+		switch (mCookedHeader.format)
+		{
+			case TextureCooker::Format::RGBA8: { mFormat = VK_FORMAT_R8G8B8A8_SRGB; break; }
+			case TextureCooker::Format::BC1: { mFormat = VK_FORMAT_BC1_RGBA_SRGB_BLOCK; break; }
+			case TextureCooker::Format::BC3: { mFormat = VK_FORMAT_BC3_SRGB_BLOCK; break; }
+			case TextureCooker::Format::BC5: { mFormat = VK_FORMAT_BC5_UNORM_BLOCK; break; }
+			default: return false;
+		}
+
+		mCookedPath = path;
+		mWidth = (int32_t)mCookedHeader.width;
+		mHeight = (int32_t)mCookedHeader.height;
+		mMipLevels = (int32_t)mCookedHeader.mipLevels;
+
+		// only the mip tail is loaded upfront, making the texture drawable right away
+		int32_t tail = 0;
+
+		while (tail < mMipLevels - 1 && std::max(mCookedHeader.levels[tail].width, mCookedHeader.levels[tail].height) > RENDERER_TEXTURE_STREAMING_TAIL_SIZE)
+			tail++;
+
+		mTailMip = tail;
+		mResidentMip = mMipLevels;
+		mRequestedMip = mMipLevels;
+		mPendingMip = tail;
+
+		if (!LoadStreamedMips())
+			return false;
+
+		ApplyStreamedMips();
+
+		// the tail is bound to descriptors as soon as the texture exists
+		VKUploader::GetInstance()->Require(mUploadTicket);
+
+		// textures with higher mips left to load are handed to the streamer
+		if (mResidentMip > 0 && VKTextureStreamer::GetInstance())
+		{
+			mStreamed = true;
+			VKTextureStreamer::GetInstance()->Register(this);
+		}
+
+		return true;
+	}
+
+	void VKTexture2D::RequestMip(int32_t mip)
+	{
+		mRequestedMip = std::min(mRequestedMip.load(), std::max(mip, 0));
+	}
+
+	bool VKTexture2D::UpdateStreaming(uint64_t frame, bool canSwap)
+	{
+		if (!mStreamed)
+			return false;
+
+		// consume the requests made since the last update, a requested texture is in use
+		int32_t requested = mRequestedMip.exchange(mMipLevels);
+
+		if (requested < mMipLevels)
+		{
+			mLastRequestedMip = requested;
+			mLastUsedFrame = frame;
+		}
+
+		// a load is in flight, wait for the file read and then for the upload before swapping it in
+		if (mStreamingLoad.valid())
+		{
+			if (mStreamingLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				return false;
+
+			if (!mStreamingLoad.get())
+			{
+				LOG_TO_TERMINAL(Logger::Error, "Failed to stream mip %d of %s", mPendingMip, mCookedPath.c_str());
+				mStreamed = false;
+				return false;
+			}
+		}
+
+		if (mPendingImage != VK_NULL_HANDLE)
+		{
+			if (!canSwap || !VKUploader::GetInstance()->IsComplete(mPendingTicket))
+				return false;
+
+			ApplyStreamedMips();
+			return true;
+		}
+
+		if (requested >= mResidentMip)
+			return false;
+
+		// only load what fits in the budget, the most detailed affordable level wins
+		VKResidency* residency = VKResidency::GetInstance();
+		int32_t target = requested;
+
+		while (target < mResidentMip && residency && !residency->CanAfford(GetStreamingCost(target) - std::min(GetStreamingCost(target), mResidentBytes)))
+			target++;
+
+		if (target < mResidentMip)
+			StartStreamingLoad(target);
+
+		return false;
+	}
+
+	bool VKTexture2D::DropMip()
+	{
+		if (!CanDropMip())
+			return false;
+
+		StartStreamingLoad(mResidentMip + 1);
+		return true;
+	}
+
+	VkDeviceSize VKTexture2D::GetStreamingCost(int32_t mip) const
+	{
+		VkDeviceSize bytes = 0;
+
+		for (int32_t i = mip; i < mMipLevels; i++)
+			bytes += (VkDeviceSize)mCookedHeader.levels[i].size;
+
+		return bytes;
+	}
+
+	void VKTexture2D::StartStreamingLoad(int32_t mip)
+	{
+		// what the load grows the texture by counts against the budget until the residency is refreshed
+		if (VKResidency::GetInstance())
+			VKResidency::GetInstance()->AddPending(GetStreamingCost(mip) - std::min(GetStreamingCost(mip), mResidentBytes));
+
+		// the file read and the upload request happen on the resources pool
+		mPendingMip = mip;
+		mStreamingLoad = thread::PoolManager::GetInstance().GetResourcesPool()->Enqueue([this]() { return LoadStreamedMips(); });
+	}
+
+	bool VKTexture2D::LoadStreamedMips()
+	{
+		PROFILER_FUNCTION();
+
+		// levels are contiguous from the requested one up to the smallest
+		const TextureCooker::Level& first = mCookedHeader.levels[mPendingMip];
+		const TextureCooker::Level& last = mCookedHeader.levels[mMipLevels - 1];
+		uint64_t payloadSize = last.offset + last.size - first.offset;
+
+		std::vector<uint8_t> payload = ReadFromBinary(mCookedPath, first.offset, payloadSize);
+
+		if (payload.size() != payloadSize)
+			return false;
+
+		// the image only holds the resident mips, so memory grows with the resolution actually needed
+		uint32_t levelCount = (uint32_t)(mMipLevels - mPendingMip);
+
+		CreateImage
 		(
 			mDevice,
-			VKCommander::GetInstance()->GetMainRef()->commandPool,
-			mImage,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			mMipLevels
+			mCookedHeader.levels[mPendingMip].width,
+			mCookedHeader.levels[mPendingMip].height,
+			levelCount,
+			1,
+			mMSAA,
+			mFormat,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			mPendingImage,
+			mPendingMemory
 		);
 
-		// copy buffer to image
-		{
-			VkCommandBuffer cmdBuffer = BeginSingleTimeCommand(mDevice, VKCommander::GetInstance()->GetMainRef()->commandPool);
+		std::vector<VkBufferImageCopy> regions(levelCount);
 
-			VkBufferImageCopy region = {};
-			region.bufferOffset = 0;
-			region.bufferRowLength = 0;
-			region.bufferImageHeight = 0;
+		for (int32_t i = mPendingMip; i < mMipLevels; i++)
+		{
+			VkBufferImageCopy& region = regions[i - mPendingMip];
+			region = {};
+			region.bufferOffset = (VkDeviceSize)(mCookedHeader.levels[i].offset - first.offset);
 			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			region.imageSubresource.mipLevel = 0;
+			region.imageSubresource.mipLevel = i - mPendingMip;
 			region.imageSubresource.baseArrayLayer = 0;
 			region.imageSubresource.layerCount = 1;
-			region.imageOffset.x = 0;
-			region.imageOffset.y = 0;
-			region.imageOffset.z = 0;
-			region.imageExtent.width = mWidth;
-			region.imageExtent.height = mHeight;
+			region.imageExtent.width = mCookedHeader.levels[i].width;
+			region.imageExtent.height = mCookedHeader.levels[i].height;
 			region.imageExtent.depth = 1;
-			vkCmdCopyBufferToImage(cmdBuffer, stagingBuffer, mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-			EndSingleTimeCommand(mDevice, VKCommander::GetInstance()->GetMainRef()->commandPool, cmdBuffer);
 		}
 
-		// free staging buffer
-		vkDestroyBuffer(mDevice->GetDevice(), stagingBuffer, nullptr);
-		vkFreeMemory(mDevice->GetDevice(), stagingMemory, nullptr);
+		VkImageSubresourceRange range = {};
+		range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		range.baseMipLevel = 0;
+		range.levelCount = levelCount;
+		range.baseArrayLayer = 0;
+		range.layerCount = 1;
 
-		CreateMipmaps();
+		// every level is copied with a single command, leaving the image ready for sampling
+		mPendingTicket = VKUploader::GetInstance()->UploadImage(mPendingImage, payload.data(), (VkDeviceSize)payloadSize, regions, range);
+
+		return true;
 	}
 
-	void VKTexture2D::CreateMipmaps()
+	void VKTexture2D::ApplyStreamedMips()
 	{
-		VkCommandBuffer commandBuffer = BeginSingleTimeCommand(mDevice, VKCommander::GetInstance()->GetMainRef()->commandPool);
-
-		VkImageMemoryBarrier barrier = {};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.image = mImage;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		barrier.subresourceRange.levelCount = 1;
-
-		int32_t mipWidth = mWidth;
-		int32_t mipHeight = mHeight;
-
-		for (int32_t i = 1; i < mMipLevels; i++)
-		{
-			barrier.subresourceRange.baseMipLevel = i - 1;
-			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-			vkCmdPipelineBarrier(commandBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-				0, nullptr,
-				0, nullptr,
-				1, &barrier);
-
-			VkImageBlit blit = {};
-			blit.srcOffsets[0] = { 0, 0, 0 };
-			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.srcSubresource.mipLevel = i - 1;
-			blit.srcSubresource.baseArrayLayer = 0;
-			blit.srcSubresource.layerCount = 1;
-			blit.dstOffsets[0] = { 0, 0, 0 };
-			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.dstSubresource.mipLevel = i;
-			blit.dstSubresource.baseArrayLayer = 0;
-			blit.dstSubresource.layerCount = 1;
-
-			vkCmdBlitImage(commandBuffer,
-				mImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1, &blit,
-				VK_FILTER_LINEAR);
-
-			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			vkCmdPipelineBarrier(commandBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-				0, nullptr,
-				0, nullptr,
-				1, &barrier);
-
-			if (mipWidth > 1) mipWidth /= 2;
-			if (mipHeight > 1) mipHeight /= 2;
-		}
+		PROFILER_FUNCTION();
+
+		uint32_t levelCount = (uint32_t)(mMipLevels - mPendingMip);
+		VkImageView view = CreateImageView(mDevice, mPendingImage, mFormat, VK_IMAGE_ASPECT_COLOR_BIT, levelCount);
 
-		barrier.subresourceRange.baseMipLevel = mMipLevels - 1;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		mResidentBytes = mPendingMemory.size;
 
-		vkCmdPipelineBarrier(commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier);
+		// the previous image may still be in use by frames in flight
+		if (mImage != VK_NULL_HANDLE)
+			VKTextureStreamer::GetInstance()->Retire(mImage, mMemory, mView);
 
-		EndSingleTimeCommand(mDevice, VKCommander::GetInstance()->GetMainRef()->commandPool, commandBuffer);
-		int x = 0;
+		mImage = mPendingImage;
+		mMemory = mPendingMemory;
+		mView = view;
+		mResidentMip = mPendingMip;
+		mUploadTicket = mPendingTicket;
+		mVersion++;
+
+		mPendingImage = VK_NULL_HANDLE;
+		mPendingMemory = {};
 	}
 
 	VKTextureCubemap::VKTextureCubemap(Shared<VKDevice> device, std::array<std::string, 6> paths, VkSampleCountFlagBits msaa)
@@ -260,7 +409,7 @@ namespace Cosmos
 
 		vkDestroyImageView(mDevice->GetDevice(), mView, nullptr);
 		vkDestroyImage(mDevice->GetDevice(), mImage, nullptr);
-		vkFreeMemory(mDevice->GetDevice(), mMemory, nullptr);
+		VKAllocator::GetInstance()->Free(mMemory);
 		vkDestroySampler(mDevice->GetDevice(), mSampler, nullptr);
 	}
 
@@ -268,19 +417,14 @@ namespace Cosmos
 	{
 		LOG_ASSERT(mPaths.size() == 6, "A Skybox must have 6 textures");
 
-		VkBuffer stagingBuffer = VK_NULL_HANDLE;
-		VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
-
-		VkDeviceSize layerSize;
-		VkDeviceSize imageSize;
+		std::vector<uint8_t> layers = {};
+		VkDeviceSize layerSize = 0;
 		int32_t channels;
 
-		void* data;
-		uint64_t memAddress;
-
 		for (uint8_t i = 0; i < mPaths.size(); i++)
 		{
-			stbi_uc* pixels = stbi_load(mPaths[i].c_str(), &mWidth, &mHeight, &channels, STBI_rgb_alpha);
+			std::vector<uint8_t> file = ReadFromBinary(mPaths[i]);
+			stbi_uc* pixels = stbi_load_from_memory(file.data(), (int32_t)file.size(), &mWidth, &mHeight, &channels, STBI_rgb_alpha);
 
 			if (pixels == nullptr)
 			{
@@ -292,30 +436,11 @@ namespace Cosmos
 			{
 				// this 4 should be mChannels, however RGBA is widely supported on GPU as RGB-only is not
 				layerSize = mWidth * mHeight * 4;
-				imageSize = layerSize * mPaths.size();
-
-				BufferCreate
-				(
-					mDevice,
-					VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					imageSize,
-					&stagingBuffer,
-					&stagingBufferMemory
-				);
-
-				vkMapMemory(mDevice->GetDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-				memAddress = reinterpret_cast<uint64_t>(data);
+				layers.resize((size_t)(layerSize * mPaths.size()));
 			}
 
-			memcpy(reinterpret_cast<uint8_t*>(memAddress), static_cast<void*>(pixels), static_cast<size_t>(layerSize));
+			memcpy(layers.data() + layerSize * i, static_cast<void*>(pixels), static_cast<size_t>(layerSize));
 			stbi_image_free(pixels);
-			memAddress += layerSize;
-
-			if (i == 5)
-			{
-				vkUnmapMemory(mDevice->GetDevice(), stagingBufferMemory);
-			}
 		}
 
 		// create image resource
@@ -336,57 +461,30 @@ namespace Cosmos
 			VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT
 		);
 
-		// transition layout to transfer data
-		TransitionImageLayout
-		(
-			mDevice,
-			VKCommander::GetInstance()->GetMainRef()->commandPool,
-			mImage,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			mMipLevels,
-			(uint32_t)mPaths.size()
-		);
-
-		LOG_TO_TERMINAL(Logger::Warn, "Test with copy regions");
-
-		// copy buffer to image
-		{
-			VkCommandBuffer cmdBuffer = BeginSingleTimeCommand(mDevice, VKCommander::GetInstance()->GetMainRef()->commandPool);
-
-			VkBufferImageCopy region = {};
-			region.bufferOffset = 0;
-			region.bufferRowLength = 0;
-			region.bufferImageHeight = 0;
-			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			region.imageSubresource.mipLevel = 0;
-			region.imageSubresource.baseArrayLayer = 0;
-			region.imageSubresource.layerCount = 6;
-			region.imageOffset.x = 0;
-			region.imageOffset.y = 0;
-			region.imageOffset.z = 0;
-			region.imageExtent.width = mWidth;
-			region.imageExtent.height = mHeight;
-			region.imageExtent.depth = 1;
-			vkCmdCopyBufferToImage(cmdBuffer, stagingBuffer, mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-			EndSingleTimeCommand(mDevice, VKCommander::GetInstance()->GetMainRef()->commandPool, cmdBuffer);
-		}
-
-		// transition layout to shader read only
-		TransitionImageLayout
-		(
-			mDevice,
-			VKCommander::GetInstance()->GetMainRef()->commandPool,
-			mImage,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			mMipLevels,
-			(uint32_t)mPaths.size()
-		);
-
-		// free staging buffer
-		vkDestroyBuffer(mDevice->GetDevice(), stagingBuffer, nullptr);
-		vkFreeMemory(mDevice->GetDevice(), stagingBufferMemory, nullptr);
+		VkBufferImageCopy region = {};
+		region.bufferOffset = 0;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 6;
+		region.imageOffset.x = 0;
+		region.imageOffset.y = 0;
+		region.imageOffset.z = 0;
+		region.imageExtent.width = mWidth;
+		region.imageExtent.height = mHeight;
+		region.imageExtent.depth = 1;
+
+		VkImageSubresourceRange range = {};
+		range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		range.baseMipLevel = 0;
+		range.levelCount = (uint32_t)mMipLevels;
+		range.baseArrayLayer = 0;
+		range.layerCount = 6;
+
+		// all faces go in a single copy, the skybox binds the cubemap right away
+		mUploadTicket = VKUploader::GetInstance()->UploadImage(mImage, layers.data(), (VkDeviceSize)layers.size(), { region }, range);
+		VKUploader::GetInstance()->Require(mUploadTicket);
 	}
 }
\ No newline at end of file
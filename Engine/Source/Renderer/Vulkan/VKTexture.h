@@ -1,8 +1,13 @@
 #pragma once
 
 #include "Renderer/Texture.h"
+#include "Renderer/TextureCooker.h"
+#include "VKAllocator.h"
 #include <vulkan/vulkan.h>
 
+#include <atomic>
+#include <future>
+
 namespace Cosmos
 {
 	// forward declarations
@@ -13,7 +18,7 @@ namespace Cosmos
 	public:
 
 		// constructor
-		VKTexture2D(Shared<VKDevice> device, const char* path, VkSampleCountFlagBits msaa = VK_SAMPLE_COUNT_1_BIT);
+		VKTexture2D(Shared<VKDevice> device, const char* path, VkSampleCountFlagBits msaa = VK_SAMPLE_COUNT_1_BIT, const TextureSampler& sampler = {});
 
 		// destructor
 		~VKTexture2D();
@@ -26,22 +31,70 @@ namespace Cosmos
 		// returns a reference to the image sampler
 		virtual inline VkSampler GetSampler() override { return mSampler; }
 
+		// requests the texture to have at least this mip level resident, streamed textures load it in the background
+		virtual void RequestMip(int32_t mip) override;
+
+	public:
+
+		// returns the last streamer frame the texture was requested on
+		inline uint64_t GetLastUsedFrame() const { return mLastUsedFrame; }
+
+		// returns the bytes the resident mips take on the gpu
+		inline VkDeviceSize GetResidentBytes() const { return mResidentBytes; }
+
+		// returns if the most detailed resident mip may be dropped, the mip tail is always kept
+		inline bool CanDropMip() const { return mStreamed && !mStreamingLoad.valid() && mPendingImage == VK_NULL_HANDLE && mResidentMip < mTailMip; }
+
+		// finishes a pending mip load (only when allowed to swap) or starts one if higher mips were requested and fit the budget, returns true if the view was replaced
+		bool UpdateStreaming(uint64_t frame, bool canSwap);
+
+		// starts replacing the image by one without its most detailed mip, returns false if it can't
+		bool DropMip();
+
 	private:
 
 		// loads the texture based on constructor's path
 		void LoadTexture();
 
-		// creates mipmaps for the current bound texture
-		void CreateMipmaps();
+		// loads a cooked texture, uploading the mip tail at once and streaming the remaining levels later, returns false if it can't be used
+		bool LoadCookedTexture(std::string path);
+
+		// reads the levels from the pending mip up to the smallest and uploads them into a new image, safe to be called from worker threads
+		bool LoadStreamedMips();
+
+		// replaces the current image with the uploaded one, must be called on the main thread
+		void ApplyStreamedMips();
+
+		// starts loading the levels from a mip up to the smallest on the resources pool
+		void StartStreamingLoad(int32_t mip);
+
+		// returns the bytes the levels from a mip up to the smallest take
+		VkDeviceSize GetStreamingCost(int32_t mip) const;
 
 	private:
 
 		Shared<VKDevice> mDevice;
-		const char* mPath = nullptr;
+		std::string mPath = {};
 		VkSampleCountFlagBits mMSAA = VK_SAMPLE_COUNT_1_BIT;
+		TextureSampler mSamplerSettings = {};
+		VkFormat mFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
+		// streaming
+		std::string mCookedPath = {};
+		TextureCooker::Header mCookedHeader = {};
+		bool mStreamed = false;
+		std::atomic<int32_t> mRequestedMip = 0;
+		int32_t mPendingMip = 0;
+		int32_t mTailMip = 0;
+		uint64_t mLastUsedFrame = 0;
+		VkDeviceSize mResidentBytes = 0;
+		std::future<bool> mStreamingLoad;
+		VkImage mPendingImage = VK_NULL_HANDLE;
+		VKAllocation mPendingMemory = {};
+		uint64_t mPendingTicket = 0;
 
 		VkImage mImage = VK_NULL_HANDLE;
-		VkDeviceMemory mMemory = VK_NULL_HANDLE;
+		VKAllocation mMemory = {};
 		VkImageView mView = VK_NULL_HANDLE;
 		VkSampler mSampler = VK_NULL_HANDLE;
 	};
@@ -76,7 +129,7 @@ namespace Cosmos
 		VkSampleCountFlagBits mMSAA = VK_SAMPLE_COUNT_1_BIT;
 
 		VkImage mImage = VK_NULL_HANDLE;
-		VkDeviceMemory mMemory = VK_NULL_HANDLE;
+		VKAllocation mMemory = {};
 		VkImageView mView = VK_NULL_HANDLE;
 		VkSampler mSampler = VK_NULL_HANDLE;
 	};
@@ -0,0 +1,81 @@
+#include "epch.h"
+#include "VKTextureStreamer.h"
+
+#include "VKDeletionQueue.h"
+#include "VKDevice.h"
+#include "VKResidency.h"
+#include "VKTexture.h"
+
+namespace Cosmos
+{
+	VKTextureStreamer* VKTextureStreamer::sStreamer = nullptr;
+
+	VKTextureStreamer::VKTextureStreamer(Shared<VKDevice> device)
+		: mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Texture Streamer");
+		sStreamer = this;
+	}
+
+	VKTextureStreamer::~VKTextureStreamer()
+	{
+		sStreamer = nullptr;
+	}
+
+	void VKTextureStreamer::OnUpdate()
+	{
+		PROFILER_FUNCTION();
+
+		mFrame++;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// under memory pressure the least recently used texture loses its most detailed mip, one texture per frame
+		if (VKResidency::GetInstance() && VKResidency::GetInstance()->IsOverBudget())
+		{
+			VKTexture2D* victim = nullptr;
+
+			for (VKTexture2D* texture : mTextures)
+			{
+				if (texture->CanDropMip() && (victim == nullptr || texture->GetLastUsedFrame() < victim->GetLastUsedFrame()))
+					victim = texture;
+			}
+
+			if (victim)
+				victim->DropMip();
+		}
+
+		// finish loads and kick new ones, limiting how many swaps happen per frame
+		uint32_t uploads = 0;
+
+		for (VKTexture2D* texture : mTextures)
+		{
+			if (texture->UpdateStreaming(mFrame, uploads < RENDERER_TEXTURE_STREAMING_UPLOADS_PER_FRAME))
+				uploads++;
+		}
+	}
+
+	void VKTextureStreamer::Register(VKTexture2D* texture)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTextures.push_back(texture);
+	}
+
+	void VKTextureStreamer::Unregister(VKTexture2D* texture)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTextures.erase(std::remove(mTextures.begin(), mTextures.end(), texture), mTextures.end());
+	}
+
+	void VKTextureStreamer::Retire(VkImage image, const VKAllocation& memory, VkImageView view)
+	{
+		VkDevice device = mDevice->GetDevice();
+
+		VKDeletionQueue::GetInstance()->Push([device, image, memory, view]()
+		{
+			vkDestroyImageView(device, view, nullptr);
+			vkDestroyImage(device, image, nullptr);
+			VKAllocator::GetInstance()->Free(memory);
+		});
+	}
+}
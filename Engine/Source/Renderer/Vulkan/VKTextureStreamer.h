@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include "VKAllocator.h"
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+	class VKTexture2D;
+
+	// drives the streamed textures, swapping in higher mips once loaded and releasing the replaced images when the gpu is done with them
+	class VKTextureStreamer
+	{
+	public:
+
+		// constructor
+		VKTextureStreamer(Shared<VKDevice> device);
+
+		// destructor
+		~VKTextureStreamer();
+
+		// returns the texture streamer singleton
+		inline static VKTextureStreamer* GetInstance() { return sStreamer; }
+
+		// returns how many textures are currently being streamed
+		inline size_t GetTextureCount() const { return mTextures.size(); }
+
+		// returns the amount of updates done so far
+		inline uint64_t GetFrame() const { return mFrame; }
+
+	public:
+
+		// must be called once per frame after the frame's fence was waited on, and after the residency was updated
+		void OnUpdate();
+
+		// starts tracking a streamed texture
+		void Register(VKTexture2D* texture);
+
+		// stops tracking a streamed texture
+		void Unregister(VKTexture2D* texture);
+
+		// destroys the image resources through the deletion queue, once every frame in flight that could use them has finished
+		void Retire(VkImage image, const VKAllocation& memory, VkImageView view);
+
+	private:
+
+		static VKTextureStreamer* sStreamer;
+		Shared<VKDevice> mDevice;
+		uint64_t mFrame = 0;
+
+		std::mutex mMutex;
+		std::vector<VKTexture2D*> mTextures = {};
+	};
+}
@@ -0,0 +1,585 @@
+#include "epch.h"
+#include "VKUploader.h"
+
+#include "VKBuffer.h"
+#include "VKDevice.h"
+#include "VKImage.h"
+
+#include <cstring>
+
+namespace Cosmos
+{
+	// staging offsets are aligned to the biggest texel block size, as required by buffer to image copies
+	static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+	VKUploader* VKUploader::sUploader = nullptr;
+
+	VKUploader::VKUploader(Shared<VKDevice> device)
+		: mDevice(device)
+	{
+		LOG_TO_TERMINAL(Logger::Severity::Trace, "Creating Vulkan Uploader");
+		sUploader = this;
+
+		VKDevice::QueueFamilyIndices indices = mDevice->FindQueueFamilies(mDevice->GetPhysicalDevice(), mDevice->GetSurface());
+
+		// without a dedicated family the copies would only compete with the frames on the same hardware queue
+		mAsync = indices.transfer.has_value() && mDevice->IsTimelineSemaphoreSupported();
+		mGraphicsFamily = indices.graphics.value();
+		mTransferFamily = mAsync ? indices.transfer.value() : mGraphicsFamily;
+		mQueue = mAsync ? mDevice->GetTransferQueue() : mDevice->GetGraphicsQueue();
+
+		VkCommandPoolCreateInfo cmdPoolInfo = {};
+		cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolInfo.queueFamilyIndex = mTransferFamily;
+		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		VK_ASSERT(vkCreateCommandPool(mDevice->GetDevice(), &cmdPoolInfo, nullptr, &mCommandPool), "Failed to create uploader command pool");
+
+		if (mAsync)
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Info, "Uploading on the dedicated transfer queue family %d", mTransferFamily);
+
+			VkSemaphoreTypeCreateInfoKHR semaphoreTypeCI = {};
+			semaphoreTypeCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+			semaphoreTypeCI.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+			semaphoreTypeCI.initialValue = 0;
+
+			VkSemaphoreCreateInfo semaphoreCI = {};
+			semaphoreCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			semaphoreCI.pNext = &semaphoreTypeCI;
+			VK_ASSERT(vkCreateSemaphore(mDevice->GetDevice(), &semaphoreCI, nullptr, &mTimeline), "Failed to create upload timeline semaphore");
+
+			// acquires are recorded on the graphics queue
+			VkCommandPoolCreateInfo acquirePoolInfo = {};
+			acquirePoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			acquirePoolInfo.queueFamilyIndex = mGraphicsFamily;
+			acquirePoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+			VK_ASSERT(vkCreateCommandPool(mDevice->GetDevice(), &acquirePoolInfo, nullptr, &mAcquirePool), "Failed to create acquire command pool");
+
+			mAcquireCommandBuffers.resize(RENDERER_MAX_FRAMES_IN_FLIGHT);
+
+			VkCommandBufferAllocateInfo cmdBufferAllocInfo = {};
+			cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			cmdBufferAllocInfo.commandPool = mAcquirePool;
+			cmdBufferAllocInfo.commandBufferCount = (uint32_t)mAcquireCommandBuffers.size();
+			VK_ASSERT(vkAllocateCommandBuffers(mDevice->GetDevice(), &cmdBufferAllocInfo, mAcquireCommandBuffers.data()), "Failed to allocate acquire command buffers");
+		}
+
+		mRingSize = (VkDeviceSize)RENDERER_STAGING_RING_SIZE_MB * 1024 * 1024;
+
+		VK_ASSERT
+		(
+			BufferCreate
+			(
+				mDevice,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				mRingSize,
+				&mRing,
+				&mRingMemory
+			),
+			"Failed to create staging ring"
+		);
+
+		mPending.ticket = 1;
+	}
+
+	VKUploader::~VKUploader()
+	{
+		vkDeviceWaitIdle(mDevice->GetDevice());
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		Reclaim(UINT64_MAX);
+
+		// uploads never submitted only own their temporary buffers
+		for (size_t i = 0; i < mPending.temporaryBuffers.size(); i++)
+		{
+			vkDestroyBuffer(mDevice->GetDevice(), mPending.temporaryBuffers[i], nullptr);
+			VKAllocator::GetInstance()->Free(mPending.temporaryMemories[i]);
+		}
+
+		for (VkFence fence : mFreeFences)
+			vkDestroyFence(mDevice->GetDevice(), fence, nullptr);
+
+		vkDestroyCommandPool(mDevice->GetDevice(), mCommandPool, nullptr);
+
+		if (mAsync)
+		{
+			vkDestroyCommandPool(mDevice->GetDevice(), mAcquirePool, nullptr);
+			vkDestroySemaphore(mDevice->GetDevice(), mTimeline, nullptr);
+		}
+
+		vkDestroyBuffer(mDevice->GetDevice(), mRing, nullptr);
+		VKAllocator::GetInstance()->Free(mRingMemory);
+
+		sUploader = nullptr;
+	}
+
+	uint64_t VKUploader::UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		BufferCopy copy = {};
+		copy.buffer = buffer;
+		copy.source = Stage(data, size, copy.region.srcOffset);
+		copy.region.dstOffset = offset;
+		copy.region.size = size;
+		mBufferCopies.push_back(copy);
+
+		return mPending.ticket;
+	}
+
+	uint64_t VKUploader::UploadImage(VkImage image, const void* data, VkDeviceSize size, const std::vector<VkBufferImageCopy>& regions, VkImageSubresourceRange range, bool generateMipmaps)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		VkDeviceSize offset = 0;
+
+		ImageCopy copy = {};
+		copy.image = image;
+		copy.source = Stage(data, size, offset);
+		copy.range = range;
+		copy.regions = regions;
+		copy.generateMipmaps = generateMipmaps;
+
+		for (VkBufferImageCopy& region : copy.regions)
+			region.bufferOffset += offset;
+
+		mImageCopies.push_back(std::move(copy));
+
+		return mPending.ticket;
+	}
+
+	bool VKUploader::IsComplete(uint64_t ticket)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// async uploads are only usable once the graphics queue has acquired them
+		return mAsync ? ticket <= mAcquired : ticket <= mCompleted;
+	}
+
+	void VKUploader::Require(uint64_t ticket)
+	{
+		uint64_t required = mRequired.load(std::memory_order_relaxed);
+
+		while (ticket > required && !mRequired.compare_exchange_weak(required, ticket, std::memory_order_relaxed));
+	}
+
+	VkCommandBuffer VKUploader::RecordAcquires(uint32_t frame, uint64_t& waitValue)
+	{
+		PROFILER_FUNCTION();
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		uint64_t required = mRequired.exchange(0);
+		waitValue = 0;
+
+		if (!mAsync)
+			return VK_NULL_HANDLE;
+
+		// uploads requested while the frame was recorded go out now, the frame waits for them on the gpu
+		if (required >= mPending.ticket)
+			Submit();
+
+		Reclaim(0);
+
+		// finished uploads are acquired even if unused, so that whatever samples them later needs no wait
+		uint64_t target = std::max(required, mCompleted);
+
+		if (mAcquires.empty() || mAcquires.front().ticket > target)
+			return VK_NULL_HANDLE;
+
+		VkCommandBuffer commandBuffer = mAcquireCommandBuffers[frame];
+
+		VkCommandBufferBeginInfo cmdBufferBeginInfo = {};
+		cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		cmdBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_ASSERT(vkBeginCommandBuffer(commandBuffer, &cmdBufferBeginInfo), "Failed to begin the acquire command buffer");
+
+		waitValue = RecordAcquires(commandBuffer, target);
+
+		VK_ASSERT(vkEndCommandBuffer(commandBuffer), "Failed to end the acquire command buffer");
+
+		return commandBuffer;
+	}
+
+	void VKUploader::Wait(uint64_t ticket)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if (ticket <= mCompleted && (!mAsync || ticket <= mAcquired))
+			return;
+
+		if (ticket >= mPending.ticket)
+			Submit();
+
+		Reclaim(ticket);
+
+		if (!mAsync || ticket <= mAcquired)
+			return;
+
+		// the resources are about to be used or destroyed on the host, the graphics queue must own them right away
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+		VkCommandBufferAllocateInfo cmdBufferAllocInfo = {};
+		cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cmdBufferAllocInfo.commandPool = mAcquirePool;
+		cmdBufferAllocInfo.commandBufferCount = 1;
+		VK_ASSERT(vkAllocateCommandBuffers(mDevice->GetDevice(), &cmdBufferAllocInfo, &commandBuffer), "Failed to allocate acquire command buffer");
+
+		VkCommandBufferBeginInfo cmdBufferBeginInfo = {};
+		cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		cmdBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_ASSERT(vkBeginCommandBuffer(commandBuffer, &cmdBufferBeginInfo), "Failed to begin the acquire command buffer");
+
+		RecordAcquires(commandBuffer, ticket);
+
+		VK_ASSERT(vkEndCommandBuffer(commandBuffer), "Failed to end the acquire command buffer");
+
+		// the transfers are known to be finished, no semaphore wait is needed
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		VK_ASSERT(vkQueueSubmit(mDevice->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE), "Failed to submit acquires");
+		vkQueueWaitIdle(mDevice->GetGraphicsQueue());
+
+		vkFreeCommandBuffers(mDevice->GetDevice(), mAcquirePool, 1, &commandBuffer);
+	}
+
+	void VKUploader::Flush()
+	{
+		PROFILER_FUNCTION();
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		Reclaim(0);
+		Submit();
+	}
+
+	VkBuffer VKUploader::Stage(const void* data, VkDeviceSize size, VkDeviceSize& offset)
+	{
+		if (mRingUsed == 0)
+		{
+			mRingHead = 0;
+			mRingTail = 0;
+		}
+
+		VkDeviceSize aligned = (mRingHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+		VkDeviceSize consumed = 0;
+		bool fits = false;
+
+		// the free space is either [head, end) plus [0, tail) or [head, tail) once the head has wrapped, head == tail means full
+		if (mRingUsed == 0 || mRingHead > mRingTail)
+		{
+			if (aligned + size <= mRingSize)
+			{
+				consumed = aligned + size - mRingHead;
+				fits = true;
+			}
+
+			else if (size <= mRingTail)
+			{
+				consumed = (mRingSize - mRingHead) + size;
+				aligned = 0;
+				fits = true;
+			}
+		}
+
+		else if (mRingHead < mRingTail && aligned + size <= mRingTail)
+		{
+			consumed = aligned + size - mRingHead;
+			fits = true;
+		}
+
+		if (fits)
+		{
+			memcpy((uint8_t*)mRingMemory.mapped + aligned, data, (size_t)size);
+
+			mRingHead = aligned + size;
+			mRingUsed += consumed;
+			mPending.ringBytes += consumed;
+
+			offset = aligned;
+			return mRing;
+		}
+
+		// the ring is busy with uploads in flight (or the data is bigger than it), stage it on its own buffer
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VKAllocation memory = {};
+
+		VK_ASSERT
+		(
+			BufferCreate
+			(
+				mDevice,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				size,
+				&buffer,
+				&memory,
+				const_cast<void*>(data)
+			),
+			"Failed to create temporary staging buffer"
+		);
+
+		mPending.temporaryBuffers.push_back(buffer);
+		mPending.temporaryMemories.push_back(memory);
+
+		offset = 0;
+		return buffer;
+	}
+
+	void VKUploader::Submit()
+	{
+		if (mBufferCopies.empty() && mImageCopies.empty())
+			return;
+
+		VkCommandBufferAllocateInfo cmdBufferAllocInfo = {};
+		cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cmdBufferAllocInfo.commandPool = mCommandPool;
+		cmdBufferAllocInfo.commandBufferCount = 1;
+		VK_ASSERT(vkAllocateCommandBuffers(mDevice->GetDevice(), &cmdBufferAllocInfo, &mPending.commandBuffer), "Failed to allocate upload command buffer");
+
+		VkCommandBufferBeginInfo cmdBufferBeginInfo = {};
+		cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		cmdBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(mPending.commandBuffer, &cmdBufferBeginInfo);
+
+		// async batches release the resources to the graphics queue, which acquires them before their first use
+		std::vector<VkBufferMemoryBarrier> bufferReleases = {};
+		std::vector<VkImageMemoryBarrier> imageReleases = {};
+		Acquire acquire = {};
+		acquire.ticket = mPending.ticket;
+
+		for (BufferCopy& copy : mBufferCopies)
+		{
+			vkCmdCopyBuffer(mPending.commandBuffer, copy.source, copy.buffer, 1, &copy.region);
+
+			if (!mAsync)
+				continue;
+
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.srcQueueFamilyIndex = mTransferFamily;
+			barrier.dstQueueFamilyIndex = mGraphicsFamily;
+			barrier.buffer = copy.buffer;
+			barrier.offset = copy.region.dstOffset;
+			barrier.size = copy.region.size;
+			bufferReleases.push_back(barrier);
+
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+			acquire.buffers.push_back(barrier);
+		}
+
+		for (ImageCopy& copy : mImageCopies)
+		{
+			InsertImageMemoryBarrier
+			(
+				mPending.commandBuffer,
+				copy.image,
+				0,
+				VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				copy.range
+			);
+
+			vkCmdCopyBufferToImage(mPending.commandBuffer, copy.source, copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copy.regions.size(), copy.regions.data());
+
+			if (mAsync)
+			{
+				// mipmaps are blitted from the first level, the whole range stays a transfer destination until then
+				VkImageMemoryBarrier barrier = {};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = 0;
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				barrier.newLayout = copy.generateMipmaps ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				barrier.srcQueueFamilyIndex = mTransferFamily;
+				barrier.dstQueueFamilyIndex = mGraphicsFamily;
+				barrier.image = copy.image;
+				barrier.subresourceRange = copy.range;
+				imageReleases.push_back(barrier);
+
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = copy.generateMipmaps ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+				acquire.images.push_back(barrier);
+
+				if (copy.generateMipmaps)
+					acquire.mipmaps.push_back(copy);
+
+				continue;
+			}
+
+			if (copy.generateMipmaps)
+			{
+				GenerateMipmaps(mPending.commandBuffer, copy.image, (int32_t)copy.regions[0].imageExtent.width, (int32_t)copy.regions[0].imageExtent.height, copy.range.levelCount);
+				continue;
+			}
+
+			InsertImageMemoryBarrier
+			(
+				mPending.commandBuffer,
+				copy.image,
+				VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				copy.range
+			);
+		}
+
+		if (mAsync)
+		{
+			vkCmdPipelineBarrier
+			(
+				mPending.commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+				0,
+				0, nullptr,
+				(uint32_t)bufferReleases.size(), bufferReleases.data(),
+				(uint32_t)imageReleases.size(), imageReleases.data()
+			);
+
+			mAcquires.push_back(std::move(acquire));
+		}
+
+		else
+		{
+			// later submissions on the queue may read the buffers right away
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier
+			(
+				mPending.commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				0,
+				1, &memoryBarrier,
+				0, nullptr,
+				0, nullptr
+			);
+		}
+
+		VK_ASSERT(vkEndCommandBuffer(mPending.commandBuffer), "Failed to end the upload command buffer");
+
+		if (mFreeFences.empty())
+		{
+			VkFenceCreateInfo fenceCI = {};
+			fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			fenceCI.flags = 0;
+
+			VkFence fence = VK_NULL_HANDLE;
+			VK_ASSERT(vkCreateFence(mDevice->GetDevice(), &fenceCI, nullptr, &fence), "Failed to create upload fence");
+			mFreeFences.push_back(fence);
+		}
+
+		mPending.fence = mFreeFences.back();
+		mFreeFences.pop_back();
+
+		// the timeline reaches the batch's ticket once its copies are done
+		VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &mPending.ticket;
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = mAsync ? &timelineInfo : nullptr;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &mPending.commandBuffer;
+		submitInfo.signalSemaphoreCount = mAsync ? 1 : 0;
+		submitInfo.pSignalSemaphores = &mTimeline;
+		VK_ASSERT(vkQueueSubmit(mQueue, 1, &submitInfo, mPending.fence), "Failed to submit uploads");
+
+		mPending.ringEnd = mRingHead;
+		mBufferCopies.clear();
+		mImageCopies.clear();
+
+		uint64_t ticket = mPending.ticket;
+		mInFlight.push_back(std::move(mPending));
+		mPending = {};
+		mPending.ticket = ticket + 1;
+	}
+
+	void VKUploader::Reclaim(uint64_t wait)
+	{
+		while (!mInFlight.empty())
+		{
+			Batch& batch = mInFlight.front();
+
+			if (batch.ticket <= wait)
+				vkWaitForFences(mDevice->GetDevice(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+
+			else if (vkGetFenceStatus(mDevice->GetDevice(), batch.fence) != VK_SUCCESS)
+				break;
+
+			for (size_t i = 0; i < batch.temporaryBuffers.size(); i++)
+			{
+				vkDestroyBuffer(mDevice->GetDevice(), batch.temporaryBuffers[i], nullptr);
+				VKAllocator::GetInstance()->Free(batch.temporaryMemories[i]);
+			}
+
+			vkResetFences(mDevice->GetDevice(), 1, &batch.fence);
+			mFreeFences.push_back(batch.fence);
+			vkFreeCommandBuffers(mDevice->GetDevice(), mCommandPool, 1, &batch.commandBuffer);
+
+			mRingTail = batch.ringEnd;
+			mRingUsed -= batch.ringBytes;
+			mCompleted = batch.ticket;
+
+			mInFlight.pop_front();
+		}
+	}
+
+	uint64_t VKUploader::RecordAcquires(VkCommandBuffer commandBuffer, uint64_t ticket)
+	{
+		std::vector<VkBufferMemoryBarrier> buffers = {};
+		std::vector<VkImageMemoryBarrier> images = {};
+		std::vector<ImageCopy> mipmaps = {};
+		uint64_t last = 0;
+
+		while (!mAcquires.empty() && mAcquires.front().ticket <= ticket)
+		{
+			Acquire& acquire = mAcquires.front();
+			buffers.insert(buffers.end(), acquire.buffers.begin(), acquire.buffers.end());
+			images.insert(images.end(), acquire.images.begin(), acquire.images.end());
+			mipmaps.insert(mipmaps.end(), acquire.mipmaps.begin(), acquire.mipmaps.end());
+			last = acquire.ticket;
+
+			mAcquires.pop_front();
+		}
+
+		// the frame waits for the timeline at the transfer stage, which comes before anything reading the resources
+		vkCmdPipelineBarrier
+		(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0,
+			0, nullptr,
+			(uint32_t)buffers.size(), buffers.data(),
+			(uint32_t)images.size(), images.data()
+		);
+
+		for (ImageCopy& copy : mipmaps)
+			GenerateMipmaps(commandBuffer, copy.image, (int32_t)copy.regions[0].imageExtent.width, (int32_t)copy.regions[0].imageExtent.height, copy.range.levelCount);
+
+		mAcquired = std::max(mAcquired, last);
+		return last;
+	}
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Defines.h"
+#include "Util/Memory.h"
+#include "VKAllocator.h"
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace Cosmos
+{
+	// forward declarations
+	class VKDevice;
+
+	// copies data into device-local buffers and images through a persistently mapped staging ring
+	// uploads may be requested from any thread, they're recorded into a single command buffer once per frame by Flush
+	// uploads requested on the main thread before the renderer's update are visible to that frame's draws
+	// when the device has a transfer-only queue family and timeline semaphores the batches run on the copy engine instead
+	// of the graphics queue, each one signaling its ticket on a timeline semaphore, and the frames only wait for the tickets they require
+	class VKUploader
+	{
+	public:
+
+		struct ImageCopy
+		{
+			VkImage image = VK_NULL_HANDLE;
+			VkBuffer source = VK_NULL_HANDLE;
+			VkImageSubresourceRange range = {};
+			std::vector<VkBufferImageCopy> regions = {};
+			bool generateMipmaps = false;
+		};
+
+		struct BufferCopy
+		{
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkBuffer source = VK_NULL_HANDLE;
+			VkBufferCopy region = {};
+		};
+
+		struct Batch
+		{
+			uint64_t ticket = 0;					// uploads of this batch are complete once this ticket is
+			VkFence fence = VK_NULL_HANDLE;
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkDeviceSize ringEnd = 0;				// ring head when the batch was submitted, becomes the tail once complete
+			VkDeviceSize ringBytes = 0;				// ring bytes used by the batch, including the wasted space when wrapping
+			std::vector<VkBuffer> temporaryBuffers = {};
+			std::vector<VKAllocation> temporaryMemories = {};
+		};
+
+		struct Acquire
+		{
+			uint64_t ticket = 0;					// ticket of the batch that released the resources to the graphics queue
+			std::vector<VkBufferMemoryBarrier> buffers = {};
+			std::vector<VkImageMemoryBarrier> images = {};
+			std::vector<ImageCopy> mipmaps = {};	// images whose mipmaps are blitted once acquired, the transfer queue can't blit
+		};
+
+	public:
+
+		// constructor
+		VKUploader(Shared<VKDevice> device);
+
+		// destructor
+		~VKUploader();
+
+		// returns the uploader singleton
+		inline static VKUploader* GetInstance() { return sUploader; }
+
+		// returns if uploads run on a dedicated transfer queue
+		inline bool IsAsync() const { return mAsync; }
+
+		// returns the timeline semaphore signaled with each batch's ticket, VK_NULL_HANDLE when uploads aren't async
+		inline VkSemaphore GetTimeline() const { return mTimeline; }
+
+	public:
+
+		// copies data into a buffer created with VK_BUFFER_USAGE_TRANSFER_DST_BIT, returns the ticket of the upload
+		uint64_t UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+
+		// copies tightly packed data into an image in VK_IMAGE_LAYOUT_UNDEFINED, regions' buffer offsets are relative to the data
+		// the range is left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, returns the ticket of the upload
+		// when generating mipmaps the regions only fill the first level of the first layer and the image needs VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+		uint64_t UploadImage(VkImage image, const void* data, VkDeviceSize size, const std::vector<VkBufferImageCopy>& regions, VkImageSubresourceRange range, bool generateMipmaps = false);
+
+		// returns if the uploads of a ticket have finished on the gpu and may be used by any frame
+		bool IsComplete(uint64_t ticket);
+
+		// marks the uploads of a ticket as used by the frame being recorded, which then waits for them on the gpu
+		void Require(uint64_t ticket);
+
+		// records the queue ownership acquires of every finished or required upload into a command buffer owned by the frame (main thread only)
+		// returns VK_NULL_HANDLE when there's nothing to acquire, otherwise the frame must execute it first and wait for the timeline to reach waitValue
+		VkCommandBuffer RecordAcquires(uint32_t frame, uint64_t& waitValue);
+
+		// blocks until the uploads of a ticket have finished, submitting them first if required (main thread only)
+		void Wait(uint64_t ticket);
+
+		// reclaims the finished batches and submits the pending uploads (main thread only)
+		void Flush();
+
+	private:
+
+		// reserves space on the ring for the pending batch, falls back to a temporary buffer when the ring is full
+		// must be called with the mutex locked
+		VkBuffer Stage(const void* data, VkDeviceSize size, VkDeviceSize& offset);
+
+		// records the pending uploads into a command buffer and submits it
+		// must be called with the mutex locked
+		void Submit();
+
+		// releases the resources of the batches the gpu is done with, waiting for the ones up to a ticket
+		// must be called with the mutex locked
+		void Reclaim(uint64_t wait);
+
+		// records the acquires of the batches up to a ticket, returns the ticket of the last one recorded
+		// must be called with the mutex locked
+		uint64_t RecordAcquires(VkCommandBuffer commandBuffer, uint64_t ticket);
+
+	private:
+
+		static VKUploader* sUploader;
+		Shared<VKDevice> mDevice;
+		VkCommandPool mCommandPool = VK_NULL_HANDLE;
+		std::vector<VkFence> mFreeFences = {};
+		VkQueue mQueue = VK_NULL_HANDLE;
+		uint32_t mTransferFamily = 0;
+		uint32_t mGraphicsFamily = 0;
+
+		// async uploads
+		bool mAsync = false;
+		VkSemaphore mTimeline = VK_NULL_HANDLE;
+		VkCommandPool mAcquirePool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> mAcquireCommandBuffers = {};
+		std::deque<Acquire> mAcquires = {};
+		std::atomic<uint64_t> mRequired = 0;
+		uint64_t mAcquired = 0;
+
+		std::mutex mMutex;
+		VkBuffer mRing = VK_NULL_HANDLE;
+		VKAllocation mRingMemory = {};
+		VkDeviceSize mRingSize = 0;
+		VkDeviceSize mRingHead = 0;
+		VkDeviceSize mRingTail = 0;
+		VkDeviceSize mRingUsed = 0;
+
+		Batch mPending = {};
+		std::vector<BufferCopy> mBufferCopies = {};
+		std::vector<ImageCopy> mImageCopies = {};
+		std::deque<Batch> mInFlight = {};
+		uint64_t mCompleted = 0;
+	};
+}
@@ -60,4 +60,26 @@ namespace Cosmos
 
         return VISCI;
     }
+
+    VkVertexInputBindingDescription VKVertex::GetInstanceBindingDescription()
+    {
+        VkVertexInputBindingDescription binding = {};
+        binding.binding = 1;
+        binding.stride = sizeof(glm::mat4);
+        binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return binding;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> VKVertex::GetInstanceAttributeDescriptions(uint32_t firstLocation)
+    {
+        std::vector<VkVertexInputAttributeDescription> result = {};
+
+        for (uint32_t column = 0; column < 4; column++)
+        {
+            result.push_back(VkVertexInputAttributeDescription({ firstLocation + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT, column * (uint32_t)sizeof(glm::vec4) }));
+        }
+
+        return result;
+    }
 }
\ No newline at end of file
@@ -49,5 +49,11 @@ namespace Cosmos
 
         // returns the pipeline vertex input state based on desired components
         static VkPipelineVertexInputStateCreateInfo GetPipelineVertexInputState(const std::vector<VKVertex::Component> components);
+
+        // returns the binding of per-instance model matrices, read from binding 1 by instanced pipelines
+        static VkVertexInputBindingDescription GetInstanceBindingDescription();
+
+        // returns the attributes of a per-instance model matrix, one vec4 column per location starting at the given one
+        static std::vector<VkVertexInputAttributeDescription> GetInstanceAttributeDescriptions(uint32_t firstLocation);
     }; 
 }
\ No newline at end of file
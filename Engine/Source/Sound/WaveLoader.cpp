@@ -1,6 +1,8 @@
 #include "epch.h"
 #include "WaveLoader.h"
 
+#include "Util/FileSystem.h"
+
 #include <cstring>
 #include <fstream>
 #include <iterator>
@@ -17,19 +19,16 @@ namespace Cosmos::sound
 
     bool WaveLoader::Load(std::string filePath)
     {
-        std::ifstream file(filePath, std::ios::binary);
+        // reads from the mounted archive or from disk
+        std::vector<uint8_t> fileData = ReadFromBinary(filePath);
 
         // check the file exists
-        if (!file.good())
+        if (fileData.empty())
         {
-            LOG_TO_TERMINAL(Logger::Error, "Could not open file %s", filePath);
+            LOG_TO_TERMINAL(Logger::Error, "Could not open file %s", filePath.c_str());
             return false;
         }
 
-        file.unsetf(std::ios::skipws);
-        std::istream_iterator<uint8_t> begin(file), end;
-        std::vector<uint8_t> fileData(begin, end);
-
         return DecodeWaveFile(fileData);
     }
 
@@ -9,6 +9,7 @@
 #include "Renderer/Renderer.h"
 #include "Renderer/Vulkan/VKBuffer.h"
 #include "Renderer/Vulkan/VKCommander.h"
+#include "Renderer/Vulkan/VKRenderGraph.h"
 #include "Renderer/Vulkan/VKRenderer.h"
 
 #include "Util/FileSystem.h"
@@ -31,10 +32,26 @@ namespace Cosmos
 
 		CreateResources();
 		SetupConfiguration();
+
+		// the interface is drawn over the backbuffer and leaves it ready to present
+		VKRenderGraph::Pass pass = {};
+		pass.name = "ImGui";
+		pass.reads = { { "Backbuffer", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL } };
+		pass.writes = { { "Backbuffer", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR } };
+		pass.attachments = { "Backbuffer" };
+		pass.clearValues.resize(1);
+		pass.clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+		pass.record = [this](VkCommandBuffer cmdBuffer) { Draw(cmdBuffer); };
+		VKRenderGraph::GetInstance()->AddPass(pass);
 	}
 
 	GUI::~GUI()
 	{
+		if (VKRenderGraph::GetInstance())
+		{
+			VKRenderGraph::GetInstance()->RemovePass("ImGui");
+		}
+
 		ImGui_ImplVulkan_Shutdown();
 		ImGui_ImplSDL2_Shutdown();
 		ImGui::DestroyContext();
@@ -76,45 +93,6 @@ namespace Cosmos
 
 	void GUI::OnEvent(Shared<Event> event)
 	{
-		if (event->GetType() == EventType::WindowResize)
-		{
-			vkDeviceWaitIdle(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice());
-
-			// recreate frame buffers
-			for (auto framebuffer : VKCommander::GetInstance()->GetEntriesRef()["ImGui"]->frameBuffers)
-			{
-				vkDestroyFramebuffer(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), framebuffer, nullptr);
-			}
-
-			VKCommander::GetInstance()->GetEntriesRef()["ImGui"]->frameBuffers.resize(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetImageViews().size());
-
-			for (size_t i = 0; i < std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetImageViews().size(); i++)
-			{
-				VkImageView attachments[] = { std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetImageViews()[i] };
-
-				VkFramebufferCreateInfo framebufferCI = {};
-				framebufferCI.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-				framebufferCI.renderPass = VKCommander::GetInstance()->GetEntriesRef()["ImGui"]->renderPass;
-				framebufferCI.attachmentCount = 1;
-				framebufferCI.pAttachments = attachments;
-				framebufferCI.width = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetExtent().width;
-				framebufferCI.height = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetExtent().height;
-				framebufferCI.layers = 1;
-
-				VK_ASSERT
-				(
-					vkCreateFramebuffer
-					(
-						std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(),
-						&framebufferCI,
-						nullptr,
-						&VKCommander::GetInstance()->GetEntriesRef()["ImGui"]->frameBuffers[i]
-					),
-					"Failed to create framebuffer"
-				);
-			}
-		}
-
 		for (Widget* widget : mWidgetStack)
 		{
 			widget->OnEvent(event);
@@ -306,37 +284,6 @@ namespace Cosmos
 				"Failed to allocate command buffers"
 			);
 		}
-
-		// frame buffers
-		{
-			VKCommander::GetInstance()->GetEntriesRef()["ImGui"]->frameBuffers.resize(std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetImageViews().size());
-
-			for (size_t i = 0; i < std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetImageViews().size(); i++)
-			{
-				VkImageView attachments[] = { std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetImageViews()[i] };
-
-				VkFramebufferCreateInfo framebufferCI = {};
-				framebufferCI.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-				framebufferCI.renderPass = VKCommander::GetInstance()->GetEntriesRef()["ImGui"]->renderPass;
-				framebufferCI.attachmentCount = 1;
-				framebufferCI.pAttachments = attachments;
-				framebufferCI.width = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetExtent().width;
-				framebufferCI.height = std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetSwapchain()->GetExtent().height;
-				framebufferCI.layers = 1;
-
-				VK_ASSERT
-				(
-					vkCreateFramebuffer
-					(
-						std::dynamic_pointer_cast<VKRenderer>(mRenderer)->GetDevice()->GetDevice(), 
-						&framebufferCI, 
-						nullptr, 
-						&VKCommander::GetInstance()->GetEntriesRef()["ImGui"]->frameBuffers[i]
-					), 
-					"Failed to create framebuffer"
-				);
-			}
-		}
 	}
 
 	void GUI::HandleInternalEvent(SDL_Event* e)
@@ -0,0 +1,388 @@
+#include "epch.h"
+#include "Archive.h"
+
+#include "Compression.h"
+#include "FileSystem.h"
+#include "Util.h"
+
+#include <cstring>
+
+#if defined(PLATFORM_WINDOWS)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Cosmos
+{
+	Archive::~Archive()
+	{
+		Close();
+	}
+
+	bool Archive::Build(std::string folder, std::string output, bool compress)
+	{
+		struct Pending
+		{
+			std::string path;
+			uint64_t hash;
+			Codec codec;
+			uint64_t size;
+			std::vector<uint8_t> data;
+		};
+
+		if (!std::filesystem::is_directory(folder))
+		{
+			LOG_TO_TERMINAL(Logger::Error, "Cannot build archive, %s is not a directory", folder.c_str());
+			return false;
+		}
+
+		// gather and (optionally) compress every file
+		std::vector<Pending> pending = {};
+
+		for (const std::filesystem::directory_entry& dirEntry : std::filesystem::recursive_directory_iterator(folder))
+		{
+			if (!dirEntry.is_regular_file())
+				continue;
+
+			std::string relative = std::filesystem::relative(dirEntry.path(), folder).string();
+			Cosmos::replace(relative.begin(), relative.end(), '\\', '/');
+
+			Pending file = {};
+			file.path = relative;
+			file.hash = HashPath(relative);
+			file.codec = Codec::None;
+
+			std::ifstream stream(dirEntry.path(), std::ios::in | std::ios::binary);
+			file.data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+			file.size = file.data.size();
+
+			if (compress && file.size >= ARCHIVE_MIN_COMPRESS_SIZE)
+			{
+				std::vector<uint8_t> compressed(lz4::CompressBound(file.data.size()));
+				size_t compressedSize = lz4::Compress(file.data.data(), file.data.size(), compressed.data(), compressed.size());
+
+				// only keep the compressed form when it saves at least an eighth of the size
+				if (compressedSize > 0 && compressedSize < file.size - (file.size / 8))
+				{
+					compressed.resize(compressedSize);
+					file.data = std::move(compressed);
+					file.codec = Codec::LZ4;
+				}
+			}
+
+			pending.push_back(std::move(file));
+		}
+
+		std::sort(pending.begin(), pending.end(), [](const Pending& a, const Pending& b) { return a.hash != b.hash ? a.hash < b.hash : a.path < b.path; });
+
+		// write into a temporary file and swap it in place only when done
+		std::string temporary = output + ".tmp";
+		std::ofstream file(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			LOG_TO_TERMINAL(Logger::Error, "Error when opening file %s for writting", temporary.c_str());
+			return false;
+		}
+
+		auto align = [](uint64_t value) { return (value + ARCHIVE_ENTRY_ALIGNMENT - 1) & ~((uint64_t)ARCHIVE_ENTRY_ALIGNMENT - 1); };
+		const char padding[ARCHIVE_ENTRY_ALIGNMENT] = {};
+
+		Header header = {};
+		header.entryCount = (uint32_t)pending.size();
+
+		std::vector<Entry> entries(pending.size());
+		std::string strings = {};
+		uint64_t offset = align(sizeof(Header));
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		file.write(padding, offset - sizeof(Header));
+
+		for (size_t i = 0; i < pending.size(); i++)
+		{
+			entries[i].hash = pending[i].hash;
+			entries[i].offset = offset;
+			entries[i].storedSize = pending[i].data.size();
+			entries[i].size = pending[i].size;
+			entries[i].pathOffset = (uint32_t)strings.size();
+			entries[i].pathLength = (uint32_t)pending[i].path.size();
+			entries[i].codec = pending[i].codec;
+			strings.append(pending[i].path);
+
+			file.write(reinterpret_cast<const char*>(pending[i].data.data()), pending[i].data.size());
+
+			uint64_t next = align(offset + pending[i].data.size());
+			file.write(padding, next - (offset + pending[i].data.size()));
+			offset = next;
+		}
+
+		header.indexOffset = offset;
+		header.stringsOffset = offset + entries.size() * sizeof(Entry);
+
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+		file.write(strings.data(), strings.size());
+
+		// rewrite the header now that the offsets are known
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		file.close();
+
+		std::error_code error;
+		std::filesystem::rename(temporary, output, error);
+
+		if (error)
+		{
+			LOG_TO_TERMINAL(Logger::Error, "Failed to move archive %s into %s: %s", temporary.c_str(), output.c_str(), error.message().c_str());
+			return false;
+		}
+
+		LOG_TO_TERMINAL(Logger::Info, "Built archive %s with %d entries", output.c_str(), (int32_t)entries.size());
+		return true;
+	}
+
+	std::string Archive::NormalizePath(std::string path)
+	{
+		Cosmos::replace(path.begin(), path.end(), '\\', '/');
+
+		while (path.rfind("./", 0) == 0)
+			path.erase(0, 2);
+
+		std::string assets = GetAssetDir();
+
+		if (path.rfind(assets, 0) == 0)
+			path.erase(0, assets.size());
+
+		return path;
+	}
+
+	uint64_t Archive::HashPath(const std::string& path)
+	{
+		// fnv-1a
+		uint64_t hash = 14695981039346656037ull;
+
+		for (char c : path)
+		{
+			hash ^= (uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	bool Archive::Open(std::string path)
+	{
+		Close();
+
+#if defined(PLATFORM_WINDOWS)
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size = {};
+		GetFileSizeEx(file, &size);
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (mapping == nullptr)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		mData = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		mSize = (size_t)size.QuadPart;
+		mFileHandle = file;
+		mMappingHandle = mapping;
+
+		if (mData == nullptr)
+		{
+			Close();
+			return false;
+		}
+#else
+		int32_t fd = open(path.c_str(), O_RDONLY);
+
+		if (fd < 0)
+			return false;
+
+		struct stat info = {};
+
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			close(fd);
+			return false;
+		}
+
+		void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping keeps the file alive
+
+		if (mapped == MAP_FAILED)
+			return false;
+
+		mData = (uint8_t*)mapped;
+		mSize = (size_t)info.st_size;
+#endif
+
+		// validate the archive before trusting any offsets
+		mHeader = reinterpret_cast<const Header*>(mData);
+
+		if (mSize < sizeof(Header) || memcmp(mHeader->magic, "CPAK", 4) != 0 || mHeader->version != Header().version)
+		{
+			LOG_TO_TERMINAL(Logger::Error, "%s is not a valid archive", path.c_str());
+			Close();
+			return false;
+		}
+
+		uint64_t indexSize = (uint64_t)mHeader->entryCount * sizeof(Entry);
+
+		if (mHeader->indexOffset + indexSize > mSize || mHeader->stringsOffset > mSize || mHeader->stringsOffset < mHeader->indexOffset + indexSize)
+		{
+			LOG_TO_TERMINAL(Logger::Error, "Archive %s is truncated", path.c_str());
+			Close();
+			return false;
+		}
+
+		mEntries = reinterpret_cast<const Entry*>(mData + mHeader->indexOffset);
+		mStrings = reinterpret_cast<const char*>(mData + mHeader->stringsOffset);
+		mPath = path;
+
+		LOG_TO_TERMINAL(Logger::Trace, "Mounted archive %s with %d entries", path.c_str(), (int32_t)mHeader->entryCount);
+		return true;
+	}
+
+	void Archive::Close()
+	{
+		if (mData != nullptr)
+		{
+#if defined(PLATFORM_WINDOWS)
+			UnmapViewOfFile(mData);
+#else
+			munmap(mData, mSize);
+#endif
+		}
+
+#if defined(PLATFORM_WINDOWS)
+		if (mMappingHandle) CloseHandle((HANDLE)mMappingHandle);
+		if (mFileHandle) CloseHandle((HANDLE)mFileHandle);
+		mMappingHandle = nullptr;
+		mFileHandle = nullptr;
+#endif
+
+		mData = nullptr;
+		mSize = 0;
+		mHeader = nullptr;
+		mEntries = nullptr;
+		mStrings = nullptr;
+		mPath.clear();
+	}
+
+	bool Archive::Exists(std::string path) const
+	{
+		return Find(NormalizePath(path)) != nullptr;
+	}
+
+	bool Archive::Read(std::string path, std::vector<uint8_t>& output) const
+	{
+		const Entry* entry = Find(NormalizePath(path));
+
+		if (entry == nullptr)
+			return false;
+
+		const uint8_t* stored = mData + entry->offset;
+		output.resize((size_t)entry->size);
+
+		switch (entry->codec)
+		{
+			case Codec::None:
+			{
+				memcpy(output.data(), stored, (size_t)entry->size);
+				return true;
+			}
+
+			case Codec::LZ4:
+			{
+				if (lz4::Decompress(stored, (size_t)entry->storedSize, output.data(), output.size()))
+					return true;
+
+				LOG_TO_TERMINAL(Logger::Error, "Archive entry %s is corrupted", path.c_str());
+				output.clear();
+				return false;
+			}
+		}
+
+		LOG_TO_TERMINAL(Logger::Error, "Archive entry %s uses an unknown codec %d", path.c_str(), (int32_t)entry->codec);
+		output.clear();
+		return false;
+	}
+
+	bool Archive::ReadRange(std::string path, uint64_t offset, uint64_t size, std::vector<uint8_t>& output) const
+	{
+		const Entry* entry = Find(NormalizePath(path));
+
+		if (entry == nullptr || size > entry->size || offset > entry->size - size)
+			return false;
+
+		if (entry->codec == Codec::None)
+		{
+			output.resize((size_t)size);
+			memcpy(output.data(), mData + entry->offset + offset, (size_t)size);
+			return true;
+		}
+
+		std::vector<uint8_t> whole;
+
+		if (!Read(path, whole))
+			return false;
+
+		output.assign(whole.begin() + (size_t)offset, whole.begin() + (size_t)(offset + size));
+		return true;
+	}
+
+	const uint8_t* Archive::View(std::string path, size_t* size) const
+	{
+		const Entry* entry = Find(NormalizePath(path));
+
+		if (entry == nullptr || entry->codec != Codec::None)
+			return nullptr;
+
+		if (size) *size = (size_t)entry->size;
+		return mData + entry->offset;
+	}
+
+	const Archive::Entry* Archive::Find(const std::string& normalized) const
+	{
+		if (!IsOpen())
+			return nullptr;
+
+		uint64_t hash = HashPath(normalized);
+		const Entry* begin = mEntries;
+		const Entry* end = mEntries + mHeader->entryCount;
+		const Entry* it = std::lower_bound(begin, end, hash, [](const Entry& entry, uint64_t value) { return entry.hash < value; });
+
+		// walk over colliding hashes comparing the stored paths
+		for (; it != end && it->hash == hash; it++)
+		{
+			if (it->pathOffset + (uint64_t)it->pathLength > mSize - mHeader->stringsOffset)
+				continue;
+
+			if (it->pathLength == normalized.size() && memcmp(mStrings + it->pathOffset, normalized.data(), normalized.size()) == 0)
+			{
+				if (it->storedSize > mSize || it->offset > mSize - it->storedSize)
+					return nullptr;
+
+				// uncompressed entries are read and viewed with their size, which must then be what's stored
+				if (it->codec == Codec::None && it->size != it->storedSize)
+					return nullptr;
+
+				return it;
+			}
+		}
+
+		return nullptr;
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Defines.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// archive files have their data aligned to this boundary, allowing zero-copy reads of uncompressed entries
+#define ARCHIVE_ENTRY_ALIGNMENT 64
+
+// entries smaller than this are never compressed, the codec overhead isn't worth it
+#define ARCHIVE_MIN_COMPRESS_SIZE 256
+
+namespace Cosmos
+{
+	// packed asset archive (.cpak), a single memory-mapped file holding every asset with a sorted hash index
+	class Archive
+	{
+	public:
+
+		typedef enum Codec : uint32_t
+		{
+			None = 0,
+			LZ4 = 1
+		} Codec;
+
+		struct Header
+		{
+			char magic[4] = { 'C', 'P', 'A', 'K' };
+			uint32_t version = 1;
+			uint32_t entryCount = 0;
+			uint32_t reserved = 0;
+			uint64_t indexOffset = 0;
+			uint64_t stringsOffset = 0;
+		};
+
+		struct Entry
+		{
+			uint64_t hash = 0;			// hash of the normalized path, the index is sorted by it
+			uint64_t offset = 0;		// offset of the data from the begining of the file
+			uint64_t storedSize = 0;	// size of the data inside the archive
+			uint64_t size = 0;			// size of the data after decompression
+			uint32_t pathOffset = 0;	// offset of the path inside the strings table
+			uint32_t pathLength = 0;	// length of the path inside the strings table
+			Codec codec = Codec::None;	// how the data was compressed
+			uint32_t reserved = 0;
+		};
+
+	public:
+
+		// constructor
+		Archive() = default;
+
+		// destructor
+		~Archive();
+
+		// delete copy constructor
+		Archive(const Archive&) = delete;
+
+		// delete assignment constructor
+		Archive& operator=(const Archive&) = delete;
+
+		// returns if the archive is currently mapped
+		inline bool IsOpen() const { return mData != nullptr; }
+
+		// returns the path of the mapped archive
+		inline const std::string& GetPath() const { return mPath; }
+
+		// returns the amount of entries inside the archive
+		inline uint32_t GetEntryCount() const { return mHeader ? mHeader->entryCount : 0; }
+
+	public:
+
+		// packs every file inside a folder into an archive, paths are stored relative to the folder
+		static bool Build(std::string folder, std::string output, bool compress = true);
+
+		// returns the normalized form of a path used as archive key (forward slashes, without the asset directory prefix)
+		static std::string NormalizePath(std::string path);
+
+		// returns the hash of an already normalized path
+		static uint64_t HashPath(const std::string& path);
+
+	public:
+
+		// maps an archive file into memory, returns false if the file is not a valid archive
+		bool Open(std::string path);
+
+		// unmaps the archive
+		void Close();
+
+		// returns if a path exists inside the archive
+		bool Exists(std::string path) const;
+
+		// reads (and decompresses if required) an entry into the output vector, returns false if not found
+		bool Read(std::string path, std::vector<uint8_t>& output) const;
+
+		// reads part of an entry into the output vector, compressed entries are fully decompressed first
+		bool ReadRange(std::string path, uint64_t offset, uint64_t size, std::vector<uint8_t>& output) const;
+
+		// returns a pointer to an uncompressed entry's mapped data without copying, nullptr if not found or compressed
+		const uint8_t* View(std::string path, size_t* size) const;
+
+	private:
+
+		// binary searches the index for a normalized path
+		const Entry* Find(const std::string& normalized) const;
+
+	private:
+
+		std::string mPath = {};
+		uint8_t* mData = nullptr;
+		size_t mSize = 0;
+		const Header* mHeader = nullptr;
+		const Entry* mEntries = nullptr;
+		const char* mStrings = nullptr;
+
+#if defined(PLATFORM_WINDOWS)
+		void* mFileHandle = nullptr;
+		void* mMappingHandle = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,204 @@
+#include "epch.h"
+#include "Compression.h"
+
+#include <cstring>
+
+namespace Cosmos::lz4
+{
+	// block format constants, see lz4 block format specification
+	constexpr size_t MIN_MATCH = 4;
+	constexpr size_t LAST_LITERALS = 5;
+	constexpr size_t MATCH_FIND_LIMIT = 12;
+	constexpr size_t MAX_OFFSET = 65535;
+	constexpr uint32_t HASH_LOG = 14;
+
+	static inline uint32_t Read32(const uint8_t* ptr)
+	{
+		uint32_t value;
+		memcpy(&value, ptr, sizeof(value));
+		return value;
+	}
+
+	static inline uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_LOG);
+	}
+
+	static inline bool WriteLength(uint8_t*& op, const uint8_t* oend, size_t length)
+	{
+		while (length >= 255)
+		{
+			if (op >= oend) return false;
+			*op++ = 255;
+			length -= 255;
+		}
+
+		if (op >= oend) return false;
+		*op++ = (uint8_t)length;
+		return true;
+	}
+
+	static inline bool WriteSequence(uint8_t*& op, const uint8_t* oend, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength, bool last)
+	{
+		if (op >= oend) return false;
+
+		uint8_t* token = op++;
+		*token = (uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+
+		if (literalLength >= 15 && !WriteLength(op, oend, literalLength - 15))
+			return false;
+
+		if ((size_t)(oend - op) < literalLength)
+			return false;
+
+		memcpy(op, literals, literalLength);
+		op += literalLength;
+
+		// the last sequence only carries literals
+		if (last)
+			return true;
+
+		if (oend - op < 2) return false;
+		*op++ = (uint8_t)(offset & 0xFF);
+		*op++ = (uint8_t)(offset >> 8);
+
+		size_t length = matchLength - MIN_MATCH;
+		*token |= (uint8_t)(length >= 15 ? 15 : length);
+
+		if (length >= 15 && !WriteLength(op, oend, length - 15))
+			return false;
+
+		return true;
+	}
+
+	size_t CompressBound(size_t srcSize)
+	{
+		return srcSize + (srcSize / 255) + 16;
+	}
+
+	size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+	{
+		uint8_t* op = dst;
+		const uint8_t* oend = dst + dstCapacity;
+		size_t anchor = 0;
+
+		if (srcSize > MATCH_FIND_LIMIT)
+		{
+			std::vector<uint32_t> table((size_t)1 << HASH_LOG, 0);
+			const size_t matchStartLimit = srcSize - MATCH_FIND_LIMIT;
+			const size_t matchEndLimit = srcSize - LAST_LITERALS;
+			size_t ip = 0;
+
+			while (ip < matchStartLimit)
+			{
+				uint32_t sequence = Read32(src + ip);
+				uint32_t hash = Hash(sequence);
+				size_t ref = table[hash];
+				table[hash] = (uint32_t)ip;
+
+				if (ref >= ip || ip - ref > MAX_OFFSET || Read32(src + ref) != sequence)
+				{
+					ip++;
+					continue;
+				}
+
+				// extend the match forward as far as allowed
+				size_t matchEnd = ip + MIN_MATCH;
+				size_t refEnd = ref + MIN_MATCH;
+
+				while (matchEnd < matchEndLimit && src[matchEnd] == src[refEnd])
+				{
+					matchEnd++;
+					refEnd++;
+				}
+
+				if (!WriteSequence(op, oend, src + anchor, ip - anchor, ip - ref, matchEnd - ip, false))
+					return 0;
+
+				ip = matchEnd;
+				anchor = ip;
+			}
+		}
+
+		// remaining bytes are emitted as literals
+		if (!WriteSequence(op, oend, src + anchor, srcSize - anchor, 0, 0, true))
+			return 0;
+
+		return (size_t)(op - dst);
+	}
+
+	bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+	{
+		size_t ip = 0;
+		size_t op = 0;
+
+		while (ip < srcSize)
+		{
+			uint8_t token = src[ip++];
+
+			// literals
+			size_t literalLength = token >> 4;
+
+			if (literalLength == 15)
+			{
+				uint8_t byte = 0;
+
+				do
+				{
+					if (ip >= srcSize) return false;
+					byte = src[ip++];
+					literalLength += byte;
+				} while (byte == 255);
+			}
+
+			if (literalLength > srcSize - ip || literalLength > dstSize - op)
+				return false;
+
+			memcpy(dst + op, src + ip, literalLength);
+			ip += literalLength;
+			op += literalLength;
+
+			// last sequence has no match part
+			if (ip >= srcSize)
+				break;
+
+			// match
+			if (srcSize - ip < 2)
+				return false;
+
+			size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+			ip += 2;
+
+			if (offset == 0 || offset > op)
+				return false;
+
+			size_t matchLength = token & 15;
+
+			if (matchLength == 15)
+			{
+				uint8_t byte = 0;
+
+				do
+				{
+					if (ip >= srcSize) return false;
+					byte = src[ip++];
+					matchLength += byte;
+				} while (byte == 255);
+			}
+
+			matchLength += MIN_MATCH;
+
+			if (matchLength > dstSize - op)
+				return false;
+
+			// byte-wise copy since the match may overlap the output being written
+			const uint8_t* match = dst + op - offset;
+			for (size_t i = 0; i < matchLength; i++)
+				dst[op + i] = match[i];
+
+			op += matchLength;
+		}
+
+		return op == dstSize;
+	}
+}
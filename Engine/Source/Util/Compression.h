@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Cosmos
+{
+	// lz4 block format (no frame header), used by the asset archive for per-entry compression
+	namespace lz4
+	{
+		// returns the worst-case size of a compressed block given the source size
+		size_t CompressBound(size_t srcSize);
+
+		// compresses src into dst, returns the amount of bytes written into dst or 0 if it didn't fit
+		size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+
+		// decompresses src into dst (dstSize must be the exact original size), returns false on malformed input
+		bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+	}
+}
@@ -1,12 +1,16 @@
 #include "epch.h"
 #include "FileSystem.h"
 
+#include "Archive.h"
 #include "Util.h"
 
 #include <filesystem>
 
 namespace Cosmos
 {
+	// the archive mounted at startup, shared by every read
+	static Archive sMountedArchive;
+
 	std::string GetBinDir()
 	{
 		std::string binDir = std::filesystem::current_path().string();
@@ -38,8 +42,36 @@ namespace Cosmos
 		return assets;
 	}
 
+	bool MountArchive(std::string path)
+	{
+		return sMountedArchive.Open(path);
+	}
+
+	void UnmountArchive()
+	{
+		sMountedArchive.Close();
+	}
+
+	bool IsArchiveMounted()
+	{
+		return sMountedArchive.IsOpen();
+	}
+
+	bool FileExists(std::string path)
+	{
+		if (sMountedArchive.IsOpen() && sMountedArchive.Exists(path))
+			return true;
+
+		return std::filesystem::exists(path);
+	}
+
 	std::vector<uint8_t> ReadFromBinary(std::string path)
 	{
+		std::vector<uint8_t> archived;
+
+		if (sMountedArchive.IsOpen() && sMountedArchive.Read(path, archived))
+			return archived;
+
 		std::ifstream file(path, std::fstream::in | std::fstream::binary);
 		std::streampos size;
 
@@ -63,6 +95,30 @@ namespace Cosmos
 		return std::vector<uint8_t>();
 	}
 
+	std::vector<uint8_t> ReadFromBinary(std::string path, uint64_t offset, uint64_t size)
+	{
+		std::vector<uint8_t> archived;
+
+		if (sMountedArchive.IsOpen() && sMountedArchive.ReadRange(path, offset, size, archived))
+			return archived;
+
+		std::ifstream file(path, std::fstream::in | std::fstream::binary);
+
+		if (file.is_open())
+		{
+			std::vector<uint8_t> data((size_t)size);
+
+			file.seekg((std::streamoff)offset, std::ios::beg);
+			file.read((char*)data.data(), (std::streamsize)size);
+
+			if ((uint64_t)file.gcount() == size)
+				return data;
+		}
+
+		Logger() << "Error when reading range of file " << path;
+		return std::vector<uint8_t>();
+	}
+
 	void WriteToBinary(std::string path, const void* data, size_t dataSize)
 	{
 		std::ofstream file(path, std::fstream::out | std::fstream::binary | std::ios::app);
@@ -76,4 +132,42 @@ namespace Cosmos
 		Logger() << "Error when opening file " << path << "for writting";
 		return;
 	}
+
+	bool WriteToBinaryAtomic(std::string path, const void* data, size_t dataSize)
+	{
+		std::string temporary = path + ".tmp";
+
+		{
+			std::ofstream file(temporary, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+
+			if (!file.is_open())
+			{
+				Logger() << "Error when opening file " << temporary << " for writting";
+				return false;
+			}
+
+			file.write(reinterpret_cast<const char*>(data), (std::streamsize)dataSize);
+			file.flush();
+
+			if (!file.good())
+			{
+				Logger() << "Error when writting file " << temporary;
+				file.close();
+				std::filesystem::remove(temporary);
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporary, path, error);
+
+		if (error)
+		{
+			Logger() << "Error when replacing file " << path << ": " << error.message();
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+
+		return true;
+	}
 }
\ No newline at end of file
@@ -14,9 +14,27 @@ namespace Cosmos
 	// returns the path of a sub-directory item that starts at the asset directory
 	std::string GetAssetSubDir(std::string subpath, bool removeExtension = false);
 
-	// reads a binary file and returns it's content
+	// mounts a packed asset archive, reads will look into it before falling back to loose files
+	bool MountArchive(std::string path);
+
+	// unmounts the currently mounted asset archive, if any
+	void UnmountArchive();
+
+	// returns if a packed asset archive is currently mounted
+	bool IsArchiveMounted();
+
+	// returns if a file exists, either inside the mounted archive or on disk
+	bool FileExists(std::string path);
+
+	// reads a binary file and returns it's content, looking inside the mounted archive first
 	std::vector<uint8_t> ReadFromBinary(std::string path);
 
+	// reads part of a binary file, returns an empty vector if the range is not inside the file
+	std::vector<uint8_t> ReadFromBinary(std::string path, uint64_t offset, uint64_t size);
+
 	// writes the data into a binary file
 	void WriteToBinary(std::string path, const void* data, size_t dataSize);
+
+	// replaces a binary file by writing a temporary one and renaming it over, a crash never leaves a partial file behind
+	bool WriteToBinaryAtomic(std::string path, const void* data, size_t dataSize);
 }
\ No newline at end of file
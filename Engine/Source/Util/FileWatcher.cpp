@@ -0,0 +1,122 @@
+#include "epch.h"
+#include "FileWatcher.h"
+
+#include <algorithm>
+
+#if defined(PLATFORM_LINUX)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace Cosmos
+{
+#if defined(PLATFORM_LINUX)
+
+	FileWatcher::FileWatcher(std::string directory)
+		: mDirectory(directory)
+	{
+		mDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+		if (mDescriptor < 0)
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "Failed to initialize inotify, %s won't be watched", mDirectory.c_str());
+			return;
+		}
+
+		// editors either write in place or write a temporary file and move it over the original
+		if (inotify_add_watch(mDescriptor, mDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+		{
+			LOG_TO_TERMINAL(Logger::Severity::Warn, "Failed to watch %s", mDirectory.c_str());
+			close(mDescriptor);
+			mDescriptor = -1;
+		}
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+		if (mDescriptor >= 0)
+			close(mDescriptor);
+	}
+
+	std::vector<std::string> FileWatcher::Poll()
+	{
+		std::vector<std::string> changes = {};
+
+		if (mDescriptor < 0)
+			return changes;
+
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length = 0;
+
+		while ((length = read(mDescriptor, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* ptr = buffer; ptr < buffer + length;)
+			{
+				const inotify_event* event = (const inotify_event*)ptr;
+				ptr += sizeof(inotify_event) + event->len;
+
+				if (event->len == 0 || (event->mask & IN_ISDIR))
+					continue;
+
+				std::string path = mDirectory + "/" + event->name;
+
+				if (std::find(changes.begin(), changes.end(), path) == changes.end())
+					changes.push_back(path);
+			}
+		}
+
+		return changes;
+	}
+
+#else
+
+	FileWatcher::FileWatcher(std::string directory)
+		: mDirectory(directory)
+	{
+		std::error_code error;
+
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(mDirectory, error))
+		{
+			if (entry.is_regular_file(error))
+				mWriteTimes[entry.path().generic_string()] = entry.last_write_time(error);
+		}
+
+		mLastPoll = std::chrono::steady_clock::now();
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+	}
+
+	std::vector<std::string> FileWatcher::Poll()
+	{
+		std::vector<std::string> changes = {};
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		if (now - mLastPoll < std::chrono::milliseconds(FILE_WATCHER_POLL_INTERVAL_MS))
+			return changes;
+
+		mLastPoll = now;
+		std::error_code error;
+
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(mDirectory, error))
+		{
+			if (!entry.is_regular_file(error))
+				continue;
+
+			std::string path = entry.path().generic_string();
+			std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+			auto it = mWriteTimes.find(path);
+
+			if (it != mWriteTimes.end() && it->second == writeTime)
+				continue;
+
+			mWriteTimes[path] = writeTime;
+			changes.push_back(path);
+		}
+
+		return changes;
+	}
+
+#endif
+}
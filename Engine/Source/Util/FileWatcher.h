@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Defines.h"
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// how often (in milliseconds) the polling fallback scans the watched directory
+#define FILE_WATCHER_POLL_INTERVAL_MS 250
+
+namespace Cosmos
+{
+	// reports files modified inside a directory (not recursive), on linux through inotify and elsewhere by polling their write times
+	class FileWatcher
+	{
+	public:
+
+		// constructor
+		FileWatcher(std::string directory);
+
+		// destructor
+		~FileWatcher();
+
+		// delete copy constructor
+		FileWatcher(const FileWatcher&) = delete;
+
+		// delete assignment constructor
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		// returns the watched directory
+		inline const std::string& GetDirectory() const { return mDirectory; }
+
+	public:
+
+		// returns the paths of the files written since the last poll, each reported once, never blocks
+		std::vector<std::string> Poll();
+
+	private:
+
+		std::string mDirectory = {};
+
+#if defined(PLATFORM_LINUX)
+		int mDescriptor = -1;
+#else
+		std::unordered_map<std::string, std::filesystem::file_time_type> mWriteTimes = {};
+		std::chrono::steady_clock::time_point mLastPoll = {};
+#endif
+	};
+}
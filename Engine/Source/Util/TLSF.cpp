@@ -0,0 +1,321 @@
+#include "epch.h"
+#include "TLSF.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Cosmos
+{
+	// index of the most significant set bit, value must not be zero
+	static inline uint32_t HighestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (uint32_t)index;
+#else
+		return 63 - (uint32_t)__builtin_clzll(value);
+#endif
+	}
+
+	// index of the least significant set bit, value must not be zero
+	static inline uint32_t LowestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return (uint32_t)index;
+#else
+		return (uint32_t)__builtin_ctzll(value);
+#endif
+	}
+
+	TLSF::TLSF(uint64_t size)
+	{
+		Reset(size);
+	}
+
+	void TLSF::Reset(uint64_t size)
+	{
+		mSize = size;
+		mUsed = 0;
+		mAllocationCount = 0;
+		mFirstLevelBitmap = 0;
+		mNodes.clear();
+		mUnusedNodes.clear();
+
+		for (uint32_t fl = 0; fl < FL_COUNT; fl++)
+		{
+			mSecondLevelBitmap[fl] = 0;
+
+			for (uint32_t sl = 0; sl < SL_COUNT; sl++)
+				mHeads[fl][sl] = Null;
+		}
+
+		if (size == 0)
+			return;
+
+		uint32_t index = CreateNode();
+		mNodes[index].offset = 0;
+		mNodes[index].size = size;
+		InsertFree(index);
+	}
+
+	uint32_t TLSF::Allocate(uint64_t size, uint64_t alignment, uint64_t* offset)
+	{
+		if (size == 0)
+			return Null;
+
+		if (alignment == 0)
+			alignment = 1;
+
+		// searching for the worst-case padding guarantees the found range fits after being aligned
+		if (size > UINT64_MAX - alignment)
+			return Null;
+
+		uint32_t index = FindFree(size + alignment - 1);
+
+		if (index == Null)
+			return Null;
+
+		RemoveFree(index);
+
+		uint64_t aligned = (mNodes[index].offset + alignment - 1) & ~(alignment - 1);
+		uint64_t padding = aligned - mNodes[index].offset;
+
+		// the padding in front becomes a free range of its own, the previous neighbour is never free as free neighbours are always merged
+		if (padding > 0)
+		{
+			uint32_t front = CreateNode();
+			mNodes[front].offset = mNodes[index].offset;
+			mNodes[front].size = padding;
+			mNodes[front].prevPhysical = mNodes[index].prevPhysical;
+			mNodes[front].nextPhysical = index;
+
+			if (mNodes[index].prevPhysical != Null)
+				mNodes[mNodes[index].prevPhysical].nextPhysical = front;
+
+			mNodes[index].prevPhysical = front;
+			mNodes[index].offset = aligned;
+			mNodes[index].size -= padding;
+			InsertFree(front);
+		}
+
+		// and so does whatever is left at the back
+		if (mNodes[index].size > size)
+		{
+			uint32_t back = CreateNode();
+			mNodes[back].offset = aligned + size;
+			mNodes[back].size = mNodes[index].size - size;
+			mNodes[back].prevPhysical = index;
+			mNodes[back].nextPhysical = mNodes[index].nextPhysical;
+
+			if (mNodes[index].nextPhysical != Null)
+				mNodes[mNodes[index].nextPhysical].prevPhysical = back;
+
+			mNodes[index].nextPhysical = back;
+			mNodes[index].size = size;
+			InsertFree(back);
+		}
+
+		mNodes[index].free = false;
+		mUsed += size;
+		mAllocationCount++;
+
+		if (offset) *offset = aligned;
+		return index;
+	}
+
+	void TLSF::Free(uint32_t handle)
+	{
+		if (handle == Null || handle >= mNodes.size() || mNodes[handle].free)
+			return;
+
+		mUsed -= mNodes[handle].size;
+		mAllocationCount--;
+
+		// merge with the previous neighbour
+		uint32_t prev = mNodes[handle].prevPhysical;
+
+		if (prev != Null && mNodes[prev].free)
+		{
+			RemoveFree(prev);
+			mNodes[prev].size += mNodes[handle].size;
+			mNodes[prev].nextPhysical = mNodes[handle].nextPhysical;
+
+			if (mNodes[handle].nextPhysical != Null)
+				mNodes[mNodes[handle].nextPhysical].prevPhysical = prev;
+
+			DestroyNode(handle);
+			handle = prev;
+		}
+
+		// merge with the next neighbour
+		uint32_t next = mNodes[handle].nextPhysical;
+
+		if (next != Null && mNodes[next].free)
+		{
+			RemoveFree(next);
+			mNodes[handle].size += mNodes[next].size;
+			mNodes[handle].nextPhysical = mNodes[next].nextPhysical;
+
+			if (mNodes[next].nextPhysical != Null)
+				mNodes[mNodes[next].nextPhysical].prevPhysical = handle;
+
+			DestroyNode(next);
+		}
+
+		InsertFree(handle);
+	}
+
+	uint64_t TLSF::GetLargestFree() const
+	{
+		if (mFirstLevelBitmap == 0)
+			return 0;
+
+		uint32_t fl = HighestBit(mFirstLevelBitmap);
+		uint32_t sl = HighestBit(mSecondLevelBitmap[fl]);
+		uint64_t largest = 0;
+
+		// ranges inside the biggest list aren't sorted
+		for (uint32_t index = mHeads[fl][sl]; index != Null; index = mNodes[index].nextFree)
+			largest = std::max(largest, mNodes[index].size);
+
+		return largest;
+	}
+
+	uint32_t TLSF::GetFreeRangeCount() const
+	{
+		uint32_t count = 0;
+
+		for (uint32_t fl = 0; fl < FL_COUNT; fl++)
+		{
+			if (mSecondLevelBitmap[fl] == 0)
+				continue;
+
+			for (uint32_t sl = 0; sl < SL_COUNT; sl++)
+			{
+				for (uint32_t index = mHeads[fl][sl]; index != Null; index = mNodes[index].nextFree)
+					count++;
+			}
+		}
+
+		return count;
+	}
+
+	void TLSF::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+	{
+		// small sizes have one list each
+		if (size < SL_COUNT)
+		{
+			fl = 0;
+			sl = (uint32_t)size;
+			return;
+		}
+
+		uint32_t log = HighestBit(size);
+		fl = log - SL_LOG + 1;
+		sl = (uint32_t)(size >> (log - SL_LOG)) - SL_COUNT;
+	}
+
+	uint32_t TLSF::CreateNode()
+	{
+		if (!mUnusedNodes.empty())
+		{
+			uint32_t index = mUnusedNodes.back();
+			mUnusedNodes.pop_back();
+			mNodes[index] = Node();
+			return index;
+		}
+
+		mNodes.emplace_back();
+		return (uint32_t)mNodes.size() - 1;
+	}
+
+	void TLSF::DestroyNode(uint32_t index)
+	{
+		mNodes[index] = Node();
+		mUnusedNodes.push_back(index);
+	}
+
+	void TLSF::InsertFree(uint32_t index)
+	{
+		uint32_t fl, sl;
+		Mapping(mNodes[index].size, fl, sl);
+
+		uint32_t head = mHeads[fl][sl];
+		mNodes[index].free = true;
+		mNodes[index].prevFree = Null;
+		mNodes[index].nextFree = head;
+
+		if (head != Null)
+			mNodes[head].prevFree = index;
+
+		mHeads[fl][sl] = index;
+		mFirstLevelBitmap |= 1ull << fl;
+		mSecondLevelBitmap[fl] |= 1u << sl;
+	}
+
+	void TLSF::RemoveFree(uint32_t index)
+	{
+		uint32_t fl, sl;
+		Mapping(mNodes[index].size, fl, sl);
+
+		uint32_t prev = mNodes[index].prevFree;
+		uint32_t next = mNodes[index].nextFree;
+
+		if (prev != Null) mNodes[prev].nextFree = next;
+		if (next != Null) mNodes[next].prevFree = prev;
+
+		if (mHeads[fl][sl] == index)
+		{
+			mHeads[fl][sl] = next;
+
+			if (next == Null)
+			{
+				mSecondLevelBitmap[fl] &= ~(1u << sl);
+
+				if (mSecondLevelBitmap[fl] == 0)
+					mFirstLevelBitmap &= ~(1ull << fl);
+			}
+		}
+
+		mNodes[index].free = false;
+		mNodes[index].prevFree = Null;
+		mNodes[index].nextFree = Null;
+	}
+
+	uint32_t TLSF::FindFree(uint64_t size)
+	{
+		// round the size up to the next list boundary so that every range of the found list is big enough
+		if (size >= SL_COUNT)
+		{
+			uint64_t round = (1ull << (HighestBit(size) - SL_LOG)) - 1;
+
+			if (size > UINT64_MAX - round)
+				return Null;
+
+			size += round;
+		}
+
+		uint32_t fl, sl;
+		Mapping(size, fl, sl);
+
+		uint32_t slBitmap = mSecondLevelBitmap[fl] & (~0u << sl);
+
+		if (slBitmap == 0)
+		{
+			uint64_t flBitmap = fl + 1 < 64 ? mFirstLevelBitmap & (~0ull << (fl + 1)) : 0;
+
+			if (flBitmap == 0)
+				return Null;
+
+			fl = LowestBit(flBitmap);
+			slBitmap = mSecondLevelBitmap[fl];
+		}
+
+		sl = LowestBit(slBitmap);
+		return mHeads[fl][sl];
+	}
+}
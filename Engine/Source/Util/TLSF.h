@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Cosmos
+{
+	// two-level segregated fit allocator over an abstract range of offsets, bookkeeping lives outside the managed range
+	// allocation and free are O(1), used to sub-allocate device memory blocks that the cpu can't write metadata into
+	class TLSF
+	{
+	public:
+
+		// invalid handle, returned when an allocation doesn't fit
+		static constexpr uint32_t Null = ~0u;
+
+	public:
+
+		// constructor
+		TLSF(uint64_t size = 0);
+
+		// destructor
+		~TLSF() = default;
+
+		// returns the size of the managed range
+		inline uint64_t GetSize() const { return mSize; }
+
+		// returns how many bytes are currently allocated (including alignment padding that couldn't be reused)
+		inline uint64_t GetUsed() const { return mUsed; }
+
+		// returns how many allocations are alive
+		inline uint32_t GetAllocationCount() const { return mAllocationCount; }
+
+		// returns if nothing is allocated
+		inline bool IsEmpty() const { return mAllocationCount == 0; }
+
+	public:
+
+		// resets the allocator to manage a range of a given size, invalidating every handle
+		void Reset(uint64_t size);
+
+		// allocates a range with the given alignment (power of two), returns Null if no free range is big enough
+		uint32_t Allocate(uint64_t size, uint64_t alignment, uint64_t* offset);
+
+		// returns a range to the allocator, merging it with its free neighbours
+		void Free(uint32_t handle);
+
+		// returns the offset of an allocation
+		inline uint64_t GetOffset(uint32_t handle) const { return mNodes[handle].offset; }
+
+		// returns the size of an allocation
+		inline uint64_t GetSize(uint32_t handle) const { return mNodes[handle].size; }
+
+		// returns the size of the biggest free range
+		uint64_t GetLargestFree() const;
+
+		// returns how many free ranges exist, a rough measure of fragmentation
+		uint32_t GetFreeRangeCount() const;
+
+	private:
+
+		// second-level subdivisions per power of two, as log2
+		static constexpr uint32_t SL_LOG = 5;
+		static constexpr uint32_t SL_COUNT = 1 << SL_LOG;
+		static constexpr uint32_t FL_COUNT = 64 - SL_LOG + 1;
+
+		struct Node
+		{
+			uint64_t offset = 0;
+			uint64_t size = 0;
+			uint32_t prevPhysical = Null;	// neighbour range with a smaller offset
+			uint32_t nextPhysical = Null;	// neighbour range with a bigger offset
+			uint32_t prevFree = Null;		// previous range in the same free list
+			uint32_t nextFree = Null;		// next range in the same free list
+			bool free = false;
+		};
+
+	private:
+
+		// returns the free list a size belongs to
+		static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+		// returns a node from the node pool
+		uint32_t CreateNode();
+
+		// returns a node to the node pool
+		void DestroyNode(uint32_t index);
+
+		// inserts a free node into its free list
+		void InsertFree(uint32_t index);
+
+		// removes a free node from its free list
+		void RemoveFree(uint32_t index);
+
+		// returns the first free node of a list that may hold the size, Null if none
+		uint32_t FindFree(uint64_t size);
+
+	private:
+
+		uint64_t mSize = 0;
+		uint64_t mUsed = 0;
+		uint32_t mAllocationCount = 0;
+
+		uint64_t mFirstLevelBitmap = 0;
+		uint32_t mSecondLevelBitmap[FL_COUNT] = {};
+		uint32_t mHeads[FL_COUNT][SL_COUNT] = {};
+
+		std::vector<Node> mNodes = {};
+		std::vector<uint32_t> mUnusedNodes = {};
+	};
+}
@@ -0,0 +1,19 @@
+#include "Test.h"
+
+// runs every test case registered, returns how many failed
+int main(int argc, char* argv[])
+{
+	int failed = 0;
+
+	for (const Cosmos::Test::Case& test : Cosmos::Test::GetCases())
+	{
+		bool passed = true;
+		test.function(passed);
+
+		std::printf("%s %s\n", passed ? "[PASS]" : "[FAIL]", test.name);
+		failed += passed ? 0 : 1;
+	}
+
+	std::printf("%zu tests, %d failed\n", Cosmos::Test::GetCases().size(), failed);
+	return failed;
+}
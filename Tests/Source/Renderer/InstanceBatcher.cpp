@@ -0,0 +1,62 @@
+#include "Test.h"
+
+#include "Renderer/InstanceBatcher.h"
+
+#include <string>
+
+namespace Cosmos
+{
+	// only the grouping the scene does on the cpu is covered, the culling and the indirect draws need a device
+
+	TEST_CASE(InstanceBatcher_GroupsByKey)
+	{
+		// keys are built per model like Model::mBatchKey, equal contents must match even from different strings
+		std::string rock = std::string("Models/rock.gltf") + "|" + "Textures/rock.png";
+		std::string rockCopy = rock;
+		std::string tree = std::string("Models/tree.gltf") + "|" + "Textures/bark.png";
+
+		InstanceBatcher batcher;
+		batcher.Begin();
+
+		TEST_CHECK(batcher.Add(rock, 0, 2) == 0);
+		TEST_CHECK(batcher.Add(tree, 0, 3) == 1);
+		TEST_CHECK(batcher.Add(rockCopy, 0, 2) == 0);
+		TEST_CHECK(batcher.Add(tree, 0, 3) == 1);
+
+		// the same meshes with another material are drawn apart
+		TEST_CHECK(batcher.Add(rock, 1, 2) == 2);
+
+		TEST_CHECK(batcher.GetBatchCount() == 3);
+		TEST_CHECK(batcher.GetInstanceCount() == 5);
+		TEST_CHECK(batcher.GetDrawCount() == 2 + 3 + 2);
+
+		// a new frame starts without batches
+		batcher.Begin();
+		TEST_CHECK(batcher.GetBatchCount() == 0 && batcher.GetInstanceCount() == 0 && batcher.GetDrawCount() == 0);
+		TEST_CHECK(batcher.Add(tree, 0, 3) == 0);
+	}
+
+	TEST_CASE(InstanceBatcher_ReducesDraws)
+	{
+		// a forest of a few model kinds, drawn one by one it would take a draw per mesh of every instance
+		const char* keys[] = { "Models/pine.gltf|", "Models/oak.gltf|", "Models/bush.gltf|", "Models/rock.gltf|" };
+		const uint32_t meshes[] = { 3, 4, 1, 2 };
+		const uint32_t instances = 1000;
+
+		InstanceBatcher batcher;
+		batcher.Begin();
+		uint32_t unbatched = 0;
+
+		for (uint32_t i = 0; i < instances; i++)
+		{
+			uint32_t kind = (i * 7) % 4;
+			TEST_CHECK(batcher.Add(keys[kind], 0, meshes[kind]) < 4);
+			unbatched += meshes[kind];
+		}
+
+		TEST_CHECK(batcher.GetBatchCount() == 4);
+		TEST_CHECK(batcher.GetInstanceCount() == instances);
+		TEST_CHECK(batcher.GetDrawCount() == 3 + 4 + 1 + 2);
+		TEST_CHECK(unbatched == 2500);
+	}
+}
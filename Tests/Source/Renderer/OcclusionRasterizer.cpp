@@ -0,0 +1,64 @@
+#include "Test.h"
+
+#include "Renderer/OcclusionRasterizer.h"
+
+#include <cfloat>
+
+namespace Cosmos
+{
+	// the camera sits at the origin looking down -z
+	static glm::mat4 ViewProjection(const OcclusionRasterizer& rasterizer)
+	{
+		return glm::perspective(glm::radians(60.0f), (float)rasterizer.GetWidth() / (float)rasterizer.GetHeight(), 0.1f, 100.0f);
+	}
+
+	// a quad facing the camera at a depth, covering the given range on x and y
+	static std::vector<glm::vec3> Wall(float minX, float maxX, float minY, float maxY, float z)
+	{
+		return { glm::vec3(minX, minY, z), glm::vec3(maxX, minY, z), glm::vec3(maxX, maxY, z), glm::vec3(minX, maxY, z) };
+	}
+
+	TEST_CASE(OcclusionRasterizer_FullyBehind)
+	{
+		OcclusionRasterizer rasterizer;
+		rasterizer.Begin(ViewProjection(rasterizer));
+		rasterizer.AddOccluder(Wall(-20.0f, 20.0f, -20.0f, 20.0f, -10.0f), glm::mat4(1.0f));
+		rasterizer.Rasterize();
+
+		TEST_CHECK(rasterizer.GetStats().primitives == 1);
+		TEST_CHECK(!rasterizer.IsVisible(glm::vec3(-1.0f, -1.0f, -30.0f), glm::vec3(1.0f, 1.0f, -25.0f), glm::mat4(1.0f)));
+		TEST_CHECK(rasterizer.IsVisible(glm::vec3(-1.0f, -1.0f, -5.0f), glm::vec3(1.0f, 1.0f, -4.0f), glm::mat4(1.0f)));
+	}
+
+	TEST_CASE(OcclusionRasterizer_PartlyVisible)
+	{
+		// the wall covers the left half of the screen
+		OcclusionRasterizer rasterizer;
+		rasterizer.Begin(ViewProjection(rasterizer));
+		rasterizer.AddOccluder(Wall(-20.0f, 0.0f, -20.0f, 20.0f, -10.0f), glm::mat4(1.0f));
+		rasterizer.Rasterize();
+
+		TEST_CHECK(rasterizer.IsVisible(glm::vec3(-2.0f, -1.0f, -30.0f), glm::vec3(2.0f, 1.0f, -25.0f), glm::mat4(1.0f)));
+		TEST_CHECK(!rasterizer.IsVisible(glm::vec3(-6.0f, -1.0f, -30.0f), glm::vec3(-3.0f, 1.0f, -25.0f), glm::mat4(1.0f)));
+	}
+
+	TEST_CASE(OcclusionRasterizer_OccluderCrossingNearPlane)
+	{
+		// the wall's bottom edge lies between the eye and the near plane, where the gpu clips it
+		OcclusionRasterizer rasterizer;
+		rasterizer.Begin(ViewProjection(rasterizer));
+
+		std::vector<glm::vec3> wall =
+		{
+			glm::vec3(-20.0f, -20.0f, -0.05f), glm::vec3(20.0f, -20.0f, -0.05f),
+			glm::vec3(20.0f, 20.0f, -10.0f), glm::vec3(-20.0f, 20.0f, -10.0f)
+		};
+
+		rasterizer.AddOccluder(wall, glm::mat4(1.0f));
+		rasterizer.Rasterize();
+
+		TEST_CHECK(rasterizer.GetStats().primitives == 0);
+		TEST_CHECK(rasterizer.GetDepth(rasterizer.GetWidth() / 2, rasterizer.GetHeight() / 2) == FLT_MAX);
+		TEST_CHECK(rasterizer.IsVisible(glm::vec3(-1.0f, -1.0f, -30.0f), glm::vec3(1.0f, 1.0f, -25.0f), glm::mat4(1.0f)));
+	}
+}
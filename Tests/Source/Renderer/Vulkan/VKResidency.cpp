@@ -0,0 +1,91 @@
+#include "Test.h"
+
+#include "Renderer/Vulkan/VKResidency.h"
+
+namespace Cosmos
+{
+	static constexpr VkDeviceSize MB = 1024 * 1024;
+
+	// a device-local heap and a bigger host heap, only the first counts towards the budget
+	static std::vector<VKResidency::Heap> Heaps(VkDeviceSize usage)
+	{
+		VKResidency::Heap local = {};
+		local.size = 1024 * MB;
+		local.budget = 800 * MB;
+		local.usage = usage;
+		local.deviceLocal = true;
+
+		VKResidency::Heap host = {};
+		host.size = 4096 * MB;
+		host.budget = 3000 * MB;
+		host.usage = 2000 * MB;
+		host.deviceLocal = false;
+
+		return { local, host };
+	}
+
+	TEST_CASE(VKResidency_Budget)
+	{
+		VKResidency residency(nullptr, nullptr);
+		residency.SetHeaps(Heaps(100 * MB));
+		residency.SetBudget(0);
+
+		TEST_CHECK(residency.GetBudget() == 800 * MB);
+		TEST_CHECK(residency.GetUsage() == 100 * MB);
+
+		// a custom budget only ever tightens the driver's
+		residency.SetBudget(200 * MB);
+		TEST_CHECK(residency.GetBudget() == 200 * MB);
+
+		residency.SetBudget(2048 * MB);
+		TEST_CHECK(residency.GetBudget() == 800 * MB);
+
+		residency.SetBudget(200 * MB);
+		TEST_CHECK(residency.CanAfford(100 * MB));
+		TEST_CHECK(!residency.CanAfford(101 * MB));
+	}
+
+	TEST_CASE(VKResidency_PendingBytes)
+	{
+		VKResidency residency(nullptr, nullptr);
+		residency.SetHeaps(Heaps(100 * MB));
+		residency.SetBudget(200 * MB);
+
+		// loads started in the same frame share the headroom the usage leaves
+		residency.AddPending(60 * MB);
+		TEST_CHECK(residency.GetPending() == 60 * MB);
+		TEST_CHECK(residency.CanAfford(40 * MB));
+		TEST_CHECK(!residency.CanAfford(41 * MB));
+
+		residency.AddPending(40 * MB);
+		TEST_CHECK(!residency.CanAfford(1));
+
+		// pending bytes don't count as usage, a load in flight isn't a reason to evict
+		TEST_CHECK(!residency.IsOverBudget());
+
+		// once refreshed the allocations show up in the usage instead
+		residency.SetHeaps(Heaps(160 * MB));
+		TEST_CHECK(residency.GetPending() == 0);
+		TEST_CHECK(residency.CanAfford(40 * MB));
+		TEST_CHECK(!residency.CanAfford(41 * MB));
+	}
+
+	TEST_CASE(VKResidency_OverBudget)
+	{
+		VKResidency residency(nullptr, nullptr);
+		residency.SetHeaps(Heaps(300 * MB));
+		residency.SetBudget(0);
+
+		TEST_CHECK(!residency.IsOverBudget());
+
+		// lowering the budget below the usage is what makes the streamer drop mips
+		residency.SetBudget(256 * MB);
+		TEST_CHECK(residency.IsOverBudget());
+		TEST_CHECK(!residency.CanAfford(1));
+
+		// dropped mips bring the usage back under it
+		residency.SetHeaps(Heaps(250 * MB));
+		TEST_CHECK(!residency.IsOverBudget());
+		TEST_CHECK(residency.CanAfford(6 * MB));
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+namespace Cosmos::Test
+{
+	// a test case, fails when any of its checks does
+	struct Case
+	{
+		const char* name;
+		void(*function)(bool& passed);
+	};
+
+	// returns every test case registered
+	inline std::vector<Case>& GetCases()
+	{
+		static std::vector<Case> cases = {};
+		return cases;
+	}
+
+	// registers a test case before main runs
+	struct Register
+	{
+		Register(const char* name, void(*function)(bool& passed)) { GetCases().push_back({ name, function }); }
+	};
+}
+
+// declares and registers a test case
+#define TEST_CASE(name) \
+	static void name(bool& passed); \
+	static Cosmos::Test::Register name##Register(#name, name); \
+	static void name(bool& passed)
+
+// fails the test case and reports where when the condition doesn't hold
+#define TEST_CHECK(condition) \
+	if (!(condition)) { std::printf("  %s:%d: %s\n", __FILE__, __LINE__, #condition); passed = false; }
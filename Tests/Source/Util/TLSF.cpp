@@ -0,0 +1,199 @@
+#include "Test.h"
+
+#include "Util/TLSF.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace Cosmos
+{
+	// a live allocation, kept to check ranges against each other
+	struct Range
+	{
+		uint32_t handle;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// returns if no two ranges overlap and all of them lie inside the allocator
+	static bool Disjoint(std::vector<Range> ranges, const TLSF& tlsf)
+	{
+		std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.offset < b.offset; });
+
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			if (ranges[i].offset + ranges[i].size > tlsf.GetSize())
+				return false;
+
+			if (i > 0 && ranges[i - 1].offset + ranges[i - 1].size > ranges[i].offset)
+				return false;
+		}
+
+		return true;
+	}
+
+	TEST_CASE(TLSF_AllocateFree)
+	{
+		TLSF tlsf(1024);
+		uint64_t first = ~0ull;
+		uint64_t second = ~0ull;
+
+		uint32_t a = tlsf.Allocate(100, 1, &first);
+		uint32_t b = tlsf.Allocate(200, 256, &second);
+
+		TEST_CHECK(a != TLSF::Null && b != TLSF::Null);
+		TEST_CHECK(first == 0);
+		TEST_CHECK(second == 256);
+		TEST_CHECK(tlsf.GetAllocationCount() == 2);
+		TEST_CHECK(tlsf.GetUsed() == 300);
+
+		// the padding between both allocations is free again
+		TEST_CHECK(tlsf.GetFreeRangeCount() == 2);
+
+		tlsf.Free(a);
+		tlsf.Free(b);
+
+		TEST_CHECK(tlsf.IsEmpty());
+		TEST_CHECK(tlsf.GetUsed() == 0);
+		TEST_CHECK(tlsf.GetFreeRangeCount() == 1);
+		TEST_CHECK(tlsf.GetLargestFree() == 1024);
+	}
+
+	TEST_CASE(TLSF_Alignment)
+	{
+		TLSF tlsf(1 << 20);
+		std::vector<Range> ranges = {};
+
+		for (uint64_t i = 0; i < 64; i++)
+		{
+			uint64_t alignment = 1ull << (i % 13);
+			uint64_t size = 1 + (i * 37) % 3000;
+			uint64_t offset = 0;
+			uint32_t handle = tlsf.Allocate(size, alignment, &offset);
+
+			TEST_CHECK(handle != TLSF::Null);
+			TEST_CHECK(offset % alignment == 0);
+			TEST_CHECK(tlsf.GetOffset(handle) == offset && tlsf.GetSize(handle) == size);
+			ranges.push_back({ handle, offset, size });
+		}
+
+		TEST_CHECK(Disjoint(ranges, tlsf));
+
+		for (const Range& range : ranges)
+			tlsf.Free(range.handle);
+
+		TEST_CHECK(tlsf.IsEmpty());
+		TEST_CHECK(tlsf.GetLargestFree() == tlsf.GetSize());
+	}
+
+	TEST_CASE(TLSF_Exhaustion)
+	{
+		TLSF tlsf(4096);
+
+		TEST_CHECK(tlsf.Allocate(0, 1, nullptr) == TLSF::Null);
+		TEST_CHECK(tlsf.Allocate(4097, 1, nullptr) == TLSF::Null);
+
+		uint32_t whole = tlsf.Allocate(4096, 1, nullptr);
+		TEST_CHECK(whole != TLSF::Null);
+		TEST_CHECK(tlsf.Allocate(1, 1, nullptr) == TLSF::Null);
+		TEST_CHECK(tlsf.GetLargestFree() == 0);
+
+		tlsf.Free(whole);
+		tlsf.Free(whole);
+
+		TEST_CHECK(tlsf.IsEmpty());
+		TEST_CHECK(tlsf.Allocate(4096, 1, nullptr) != TLSF::Null);
+	}
+
+	TEST_CASE(TLSF_Fragmentation)
+	{
+		const uint64_t blockSize = 256;
+		const uint32_t blockCount = 64;
+
+		TLSF tlsf(blockSize * blockCount);
+		std::vector<uint32_t> handles = {};
+
+		for (uint32_t i = 0; i < blockCount; i++)
+			handles.push_back(tlsf.Allocate(blockSize, 1, nullptr));
+
+		TEST_CHECK(tlsf.GetFreeRangeCount() == 0);
+
+		// every other block freed leaves holes that can't hold anything bigger than one block
+		for (uint32_t i = 0; i < blockCount; i += 2)
+			tlsf.Free(handles[i]);
+
+		TEST_CHECK(tlsf.GetFreeRangeCount() == blockCount / 2);
+		TEST_CHECK(tlsf.GetLargestFree() == blockSize);
+		TEST_CHECK(tlsf.Allocate(blockSize * 2, 1, nullptr) == TLSF::Null);
+
+		// a hole is reused as a whole
+		handles[0] = tlsf.Allocate(blockSize, 1, nullptr);
+		TEST_CHECK(handles[0] != TLSF::Null);
+		TEST_CHECK(tlsf.GetFreeRangeCount() == blockCount / 2 - 1);
+
+		// freeing the rest merges every range back into one
+		tlsf.Free(handles[0]);
+
+		for (uint32_t i = 1; i < blockCount; i += 2)
+			tlsf.Free(handles[i]);
+
+		TEST_CHECK(tlsf.IsEmpty());
+		TEST_CHECK(tlsf.GetFreeRangeCount() == 1);
+		TEST_CHECK(tlsf.Allocate(blockSize * blockCount, 1, nullptr) != TLSF::Null);
+	}
+
+	TEST_CASE(TLSF_Benchmark)
+	{
+		// random sizes and alignments like the ones buffers and images ask for, with allocations freed in random order and about
+		// half of the live limit alive at any time
+		const uint32_t operations = 1000000;
+		const uint32_t live = 4096;
+
+		TLSF tlsf(256ull << 20);
+		std::mt19937 random(1234);
+		std::vector<Range> ranges = {};
+		uint32_t failed = 0;
+
+		ranges.reserve(live);
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < operations; i++)
+		{
+			if (random() % live >= ranges.size())
+			{
+				uint64_t size = 256 + random() % (64 << 10);
+				uint64_t alignment = 1ull << (random() % 9 + 4);
+				uint64_t offset = 0;
+				uint32_t handle = tlsf.Allocate(size, alignment, &offset);
+
+				if (handle == TLSF::Null)
+					failed++;
+
+				else
+					ranges.push_back({ handle, offset, size });
+			}
+
+			else
+			{
+				size_t index = random() % ranges.size();
+				tlsf.Free(ranges[index].handle);
+				ranges[index] = ranges.back();
+				ranges.pop_back();
+			}
+		}
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::printf("  %u operations in %.2f ms, %.1f ns each, %u free ranges with %zu allocations alive\n", operations, milliseconds, milliseconds * 1e6 / operations, tlsf.GetFreeRangeCount(), ranges.size());
+
+		TEST_CHECK(failed == 0);
+		TEST_CHECK(Disjoint(ranges, tlsf));
+
+		for (const Range& range : ranges)
+			tlsf.Free(range.handle);
+
+		TEST_CHECK(tlsf.IsEmpty());
+		TEST_CHECK(tlsf.GetFreeRangeCount() == 1);
+	}
+}
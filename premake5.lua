@@ -13,6 +13,7 @@ includes = {}
 includes["Engine"] = "%{wks.location}/Engine"
 includes["Editor"] = "%{wks.location}/Editor"
 includes["Game"] = "%{wks.location}/Game"
+includes["Tests"] = "%{wks.location}/Tests"
 includes["GLM"] = "%{wks.location}/Thirdparty/glm"
 includes["ImGui"] = "%{wks.location}/Thirdparty/imgui"
 includes["ImGuiExtra"] = "%{wks.location}/Thirdparty/imgui_extra"
@@ -30,12 +31,14 @@ if os.host() == "windows" then
     include "Game/Setup_Windows.lua"
     include "Editor/Setup_Windows.lua"
     include "Engine/Setup_Windows.lua"
+    include "Tests/Setup_Windows.lua"
 end
 
 if os.host() == "linux" then
     include "Game/Setup_Linux.lua"
     include "Editor/Setup_Linux.lua"
     include "Engine/Setup_Linux.lua"
+    include "Tests/Setup_Linux.lua"
 end
 
 if os.host() == "macosx" then -- not implemented